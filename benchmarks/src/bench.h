@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Minimal microbenchmark harness shared by the qwiet_bench suites.
+ *
+ * bench_run() times a batch of operations repeatedly, after untimed warmup
+ * batches, and reports the median and p99 cost per operation across the
+ * repetitions. bench_sample() is for operations timed one at a time, such
+ * as round trips and wakeups, and reports the median and p99 of the
+ * samples. bench_report() records a single measurement. Every result is
+ * printed as it completes and, with --json, written to a file at exit.
+ */
+#ifndef QWIET_BENCH_H
+#define QWIET_BENCH_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/posix/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct bench_options {
+  int warmup; /* untimed batches before bench_run() measures */
+  int reps;   /* timed batches */
+};
+
+extern struct bench_options bench_opts;
+
+/* Perform @ops operations */
+typedef void (*bench_batch_fn)(void *arg, uint64_t ops);
+
+/* Perform one operation and return its duration in ns */
+typedef int64_t (*bench_sample_fn)(void *arg);
+
+void
+bench_run(const char *name, uint64_t ops, bench_batch_fn fn, void *arg);
+
+void
+bench_sample(const char *name, uint64_t samples, bench_sample_fn fn, void *arg);
+
+void
+bench_report(const char *name, uint64_t ops, int64_t elapsed_ns);
+
+void
+bench_arena(void);
+
+void
+bench_dither(void);
+
+void
+bench_hashtable(void);
+
+void
+bench_ipc(void);
+
+void
+bench_list_ops(void);
+
+void
+bench_journal(void);
+
+void
+bench_net(void);
+
+void
+bench_ordered(void);
+
+void
+bench_raster(void);
+
+void
+bench_slab(void);
+
+void
+bench_spatial(void);
+
+void
+bench_stabilizer(void);
+
+void
+bench_stylus(void);
+
+void
+bench_task_echo(void);
+
+void
+bench_timer(void);
+
+void
+bench_trace(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+#include <qwiet/platform/common/arena.h>
+
+#include "bench.h"
+
+/*
+ * Per-frame scratch memory: each frame makes a burst of short lived
+ * allocations that all die at the end of the frame. malloc/free them one by
+ * one, against one arena reset per frame.
+ */
+
+#define ARENA_FRAMES 20000
+#define ARENA_PER_FRAME 256
+
+static void *arena_objs[ARENA_PER_FRAME];
+
+static inline size_t
+frame_size(int frame, int i)
+{
+  return 16 + ((frame * 31 + i * 17) % 496);
+}
+
+static void
+bench_frames_malloc(void)
+{
+  int64_t start = pal_uptime_ns();
+
+  for (int f = 0; f < ARENA_FRAMES; f++) {
+    for (int i = 0; i < ARENA_PER_FRAME; i++) {
+      arena_objs[i] = pal_malloc(frame_size(f, i));
+      *(volatile char *)arena_objs[i] = 0;
+    }
+    for (int i = 0; i < ARENA_PER_FRAME; i++) {
+      pal_free(arena_objs[i]);
+    }
+  }
+  bench_report("frame scratch malloc/free",
+               (uint64_t)ARENA_FRAMES * ARENA_PER_FRAME,
+               pal_uptime_ns() - start);
+}
+
+static void
+bench_frames_arena(void)
+{
+  pal_arena_t arena;
+  int64_t start;
+
+  pal_arena_init(&arena, 64 * 1024);
+  start = pal_uptime_ns();
+  for (int f = 0; f < ARENA_FRAMES; f++) {
+    pal_arena_reset(&arena);
+    for (int i = 0; i < ARENA_PER_FRAME; i++) {
+      arena_objs[i] = pal_arena_alloc(&arena, frame_size(f, i));
+      *(volatile char *)arena_objs[i] = 0;
+    }
+  }
+  bench_report("frame scratch arena",
+               (uint64_t)ARENA_FRAMES * ARENA_PER_FRAME,
+               pal_uptime_ns() - start);
+  printf("arena footprint after %d frames: %zu KiB\n",
+         ARENA_FRAMES,
+         pal_arena_footprint(&arena) >> 10);
+  pal_arena_cleanup(&arena);
+}
+
+void
+bench_arena(void)
+{
+  bench_frames_malloc();
+  bench_frames_arena();
+}
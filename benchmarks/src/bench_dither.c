@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include <qwiet/platform/common/dither.h>
+
+#include "bench.h"
+
+/*
+ * Full PineNote frames dithered per second, per method and kernel, to Y2
+ * (DU4) and Y1 (A2); then the same frames spread over a worker pool.
+ */
+
+#define DITHER_WIDTH 1872
+#define DITHER_HEIGHT 1404
+
+struct dither_case {
+  pal_dither_src_t src;
+  pal_dither_dst_t dst;
+  enum pal_dither_method method;
+#ifdef CONFIG_PAL_POSIX_POOL
+  pal_pool_t *pool;
+#endif
+};
+
+static const char *const dither_methods[] = {
+    [PAL_DITHER_FLOYD] = "floyd",
+    [PAL_DITHER_BAYER] = "bayer",
+    [PAL_DITHER_BLUE_NOISE] = "blue noise",
+};
+
+static void
+dither_frames(void *arg, uint64_t ops)
+{
+  struct dither_case *c = arg;
+
+  for (uint64_t i = 0; i < ops; i++) {
+    pal_dither(&c->src, &c->dst, c->method);
+  }
+}
+
+#ifdef CONFIG_PAL_POSIX_POOL
+static void
+dither_frames_parallel(void *arg, uint64_t ops)
+{
+  struct dither_case *c = arg;
+
+  for (uint64_t i = 0; i < ops; i++) {
+    pal_dither_parallel(c->pool, &c->src, &c->dst, c->method);
+  }
+}
+#endif
+
+/* A page: gradients, with text-like noise in bands */
+static void
+dither_page(uint8_t *buf)
+{
+  uint32_t rng = 1;
+
+  for (uint32_t y = 0; y < DITHER_HEIGHT; y++) {
+    for (uint32_t x = 0; x < DITHER_WIDTH; x++) {
+      uint8_t v = (uint8_t)((x + y) * 255 / (DITHER_WIDTH + DITHER_HEIGHT));
+      if (y / 32 % 3 == 1) {
+        rng = rng * 1103515245 + 12345;
+        v = rng >> 28 ? 240 : 16;
+      }
+      buf[(size_t)y * DITHER_WIDTH + x] = v;
+    }
+  }
+}
+
+void
+bench_dither(void)
+{
+  uint8_t *in = pal_malloc((size_t)DITHER_WIDTH * DITHER_HEIGHT);
+  uint8_t *out = pal_malloc((size_t)DITHER_WIDTH * DITHER_HEIGHT / 4);
+  struct dither_case c = {
+      .src = {in, DITHER_WIDTH, DITHER_HEIGHT, DITHER_WIDTH},
+  };
+  const enum pal_dither_depth depths[] = {PAL_DITHER_Y2, PAL_DITHER_Y1};
+  char name[64];
+
+  pal_assert(in && out, "failed to allocate frames");
+  dither_page(in);
+
+  for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+    c.dst = (pal_dither_dst_t){
+        out, (DITHER_WIDTH * depths[d] + 7) / 8, depths[d]};
+
+    c.method = PAL_DITHER_FLOYD;
+    snprintf(name, sizeof(name), "dither floyd y%d", depths[d]);
+    bench_run(name, 4, dither_frames, &c);
+
+    for (int impl = PAL_DITHER_SCALAR; impl <= PAL_DITHER_NEON; impl++) {
+      if (pal_dither_select(impl)) {
+        continue;
+      }
+      for (int m = PAL_DITHER_BAYER; m <= PAL_DITHER_BLUE_NOISE; m++) {
+        c.method = m;
+        snprintf(name,
+                 sizeof(name),
+                 "dither %s y%d (%s)",
+                 dither_methods[m],
+                 depths[d],
+                 pal_dither_impl_name(impl));
+        bench_run(name, 16, dither_frames, &c);
+      }
+    }
+  }
+
+#ifdef CONFIG_PAL_POSIX_POOL
+  pal_pool_t pool;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  /* The caller works too, so one worker fewer than CPUs */
+  pal_pool_init(&pool, cpus > 1 ? (int)cpus - 1 : 1);
+  pal_dither_select(pal_dither_selected());
+  c.pool = &pool;
+  c.dst = (pal_dither_dst_t){out, DITHER_WIDTH / 4, PAL_DITHER_Y2};
+  for (int m = PAL_DITHER_FLOYD; m <= PAL_DITHER_BLUE_NOISE; m++) {
+    c.method = m;
+    snprintf(name,
+             sizeof(name),
+             "dither %s y2 (%ld cpus)",
+             dither_methods[m],
+             cpus);
+    bench_run(name, 16, dither_frames_parallel, &c);
+  }
+  pal_pool_cleanup(&pool);
+#endif
+
+  pal_free(out);
+  pal_free(in);
+}
@@ -0,0 +1,101 @@
+#include <qwiet/platform/common/hashtable.h>
+
+#include "bench.h"
+
+/* Keyed lookups through pal_hashtable against a pal_list walk */
+
+struct bench_item {
+  uint64_t key;
+  struct pal_list_head node;
+  struct pal_hash_node hnode;
+};
+
+static volatile uint64_t bench_sink;
+
+static bool
+item_eq(const struct pal_hash_node *node, const void *key)
+{
+  return PAL_CONTAINER_OF(node, struct bench_item, hnode)->key ==
+         *(const uint64_t *)key;
+}
+
+static uint64_t
+xorshift64(uint64_t *state)
+{
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return *state = x;
+}
+
+static void
+bench_lookup_size(size_t n)
+{
+  struct bench_item *items = pal_malloc(n * sizeof(*items));
+  PAL_LIST_HEAD(list);
+  pal_hashtable_t table;
+  uint64_t rng = 0x9e3779b97f4a7c15ull, sum = 0;
+  int64_t start, t, worst = 0;
+  size_t lookups;
+  char name[64];
+
+  pal_assert(items, "failed to allocate %zu items", n);
+  for (size_t i = 0; i < n; i++) {
+    items[i].key = xorshift64(&rng);
+    pal_list_add_tail(&items[i].node, &list);
+  }
+
+  /* Inserts, including every incremental rehash step along the way */
+  pal_hashtable_init(&table, 0);
+  start = pal_uptime_ns();
+  for (size_t i = 0; i < n; i++) {
+    t = pal_uptime_ns();
+    pal_hashtable_add(&table, &items[i].hnode, pal_hash_u64(items[i].key));
+    t = pal_uptime_ns() - t;
+    worst = t > worst ? t : worst;
+  }
+  snprintf(name, sizeof(name), "hashtable insert n=%zu", n);
+  bench_report(name, n, pal_uptime_ns() - start);
+  printf("%-32s %12lld ns worst single insert\n", name, (long long)worst);
+
+  lookups = 1000000;
+  start = pal_uptime_ns();
+  for (size_t i = 0; i < lookups; i++) {
+    uint64_t key = items[xorshift64(&rng) % n].key;
+    struct pal_hash_node *node =
+        pal_hashtable_find(&table, pal_hash_u64(key), item_eq, &key);
+    sum += PAL_CONTAINER_OF(node, struct bench_item, hnode)->key;
+  }
+  snprintf(name, sizeof(name), "hashtable find n=%zu", n);
+  bench_report(name, lookups, pal_uptime_ns() - start);
+
+  /* A list walk averages n/2 steps; scale the op count to keep it short */
+  lookups = n > 1000 ? 2000 : 1000000 / n * 10;
+  start = pal_uptime_ns();
+  for (size_t i = 0; i < lookups; i++) {
+    uint64_t key = items[xorshift64(&rng) % n].key;
+    struct bench_item *pos;
+    pal_list_for_each_entry(pos, &list, node)
+    {
+      if (pos->key == key) {
+        sum += pos->key;
+        break;
+      }
+    }
+  }
+  snprintf(name, sizeof(name), "list walk find n=%zu", n);
+  bench_report(name, lookups, pal_uptime_ns() - start);
+
+  bench_sink = sum;
+  pal_hashtable_cleanup(&table);
+  pal_free(items);
+}
+
+void
+bench_hashtable(void)
+{
+  bench_lookup_size(10);
+  bench_lookup_size(1000);
+  bench_lookup_size(100000);
+}
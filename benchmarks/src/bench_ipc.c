@@ -0,0 +1,112 @@
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <qwiet/platform/linux/event.h>
+#include <qwiet/platform/posix/sem.h>
+
+#include "bench.h"
+
+/* Cross-thread wakeup round trips: semaphore and eventfd ping-pong */
+
+#define IPC_SAMPLES 20000
+
+struct ipc_pair {
+  pal_sem_t ping;
+  pal_sem_t pong;
+  int efd_ping;
+  int efd_pong;
+  bool stop;
+};
+
+static void *
+sem_ponger(void *arg)
+{
+  struct ipc_pair *p = arg;
+
+  for (;;) {
+    pal_sem_wait(&p->ping, PAL_FOREVER);
+    if (__atomic_load_n(&p->stop, __ATOMIC_ACQUIRE)) {
+      return NULL;
+    }
+    pal_sem_post(&p->pong);
+  }
+}
+
+static int64_t
+sem_round_trip(void *arg)
+{
+  struct ipc_pair *p = arg;
+  int64_t start = pal_uptime_ns();
+
+  pal_sem_post(&p->ping);
+  pal_sem_wait(&p->pong, PAL_FOREVER);
+  return pal_uptime_ns() - start;
+}
+
+static void
+event_wait(int fd)
+{
+  struct pollfd pfd = {.fd = fd, .events = POLLIN};
+  uint64_t val;
+
+  while (pal_event_read(fd, &val)) {
+    poll(&pfd, 1, -1);
+  }
+}
+
+static void *
+event_ponger(void *arg)
+{
+  struct ipc_pair *p = arg;
+
+  for (;;) {
+    event_wait(p->efd_ping);
+    if (__atomic_load_n(&p->stop, __ATOMIC_ACQUIRE)) {
+      return NULL;
+    }
+    pal_event_write(p->efd_pong, 1);
+  }
+}
+
+static int64_t
+event_round_trip(void *arg)
+{
+  struct ipc_pair *p = arg;
+  int64_t start = pal_uptime_ns();
+
+  pal_event_write(p->efd_ping, 1);
+  event_wait(p->efd_pong);
+  return pal_uptime_ns() - start;
+}
+
+void
+bench_ipc(void)
+{
+  struct ipc_pair p = {0};
+  pthread_t thread;
+
+  pal_sem_init(&p.ping, 0);
+  pal_sem_init(&p.pong, 0);
+  pthread_create(&thread, NULL, sem_ponger, &p);
+  bench_sample("sem ping-pong round trip", IPC_SAMPLES, sem_round_trip, &p);
+  __atomic_store_n(&p.stop, true, __ATOMIC_RELEASE);
+  pal_sem_post(&p.ping);
+  pthread_join(thread, NULL);
+  pal_sem_destroy(&p.ping);
+  pal_sem_destroy(&p.pong);
+
+  p.stop = false;
+  p.efd_ping = pal_event_fd();
+  p.efd_pong = pal_event_fd();
+  pthread_create(&thread, NULL, event_ponger, &p);
+  bench_sample("eventfd ping-pong round trip",
+               IPC_SAMPLES,
+               event_round_trip,
+               &p);
+  __atomic_store_n(&p.stop, true, __ATOMIC_RELEASE);
+  pal_event_write(p.efd_ping, 1);
+  pthread_join(thread, NULL);
+  close(p.efd_ping);
+  close(p.efd_pong);
+}
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include <qwiet/platform/posix/journal.h>
+
+#include "bench.h"
+
+/* Append cost with the flusher running, and the cost of a group commit */
+
+#define JOURNAL_RECORD 1024 /* about a 64 sample stroke */
+#define JOURNAL_BATCH 64
+#define JOURNAL_ROUNDS 64
+
+void
+bench_journal(void)
+{
+  /* Buffer the whole run, so no append waits on the flusher */
+  pal_journal_config_t cfg = {
+      .capacity = (size_t)JOURNAL_RECORD * 2 * JOURNAL_BATCH * JOURNAL_ROUNDS,
+      .interval = PAL_MSEC(10),
+      .buffer = (size_t)JOURNAL_RECORD * 2 * JOURNAL_BATCH * JOURNAL_ROUNDS};
+  static uint8_t record[JOURNAL_RECORD];
+  char path[] = "/tmp/qwiet_bench_journal_XXXXXX";
+  int64_t appending = 0, syncing = 0;
+  pal_journal_t journal;
+  int fd = mkstemp(path);
+
+  if (fd < 0) {
+    printf("journal: cannot create %s\n", path);
+    return;
+  }
+  close(fd);
+  unlink(path);
+  if (pal_journal_open(&journal, path, &cfg)) {
+    printf("journal: cannot open %s\n", path);
+    return;
+  }
+
+  for (int round = 0; round < JOURNAL_ROUNDS; round++) {
+    int64_t start = pal_uptime_ns();
+    for (int i = 0; i < JOURNAL_BATCH; i++) {
+      record[0] = (uint8_t)i;
+      pal_journal_append(&journal, PAL_JOURNAL_STROKE, record, sizeof(record));
+    }
+    appending += pal_uptime_ns() - start;
+  }
+  pal_journal_close(&journal);
+  unlink(path);
+
+  /* Same again with nobody flushing, each batch synced by hand */
+  cfg.interval = PAL_FOREVER;
+  if (pal_journal_open(&journal, path, &cfg)) {
+    printf("journal: cannot open %s\n", path);
+    return;
+  }
+  for (int round = 0; round < JOURNAL_ROUNDS; round++) {
+    int64_t start;
+    for (int i = 0; i < JOURNAL_BATCH; i++) {
+      pal_journal_append(&journal, PAL_JOURNAL_STROKE, record, sizeof(record));
+    }
+    start = pal_uptime_ns();
+    pal_journal_sync(&journal);
+    syncing += pal_uptime_ns() - start;
+  }
+  pal_journal_close(&journal);
+  unlink(path);
+
+  bench_report("journal append, 1 KiB",
+               (uint64_t)JOURNAL_BATCH * JOURNAL_ROUNDS,
+               appending);
+  bench_report("journal sync, 64 KiB batch", JOURNAL_ROUNDS, syncing);
+}
@@ -0,0 +1,69 @@
+#include <qwiet/platform/common/list.h>
+
+#include "bench.h"
+
+/* pal_list primitives on a list of LIST_NODES entries */
+
+#define LIST_NODES 1024
+
+struct list_item {
+  struct pal_list_head node;
+  uint64_t value;
+};
+
+static struct list_item list_items[LIST_NODES];
+static volatile uint64_t list_sink;
+
+static void
+list_add_del(void *arg, uint64_t ops)
+{
+  struct pal_list_head *head = arg;
+
+  for (uint64_t i = 0; i < ops; i++) {
+    struct list_item *it = &list_items[i % LIST_NODES];
+    pal_list_del(&it->node);
+    pal_list_add_tail(&it->node, head);
+  }
+}
+
+static void
+list_walk(void *arg, uint64_t ops)
+{
+  struct pal_list_head *head = arg;
+  struct list_item *it;
+  uint64_t sum = 0;
+
+  for (uint64_t i = 0; i < ops; i += LIST_NODES) {
+    pal_list_for_each_entry(it, head, node)
+    {
+      sum += it->value;
+    }
+  }
+  list_sink = sum;
+}
+
+static void
+list_splice(void *arg, uint64_t ops)
+{
+  struct pal_list_head *head = arg;
+  PAL_LIST_HEAD(other);
+
+  for (uint64_t i = 0; i < ops; i++) {
+    pal_list_splice_tail_init(head, &other);
+    pal_list_splice_tail_init(&other, head);
+  }
+}
+
+void
+bench_list_ops(void)
+{
+  PAL_LIST_HEAD(head);
+
+  for (int i = 0; i < LIST_NODES; i++) {
+    list_items[i].value = i;
+    pal_list_add_tail(&list_items[i].node, &head);
+  }
+  bench_run("list del+add_tail", 1000000, list_add_del, &head);
+  bench_run("list walk per node", 1024 * LIST_NODES, list_walk, &head);
+  bench_run("list splice+splice back", 1000000, list_splice, &head);
+}
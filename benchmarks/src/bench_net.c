@@ -0,0 +1,59 @@
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <qwiet/platform/posix/net.h>
+
+#include "bench.h"
+
+/* Loopback TCP throughput through pal_net_send/pal_net_recv */
+
+#define NET_MSG 4096
+
+struct net_pair {
+  int client;
+  int server;
+  uint8_t buf[NET_MSG];
+};
+
+static void
+net_echo_batch(void *arg, uint64_t ops)
+{
+  struct net_pair *p = arg;
+
+  for (uint64_t i = 0; i < ops; i++) {
+    int sent = pal_net_send(p->client, p->buf, NET_MSG, 0);
+    int got = 0;
+    pal_assert(sent == NET_MSG, "short send %d", sent);
+    while (got < NET_MSG) {
+      int n = pal_net_recv(p->server, p->buf + got, NET_MSG - got, 0);
+      pal_assert(n > 0, "recv failed %d", n);
+      got += n;
+    }
+  }
+}
+
+void
+bench_net(void)
+{
+  static struct net_pair p;
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  int listener = pal_net_socket_tcp(false);
+
+  /* Port 0 picks a free port; read back which */
+  pal_assert(pal_net_listen(listener, 0, 1) == 0, "listen failed");
+  getsockname(listener, (struct sockaddr *)&addr, &len);
+
+  p.client = pal_net_socket_tcp(false);
+  pal_assert(pal_net_connect(p.client, "127.0.0.1", ntohs(addr.sin_port)) ==
+                 1,
+             "loopback connect failed");
+  p.server = accept(listener, NULL, NULL);
+  pal_assert(p.server >= 0, "accept failed");
+  pal_net_close(listener);
+
+  bench_run("net loopback 4KiB send+recv", 20000, net_echo_batch, &p);
+
+  pal_net_close(p.client);
+  pal_net_close(p.server);
+}
@@ -0,0 +1,146 @@
+#include <qwiet/platform/common/heap.h>
+#include <qwiet/platform/common/list.h>
+#include <qwiet/platform/common/rbtree.h>
+
+#include "bench.h"
+
+/* Insert then pop-min of random keys: sorted pal_list, pal_rb, pal_heap */
+
+struct bench_item {
+  uint64_t key;
+  struct pal_list_head lnode;
+  struct pal_rb_node rbnode;
+  struct pal_heap_node hnode;
+};
+
+static volatile uint64_t bench_sink;
+
+static bool
+rb_item_less(struct pal_rb_node *a, const struct pal_rb_node *b)
+{
+  return pal_rb_entry(a, struct bench_item, rbnode)->key <
+         pal_rb_entry(b, struct bench_item, rbnode)->key;
+}
+
+static bool
+heap_item_less(const struct pal_heap_node *a, const struct pal_heap_node *b)
+{
+  return PAL_CONTAINER_OF(a, struct bench_item, hnode)->key <
+         PAL_CONTAINER_OF(b, struct bench_item, hnode)->key;
+}
+
+static void
+bench_list(struct bench_item *items, size_t n)
+{
+  PAL_LIST_HEAD(list);
+  uint64_t sum = 0;
+  int64_t start;
+  char name[64];
+
+  start = pal_uptime_ns();
+  for (size_t i = 0; i < n; i++) {
+    struct pal_list_head *pos;
+    pal_list_for_each_prev(pos, &list)
+    {
+      if (pal_list_entry(pos, struct bench_item, lnode)->key <= items[i].key) {
+        break;
+      }
+    }
+    pal_list_add(&items[i].lnode, pos);
+  }
+  snprintf(name, sizeof(name), "sorted list insert n=%zu", n);
+  bench_report(name, n, pal_uptime_ns() - start);
+
+  start = pal_uptime_ns();
+  while (!pal_list_empty(&list)) {
+    struct bench_item *item =
+        pal_list_first_entry(&list, struct bench_item, lnode);
+    pal_list_del(&item->lnode);
+    sum += item->key;
+  }
+  snprintf(name, sizeof(name), "sorted list pop n=%zu", n);
+  bench_report(name, n, pal_uptime_ns() - start);
+  bench_sink = sum;
+}
+
+static void
+bench_rbtree(struct bench_item *items, size_t n)
+{
+  struct pal_rb_root_cached tree = PAL_RB_ROOT_CACHED;
+  struct pal_rb_node *first;
+  uint64_t sum = 0;
+  int64_t start;
+  char name[64];
+
+  start = pal_uptime_ns();
+  for (size_t i = 0; i < n; i++) {
+    pal_rb_add_cached(&items[i].rbnode, &tree, rb_item_less);
+  }
+  snprintf(name, sizeof(name), "rbtree insert n=%zu", n);
+  bench_report(name, n, pal_uptime_ns() - start);
+
+  start = pal_uptime_ns();
+  while ((first = pal_rb_first_cached(&tree))) {
+    pal_rb_erase_cached(first, &tree);
+    sum += pal_rb_entry(first, struct bench_item, rbnode)->key;
+  }
+  snprintf(name, sizeof(name), "rbtree pop n=%zu", n);
+  bench_report(name, n, pal_uptime_ns() - start);
+  bench_sink = sum;
+}
+
+static void
+bench_heap(struct bench_item *items, size_t n)
+{
+  struct pal_heap_node *node;
+  pal_heap_t heap;
+  uint64_t sum = 0;
+  int64_t start;
+  char name[64];
+
+  pal_heap_init(&heap, heap_item_less, n);
+  start = pal_uptime_ns();
+  for (size_t i = 0; i < n; i++) {
+    pal_heap_push(&heap, &items[i].hnode);
+  }
+  snprintf(name, sizeof(name), "heap insert n=%zu", n);
+  bench_report(name, n, pal_uptime_ns() - start);
+
+  start = pal_uptime_ns();
+  while ((node = pal_heap_pop(&heap))) {
+    sum += PAL_CONTAINER_OF(node, struct bench_item, hnode)->key;
+  }
+  snprintf(name, sizeof(name), "heap pop n=%zu", n);
+  bench_report(name, n, pal_uptime_ns() - start);
+  bench_sink = sum;
+  pal_heap_cleanup(&heap);
+}
+
+static void
+bench_ordered_size(size_t n)
+{
+  struct bench_item *items = pal_malloc(n * sizeof(*items));
+  uint64_t x = 0x2545f4914f6cdd1dull;
+
+  pal_assert(items, "failed to allocate %zu items", n);
+  for (size_t i = 0; i < n; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    items[i].key = x;
+  }
+
+  bench_list(items, n);
+  bench_rbtree(items, n);
+  bench_heap(items, n);
+  pal_free(items);
+}
+
+void
+bench_ordered(void)
+{
+  /* Sorted list insertion is quadratic; 10k already takes seconds */
+  bench_ordered_size(100);
+  bench_ordered_size(1000);
+  bench_ordered_size(10000);
+}
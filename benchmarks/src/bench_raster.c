@@ -0,0 +1,80 @@
+#include <stdio.h>
+
+#include <qwiet/platform/common/raster.h>
+
+#include "bench.h"
+
+/*
+ * Stroke segments per second on a full PineNote frame, per coverage
+ * kernel. Segments are what a 200 Hz pen report loop produces: a few
+ * pixels long, pressure varying, at 6 px nominal width.
+ */
+
+#define RASTER_WIDTH 1872
+#define RASTER_HEIGHT 1404
+#define RASTER_POINTS 4096
+
+static pal_raster_point_t raster_points[RASTER_POINTS];
+static const pal_raster_pen_t raster_pen = {
+    .min_width = 1.0f, .max_width = 11.0f, .ink = 0};
+
+static void
+raster_stroke(void)
+{
+  float x = 200.0f, y = 200.0f;
+
+  /* A pseudo-random walk, deterministic across runs */
+  for (int i = 0; i < RASTER_POINTS; i++) {
+    uint32_t r = (uint32_t)i * 2654435761U;
+    x += (float)((r >> 8) % 9) - 4.0f + 1.5f;
+    y += (float)((r >> 16) % 9) - 4.0f;
+    if (x > RASTER_WIDTH - 200) {
+      x = 200.0f;
+      y += 40.0f;
+    }
+    if (y < 100 || y > RASTER_HEIGHT - 100) {
+      y = RASTER_HEIGHT / 2;
+    }
+    raster_points[i] = (pal_raster_point_t){
+        .x = x, .y = y, .pressure = (float)(i % 100) / 100.0f};
+  }
+}
+
+static void
+raster_segments(void *arg, uint64_t ops)
+{
+  const pal_raster_fb_t *fb = arg;
+
+  for (uint64_t i = 0; i < ops; i++) {
+    size_t n = i % (RASTER_POINTS - 1);
+    pal_raster_segment(
+        fb, &raster_pen, raster_points[n], raster_points[n + 1]);
+  }
+}
+
+void
+bench_raster(void)
+{
+  uint32_t pitch = (RASTER_WIDTH + 1) / 2;
+  pal_raster_fb_t fb = {.width = RASTER_WIDTH,
+                        .height = RASTER_HEIGHT,
+                        .pitch = pitch};
+  char name[64];
+
+  fb.buf = pal_malloc((size_t)pitch * RASTER_HEIGHT);
+  pal_assert(fb.buf, "failed to allocate framebuffer");
+  pal_raster_fill(&fb, 15);
+  raster_stroke();
+
+  for (int impl = PAL_RASTER_SCALAR; impl <= PAL_RASTER_NEON; impl++) {
+    if (pal_raster_select(impl)) {
+      continue;
+    }
+    snprintf(name,
+             sizeof(name),
+             "raster segment (%s)",
+             pal_raster_impl_name(impl));
+    bench_run(name, 200000, raster_segments, &fb);
+  }
+  pal_free(fb.buf);
+}
@@ -0,0 +1,101 @@
+#include <qwiet/platform/posix/slab.h>
+
+#include "bench.h"
+
+/* pal_pool_alloc against libc malloc, plus fragmentation after churn */
+
+#define SLAB_BATCH 10000
+#define SLAB_LIVE 50000
+#define SLAB_CHURN 2000000
+
+static void *slab_objs[SLAB_LIVE];
+
+static uint32_t
+slab_rand(uint32_t *state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+static void
+bench_pairs(const char *name, void *(*alloc)(size_t), void (*release)(void *))
+{
+  int64_t start = pal_uptime_ns();
+
+  for (int i = 0; i < SLAB_CHURN; i++) {
+    void *p = alloc(64);
+    *(volatile char *)p = 0;
+    release(p);
+  }
+  bench_report(name, SLAB_CHURN, pal_uptime_ns() - start);
+}
+
+static void
+bench_batch(const char *name, void *(*alloc)(size_t), void (*release)(void *))
+{
+  uint32_t rng = 7;
+  int64_t start = pal_uptime_ns();
+
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < SLAB_BATCH; i++) {
+      slab_objs[i] = alloc(16 + slab_rand(&rng) % 512);
+      *(volatile char *)slab_objs[i] = 0;
+    }
+    /* Free in a scrambled order to defeat LIFO reuse */
+    for (int i = 0; i < SLAB_BATCH; i++) {
+      release(slab_objs[(i * 7919) % SLAB_BATCH]);
+    }
+  }
+  bench_report(name, 20 * SLAB_BATCH, pal_uptime_ns() - start);
+}
+
+/*
+ * Long-uptime stand-in: keep a live set of mixed sizes, replace random
+ * members for a while, then drop most of it and report what the arena
+ * still holds.
+ */
+static void
+bench_churn(void)
+{
+  uint32_t rng = 11;
+  int64_t start;
+
+  for (int i = 0; i < SLAB_LIVE; i++) {
+    slab_objs[i] = pal_pool_alloc(16 + slab_rand(&rng) % 1024);
+  }
+  start = pal_uptime_ns();
+  for (int i = 0; i < SLAB_CHURN; i++) {
+    uint32_t victim = slab_rand(&rng) % SLAB_LIVE;
+    pal_pool_free(slab_objs[victim]);
+    slab_objs[victim] = pal_pool_alloc(16 + slab_rand(&rng) % 1024);
+  }
+  bench_report("slab churn replace", SLAB_CHURN, pal_uptime_ns() - start);
+
+  printf("after churn, %d live objects:\n", SLAB_LIVE);
+  pal_pool_stats_print(stdout);
+
+  for (int i = 0; i < SLAB_LIVE; i++) {
+    if (i % 10) {
+      pal_pool_free(slab_objs[i]);
+      slab_objs[i] = NULL;
+    }
+  }
+  printf("after freeing 90%%:\n");
+  pal_pool_stats_print(stdout);
+
+  for (int i = 0; i < SLAB_LIVE; i += 10) {
+    pal_pool_free(slab_objs[i]);
+  }
+}
+
+void
+bench_slab(void)
+{
+  bench_pairs("malloc 64B alloc/free", malloc, free);
+  bench_pairs("slab 64B alloc/free", pal_pool_alloc, pal_pool_free);
+  bench_batch("malloc mixed batch", malloc, free);
+  bench_batch("slab mixed batch", pal_pool_alloc, pal_pool_free);
+  bench_churn();
+}
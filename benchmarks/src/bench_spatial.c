@@ -0,0 +1,182 @@
+#include <stdio.h>
+
+#include <qwiet/platform/common/spatial.h>
+
+#include "bench.h"
+
+/*
+ * Eraser hit tests and region queries on pages of 1k, 10k and 100k
+ * strokes, against a scan of every segment. Strokes are handwriting sized:
+ * 16 segments of a few pixels, scattered over a PineNote page.
+ */
+
+#define SPATIAL_WIDTH 1872
+#define SPATIAL_HEIGHT 1404
+#define SPATIAL_SEGMENTS 16
+#define SPATIAL_QUERIES 1024
+#define SPATIAL_ERASER 8.0f
+
+struct spatial_bench {
+  pal_spatial_t index;
+  pal_raster_point_t *points; /* SPATIAL_SEGMENTS + 1 per stroke */
+  uint32_t strokes;
+  float queries[SPATIAL_QUERIES][2];
+};
+
+static volatile size_t spatial_sink;
+
+static const pal_raster_pen_t spatial_pen = {
+    .min_width = 1.0f, .max_width = 5.0f, .ink = 0};
+
+static uint32_t
+spatial_rand(uint32_t *state)
+{
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 8;
+}
+
+static void
+spatial_strokes(struct spatial_bench *b)
+{
+  uint32_t state = 1;
+
+  for (uint32_t s = 0; s < b->strokes; s++) {
+    pal_raster_point_t *p = &b->points[s * (SPATIAL_SEGMENTS + 1)];
+    float x = (float)(spatial_rand(&state) % (SPATIAL_WIDTH - 100) + 50);
+    float y = (float)(spatial_rand(&state) % (SPATIAL_HEIGHT - 100) + 50);
+
+    for (int k = 0; k <= SPATIAL_SEGMENTS; k++) {
+      p[k] = (pal_raster_point_t){.x = x, .y = y, .pressure = 0.5f};
+      x += (float)(spatial_rand(&state) % 7) - 2.0f;
+      y += (float)(spatial_rand(&state) % 7) - 3.0f;
+    }
+  }
+  for (int q = 0; q < SPATIAL_QUERIES; q++) {
+    b->queries[q][0] = (float)(spatial_rand(&state) % SPATIAL_WIDTH);
+    b->queries[q][1] = (float)(spatial_rand(&state) % SPATIAL_HEIGHT);
+  }
+}
+
+static int
+spatial_count(void *ctx, uint32_t id)
+{
+  (void)id;
+  (*(size_t *)ctx)++;
+  return 0;
+}
+
+static void
+spatial_eraser(void *arg, uint64_t ops)
+{
+  struct spatial_bench *b = arg;
+  size_t hits = 0;
+
+  for (uint64_t i = 0; i < ops; i++) {
+    const float *q = b->queries[i % SPATIAL_QUERIES];
+    pal_spatial_query_circle(
+        &b->index, q[0], q[1], SPATIAL_ERASER, spatial_count, &hits);
+  }
+  spatial_sink = hits;
+}
+
+static void
+spatial_region(void *arg, uint64_t ops)
+{
+  struct spatial_bench *b = arg;
+  size_t hits = 0;
+
+  for (uint64_t i = 0; i < ops; i++) {
+    const float *q = b->queries[i % SPATIAL_QUERIES];
+    pal_rect_t rect = PAL_RECT(
+        (int32_t)q[0], (int32_t)q[1], (int32_t)q[0] + 256, (int32_t)q[1] + 256);
+    pal_spatial_query_rect(&b->index, rect, spatial_count, &hits);
+  }
+  spatial_sink = hits;
+}
+
+/* The same hit test as the index, over every segment of every stroke */
+static void
+spatial_scan(void *arg, uint64_t ops)
+{
+  struct spatial_bench *b = arg;
+  float r = (spatial_pen.min_width + spatial_pen.max_width) * 0.25f;
+  float reach = (SPATIAL_ERASER + r) * (SPATIAL_ERASER + r);
+  size_t hits = 0;
+
+  for (uint64_t i = 0; i < ops; i++) {
+    const float *q = b->queries[i % SPATIAL_QUERIES];
+    for (uint32_t s = 0; s < b->strokes; s++) {
+      const pal_raster_point_t *p = &b->points[s * (SPATIAL_SEGMENTS + 1)];
+      for (int k = 0; k < SPATIAL_SEGMENTS; k++) {
+        float dx = p[k + 1].x - p[k].x, dy = p[k + 1].y - p[k].y;
+        float px = q[0] - p[k].x, py = q[1] - p[k].y;
+        float len2 = dx * dx + dy * dy;
+        float t = len2 > 0.0f ? (px * dx + py * dy) / len2 : 0.0f;
+        t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+        px -= t * dx;
+        py -= t * dy;
+        if (px * px + py * py <= reach) {
+          hits++;
+          break;
+        }
+      }
+    }
+  }
+  spatial_sink = hits;
+}
+
+static void
+spatial_page(uint32_t strokes)
+{
+  struct spatial_bench *b = pal_malloc(sizeof(*b));
+  char name[64];
+  int64_t start;
+
+  pal_assert(b, "failed to allocate benchmark");
+  b->strokes = strokes;
+  b->points = pal_malloc((size_t)strokes * (SPATIAL_SEGMENTS + 1) *
+                         sizeof(*b->points));
+  pal_assert(b->points, "failed to allocate strokes");
+  spatial_strokes(b);
+  pal_spatial_init(
+      &b->index, SPATIAL_WIDTH, SPATIAL_HEIGHT, PAL_SPATIAL_CELL_SHIFT);
+
+  start = pal_uptime_ns();
+  for (uint32_t s = 0; s < strokes; s++) {
+    const pal_raster_point_t *p = &b->points[s * (SPATIAL_SEGMENTS + 1)];
+    for (int k = 0; k < SPATIAL_SEGMENTS; k++) {
+      pal_spatial_add(&b->index, s, &spatial_pen, p[k], p[k + 1]);
+    }
+  }
+  snprintf(name, sizeof(name), "spatial add segment, %u strokes", strokes);
+  bench_report(
+      name, (uint64_t)strokes * SPATIAL_SEGMENTS, pal_uptime_ns() - start);
+
+  snprintf(name, sizeof(name), "spatial eraser, %u strokes", strokes);
+  bench_run(name, 10000, spatial_eraser, b);
+  snprintf(name, sizeof(name), "spatial rect 256px, %u strokes", strokes);
+  bench_run(name, 1000, spatial_region, b);
+  snprintf(name, sizeof(name), "linear scan eraser, %u strokes", strokes);
+  bench_run(name, 20000000 / ((uint64_t)strokes * SPATIAL_SEGMENTS) + 1,
+            spatial_scan,
+            b);
+
+  start = pal_uptime_ns();
+  for (uint32_t s = 0; s < strokes; s++) {
+    pal_spatial_remove(&b->index, s);
+  }
+  snprintf(name, sizeof(name), "spatial remove stroke, %u strokes", strokes);
+  bench_report(name, strokes, pal_uptime_ns() - start);
+
+  pal_spatial_cleanup(&b->index);
+  pal_free(b->points);
+  pal_free(b);
+}
+
+void
+bench_spatial(void)
+{
+  spatial_page(1000);
+  spatial_page(10000);
+  spatial_page(100000);
+}
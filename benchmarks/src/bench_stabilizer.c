@@ -0,0 +1,60 @@
+#include <stdio.h>
+
+#include <qwiet/platform/linux/input/stabilizer.h>
+
+#include "bench.h"
+
+/* Cost per sample of each smoothing method, with a prediction per sample */
+
+#define STABILIZER_SAMPLES 1024
+
+static pal_stylus_sample_t stabilizer_samples[STABILIZER_SAMPLES];
+static volatile int32_t stabilizer_sink;
+
+static void
+stabilizer_stroke(void)
+{
+  for (int i = 0; i < STABILIZER_SAMPLES; i++) {
+    uint32_t r = (uint32_t)i * 2654435761U;
+    stabilizer_samples[i] = (pal_stylus_sample_t){
+        .time_ns = (int64_t)i * 5000000,
+        .x = 10000 + i * 40 + (int32_t)(r >> 28),
+        .y = 20000 + (i % 64) * 30 + (int32_t)((r >> 24) & 0xf),
+        .pressure = 1000,
+        .touching = 1,
+        .in_range = 1};
+  }
+}
+
+static void
+stabilizer_run(void *arg, uint64_t ops)
+{
+  pal_stabilizer_t *st = arg;
+  pal_stylus_sample_t out, ahead;
+  int32_t sum = 0;
+
+  for (uint64_t i = 0; i < ops; i++) {
+    pal_stabilizer_feed(st, &stabilizer_samples[i % STABILIZER_SAMPLES], &out);
+    if (pal_stabilizer_predict(st, PAL_MSEC(8), &ahead)) {
+      sum += ahead.x;
+    }
+  }
+  stabilizer_sink = sum;
+}
+
+void
+bench_stabilizer(void)
+{
+  static const char *const names[] = {"none", "average", "euro", "kalman"};
+  pal_stabilizer_config_t cfg = PAL_STABILIZER_CONFIG_DEFAULT;
+  pal_stabilizer_t st;
+  char name[64];
+
+  stabilizer_stroke();
+  for (int m = PAL_STABILIZER_NONE; m <= PAL_STABILIZER_KALMAN; m++) {
+    cfg.method = m;
+    pal_stabilizer_init(&st, &cfg);
+    snprintf(name, sizeof(name), "stabilizer sample (%s)", names[m]);
+    bench_run(name, 1000000, stabilizer_run, &st);
+  }
+}
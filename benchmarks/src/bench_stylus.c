@@ -0,0 +1,60 @@
+#include <qwiet/platform/linux/input/stylus.h>
+
+#include "bench.h"
+
+/* Event parse rate of the stylus assembler on a synthetic pen stroke */
+
+#define STYLUS_REPORTS 1024
+#define STYLUS_EVENTS_PER_REPORT 6
+
+static struct input_event stylus_events[STYLUS_REPORTS *
+                                        STYLUS_EVENTS_PER_REPORT];
+static volatile int32_t stylus_sink;
+
+static void
+stylus_stroke(void)
+{
+  struct input_event *ev = stylus_events;
+
+  for (int i = 0; i < STYLUS_REPORTS; i++) {
+    const struct input_event report[STYLUS_EVENTS_PER_REPORT] = {
+        {.type = EV_ABS, .code = ABS_X, .value = 1000 + i * 3},
+        {.type = EV_ABS, .code = ABS_Y, .value = 2000 + i * 2},
+        {.type = EV_ABS, .code = ABS_PRESSURE, .value = 400 + i % 200},
+        {.type = EV_ABS, .code = ABS_TILT_X, .value = i % 60 - 30},
+        {.type = EV_ABS, .code = ABS_TILT_Y, .value = 30 - i % 60},
+        {.type = EV_SYN, .code = SYN_REPORT},
+    };
+    for (int e = 0; e < STYLUS_EVENTS_PER_REPORT; e++) {
+      *ev = report[e];
+      ev->time.tv_usec = i * 2000; /* 500 Hz pen */
+      ev++;
+    }
+  }
+}
+
+static void
+stylus_parse(void *arg, uint64_t ops)
+{
+  pal_stylus_t *pen = arg;
+  pal_stylus_sample_t sample;
+  const size_t n = sizeof(stylus_events) / sizeof(stylus_events[0]);
+  int32_t sum = 0;
+
+  for (uint64_t i = 0; i < ops; i++) {
+    if (pal_stylus_feed(pen, &stylus_events[i % n], &sample)) {
+      sum += sample.pressure;
+    }
+  }
+  stylus_sink = sum;
+}
+
+void
+bench_stylus(void)
+{
+  pal_stylus_t pen;
+
+  stylus_stroke();
+  pal_stylus_init(&pen);
+  bench_run("stylus parse per evdev event", 6000000, stylus_parse, &pen);
+}
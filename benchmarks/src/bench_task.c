@@ -0,0 +1,130 @@
+#include <errno.h>
+#include <sys/resource.h>
+
+#include <qwiet/platform/linux/task.h>
+#include <qwiet/platform/posix/net.h>
+
+#include "bench.h"
+
+/* 10k concurrent client/server task pairs echoing over loopback sockets */
+#define ECHO_PAIRS 10000
+#define ECHO_ROUNDS 16
+#define ECHO_MSG 64
+
+struct echo_client {
+  struct pal_task task;
+  int sock;
+  uint16_t round;
+  uint16_t off;
+  uint8_t buf[ECHO_MSG];
+};
+
+struct echo_server {
+  struct pal_task task;
+  int sock;
+  uint8_t buf[ECHO_MSG];
+};
+
+static const uint8_t echo_msg[ECHO_MSG] = "qwiet echo benchmark";
+
+static int
+echo_client_run(struct pal_task *task)
+{
+  struct echo_client *c = PAL_CONTAINER_OF(task, struct echo_client, task);
+  int n;
+
+  PAL_TASK_BEGIN(task);
+  for (c->round = 0; c->round < ECHO_ROUNDS; c->round++) {
+    while (pal_net_send(c->sock, echo_msg, ECHO_MSG, 0) != ECHO_MSG) {
+      PAL_TASK_AWAIT_FD(task, c->sock, POLLOUT, PAL_FOREVER);
+    }
+    for (c->off = 0; c->off < ECHO_MSG;) {
+      PAL_TASK_AWAIT_FD(task, c->sock, POLLIN, PAL_FOREVER);
+      n = pal_net_recv(c->sock, c->buf + c->off, ECHO_MSG - c->off, 0);
+      if (n > 0) {
+        c->off += n;
+      } else if (n == 0 || errno != EAGAIN) {
+        c->round = ECHO_ROUNDS; /* server went away */
+        break;
+      }
+    }
+  }
+  pal_net_close(c->sock);
+  PAL_TASK_END(task);
+}
+
+static int
+echo_server_run(struct pal_task *task)
+{
+  struct echo_server *s = PAL_CONTAINER_OF(task, struct echo_server, task);
+  int n;
+
+  PAL_TASK_BEGIN(task);
+  for (;;) {
+    PAL_TASK_AWAIT_FD(task, s->sock, POLLIN, PAL_FOREVER);
+    n = pal_net_recv(s->sock, s->buf, sizeof(s->buf), 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN)) {
+      break; /* client hung up */
+    } else if (n > 0) {
+      pal_net_send(s->sock, s->buf, (uint16_t)n, 0);
+    }
+  }
+  pal_net_close(s->sock);
+  PAL_TASK_END(task);
+}
+
+static int
+echo_max_pairs(void)
+{
+  struct rlimit rl;
+
+  /* Each pair needs two fds; raise the soft limit as far as allowed */
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    getrlimit(RLIMIT_NOFILE, &rl);
+    if (rl.rlim_cur != RLIM_INFINITY && (rl.rlim_cur - 64) / 2 < ECHO_PAIRS) {
+      return (int)((rl.rlim_cur - 64) / 2);
+    }
+  }
+  return ECHO_PAIRS;
+}
+
+void
+bench_task_echo(void)
+{
+  int pairs = echo_max_pairs();
+  struct echo_client *clients = pal_malloc(sizeof(*clients) * pairs);
+  struct echo_server *servers = pal_malloc(sizeof(*servers) * pairs);
+  pal_executor_t exec;
+  int64_t start;
+
+  pal_assert(clients && servers, "failed to allocate %d echo pairs", pairs);
+  if (pairs < ECHO_PAIRS) {
+    printf("task_echo: fd limit allows only %d pairs\n", pairs);
+  }
+  printf("task_echo: %d tasks, %zu bytes per client, %zu per server\n",
+         pairs * 2,
+         sizeof(struct echo_client),
+         sizeof(struct echo_server));
+
+  pal_executor_init(&exec);
+  for (int i = 0; i < pairs; i++) {
+    int sv[2];
+    pal_net_socketpair(true, sv);
+    clients[i].sock = sv[0];
+    servers[i].sock = sv[1];
+    pal_task_spawn(&exec, &servers[i].task, echo_server_run);
+    pal_task_spawn(&exec, &clients[i].task, echo_client_run);
+  }
+
+  start = pal_uptime_ns();
+  pal_executor_run(&exec);
+  bench_report("task_echo round trip",
+               (uint64_t)pairs * ECHO_ROUNDS,
+               pal_uptime_ns() - start);
+
+  pal_executor_cleanup(&exec);
+  pal_free(servers);
+  pal_free(clients);
+}
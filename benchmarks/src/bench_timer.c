@@ -0,0 +1,30 @@
+#include <qwiet/platform/linux/timer.h>
+
+#include "bench.h"
+
+/* How late timerfd wakeups land past their deadline */
+
+#define TIMER_SAMPLES 500
+
+static int64_t
+timer_lateness(void *arg)
+{
+  pal_timer_t *timer = arg;
+  int64_t due = pal_uptime_ns() + 1000000;
+
+  pal_timer_start_oneshot(timer, PAL_MSEC(1));
+  pal_timer_wait_ready(timer, PAL_FOREVER);
+  pal_timer_read(timer);
+  return pal_uptime_ns() - due;
+}
+
+void
+bench_timer(void)
+{
+  pal_timer_t timer;
+
+  pal_timer_init(&timer);
+  bench_sample(
+      "timerfd 1ms oneshot lateness", TIMER_SAMPLES, timer_lateness, &timer);
+  pal_timer_cleanup(&timer);
+}
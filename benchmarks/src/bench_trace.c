@@ -0,0 +1,62 @@
+#include <unistd.h>
+
+#include <qwiet/platform/posix/trace.h>
+
+#include "bench.h"
+
+/* Cost of a trace record, outside a session and inside one */
+
+#define TRACE_PAIRS (CONFIG_PAL_TRACE_RING_RECORDS / 4)
+#define TRACE_ROUNDS 20
+
+static void
+bench_trace_idle(void)
+{
+  int64_t start = pal_uptime_ns();
+
+  for (int i = 0; i < TRACE_PAIRS * TRACE_ROUNDS; i++) {
+    PAL_TRACE_BEGIN("bench");
+    PAL_TRACE_END("bench");
+  }
+  bench_report("trace record, no session",
+               2ULL * TRACE_PAIRS * TRACE_ROUNDS,
+               pal_uptime_ns() - start);
+}
+
+static void
+bench_trace_session(void)
+{
+  char path[] = "/tmp/qwiet_bench_trace_XXXXXX";
+  int64_t elapsed = 0;
+  int fd = mkstemp(path);
+
+  if (fd < 0 || pal_trace_start(path)) {
+    printf("trace: cannot create %s\n", path);
+    return;
+  }
+  close(fd);
+
+  /* Half a ring per round, then let the flusher catch up, so the
+   * measurement never hits the dropping path */
+  for (int round = 0; round < TRACE_ROUNDS; round++) {
+    int64_t start = pal_uptime_ns();
+    for (int i = 0; i < TRACE_PAIRS; i++) {
+      PAL_TRACE_BEGIN("bench");
+      PAL_TRACE_END("bench");
+    }
+    elapsed += pal_uptime_ns() - start;
+    usleep(60 * 1000);
+  }
+  pal_trace_stop();
+  unlink(path);
+
+  bench_report(
+      "trace record, in session", 2ULL * TRACE_PAIRS * TRACE_ROUNDS, elapsed);
+}
+
+void
+bench_trace(void)
+{
+  bench_trace_idle();
+  bench_trace_session();
+}
@@ -0,0 +1,302 @@
+#define _GNU_SOURCE /* sched_setaffinity */
+#include <sched.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <qwiet/platform/common/histogram.h>
+
+#include "bench.h"
+
+#define BENCH_RESULTS_MAX 256
+
+struct bench {
+  const char *name;
+  void (*run)(void);
+};
+
+struct bench_result {
+  char name[64];
+  const char *kind; /* "batch", "sample" or "single" */
+  uint64_t ops;     /* per repetition, or samples */
+  int reps;
+  double median_ns;
+  double p99_ns;
+  double min_ns;
+  double max_ns;
+};
+
+static const struct bench benches[] = {
+    {"arena", bench_arena},
+    {"dither", bench_dither},
+    {"hashtable", bench_hashtable},
+#if defined(CONFIG_PAL_POSIX_SEM) && defined(CONFIG_PAL_LINUX_EVENT)
+    {"ipc", bench_ipc},
+#endif
+#ifdef CONFIG_PAL_POSIX_JOURNAL
+    {"journal", bench_journal},
+#endif
+    {"list", bench_list_ops},
+#ifdef CONFIG_PAL_POSIX_NET
+    {"net", bench_net},
+#endif
+    {"ordered", bench_ordered},
+    {"raster", bench_raster},
+#ifdef CONFIG_PAL_POSIX_SLAB
+    {"slab", bench_slab},
+#endif
+    {"spatial", bench_spatial},
+#ifdef CONFIG_PAL_LINUX_STABILIZER
+    {"stabilizer", bench_stabilizer},
+#endif
+#ifdef CONFIG_PAL_LINUX_STYLUS
+    {"stylus", bench_stylus},
+#endif
+#if defined(CONFIG_PAL_LINUX_TASK) && defined(CONFIG_PAL_POSIX_NET)
+    {"task_echo", bench_task_echo},
+#endif
+#ifdef CONFIG_PAL_LINUX_TIMER
+    {"timer", bench_timer},
+#endif
+#ifdef CONFIG_PAL_TRACE
+    {"trace", bench_trace},
+#endif
+    {NULL, NULL},
+};
+
+struct bench_options bench_opts = {.warmup = 3, .reps = 15};
+
+static struct bench_result results[BENCH_RESULTS_MAX];
+static size_t nresults;
+
+static void
+bench_print(const struct bench_result *r)
+{
+  printf("%-36s %10llu x%-3d %10.1f %10.1f %10.1f ns%s\n",
+         r->name,
+         (unsigned long long)r->ops,
+         r->reps,
+         r->median_ns,
+         r->p99_ns,
+         r->max_ns,
+         strcmp(r->kind, "sample") ? "/op" : "");
+  fflush(stdout);
+}
+
+static void
+bench_add(const struct bench_result *r)
+{
+  bench_print(r);
+  if (nresults < BENCH_RESULTS_MAX) {
+    results[nresults++] = *r;
+  }
+}
+
+static int
+double_cmp(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of a sorted array */
+static double
+percentile(const double *sorted, int n, double p)
+{
+  int rank = (int)(p / 100.0 * n + 0.999999);
+  return sorted[rank < 1 ? 0 : rank > n ? n - 1 : rank - 1];
+}
+
+/**
+ * bench_run - time batches of @ops operations
+ * @name: result name
+ * @ops:  operations per batch
+ * @fn:   runs one batch
+ * @arg:  passed to @fn
+ */
+void
+bench_run(const char *name, uint64_t ops, bench_batch_fn fn, void *arg)
+{
+  struct bench_result r = {.kind = "batch", .ops = ops};
+  double *per_op = malloc(sizeof(*per_op) * bench_opts.reps);
+
+  pal_assert(per_op, "failed to allocate %d repetitions", bench_opts.reps);
+  for (int i = 0; i < bench_opts.warmup; i++) {
+    fn(arg, ops);
+  }
+  for (int i = 0; i < bench_opts.reps; i++) {
+    int64_t start = pal_uptime_ns();
+    fn(arg, ops);
+    per_op[i] = (double)(pal_uptime_ns() - start) / (double)ops;
+  }
+  qsort(per_op, bench_opts.reps, sizeof(*per_op), double_cmp);
+
+  snprintf(r.name, sizeof(r.name), "%s", name);
+  r.reps = bench_opts.reps;
+  r.median_ns = percentile(per_op, r.reps, 50.0);
+  r.p99_ns = percentile(per_op, r.reps, 99.0);
+  r.min_ns = per_op[0];
+  r.max_ns = per_op[r.reps - 1];
+  free(per_op);
+  bench_add(&r);
+}
+
+/**
+ * bench_sample - time @samples single operations
+ * @name:    result name
+ * @samples: operations to time, after a tenth as many untimed ones
+ * @fn:      runs one operation and returns its duration
+ * @arg:     passed to @fn
+ */
+void
+bench_sample(const char *name, uint64_t samples, bench_sample_fn fn, void *arg)
+{
+  struct bench_result r = {.kind = "sample", .ops = samples, .reps = 1};
+  pal_histogram_t *h = malloc(sizeof(*h));
+
+  pal_assert(h, "failed to allocate histogram");
+  pal_histogram_reset(h);
+  for (uint64_t i = 0; i < samples / 10; i++) {
+    fn(arg);
+  }
+  for (uint64_t i = 0; i < samples; i++) {
+    int64_t ns = fn(arg);
+    pal_histogram_record(h, ns > 0 ? (uint64_t)ns : 0);
+  }
+
+  snprintf(r.name, sizeof(r.name), "%s", name);
+  r.median_ns = (double)pal_histogram_percentile(h, 50.0);
+  r.p99_ns = (double)pal_histogram_percentile(h, 99.0);
+  r.min_ns = (double)h->min;
+  r.max_ns = (double)h->max;
+  free(h);
+  bench_add(&r);
+}
+
+void
+bench_report(const char *name, uint64_t ops, int64_t elapsed_ns)
+{
+  struct bench_result r = {.kind = "single", .ops = ops, .reps = 1};
+  double ns_per_op = ops ? (double)elapsed_ns / (double)ops : 0.0;
+
+  snprintf(r.name, sizeof(r.name), "%s", name);
+  r.median_ns = r.p99_ns = r.min_ns = r.max_ns = ns_per_op;
+  bench_add(&r);
+}
+
+static void
+bench_write_json(const char *path)
+{
+  struct utsname uts;
+  FILE *out = fopen(path, "w");
+
+  if (!out) {
+    fprintf(stderr, "qwiet_bench: cannot write %s\n", path);
+    return;
+  }
+  uname(&uts);
+  fprintf(out,
+          "{\n  \"machine\": \"%s\",\n  \"kernel\": \"%s\",\n"
+          "  \"cpus\": %ld,\n  \"compiler\": \"%s\",\n"
+          "  \"warmup\": %d,\n  \"reps\": %d,\n  \"results\": [",
+          uts.machine,
+          uts.release,
+          sysconf(_SC_NPROCESSORS_ONLN),
+          __VERSION__,
+          bench_opts.warmup,
+          bench_opts.reps);
+  for (size_t i = 0; i < nresults; i++) {
+    const struct bench_result *r = &results[i];
+    fprintf(out,
+            "%s\n    {\"name\": \"%s\", \"kind\": \"%s\", \"ops\": %llu, "
+            "\"reps\": %d, \"median_ns\": %.3f, \"p99_ns\": %.3f, "
+            "\"min_ns\": %.3f, \"max_ns\": %.3f}",
+            i ? "," : "",
+            r->name,
+            r->kind,
+            (unsigned long long)r->ops,
+            r->reps,
+            r->median_ns,
+            r->p99_ns,
+            r->min_ns,
+            r->max_ns);
+  }
+  fputs("\n  ]\n}\n", out);
+  fclose(out);
+}
+
+static bool
+bench_selected(const char *name, int nfilters, char **filters)
+{
+  if (nfilters == 0) {
+    return true;
+  }
+  for (int i = 0; i < nfilters; i++) {
+    if (strstr(name, filters[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void
+usage(void)
+{
+  fprintf(stderr,
+          "usage: qwiet_bench [--json FILE] [--reps N] [--warmup N] "
+          "[--cpu N] [NAME...]\n"
+          "  NAME  run only benchmarks whose name contains it\n");
+  exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+  const char *json = NULL;
+  char **filters = argv + 1;
+  int nfilters = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] != '-') {
+      filters[nfilters++] = argv[i];
+    } else if (i + 1 == argc) {
+      usage();
+    } else if (!strcmp(argv[i], "--json")) {
+      json = argv[++i];
+    } else if (!strcmp(argv[i], "--reps")) {
+      bench_opts.reps = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--warmup")) {
+      bench_opts.warmup = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--cpu")) {
+      /* Pinning keeps runs on one core type and out of migrations */
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(atoi(argv[++i]), &set);
+      if (sched_setaffinity(0, sizeof(set), &set)) {
+        perror("qwiet_bench: sched_setaffinity");
+      }
+    } else {
+      usage();
+    }
+  }
+  if (bench_opts.reps < 1) {
+    usage();
+  }
+
+  printf("%-36s %10s %4s %10s %10s %10s\n",
+         "benchmark",
+         "ops",
+         "reps",
+         "median",
+         "p99",
+         "max");
+  for (const struct bench *b = benches; b->name; b++) {
+    if (bench_selected(b->name, nfilters, filters)) {
+      b->run();
+    }
+  }
+
+  if (json) {
+    bench_write_json(json);
+  }
+  return 0;
+}
@@ -24,8 +24,35 @@ extern "C" {
 #include <sys/poll.h>
 #include <time.h>
 
-#define pal_malloc(x) malloc(x)
-#define pal_free(x) free(x)
+#if defined(PAL_MALLOC_SLAB) && defined(CONFIG_PAL_POSIX_SLAB)
+/* Subsystems opt in per target; see qwiet/platform/posix/slab.h */
+#include <qwiet/platform/posix/slab.h>
+#define __pal_malloc(x) pal_pool_alloc(x)
+#define __pal_free(x) pal_pool_free(x)
+#else
+#define __pal_malloc(x) malloc(x)
+#define __pal_free(x) free(x)
+#endif
+#ifdef CONFIG_PAL_MALLOC_STATS
+/* Per call site accounting; see qwiet/platform/posix/malloc_stats.h */
+#include <qwiet/platform/posix/malloc_stats.h>
+#define pal_malloc(x)                                                          \
+  ({                                                                           \
+    static struct pal_malloc_site __pal_site = {                               \
+        .file = __FILE__, .func = __func__, .line = __LINE__};                 \
+    size_t __pal_size = (x);                                                   \
+    pal_malloc_stats_record(                                                   \
+        &__pal_site,                                                           \
+        __pal_size > SIZE_MAX - sizeof(struct pal_malloc_hdr)                  \
+            ? NULL                                                             \
+            : __pal_malloc(sizeof(struct pal_malloc_hdr) + __pal_size),        \
+        __pal_size);                                                           \
+  })
+#define pal_free(x) __pal_free(pal_malloc_stats_forget(x))
+#else
+#define pal_malloc(x) __pal_malloc(x)
+#define pal_free(x) __pal_free(x)
+#endif
 #define pal_assert(cond, fmt, ...)                                             \
   do {                                                                         \
     if (!(cond)) {                                                             \
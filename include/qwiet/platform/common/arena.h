@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Bump allocator for scratch memory that dies all at once.
+ *
+ * Allocation moves a cursor through a chain of chunks. Nothing is freed
+ * individually: pal_arena_rewind() returns to a pal_arena_mark() and
+ * pal_arena_reset() to the start, both O(1). Chunks past the cursor stay
+ * chained and are reused by later allocations, so once a frame loop has
+ * seen its largest frame it stops calling pal_malloc() altogether.
+ *
+ *   pal_arena_reset(&frame);
+ *   rects = pal_arena_alloc(&frame, n * sizeof(*rects));
+ *   ...
+ *
+ * An arena may start from a caller-provided buffer (pal_arena_init_static),
+ * e.g. a static array on targets without a heap; with grow_size 0 it never
+ * allocates and pal_arena_alloc() returns NULL once the buffer is full.
+ *
+ * Not thread safe.
+ */
+#ifndef QWIET_PLATFORM_COMMON_ARENA_H
+#define QWIET_PLATFORM_COMMON_ARENA_H
+
+#include <qwiet/platform/common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default alignment, enough for any scalar type */
+#define PAL_ARENA_ALIGN _Alignof(max_align_t)
+
+#define PAL_ARENA_CHUNK_STATIC 0x1 /* memory not owned by the arena */
+
+struct pal_arena_chunk {
+  struct pal_arena_chunk *next;
+  size_t size; /* usable bytes in data[] */
+  unsigned int flags;
+  _Alignas(max_align_t) unsigned char data[];
+};
+
+typedef struct {
+  struct pal_arena_chunk *first;
+  struct pal_arena_chunk *cur;
+  size_t used;      /* bytes used in cur */
+  size_t grow_size; /* data size of new chunks, 0 to never allocate */
+} pal_arena_t;
+
+typedef struct {
+  struct pal_arena_chunk *chunk;
+  size_t used;
+} pal_arena_mark_t;
+
+void
+pal_arena_init(pal_arena_t *arena, size_t chunk_size);
+
+void
+pal_arena_init_static(pal_arena_t *arena,
+                      void *buf,
+                      size_t size,
+                      size_t grow_size);
+
+void *
+pal_arena_alloc_aligned(pal_arena_t *arena, size_t size, size_t align);
+
+void
+pal_arena_trim(pal_arena_t *arena);
+
+void
+pal_arena_cleanup(pal_arena_t *arena);
+
+size_t
+pal_arena_footprint(const pal_arena_t *arena);
+
+static inline void *
+pal_arena_alloc(pal_arena_t *arena, size_t size)
+{
+  return pal_arena_alloc_aligned(arena, size, PAL_ARENA_ALIGN);
+}
+
+static inline void *
+pal_arena_zalloc(pal_arena_t *arena, size_t size)
+{
+  void *ptr = pal_arena_alloc(arena, size);
+  return ptr ? memset(ptr, 0, size) : NULL;
+}
+
+static inline pal_arena_mark_t
+pal_arena_mark(const pal_arena_t *arena)
+{
+  return (pal_arena_mark_t){.chunk = arena->cur, .used = arena->used};
+}
+
+/**
+ * pal_arena_rewind - release everything allocated since @mark
+ * @arena: arena to rewind
+ * @mark:  value from pal_arena_mark() on this arena, not yet rewound past
+ */
+static inline void
+pal_arena_rewind(pal_arena_t *arena, pal_arena_mark_t mark)
+{
+  arena->cur = mark.chunk;
+  arena->used = mark.used;
+}
+
+/**
+ * pal_arena_reset - release everything, keeping the chunks for reuse
+ * @arena: arena to reset
+ */
+static inline void
+pal_arena_reset(pal_arena_t *arena)
+{
+  arena->cur = arena->first;
+  arena->used = 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_ARENA_H */
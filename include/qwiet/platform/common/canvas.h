@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Tiled Y4 canvas with copy-on-write tiles and an undo history.
+ *
+ * The page is a grid of PAL_CANVAS_TILE square tiles, each packed like the
+ * framebuffer (two pixels per byte, even pixel in the low nibble). A tile
+ * that was never drawn on is NULL and reads as the background. Tiles are
+ * reference counted: the history keeps the tiles each step replaced, and
+ * writing to a tile someone else still holds copies it first, so an undo
+ * step costs the tiles the stroke touched rather than a frame.
+ *
+ *   pal_canvas_segment(&canvas, &pen, prev, next);
+ *   ...
+ *   pal_canvas_commit(&history);          (pen up)
+ *   pal_canvas_damage(&canvas, &damage);  (at refresh)
+ *   pal_canvas_blit(&canvas, &fb, rect);
+ *
+ * Every tile written since the last pal_canvas_damage() is reported there;
+ * pal_canvas_blit() copies the canvas out to a flat framebuffer.
+ *
+ * Not thread safe.
+ */
+#ifndef QWIET_PLATFORM_COMMON_CANVAS_H
+#define QWIET_PLATFORM_COMMON_CANVAS_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/damage.h>
+#include <qwiet/platform/common/raster.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Tile edge in pixels */
+#define PAL_CANVAS_TILE 64
+#define PAL_CANVAS_TILE_PITCH (PAL_CANVAS_TILE / 2)
+#define PAL_CANVAS_TILE_BYTES (PAL_CANVAS_TILE * PAL_CANVAS_TILE_PITCH)
+
+struct pal_canvas_tile {
+  uint32_t refs;
+  uint8_t px[PAL_CANVAS_TILE_BYTES];
+};
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  uint32_t cols;
+  uint32_t rows;
+  uint8_t background;             /* level of NULL tiles */
+  struct pal_canvas_tile **tiles; /* cols * rows, row major */
+  uint64_t *dirty;                /* written since pal_canvas_damage() */
+  uint64_t *changed;              /* written since pal_canvas_commit() */
+  size_t ntiles;                  /* allocated, here or in a history */
+} pal_canvas_t;
+
+/* The tiles one commit replaced */
+struct pal_canvas_step;
+
+typedef struct {
+  pal_canvas_t *canvas;
+  struct pal_canvas_tile **base; /* the canvas as of the last commit */
+  struct pal_canvas_step **steps;
+  size_t depth; /* steps kept */
+  size_t first; /* ring index of the oldest step */
+  size_t count; /* steps held, undone ones included */
+  size_t cur;   /* steps applied */
+} pal_canvas_history_t;
+
+void
+pal_canvas_init(pal_canvas_t *canvas,
+                uint32_t width,
+                uint32_t height,
+                uint8_t background);
+
+void
+pal_canvas_cleanup(pal_canvas_t *canvas);
+
+static inline const struct pal_canvas_tile *
+pal_canvas_tile(const pal_canvas_t *canvas, uint32_t col, uint32_t row)
+{
+  return canvas->tiles[(size_t)row * canvas->cols + col];
+}
+
+static inline uint8_t
+pal_canvas_get(const pal_canvas_t *canvas, uint32_t x, uint32_t y)
+{
+  const struct pal_canvas_tile *tile =
+      pal_canvas_tile(canvas, x / PAL_CANVAS_TILE, y / PAL_CANVAS_TILE);
+  uint8_t byte;
+
+  if (!tile) {
+    return canvas->background;
+  }
+  byte = tile->px[y % PAL_CANVAS_TILE * PAL_CANVAS_TILE_PITCH +
+                  x % PAL_CANVAS_TILE / 2];
+  return x & 1 ? byte >> 4 : byte & 0xf;
+}
+
+uint8_t *
+pal_canvas_tile_write(pal_canvas_t *canvas, uint32_t col, uint32_t row);
+
+void
+pal_canvas_segment(pal_canvas_t *canvas,
+                   const pal_raster_pen_t *pen,
+                   pal_raster_point_t a,
+                   pal_raster_point_t b);
+
+void
+pal_canvas_clear(pal_canvas_t *canvas);
+
+void
+pal_canvas_damage(pal_canvas_t *canvas, pal_damage_t *damage);
+
+void
+pal_canvas_blit(const pal_canvas_t *canvas,
+                const pal_raster_fb_t *fb,
+                pal_rect_t rect);
+
+void
+pal_canvas_history_init(pal_canvas_history_t *history,
+                        pal_canvas_t *canvas,
+                        size_t depth);
+
+void
+pal_canvas_commit(pal_canvas_history_t *history);
+
+int
+pal_canvas_undo(pal_canvas_history_t *history);
+
+int
+pal_canvas_redo(pal_canvas_history_t *history);
+
+void
+pal_canvas_history_cleanup(pal_canvas_history_t *history);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_CANVAS_H */
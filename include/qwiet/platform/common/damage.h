@@ -0,0 +1,118 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Dirty rectangle tracker for partial display refresh.
+ *
+ * Drawing code reports what it touched with pal_damage_add(); at commit
+ * pal_damage_take() hands out at most a fixed number of rectangles that
+ * cover it all and starts the next frame empty. Rectangles that overlap or
+ * touch are merged as they arrive whenever the pixels the union adds cost
+ * no more than keeping a separate rectangle, which folds the run of small
+ * boxes a pen stroke produces into a few. When more remain than may be
+ * handed out, the pair whose union wastes the fewest pixels is merged until
+ * they fit.
+ *
+ *   pal_damage_add(&damage, PAL_RECT(x - r, y - r, x + r, y + r));
+ *   ...
+ *   n = pal_damage_take(&damage, hints, PAL_DAMAGE_HINTS);
+ *
+ * Rectangles are half open, [x1, x2) x [y1, y2), and clipped to the
+ * surface. Storage is a fixed array; nothing allocates.
+ *
+ * Not thread safe.
+ */
+#ifndef QWIET_PLATFORM_COMMON_DAMAGE_H
+#define QWIET_PLATFORM_COMMON_DAMAGE_H
+
+#include <qwiet/platform/common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Rectangles tracked within a frame; more are merged on the way in */
+#define PAL_DAMAGE_RECTS 32
+
+/* Default bound on the rectangles handed out per commit */
+#define PAL_DAMAGE_HINTS 8
+
+/* Default cost of one more rectangle, in pixels refreshed for nothing */
+#define PAL_DAMAGE_RECT_COST (64 * 64)
+
+typedef struct {
+  int32_t x1;
+  int32_t y1;
+  int32_t x2;
+  int32_t y2;
+} pal_rect_t;
+
+#define PAL_RECT(x1_, y1_, x2_, y2_)                                           \
+  ((pal_rect_t){.x1 = (x1_), .y1 = (y1_), .x2 = (x2_), .y2 = (y2_)})
+
+typedef struct {
+  pal_rect_t bounds;
+  uint64_t rect_cost;
+  size_t count;
+  pal_rect_t rects[PAL_DAMAGE_RECTS];
+} pal_damage_t;
+
+static inline bool
+pal_rect_empty(pal_rect_t r)
+{
+  return r.x1 >= r.x2 || r.y1 >= r.y2;
+}
+
+static inline uint64_t
+pal_rect_area(pal_rect_t r)
+{
+  return pal_rect_empty(r) ? 0 : (uint64_t)(r.x2 - r.x1) * (r.y2 - r.y1);
+}
+
+static inline pal_rect_t
+pal_rect_union(pal_rect_t a, pal_rect_t b)
+{
+  return PAL_RECT(a.x1 < b.x1 ? a.x1 : b.x1,
+                  a.y1 < b.y1 ? a.y1 : b.y1,
+                  a.x2 > b.x2 ? a.x2 : b.x2,
+                  a.y2 > b.y2 ? a.y2 : b.y2);
+}
+
+static inline pal_rect_t
+pal_rect_intersect(pal_rect_t a, pal_rect_t b)
+{
+  return PAL_RECT(a.x1 > b.x1 ? a.x1 : b.x1,
+                  a.y1 > b.y1 ? a.y1 : b.y1,
+                  a.x2 < b.x2 ? a.x2 : b.x2,
+                  a.y2 < b.y2 ? a.y2 : b.y2);
+}
+
+/* @outer covers all of @inner */
+static inline bool
+pal_rect_contains(pal_rect_t outer, pal_rect_t inner)
+{
+  return inner.x1 >= outer.x1 && inner.y1 >= outer.y1 &&
+         inner.x2 <= outer.x2 && inner.y2 <= outer.y2;
+}
+
+void
+pal_damage_init(pal_damage_t *damage, int32_t width, int32_t height);
+
+void
+pal_damage_add(pal_damage_t *damage, pal_rect_t rect);
+
+void
+pal_damage_add_all(pal_damage_t *damage);
+
+size_t
+pal_damage_take(pal_damage_t *damage, pal_rect_t *out, size_t max);
+
+static inline bool
+pal_damage_empty(const pal_damage_t *damage)
+{
+  return damage->count == 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_DAMAGE_H */
@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Dithering from 8-bit grayscale to the e-ink framebuffer depths.
+ *
+ * The fast waveforms render only 2 (A2) or 4 (DU4) gray levels, so content
+ * is dithered down before it is shown in fast mode:
+ *
+ *   - PAL_DITHER_FLOYD: Floyd-Steinberg error diffusion, serpentine; best
+ *     for photos, but sequential and it shimmers when content changes
+ *   - PAL_DITHER_BAYER: 8x8 ordered; stable and cheapest, with a visible
+ *     cross-hatch
+ *   - PAL_DITHER_BLUE_NOISE: 64x64 void-and-cluster threshold map; stable,
+ *     no pattern, as cheap as Bayer
+ *
+ * Output is packed like the framebuffer, low bits first: Y4 two pixels per
+ * byte, Y2 four, Y1 eight, 0 black. Threshold methods are vectorized (the
+ * kernel is picked at first use, as for the rasterizer); error diffusion is
+ * scalar.
+ *
+ * Frames are processed in bands of PAL_DITHER_BAND rows and error diffusion
+ * restarts at each band, so a frame dithers to the same bytes whether its
+ * bands run in order or on a pool:
+ *
+ *   pal_dither(&src, &dst, PAL_DITHER_BLUE_NOISE);
+ *   pal_dither_parallel(&pool, &src, &dst, PAL_DITHER_FLOYD);
+ */
+#ifndef QWIET_PLATFORM_COMMON_DITHER_H
+#define QWIET_PLATFORM_COMMON_DITHER_H
+
+#include <qwiet/platform/common.h>
+#ifdef CONFIG_PAL_POSIX_POOL
+#include <qwiet/platform/posix/pool.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Rows per band; bands are the unit of parallel work */
+#define PAL_DITHER_BAND 64
+
+enum pal_dither_method {
+  PAL_DITHER_FLOYD,
+  PAL_DITHER_BAYER,
+  PAL_DITHER_BLUE_NOISE,
+};
+
+/* Bits per output pixel */
+enum pal_dither_depth {
+  PAL_DITHER_Y1 = 1,
+  PAL_DITHER_Y2 = 2,
+  PAL_DITHER_Y4 = 4,
+};
+
+enum pal_dither_impl {
+  PAL_DITHER_SCALAR,
+  PAL_DITHER_SSE2,
+  PAL_DITHER_AVX2,
+  PAL_DITHER_NEON,
+};
+
+/* 8-bit grayscale, 0 black */
+typedef struct {
+  const uint8_t *buf;
+  uint32_t width;
+  uint32_t height;
+  uint32_t pitch;
+} pal_dither_src_t;
+
+/* Same width and height as the source */
+typedef struct {
+  uint8_t *buf;
+  uint32_t pitch; /* at least (width * depth + 7) / 8 */
+  enum pal_dither_depth depth;
+} pal_dither_dst_t;
+
+void
+pal_dither_bands(const pal_dither_src_t *src,
+                 const pal_dither_dst_t *dst,
+                 enum pal_dither_method method,
+                 size_t begin,
+                 size_t end);
+
+static inline size_t
+pal_dither_nbands(const pal_dither_src_t *src)
+{
+  return (src->height + PAL_DITHER_BAND - 1) / PAL_DITHER_BAND;
+}
+
+static inline void
+pal_dither(const pal_dither_src_t *src,
+           const pal_dither_dst_t *dst,
+           enum pal_dither_method method)
+{
+  pal_dither_bands(src, dst, method, 0, pal_dither_nbands(src));
+}
+
+#ifdef CONFIG_PAL_POSIX_POOL
+struct pal_dither_job {
+  const pal_dither_src_t *src;
+  const pal_dither_dst_t *dst;
+  enum pal_dither_method method;
+};
+
+static inline void
+__pal_dither_bands(void *arg, size_t begin, size_t end)
+{
+  struct pal_dither_job *job = arg;
+  pal_dither_bands(job->src, job->dst, job->method, begin, end);
+}
+
+/* pal_dither() with the bands spread over @pool; returns when done */
+static inline void
+pal_dither_parallel(pal_pool_t *pool,
+                    const pal_dither_src_t *src,
+                    const pal_dither_dst_t *dst,
+                    enum pal_dither_method method)
+{
+  struct pal_dither_job job = {.src = src, .dst = dst, .method = method};
+  pal_pool_parallel_for(
+      pool, 0, pal_dither_nbands(src), 1, __pal_dither_bands, &job);
+}
+#endif
+
+bool
+pal_dither_supported(enum pal_dither_impl impl);
+
+int
+pal_dither_select(enum pal_dither_impl impl);
+
+enum pal_dither_impl
+pal_dither_selected(void);
+
+const char *
+pal_dither_impl_name(enum pal_dither_impl impl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_DITHER_H */
@@ -0,0 +1,366 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Resizable intrusive hash table built on pal_hlist.
+ *
+ * Entries embed a struct pal_hash_node and stay owned by the caller; the
+ * table only allocates its bucket arrays. When the load factor passes 1 the
+ * table allocates a bucket array twice the size, and every following insert
+ * migrates a few old buckets into it, so no single insert pays for moving
+ * the whole table (the incremental rehash used by Redis' dict); new buckets
+ * are even initialized lazily, so growing costs one malloc. Each old
+ * bucket lives in exactly one array at any time, chosen by comparing its
+ * index with the migration cursor, so lookups stay a single bucket walk
+ * mid-rehash.
+ *
+ *   struct conn {
+ *     int fd;
+ *     struct pal_hash_node hnode;
+ *   };
+ *
+ *   static bool
+ *   conn_eq(const struct pal_hash_node *node, const void *key)
+ *   {
+ *     return PAL_CONTAINER_OF(node, struct conn, hnode)->fd ==
+ *            *(const int *)key;
+ *   }
+ *
+ *   pal_hashtable_add(&conns, &c->hnode, pal_hash_u32(c->fd));
+ *   node = pal_hashtable_find(&conns, pal_hash_u32(fd), conn_eq, &fd);
+ *
+ * The table never shrinks and is not thread safe.
+ */
+#ifndef QWIET_PLATFORM_COMMON_HASHTABLE_H
+#define QWIET_PLATFORM_COMMON_HASHTABLE_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/list.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Old buckets migrated per insert while a rehash is in progress */
+#define PAL_HASHTABLE_REHASH_STEP 4
+
+#define PAL_HASHTABLE_MIN_BUCKETS 8
+
+struct pal_hash_node {
+  struct pal_hlist_node node;
+  uint32_t hash;
+};
+
+typedef struct {
+  struct pal_hlist_head *buckets[2]; /* [1] is only set mid-rehash */
+  size_t mask[2];
+  size_t cursor; /* next bucket of buckets[0] to migrate */
+  size_t count;
+} pal_hashtable_t;
+
+typedef bool (*pal_hash_eq_fn)(const struct pal_hash_node *node,
+                               const void *key);
+
+/*
+ * Hash helpers. Bucket indices come from the low bits, so every helper ends
+ * with a full avalanche (MurmurHash3 finalizers).
+ */
+static inline uint32_t
+pal_hash_u32(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+  return x;
+}
+
+static inline uint32_t
+pal_hash_u64(uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return (uint32_t)x;
+}
+
+static inline uint32_t
+pal_hash_ptr(const void *ptr)
+{
+  return pal_hash_u64((uintptr_t)ptr);
+}
+
+/* FNV-1a, finalized so short keys still spread over the low bits */
+static inline uint32_t
+pal_hash_bytes(const void *data, size_t len)
+{
+  const uint8_t *p = data;
+  uint32_t h = 2166136261u;
+
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ p[i]) * 16777619u;
+  }
+  return pal_hash_u32(h);
+}
+
+static inline uint32_t
+pal_hash_str(const char *str)
+{
+  return pal_hash_bytes(str, strlen(str));
+}
+
+static inline struct pal_hlist_head *
+__pal_hashtable_alloc(size_t nbuckets)
+{
+  struct pal_hlist_head *buckets = pal_malloc(nbuckets * sizeof(*buckets));
+
+  pal_assert(buckets, "failed to allocate %zu hash buckets", nbuckets);
+  return buckets;
+}
+
+/* The one bucket that entries with @hash live in right now */
+static inline struct pal_hlist_head *
+__pal_hashtable_bucket(const pal_hashtable_t *ht, uint32_t hash)
+{
+  size_t i = hash & ht->mask[0];
+
+  if (ht->buckets[1] && i < ht->cursor) {
+    return &ht->buckets[1][hash & ht->mask[1]];
+  }
+  return &ht->buckets[0][i];
+}
+
+/*
+ * Buckets of the new array are initialized as the old bucket that feeds them
+ * migrates, so only [0, cursor) and [old size, old size + cursor) are valid.
+ * Iteration walks the old array and then those two ranges of the new one.
+ */
+static inline size_t
+__pal_hashtable_nbuckets(const pal_hashtable_t *ht)
+{
+  return ht->mask[0] + 1 + (ht->buckets[1] ? 2 * ht->cursor : 0);
+}
+
+static inline struct pal_hlist_head *
+__pal_hashtable_bucket_at(const pal_hashtable_t *ht, size_t bkt)
+{
+  if (bkt <= ht->mask[0]) {
+    return &ht->buckets[0][bkt];
+  }
+  bkt -= ht->mask[0] + 1;
+  if (bkt >= ht->cursor) {
+    bkt += ht->mask[0] + 1 - ht->cursor;
+  }
+  return &ht->buckets[1][bkt];
+}
+
+/**
+ * pal_hashtable_init - initialize an empty table
+ * @ht:   table to initialize
+ * @hint: expected number of entries, 0 for the minimum size
+ */
+static inline void
+pal_hashtable_init(pal_hashtable_t *ht, size_t hint)
+{
+  size_t n = PAL_HASHTABLE_MIN_BUCKETS;
+
+  while (n < hint) {
+    n <<= 1;
+  }
+  ht->buckets[0] = __pal_hashtable_alloc(n);
+  for (size_t i = 0; i < n; i++) {
+    PAL_INIT_HLIST_HEAD(&ht->buckets[0][i]);
+  }
+  ht->buckets[1] = NULL;
+  ht->mask[0] = n - 1;
+  ht->mask[1] = 0;
+  ht->cursor = 0;
+  ht->count = 0;
+}
+
+/**
+ * pal_hashtable_cleanup - release the bucket arrays
+ * @ht: table to clean up
+ *
+ * Entries still in the table are left as they are; the caller owns them.
+ */
+static inline void
+pal_hashtable_cleanup(pal_hashtable_t *ht)
+{
+  pal_free(ht->buckets[0]);
+  pal_free(ht->buckets[1]);
+  ht->buckets[0] = ht->buckets[1] = NULL;
+  ht->count = 0;
+}
+
+/**
+ * pal_hashtable_count - number of entries in the table
+ * @ht: table to query
+ */
+static inline size_t
+pal_hashtable_count(const pal_hashtable_t *ht)
+{
+  return ht->count;
+}
+
+/**
+ * pal_hashtable_rehash_step - migrate up to @n buckets of a pending rehash
+ * @ht: table to work on
+ * @n:  number of old buckets to migrate
+ *
+ * Inserts call this on their own; an idle loop may call it to finish a
+ * rehash early. Does nothing when no rehash is in progress.
+ */
+static inline void
+pal_hashtable_rehash_step(pal_hashtable_t *ht, size_t n)
+{
+  struct pal_hlist_node *pos, *tmp;
+
+  if (!ht->buckets[1]) {
+    return;
+  }
+
+  while (n-- && ht->cursor <= ht->mask[0]) {
+    struct pal_hlist_head *old = &ht->buckets[0][ht->cursor];
+
+    /* Old bucket i splits into new buckets i and i + old size */
+    PAL_INIT_HLIST_HEAD(&ht->buckets[1][ht->cursor]);
+    PAL_INIT_HLIST_HEAD(&ht->buckets[1][ht->cursor + ht->mask[0] + 1]);
+    ht->cursor++;
+
+    pal_hlist_for_each_safe(pos, tmp, old)
+    {
+      uint32_t hash = pal_hlist_entry(pos, struct pal_hash_node, node)->hash;
+      __pal_hlist_del(pos);
+      pal_hlist_add_head(pos, &ht->buckets[1][hash & ht->mask[1]]);
+    }
+  }
+
+  if (ht->cursor > ht->mask[0]) {
+    pal_free(ht->buckets[0]);
+    ht->buckets[0] = ht->buckets[1];
+    ht->mask[0] = ht->mask[1];
+    ht->buckets[1] = NULL;
+    ht->mask[1] = 0;
+    ht->cursor = 0;
+  }
+}
+
+/**
+ * pal_hashtable_add - insert an entry
+ * @ht:   table to insert into
+ * @node: entry to insert, must not already be in a table
+ * @hash: hash of the entry's key
+ *
+ * Duplicate keys are allowed; pal_hashtable_find() returns the most recently
+ * added one.
+ */
+static inline void
+pal_hashtable_add(pal_hashtable_t *ht,
+                  struct pal_hash_node *node,
+                  uint32_t hash)
+{
+  pal_hashtable_rehash_step(ht, PAL_HASHTABLE_REHASH_STEP);
+
+  /* A rehash always finishes well before the new array fills up, so only
+   * grow when none is pending */
+  if (!ht->buckets[1] && ht->count > ht->mask[0]) {
+    ht->mask[1] = (ht->mask[0] << 1) | 1;
+    ht->buckets[1] = __pal_hashtable_alloc(ht->mask[1] + 1);
+    ht->cursor = 0;
+  }
+
+  node->hash = hash;
+  pal_hlist_add_head(&node->node, __pal_hashtable_bucket(ht, hash));
+  ht->count++;
+}
+
+/**
+ * pal_hashtable_del - remove an entry
+ * @ht:   table the entry is in
+ * @node: entry to remove
+ *
+ * Never moves other entries, so it is safe inside
+ * pal_hashtable_for_each_safe().
+ */
+static inline void
+pal_hashtable_del(pal_hashtable_t *ht, struct pal_hash_node *node)
+{
+  pal_hlist_del_init(&node->node);
+  ht->count--;
+}
+
+/**
+ * pal_hashtable_find - look up an entry
+ * @ht:   table to search
+ * @hash: hash of @key
+ * @eq:   returns true when @node's key equals @key
+ * @key:  key passed through to @eq
+ *
+ * @eq is only called for entries whose stored hash matches. Returns NULL if
+ * no entry matches.
+ */
+static inline struct pal_hash_node *
+pal_hashtable_find(const pal_hashtable_t *ht,
+                   uint32_t hash,
+                   pal_hash_eq_fn eq,
+                   const void *key)
+{
+  struct pal_hash_node *pos;
+
+  pal_hlist_for_each_entry(pos, __pal_hashtable_bucket(ht, hash), node)
+  {
+    if (pos->hash == hash && eq(pos, key)) {
+      return pos;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * pal_hashtable_for_each_possible - iterate over entries that may match @hash
+ * @ht:   the table
+ * @pos:  struct pal_hash_node * to use as a loop cursor
+ * @hash: the hash to look for
+ *
+ * Visits the bucket for @hash; entries with other hashes may share it, so
+ * compare pos->hash before the key.
+ */
+#define pal_hashtable_for_each_possible(ht, pos, hash)                         \
+  pal_hlist_for_each_entry(pos, __pal_hashtable_bucket(ht, hash), node)
+
+/**
+ * pal_hashtable_for_each - iterate over every entry
+ * @ht:  the table
+ * @bkt: size_t to use as a bucket cursor
+ * @pos: struct pal_hash_node * to use as a loop cursor
+ *
+ * The table must not be modified during the walk.
+ */
+#define pal_hashtable_for_each(ht, bkt, pos)                                   \
+  for ((bkt) = 0, (pos) = NULL;                                                \
+       (pos) == NULL && (bkt) < __pal_hashtable_nbuckets(ht);                  \
+       (bkt)++)                                                                \
+  pal_hlist_for_each_entry(pos, __pal_hashtable_bucket_at(ht, bkt), node)
+
+/**
+ * pal_hashtable_for_each_safe - iterate over every entry, safe against
+ *                               pal_hashtable_del() of the current entry
+ * @ht:  the table
+ * @bkt: size_t to use as a bucket cursor
+ * @tmp: struct pal_hlist_node * to use as temporary storage
+ * @pos: struct pal_hash_node * to use as a loop cursor
+ */
+#define pal_hashtable_for_each_safe(ht, bkt, tmp, pos)                         \
+  for ((bkt) = 0, (pos) = NULL;                                                \
+       (pos) == NULL && (bkt) < __pal_hashtable_nbuckets(ht);                  \
+       (bkt)++)                                                                \
+  pal_hlist_for_each_entry_safe(                                               \
+      pos, tmp, __pal_hashtable_bucket_at(ht, bkt), node)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_HASHTABLE_H */
@@ -0,0 +1,268 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Intrusive d-ary min-heap.
+ *
+ * Entries embed a struct pal_heap_node, which records the entry's slot in
+ * the heap array so pal_heap_remove() and pal_heap_update() work on any
+ * entry in O(log n) without a search. The heap owns only the pointer array,
+ * which grows on demand.
+ *
+ * A 4-ary heap is shallower than a binary one and keeps each node's
+ * children in one cache line of pointers, which favors the pop-heavy
+ * deadline and ordering workloads it is used for. Unlike the rbtree there
+ * is no stable order among equal keys.
+ *
+ *   static bool
+ *   job_less(const struct pal_heap_node *a, const struct pal_heap_node *b)
+ *   {
+ *     return PAL_CONTAINER_OF(a, struct job, hnode)->deadline <
+ *            PAL_CONTAINER_OF(b, struct job, hnode)->deadline;
+ *   }
+ *
+ * Not thread safe.
+ */
+#ifndef QWIET_PLATFORM_COMMON_HEAP_H
+#define QWIET_PLATFORM_COMMON_HEAP_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/macros.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PAL_HEAP_ARITY 4
+
+#define PAL_HEAP_MIN_CAPACITY 16
+
+/* index value of a node that is not in a heap */
+#define PAL_HEAP_DETACHED SIZE_MAX
+
+struct pal_heap_node {
+  size_t index;
+};
+
+typedef bool (*pal_heap_less_fn)(const struct pal_heap_node *a,
+                                 const struct pal_heap_node *b);
+
+typedef struct {
+  struct pal_heap_node **nodes;
+  size_t count;
+  size_t capacity;
+  pal_heap_less_fn less;
+} pal_heap_t;
+
+static inline void
+__pal_heap_set(pal_heap_t *heap, size_t i, struct pal_heap_node *node)
+{
+  heap->nodes[i] = node;
+  node->index = i;
+}
+
+static inline void
+__pal_heap_sift_up(pal_heap_t *heap, size_t i)
+{
+  struct pal_heap_node *node = heap->nodes[i];
+
+  while (i > 0) {
+    size_t parent = (i - 1) / PAL_HEAP_ARITY;
+    if (!heap->less(node, heap->nodes[parent])) {
+      break;
+    }
+    __pal_heap_set(heap, i, heap->nodes[parent]);
+    i = parent;
+  }
+  __pal_heap_set(heap, i, node);
+}
+
+static inline void
+__pal_heap_sift_down(pal_heap_t *heap, size_t i)
+{
+  struct pal_heap_node *node = heap->nodes[i];
+
+  for (;;) {
+    size_t first = i * PAL_HEAP_ARITY + 1;
+    size_t last = first + PAL_HEAP_ARITY;
+    size_t min = first;
+
+    if (first >= heap->count) {
+      break;
+    }
+    if (last > heap->count) {
+      last = heap->count;
+    }
+    for (size_t c = first + 1; c < last; c++) {
+      if (heap->less(heap->nodes[c], heap->nodes[min])) {
+        min = c;
+      }
+    }
+    if (!heap->less(heap->nodes[min], node)) {
+      break;
+    }
+    __pal_heap_set(heap, i, heap->nodes[min]);
+    i = min;
+  }
+  __pal_heap_set(heap, i, node);
+}
+
+/* Move the node at @i up or down until order holds around it again */
+static inline void
+__pal_heap_fix(pal_heap_t *heap, size_t i)
+{
+  if (i > 0 &&
+      heap->less(heap->nodes[i], heap->nodes[(i - 1) / PAL_HEAP_ARITY])) {
+    __pal_heap_sift_up(heap, i);
+  } else {
+    __pal_heap_sift_down(heap, i);
+  }
+}
+
+/**
+ * pal_heap_node_init - mark a node as not being in a heap
+ * @node: node to initialize
+ */
+static inline void
+pal_heap_node_init(struct pal_heap_node *node)
+{
+  node->index = PAL_HEAP_DETACHED;
+}
+
+/**
+ * pal_heap_node_queued - test whether @node is in a heap
+ * @node: node to test
+ */
+static inline bool
+pal_heap_node_queued(const struct pal_heap_node *node)
+{
+  return node->index != PAL_HEAP_DETACHED;
+}
+
+/**
+ * pal_heap_init - initialize an empty heap
+ * @heap: heap to initialize
+ * @less: strict ordering of two nodes; the least node is popped first
+ * @hint: expected number of entries, 0 for the minimum size
+ */
+static inline void
+pal_heap_init(pal_heap_t *heap, pal_heap_less_fn less, size_t hint)
+{
+  heap->capacity = hint > PAL_HEAP_MIN_CAPACITY ? hint : PAL_HEAP_MIN_CAPACITY;
+  heap->nodes = pal_malloc(heap->capacity * sizeof(*heap->nodes));
+  pal_assert(heap->nodes, "failed to allocate heap of %zu", heap->capacity);
+  heap->count = 0;
+  heap->less = less;
+}
+
+/**
+ * pal_heap_cleanup - release the pointer array
+ * @heap: heap to clean up
+ *
+ * Nodes still queued are left as they are; the caller owns them.
+ */
+static inline void
+pal_heap_cleanup(pal_heap_t *heap)
+{
+  pal_free(heap->nodes);
+  heap->nodes = NULL;
+  heap->count = heap->capacity = 0;
+}
+
+static inline size_t
+pal_heap_count(const pal_heap_t *heap)
+{
+  return heap->count;
+}
+
+static inline bool
+pal_heap_empty(const pal_heap_t *heap)
+{
+  return heap->count == 0;
+}
+
+/**
+ * pal_heap_peek - the least node, or NULL if the heap is empty
+ * @heap: heap to query
+ */
+static inline struct pal_heap_node *
+pal_heap_peek(const pal_heap_t *heap)
+{
+  return heap->count ? heap->nodes[0] : NULL;
+}
+
+/**
+ * pal_heap_push - add a node
+ * @heap: heap to add to
+ * @node: node to add, must not be queued
+ */
+static inline void
+pal_heap_push(pal_heap_t *heap, struct pal_heap_node *node)
+{
+  if (heap->count == heap->capacity) {
+    size_t capacity = heap->capacity * 2;
+    struct pal_heap_node **nodes = pal_malloc(capacity * sizeof(*nodes));
+
+    pal_assert(nodes, "failed to grow heap to %zu", capacity);
+    memcpy(nodes, heap->nodes, heap->count * sizeof(*nodes));
+    pal_free(heap->nodes);
+    heap->nodes = nodes;
+    heap->capacity = capacity;
+  }
+
+  heap->nodes[heap->count] = node;
+  __pal_heap_sift_up(heap, heap->count++);
+}
+
+/**
+ * pal_heap_remove - remove any queued node
+ * @heap: heap the node is in
+ * @node: node to remove
+ */
+static inline void
+pal_heap_remove(pal_heap_t *heap, struct pal_heap_node *node)
+{
+  size_t i = node->index;
+  struct pal_heap_node *last = heap->nodes[--heap->count];
+
+  pal_heap_node_init(node);
+  if (last == node) {
+    return;
+  }
+
+  /* Fill the hole with the last node and restore order around it */
+  __pal_heap_set(heap, i, last);
+  __pal_heap_fix(heap, i);
+}
+
+/**
+ * pal_heap_pop - remove and return the least node
+ * @heap: heap to pop from
+ *
+ * Returns NULL if the heap is empty.
+ */
+static inline struct pal_heap_node *
+pal_heap_pop(pal_heap_t *heap)
+{
+  struct pal_heap_node *node = pal_heap_peek(heap);
+
+  if (node) {
+    pal_heap_remove(heap, node);
+  }
+  return node;
+}
+
+/**
+ * pal_heap_update - restore order after a queued node's key changed
+ * @heap: heap the node is in
+ * @node: node whose key changed
+ */
+static inline void
+pal_heap_update(pal_heap_t *heap, struct pal_heap_node *node)
+{
+  __pal_heap_fix(heap, node->index);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_HEAP_H */
@@ -0,0 +1,192 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Log-linear histogram for latency distributions.
+ *
+ * Values below 2^PAL_HISTOGRAM_SUB_BITS get a bucket each; above that every
+ * power of two is split into 2^(PAL_HISTOGRAM_SUB_BITS - 1) equal buckets,
+ * so a reported percentile is within 1/32 (about 3%) of the true value. The
+ * counters are a fixed array: recording is a few instructions, never
+ * allocates and never fails. Values of 2^PAL_HISTOGRAM_MAX_BITS (about 68 s
+ * in nanoseconds) and above are counted in the last bucket; max still
+ * reports them exactly.
+ *
+ * An instance has one writer. Other threads may read or merge it while it
+ * is being written, seeing each counter either before or after an update,
+ * so per-thread instances can be merged into a process-wide view at any
+ * time.
+ *
+ *   pal_histogram_record(&h, pal_uptime_ns() - start);
+ *   p99 = pal_histogram_percentile(&h, 99.0);
+ */
+#ifndef QWIET_PLATFORM_COMMON_HISTOGRAM_H
+#define QWIET_PLATFORM_COMMON_HISTOGRAM_H
+
+#include <qwiet/platform/common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PAL_HISTOGRAM_SUB_BITS 6
+#define PAL_HISTOGRAM_MAX_BITS 36
+
+#define PAL_HISTOGRAM_HALF (1U << (PAL_HISTOGRAM_SUB_BITS - 1))
+#define PAL_HISTOGRAM_BUCKETS                                                  \
+  ((PAL_HISTOGRAM_MAX_BITS - PAL_HISTOGRAM_SUB_BITS + 2) * PAL_HISTOGRAM_HALF)
+
+typedef struct {
+  uint64_t count;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+  uint64_t buckets[PAL_HISTOGRAM_BUCKETS];
+} pal_histogram_t;
+
+/* Single writer: plain loads and stores that a concurrent reader cannot
+ * see torn */
+#define __PAL_HISTOGRAM_LOAD(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+#define __PAL_HISTOGRAM_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELAXED)
+
+static inline size_t
+__pal_histogram_index(uint64_t value)
+{
+  int msb, shift;
+
+  if (value < 2 * PAL_HISTOGRAM_HALF) {
+    return value;
+  }
+  msb = 63 - __builtin_clzll(value);
+  if (msb >= PAL_HISTOGRAM_MAX_BITS) {
+    return PAL_HISTOGRAM_BUCKETS - 1;
+  }
+  shift = msb - PAL_HISTOGRAM_SUB_BITS + 1;
+  return (size_t)shift * PAL_HISTOGRAM_HALF + (value >> shift);
+}
+
+/* Lowest value counted in bucket @i */
+static inline uint64_t
+__pal_histogram_lower(size_t i)
+{
+  size_t shift;
+
+  if (i < 2 * PAL_HISTOGRAM_HALF) {
+    return i;
+  }
+  shift = i / PAL_HISTOGRAM_HALF - 1;
+  return (uint64_t)(i % PAL_HISTOGRAM_HALF + PAL_HISTOGRAM_HALF) << shift;
+}
+
+/* Highest value counted in bucket @i */
+static inline uint64_t
+__pal_histogram_upper(size_t i)
+{
+  return i + 1 < PAL_HISTOGRAM_BUCKETS ? __pal_histogram_lower(i + 1) - 1
+                                       : UINT64_MAX;
+}
+
+/**
+ * pal_histogram_reset - forget every recorded value
+ * @h: histogram to reset, also serves as initialization
+ */
+static inline void
+pal_histogram_reset(pal_histogram_t *h)
+{
+  memset(h, 0, sizeof(*h));
+  h->min = UINT64_MAX;
+}
+
+/**
+ * pal_histogram_record_n - record @value @n times
+ * @h:     histogram, written by the calling thread only
+ * @value: value to record
+ * @n:     number of occurrences
+ */
+static inline void
+pal_histogram_record_n(pal_histogram_t *h, uint64_t value, uint64_t n)
+{
+  uint64_t *bucket = &h->buckets[__pal_histogram_index(value)];
+
+  __PAL_HISTOGRAM_STORE(bucket, __PAL_HISTOGRAM_LOAD(bucket) + n);
+  __PAL_HISTOGRAM_STORE(&h->sum, h->sum + value * n);
+  if (value < h->min) {
+    __PAL_HISTOGRAM_STORE(&h->min, value);
+  }
+  if (value > h->max) {
+    __PAL_HISTOGRAM_STORE(&h->max, value);
+  }
+  __PAL_HISTOGRAM_STORE(&h->count, h->count + n);
+}
+
+static inline void
+pal_histogram_record(pal_histogram_t *h, uint64_t value)
+{
+  pal_histogram_record_n(h, value, 1);
+}
+
+/**
+ * pal_histogram_merge - add the values recorded in @src to @dst
+ * @dst: histogram owned by the caller
+ * @src: histogram to add, may be written concurrently by its owner
+ */
+static inline void
+pal_histogram_merge(pal_histogram_t *dst, const pal_histogram_t *src)
+{
+  uint64_t min = __PAL_HISTOGRAM_LOAD(&src->min);
+  uint64_t max = __PAL_HISTOGRAM_LOAD(&src->max);
+
+  for (size_t i = 0; i < PAL_HISTOGRAM_BUCKETS; i++) {
+    uint64_t n = __PAL_HISTOGRAM_LOAD(&src->buckets[i]);
+    dst->buckets[i] += n;
+    dst->count += n; /* from the buckets so percentiles stay consistent */
+  }
+  dst->sum += __PAL_HISTOGRAM_LOAD(&src->sum);
+  dst->min = min < dst->min ? min : dst->min;
+  dst->max = max > dst->max ? max : dst->max;
+}
+
+static inline uint64_t
+pal_histogram_count(const pal_histogram_t *h)
+{
+  return h->count;
+}
+
+static inline double
+pal_histogram_mean(const pal_histogram_t *h)
+{
+  return h->count ? (double)h->sum / (double)h->count : 0.0;
+}
+
+/**
+ * pal_histogram_percentile - value at or below which @p percent fall
+ * @h: histogram to query
+ * @p: percentile, 0 to 100
+ *
+ * Reports the top of the bucket holding the value, clamped to the observed
+ * range; 0 for an empty histogram.
+ */
+static inline uint64_t
+pal_histogram_percentile(const pal_histogram_t *h, double p)
+{
+  uint64_t rank, seen = 0;
+
+  if (!h->count) {
+    return 0;
+  }
+  rank = (uint64_t)(p / 100.0 * (double)h->count + 0.5);
+  rank = rank < 1 ? 1 : rank > h->count ? h->count : rank;
+
+  for (size_t i = 0; i < PAL_HISTOGRAM_BUCKETS; i++) {
+    seen += h->buckets[i];
+    if (seen >= rank) {
+      uint64_t v = __pal_histogram_upper(i);
+      return v < h->min ? h->min : v > h->max ? h->max : v;
+    }
+  }
+  return h->max;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_HISTOGRAM_H */
@@ -14,6 +14,14 @@ struct pal_list_head {
   struct pal_list_head *next, *prev;
 };
 
+struct pal_hlist_head {
+  struct pal_hlist_node *first;
+};
+
+struct pal_hlist_node {
+  struct pal_hlist_node *next, **pprev;
+};
+
 /*
  * Circular doubly linked list implementation.
  *
@@ -809,4 +817,228 @@ pal_list_count_nodes(struct pal_list_head *head)
 #define pal_list_safe_reset_next(pos, n, member)                               \
   n = pal_list_next_entry(pos, member)
 
+/*
+ * Double linked lists with a single pointer list head.
+ * Mostly useful for hash tables where the two pointer list head is
+ * too wasteful.
+ * You lose the ability to access the tail in O(1).
+ */
+
+#define PAL_HLIST_HEAD_INIT {.first = NULL}
+#define PAL_HLIST_HEAD(name) struct pal_hlist_head name = {.first = NULL}
+#define PAL_INIT_HLIST_HEAD(ptr) ((ptr)->first = NULL)
+
+/**
+ * pal_hlist_node_init - Initialize a pal_hlist_node structure
+ * @h: pal_hlist_node structure to be initialized.
+ */
+static inline void
+pal_hlist_node_init(struct pal_hlist_node *h)
+{
+  h->next = NULL;
+  h->pprev = NULL;
+}
+
+/**
+ * pal_hlist_unhashed - Has node been removed from list and reinitialized?
+ * @h: Node to be checked
+ *
+ * Note that not all removal functions will leave a node in unhashed
+ * state.  For example, pal_hlist_del() leaves the node in an undefined
+ * state.
+ */
+static inline int
+pal_hlist_unhashed(const struct pal_hlist_node *h)
+{
+  return !h->pprev;
+}
+
+/**
+ * pal_hlist_empty - Is the specified pal_hlist_head structure an empty hlist?
+ * @h: Structure to check.
+ */
+static inline int
+pal_hlist_empty(const struct pal_hlist_head *h)
+{
+  return !h->first;
+}
+
+static inline void
+__pal_hlist_del(struct pal_hlist_node *n)
+{
+  struct pal_hlist_node *next = n->next;
+  struct pal_hlist_node **pprev = n->pprev;
+
+  *pprev = next;
+  if (next)
+    next->pprev = pprev;
+}
+
+/**
+ * pal_hlist_del - Delete the specified pal_hlist_node from its list
+ * @n: Node to delete.
+ *
+ * Note that this function leaves the node in undefined state.
+ */
+static inline void
+pal_hlist_del(struct pal_hlist_node *n)
+{
+  __pal_hlist_del(n);
+  n->next = NULL;
+  n->pprev = NULL;
+}
+
+/**
+ * pal_hlist_del_init - Delete the specified pal_hlist_node from its list and
+ *                      initialize
+ * @n: Node to delete.
+ *
+ * Note that this function leaves the node in unhashed state.
+ */
+static inline void
+pal_hlist_del_init(struct pal_hlist_node *n)
+{
+  if (!pal_hlist_unhashed(n)) {
+    __pal_hlist_del(n);
+    pal_hlist_node_init(n);
+  }
+}
+
+/**
+ * pal_hlist_add_head - add a new entry at the beginning of the hlist
+ * @n: new entry to be added
+ * @h: hlist head to add it after
+ *
+ * Insert a new entry after the specified head.
+ * This is good for implementing stacks.
+ */
+static inline void
+pal_hlist_add_head(struct pal_hlist_node *n, struct pal_hlist_head *h)
+{
+  struct pal_hlist_node *first = h->first;
+  n->next = first;
+  if (first)
+    first->pprev = &n->next;
+  h->first = n;
+  n->pprev = &h->first;
+}
+
+/**
+ * pal_hlist_add_before - add a new entry before the one specified
+ * @n: new entry to be added
+ * @next: hlist node to add it before, which must be non-NULL
+ */
+static inline void
+pal_hlist_add_before(struct pal_hlist_node *n, struct pal_hlist_node *next)
+{
+  n->pprev = next->pprev;
+  n->next = next;
+  next->pprev = &n->next;
+  *(n->pprev) = n;
+}
+
+/**
+ * pal_hlist_add_behind - add a new entry after the one specified
+ * @n: new entry to be added
+ * @prev: hlist node to add it after, which must be non-NULL
+ */
+static inline void
+pal_hlist_add_behind(struct pal_hlist_node *n, struct pal_hlist_node *prev)
+{
+  n->next = prev->next;
+  prev->next = n;
+  n->pprev = &prev->next;
+
+  if (n->next)
+    n->next->pprev = &n->next;
+}
+
+/**
+ * pal_hlist_move_list - Move an hlist
+ * @old: pal_hlist_head for old list.
+ * @new: pal_hlist_head for new list.
+ *
+ * Move a list from one list head to another. Fixup the pprev
+ * reference of the first entry if it exists.
+ */
+static inline void
+pal_hlist_move_list(struct pal_hlist_head *old, struct pal_hlist_head *new)
+{
+  new->first = old->first;
+  if (new->first)
+    new->first->pprev = &new->first;
+  old->first = NULL;
+}
+
+#define pal_hlist_entry(ptr, type, member) PAL_CONTAINER_OF(ptr, type, member)
+
+#define pal_hlist_for_each(pos, head)                                          \
+  for (pos = (head)->first; pos; pos = pos->next)
+
+#define pal_hlist_for_each_safe(pos, n, head)                                  \
+  for (pos = (head)->first; pos && ({                                          \
+                              n = pos->next;                                   \
+                              1;                                               \
+                            });                                                \
+       pos = n)
+
+#define pal_hlist_entry_safe(ptr, type, member)                                \
+  ({                                                                           \
+    typeof(ptr) ____ptr = (ptr);                                               \
+    ____ptr ? pal_hlist_entry(____ptr, type, member) : NULL;                   \
+  })
+
+/**
+ * pal_hlist_for_each_entry - iterate over list of given type
+ * @pos:    the type * to use as a loop cursor.
+ * @head:   the head for your list.
+ * @member: the name of the pal_hlist_node within the struct.
+ */
+#define pal_hlist_for_each_entry(pos, head, member)                            \
+  for (pos = pal_hlist_entry_safe((head)->first, typeof(*(pos)), member);      \
+       pos;                                                                    \
+       pos = pal_hlist_entry_safe((pos)->member.next, typeof(*(pos)), member))
+
+/**
+ * pal_hlist_for_each_entry_continue - iterate over a hlist continuing after
+ *                                     current point
+ * @pos:    the type * to use as a loop cursor.
+ * @member: the name of the pal_hlist_node within the struct.
+ */
+#define pal_hlist_for_each_entry_continue(pos, member)                         \
+  for (pos = pal_hlist_entry_safe((pos)->member.next, typeof(*(pos)), member); \
+       pos;                                                                    \
+       pos = pal_hlist_entry_safe((pos)->member.next, typeof(*(pos)), member))
+
+/**
+ * pal_hlist_for_each_entry_safe - iterate over list of given type safe
+ *                                 against removal of list entry
+ * @pos:    the type * to use as a loop cursor.
+ * @n:      a &struct pal_hlist_node to use as temporary storage
+ * @head:   the head for your list.
+ * @member: the name of the pal_hlist_node within the struct.
+ */
+#define pal_hlist_for_each_entry_safe(pos, n, head, member)                    \
+  for (pos = pal_hlist_entry_safe((head)->first, typeof(*pos), member);        \
+       pos && ({                                                               \
+         n = pos->member.next;                                                 \
+         1;                                                                    \
+       });                                                                     \
+       pos = pal_hlist_entry_safe(n, typeof(*pos), member))
+
+/**
+ * pal_hlist_count_nodes - count nodes in the hlist
+ * @head: the head for your hlist.
+ */
+static inline size_t
+pal_hlist_count_nodes(struct pal_hlist_head *head)
+{
+  struct pal_hlist_node *pos;
+  size_t count = 0;
+
+  pal_hlist_for_each(pos, head) count++;
+
+  return count;
+}
+
 #endif /* QWIET_PLATFORM_COMMON_LIST_H */
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Intrusive multi-producer single-consumer queue.
+ *
+ * Algorithm by Dmitry Vyukov ("Intrusive MPSC node-based queue",
+ * 1024cores.net). Producers never block each other: a push is one atomic
+ * exchange plus one release store. The consumer side is wait-free but may
+ * transiently observe an empty queue while a producer is between those two
+ * steps; callers pair the queue with a wakeup that the producer issues after
+ * its push completes (see pal_channel_t).
+ */
+#ifndef QWIET_PLATFORM_COMMON_MPSC_H
+#define QWIET_PLATFORM_COMMON_MPSC_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "qwiet/platform/common/macros.h"
+
+struct pal_mpsc_node {
+  struct pal_mpsc_node *_Atomic next;
+};
+
+struct pal_mpsc_queue {
+  struct pal_mpsc_node *_Atomic head; /* producers swap new nodes in here */
+  struct pal_mpsc_node *tail;         /* consumer pops from here */
+  struct pal_mpsc_node stub;
+};
+
+/**
+ * pal_mpsc_init - initialize an empty queue
+ * @q: queue to initialize
+ */
+static inline void
+pal_mpsc_init(struct pal_mpsc_queue *q)
+{
+  atomic_store_explicit(&q->stub.next, NULL, memory_order_relaxed);
+  atomic_store_explicit(&q->head, &q->stub, memory_order_relaxed);
+  q->tail = &q->stub;
+}
+
+/**
+ * pal_mpsc_push - add a node to the queue
+ * @q:    queue to push onto
+ * @node: node to push, must not currently be queued
+ *
+ * Safe to call concurrently from any number of threads.
+ */
+static inline void
+pal_mpsc_push(struct pal_mpsc_queue *q, struct pal_mpsc_node *node)
+{
+  struct pal_mpsc_node *prev;
+
+  atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+  prev = atomic_exchange_explicit(&q->head, node, memory_order_acq_rel);
+  atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+/**
+ * pal_mpsc_pop - remove the oldest node from the queue
+ * @q: queue to pop from
+ *
+ * Must only be called from the single consumer thread. Returns NULL when the
+ * queue is empty, or when the next node is still being linked in by a
+ * producer.
+ */
+static inline struct pal_mpsc_node *
+pal_mpsc_pop(struct pal_mpsc_queue *q)
+{
+  struct pal_mpsc_node *tail = q->tail;
+  struct pal_mpsc_node *next =
+      atomic_load_explicit(&tail->next, memory_order_acquire);
+
+  if (tail == &q->stub) {
+    if (next == NULL)
+      return NULL;
+    q->tail = next;
+    tail = next;
+    next = atomic_load_explicit(&next->next, memory_order_acquire);
+  }
+
+  if (next) {
+    q->tail = next;
+    return tail;
+  }
+
+  if (tail != atomic_load_explicit(&q->head, memory_order_acquire))
+    return NULL; /* producer is mid-push */
+
+  pal_mpsc_push(q, &q->stub);
+  next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  if (next) {
+    q->tail = next;
+    return tail;
+  }
+  return NULL;
+}
+
+/**
+ * pal_mpsc_entry - get the struct for this entry
+ * @ptr:    the &struct pal_mpsc_node pointer.
+ * @type:   the type of the struct this is embedded in.
+ * @member: the name of the pal_mpsc_node within the struct.
+ */
+#define pal_mpsc_entry(ptr, type, member) PAL_CONTAINER_OF(ptr, type, member)
+
+#endif /* QWIET_PLATFORM_COMMON_MPSC_H */
@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Anti-aliased, pressure-width stroke rasterizer for 4-bit grayscale.
+ *
+ * A stroke is drawn one segment at a time between consecutive pen samples.
+ * Each segment is a capsule whose radius follows the pressure linearly from
+ * one end to the other, so consecutive segments join with round ends. A
+ * pixel is blended towards the ink in proportion to how far its center lies
+ * inside the capsule, quantized to sixteenths.
+ *
+ *   pal_raster_segment(&fb, &pen, prev, next);
+ *
+ * Framebuffers are Y4: two pixels per byte, the even pixel in the low
+ * nibble, 0 black and 15 white, as the e-ink controller scans them out.
+ *
+ * The coverage kernel is picked at first use from what the CPU supports:
+ * AVX2 or SSE2 on x86, NEON on arm64, or the scalar reference. All produce
+ * the same pixels; pal_raster_select() forces one for tests and benchmarks.
+ */
+#ifndef QWIET_PLATFORM_COMMON_RASTER_H
+#define QWIET_PLATFORM_COMMON_RASTER_H
+
+#include <qwiet/platform/common.h>
+#ifdef CONFIG_PAL_LINUX_STYLUS
+#include <qwiet/platform/linux/input/stylus.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  uint8_t *buf;
+  uint32_t width;
+  uint32_t height;
+  uint32_t pitch; /* bytes per row, at least (width + 1) / 2 */
+} pal_raster_fb_t;
+
+typedef struct {
+  float min_width; /* pixels, at zero pressure */
+  float max_width; /* pixels, at full pressure */
+  uint8_t ink;     /* 0 (black) to 15 (white) */
+} pal_raster_pen_t;
+
+typedef struct {
+  float x;
+  float y;
+  float pressure; /* 0 to 1 */
+} pal_raster_point_t;
+
+enum pal_raster_impl {
+  PAL_RASTER_SCALAR,
+  PAL_RASTER_SSE2,
+  PAL_RASTER_AVX2,
+  PAL_RASTER_NEON,
+};
+
+void
+pal_raster_segment(const pal_raster_fb_t *fb,
+                   const pal_raster_pen_t *pen,
+                   pal_raster_point_t a,
+                   pal_raster_point_t b);
+
+static inline uint8_t
+pal_raster_get(const pal_raster_fb_t *fb, uint32_t x, uint32_t y)
+{
+  uint8_t byte = fb->buf[(size_t)y * fb->pitch + x / 2];
+  return x & 1 ? byte >> 4 : byte & 0xf;
+}
+
+static inline void
+pal_raster_fill(const pal_raster_fb_t *fb, uint8_t level)
+{
+  for (uint32_t y = 0; y < fb->height; y++) {
+    memset(
+        fb->buf + (size_t)y * fb->pitch, level * 0x11, (fb->width + 1) / 2);
+  }
+}
+
+#ifdef CONFIG_PAL_LINUX_STYLUS
+/**
+ * pal_raster_point_from_stylus - place a stylus sample on the framebuffer
+ * @s:            sample in device units
+ * @scale_x:      framebuffer pixels per device unit, horizontally
+ * @scale_y:      framebuffer pixels per device unit, vertically
+ * @pressure_max: top of the device's ABS_PRESSURE range
+ */
+static inline pal_raster_point_t
+pal_raster_point_from_stylus(const pal_stylus_sample_t *s,
+                             float scale_x,
+                             float scale_y,
+                             int32_t pressure_max)
+{
+  float p = pressure_max > 0 ? (float)s->pressure / (float)pressure_max : 0;
+  return (pal_raster_point_t){.x = (float)s->x * scale_x,
+                              .y = (float)s->y * scale_y,
+                              .pressure = p < 0 ? 0 : p > 1 ? 1 : p};
+}
+#endif
+
+bool
+pal_raster_supported(enum pal_raster_impl impl);
+
+int
+pal_raster_select(enum pal_raster_impl impl);
+
+enum pal_raster_impl
+pal_raster_selected(void);
+
+const char *
+pal_raster_impl_name(enum pal_raster_impl impl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_RASTER_H */
@@ -0,0 +1,327 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Red-black tree implementation.
+ *
+ * Adapted from the Linux kernel (include/linux/rbtree.h,
+ * include/linux/rbtree_augmented.h and lib/rbtree.c) for userspace use.
+ * Augmented trees and the RCU-safe variants are not ported.
+ * Original authors: Andrea Arcangeli, David Woodhouse, Michel Lespinasse
+ *
+ * As in the kernel, callers may open-code their insert and search loops so
+ * the comparison inlines; pal_rb_add() and pal_rb_find() cover the common
+ * case with a comparator the compiler can still inline.
+ */
+#ifndef QWIET_PLATFORM_COMMON_RBTREE_H
+#define QWIET_PLATFORM_COMMON_RBTREE_H
+
+#include <stdbool.h>
+
+#include "qwiet/platform/common/macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pal_rb_node {
+  unsigned long __rb_parent_color;
+  struct pal_rb_node *rb_right;
+  struct pal_rb_node *rb_left;
+} __attribute__((aligned(sizeof(long))));
+
+struct pal_rb_root {
+  struct pal_rb_node *rb_node;
+};
+
+/*
+ * Leftmost-cached rbtrees.
+ *
+ * We do not cache the rightmost node based on footprint
+ * size vs number of potential users that could benefit
+ * from O(1) pal_rb_last(). Just not worth it, users that want
+ * this feature can always implement the logic explicitly.
+ * Furthermore, users that want to cache both pointers may
+ * find it a bit asymmetric, but that's ok.
+ */
+struct pal_rb_root_cached {
+  struct pal_rb_root rb_root;
+  struct pal_rb_node *rb_leftmost;
+};
+
+typedef bool (*pal_rb_less_fn)(struct pal_rb_node *a,
+                               const struct pal_rb_node *b);
+typedef int (*pal_rb_cmp_fn)(const void *key, const struct pal_rb_node *node);
+
+#define pal_rb_parent(r) ((struct pal_rb_node *)((r)->__rb_parent_color & ~3))
+
+#define PAL_RB_ROOT ((struct pal_rb_root){NULL})
+#define PAL_RB_ROOT_CACHED ((struct pal_rb_root_cached){{NULL}, NULL})
+
+#define pal_rb_entry(ptr, type, member) PAL_CONTAINER_OF(ptr, type, member)
+
+#define PAL_RB_EMPTY_ROOT(root) ((root)->rb_node == NULL)
+
+/* 'empty' nodes are nodes that are known not to be inserted in an rbtree */
+#define PAL_RB_EMPTY_NODE(node)                                                \
+  ((node)->__rb_parent_color == (unsigned long)(node))
+#define PAL_RB_CLEAR_NODE(node)                                                \
+  ((node)->__rb_parent_color = (unsigned long)(node))
+
+void
+pal_rb_insert_color(struct pal_rb_node *node, struct pal_rb_root *root);
+
+void
+pal_rb_erase(struct pal_rb_node *node, struct pal_rb_root *root);
+
+/* Find logical next and previous nodes in a tree */
+struct pal_rb_node *
+pal_rb_next(const struct pal_rb_node *node);
+
+struct pal_rb_node *
+pal_rb_prev(const struct pal_rb_node *node);
+
+struct pal_rb_node *
+pal_rb_first(const struct pal_rb_root *root);
+
+struct pal_rb_node *
+pal_rb_last(const struct pal_rb_root *root);
+
+/* Postorder iteration - always visit the parent after its children */
+struct pal_rb_node *
+pal_rb_first_postorder(const struct pal_rb_root *root);
+
+struct pal_rb_node *
+pal_rb_next_postorder(const struct pal_rb_node *node);
+
+/* Fast replacement of a single node without remove/rebalance/add/rebalance */
+void
+pal_rb_replace_node(struct pal_rb_node *victim,
+                    struct pal_rb_node *new,
+                    struct pal_rb_root *root);
+
+static inline void
+pal_rb_link_node(struct pal_rb_node *node,
+                 struct pal_rb_node *parent,
+                 struct pal_rb_node **rb_link)
+{
+  node->__rb_parent_color = (unsigned long)parent;
+  node->rb_left = node->rb_right = NULL;
+
+  *rb_link = node;
+}
+
+#define pal_rb_entry_safe(ptr, type, member)                                   \
+  ({                                                                           \
+    typeof(ptr) ____ptr = (ptr);                                               \
+    ____ptr ? pal_rb_entry(____ptr, type, member) : NULL;                      \
+  })
+
+/**
+ * pal_rbtree_postorder_for_each_entry_safe - iterate in post-order over rb_root
+ * of given type allowing the backing memory of @pos to be invalidated
+ *
+ * @pos:   the 'type *' to use as a loop cursor.
+ * @n:     another 'type *' to use as temporary storage
+ * @root:  'pal_rb_root *' of the rbtree.
+ * @field: the name of the pal_rb_node field within 'type'.
+ *
+ * pal_rbtree_postorder_for_each_entry_safe() provides a similar guarantee as
+ * pal_list_for_each_entry_safe() and allows the iteration to continue
+ * independent of changes to @pos by the body of the loop.
+ *
+ * Note, however, that it cannot handle other modifications that re-order the
+ * rbtree it is iterating over. This includes calling pal_rb_erase() on @pos,
+ * as pal_rb_erase() may rebalance the tree, causing us to miss some nodes.
+ */
+#define pal_rbtree_postorder_for_each_entry_safe(pos, n, root, field)          \
+  for (pos = pal_rb_entry_safe(pal_rb_first_postorder(root), typeof(*pos),     \
+                               field);                                         \
+       pos && ({                                                               \
+         n = pal_rb_entry_safe(pal_rb_next_postorder(&pos->field),             \
+                               typeof(*pos), field);                           \
+         1;                                                                    \
+       });                                                                     \
+       pos = n)
+
+/* Same as pal_rb_first(), but O(1) */
+#define pal_rb_first_cached(root) (root)->rb_leftmost
+
+static inline void
+pal_rb_insert_color_cached(struct pal_rb_node *node,
+                           struct pal_rb_root_cached *root,
+                           bool leftmost)
+{
+  if (leftmost)
+    root->rb_leftmost = node;
+  pal_rb_insert_color(node, &root->rb_root);
+}
+
+static inline struct pal_rb_node *
+pal_rb_erase_cached(struct pal_rb_node *node, struct pal_rb_root_cached *root)
+{
+  struct pal_rb_node *leftmost = NULL;
+
+  if (root->rb_leftmost == node)
+    leftmost = root->rb_leftmost = pal_rb_next(node);
+
+  pal_rb_erase(node, &root->rb_root);
+
+  return leftmost;
+}
+
+/**
+ * pal_rb_add_cached() - insert @node into the leftmost cached tree @tree
+ * @node: node to insert
+ * @tree: leftmost cached tree to insert @node into
+ * @less: operator defining the (partial) node order
+ *
+ * Nodes that compare equal are inserted after the existing ones, so equal
+ * keys come out in insertion order.
+ *
+ * Returns @node when it is the new leftmost, or NULL.
+ */
+static inline struct pal_rb_node *
+pal_rb_add_cached(struct pal_rb_node *node,
+                  struct pal_rb_root_cached *tree,
+                  pal_rb_less_fn less)
+{
+  struct pal_rb_node **link = &tree->rb_root.rb_node;
+  struct pal_rb_node *parent = NULL;
+  bool leftmost = true;
+
+  while (*link) {
+    parent = *link;
+    if (less(node, parent)) {
+      link = &parent->rb_left;
+    } else {
+      link = &parent->rb_right;
+      leftmost = false;
+    }
+  }
+
+  pal_rb_link_node(node, parent, link);
+  pal_rb_insert_color_cached(node, tree, leftmost);
+
+  return leftmost ? node : NULL;
+}
+
+/**
+ * pal_rb_add() - insert @node into @tree
+ * @node: node to insert
+ * @tree: tree to insert @node into
+ * @less: operator defining the (partial) node order
+ */
+static inline void
+pal_rb_add(struct pal_rb_node *node,
+           struct pal_rb_root *tree,
+           pal_rb_less_fn less)
+{
+  struct pal_rb_node **link = &tree->rb_node;
+  struct pal_rb_node *parent = NULL;
+
+  while (*link) {
+    parent = *link;
+    if (less(node, parent))
+      link = &parent->rb_left;
+    else
+      link = &parent->rb_right;
+  }
+
+  pal_rb_link_node(node, parent, link);
+  pal_rb_insert_color(node, tree);
+}
+
+/**
+ * pal_rb_find() - find @key in tree @tree
+ * @key:  key to match
+ * @tree: tree to search
+ * @cmp:  operator defining the node order
+ *
+ * Returns the rb_node matching @key or NULL.
+ */
+static inline struct pal_rb_node *
+pal_rb_find(const void *key,
+            const struct pal_rb_root *tree,
+            pal_rb_cmp_fn cmp)
+{
+  struct pal_rb_node *node = tree->rb_node;
+
+  while (node) {
+    int c = cmp(key, node);
+
+    if (c < 0)
+      node = node->rb_left;
+    else if (c > 0)
+      node = node->rb_right;
+    else
+      return node;
+  }
+
+  return NULL;
+}
+
+/**
+ * pal_rb_find_first() - find the first @key in @tree
+ * @key:  key to match
+ * @tree: tree to search
+ * @cmp:  operator defining node order
+ *
+ * Returns the leftmost node matching @key, or NULL.
+ */
+static inline struct pal_rb_node *
+pal_rb_find_first(const void *key,
+                  const struct pal_rb_root *tree,
+                  pal_rb_cmp_fn cmp)
+{
+  struct pal_rb_node *node = tree->rb_node;
+  struct pal_rb_node *match = NULL;
+
+  while (node) {
+    int c = cmp(key, node);
+
+    if (c <= 0) {
+      if (!c)
+        match = node;
+      node = node->rb_left;
+    } else if (c > 0) {
+      node = node->rb_right;
+    }
+  }
+
+  return match;
+}
+
+/**
+ * pal_rb_lower_bound() - find the first node not ordered before @key
+ * @key:  key to match
+ * @tree: tree to search
+ * @cmp:  operator defining node order
+ *
+ * Returns the leftmost node for which @cmp(@key, node) <= 0, or NULL when
+ * every node orders before @key. Walk on with pal_rb_next() for range
+ * lookups.
+ */
+static inline struct pal_rb_node *
+pal_rb_lower_bound(const void *key,
+                   const struct pal_rb_root *tree,
+                   pal_rb_cmp_fn cmp)
+{
+  struct pal_rb_node *node = tree->rb_node;
+  struct pal_rb_node *match = NULL;
+
+  while (node) {
+    if (cmp(key, node) <= 0) {
+      match = node;
+      node = node->rb_left;
+    } else {
+      node = node->rb_right;
+    }
+  }
+
+  return match;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_RBTREE_H */
@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Uniform grid index over stroke segments, for eraser hit testing, lasso
+ * selection and finding what to redraw in a damaged region.
+ *
+ * Strokes are added a segment at a time, as they are drawn, under an id the
+ * caller picks, and removed whole. Each segment is listed, with its
+ * bounding box, in every grid cell the box touches, so a query only looks
+ * at the cells under it and the boxes stored there; the segments themselves
+ * are only read for the exact test of a circle query.
+ *
+ *   pal_spatial_add(&index, id, &pen, prev, next);
+ *   ...
+ *   pal_spatial_query_circle(&index, x, y, eraser_radius, erase, &ctx);
+ *
+ * Every stroke a query finds is reported once. A segment's width runs
+ * from that of its start to that of its end, as the rasterizer draws it;
+ * pal_spatial_query_circle() reports the strokes one of whose segments the
+ * circle touches, pal_spatial_query_rect() those with a segment whose
+ * bounding box, at the wider end's width, meets the rectangle. Cells are
+ * square, a power of two in pixels; with cells around the size of a word of
+ * handwriting a query visits a handful of cells whatever the page holds.
+ *
+ * Not thread safe.
+ */
+#ifndef QWIET_PLATFORM_COMMON_SPATIAL_H
+#define QWIET_PLATFORM_COMMON_SPATIAL_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/damage.h>
+#include <qwiet/platform/common/hashtable.h>
+#include <qwiet/platform/common/raster.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default cell size, 64 pixels, the canvas tile size */
+#define PAL_SPATIAL_CELL_SHIFT 6
+
+struct pal_spatial_cell;
+
+typedef struct {
+  pal_hashtable_t strokes;
+  struct pal_spatial_cell *cells;
+  uint32_t cols;
+  uint32_t rows;
+  uint32_t shift; /* log2 of the cell size */
+  uint32_t stamp; /* current query, to report each stroke once */
+  size_t segments;
+} pal_spatial_t;
+
+/* Called per stroke found by a query; nonzero ends the query */
+typedef int (*pal_spatial_visit_fn)(void *ctx, uint32_t id);
+
+void
+pal_spatial_init(pal_spatial_t *index,
+                 uint32_t width,
+                 uint32_t height,
+                 uint32_t shift);
+
+void
+pal_spatial_cleanup(pal_spatial_t *index);
+
+void
+pal_spatial_add(pal_spatial_t *index,
+                uint32_t id,
+                const pal_raster_pen_t *pen,
+                pal_raster_point_t a,
+                pal_raster_point_t b);
+
+bool
+pal_spatial_remove(pal_spatial_t *index, uint32_t id);
+
+bool
+pal_spatial_bounds(const pal_spatial_t *index, uint32_t id, pal_rect_t *out);
+
+size_t
+pal_spatial_query_rect(pal_spatial_t *index,
+                       pal_rect_t rect,
+                       pal_spatial_visit_fn visit,
+                       void *ctx);
+
+size_t
+pal_spatial_query_circle(pal_spatial_t *index,
+                         float x,
+                         float y,
+                         float r,
+                         pal_spatial_visit_fn visit,
+                         void *ctx);
+
+/* Strokes in the index */
+static inline size_t
+pal_spatial_count(const pal_spatial_t *index)
+{
+  return pal_hashtable_count(&index->strokes);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_SPATIAL_H */
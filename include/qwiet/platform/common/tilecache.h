@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Compressed store for the canvas tiles of off-screen pages.
+ *
+ * Tiles are keyed by page and tile index. The most recently used tiles stay
+ * raw, up to a budget in bytes; older ones are kept only run-length
+ * compressed and are expanded again when next read. Mostly white pages
+ * shrink to a few percent, so a notebook stays in RAM and a page flip is a
+ * pal_canvas_load() instead of replaying its strokes:
+ *
+ *   pal_canvas_save(&canvas, &cache, page);
+ *   pal_canvas_load(&canvas, &cache, next);
+ *
+ * Compression is PackBits over the packed Y4 bytes. A tile that is read
+ * but not rewritten keeps its compressed copy, so pushing it out again
+ * costs a free.
+ *
+ * Not thread safe.
+ */
+#ifndef QWIET_PLATFORM_COMMON_TILECACHE_H
+#define QWIET_PLATFORM_COMMON_TILECACHE_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/canvas.h>
+#include <qwiet/platform/common/hashtable.h>
+#include <qwiet/platform/common/list.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default raw budget, from Kconfig */
+#define PAL_TILECACHE_BUDGET ((size_t)CONFIG_PAL_COMMON_TILECACHE_KB * 1024)
+
+typedef struct {
+  pal_hashtable_t table;
+  struct pal_list_head lru; /* raw tiles, most recently used first */
+  size_t budget;            /* bytes of raw tiles kept */
+  size_t tiles;
+  size_t raw;             /* tiles held raw */
+  size_t compressed;      /* tiles with a compressed copy */
+  size_t compressed_size; /* bytes of those copies */
+  uint64_t hits;          /* reads served raw */
+  uint64_t misses;        /* reads that decompressed */
+} pal_tilecache_t;
+
+void
+pal_tilecache_init(pal_tilecache_t *cache, size_t budget);
+
+void
+pal_tilecache_cleanup(pal_tilecache_t *cache);
+
+void
+pal_tilecache_put(pal_tilecache_t *cache,
+                  uint32_t page,
+                  uint32_t tile,
+                  const uint8_t *px);
+
+const uint8_t *
+pal_tilecache_get(pal_tilecache_t *cache, uint32_t page, uint32_t tile);
+
+void
+pal_tilecache_drop(pal_tilecache_t *cache, uint32_t page, uint32_t tile);
+
+void
+pal_tilecache_drop_page(pal_tilecache_t *cache, uint32_t page);
+
+/* Reads served without decompressing, 0 to 1 */
+static inline double
+pal_tilecache_hit_rate(const pal_tilecache_t *cache)
+{
+  uint64_t reads = cache->hits + cache->misses;
+  return reads ? (double)cache->hits / (double)reads : 0.0;
+}
+
+/* Raw size over compressed size of the compressed tiles */
+static inline double
+pal_tilecache_ratio(const pal_tilecache_t *cache)
+{
+  return cache->compressed_size
+             ? (double)cache->compressed * PAL_CANVAS_TILE_BYTES /
+                   (double)cache->compressed_size
+             : 0.0;
+}
+
+void
+pal_canvas_save(const pal_canvas_t *canvas,
+                pal_tilecache_t *cache,
+                uint32_t page);
+
+void
+pal_canvas_load(pal_canvas_t *canvas, pal_tilecache_t *cache, uint32_t page);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWIET_PLATFORM_COMMON_TILECACHE_H */
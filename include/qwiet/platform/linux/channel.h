@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Many-to-one message channel: an intrusive MPSC queue paired with a waker.
+ *
+ * Worker threads (e.g. the HTTP thread) send nodes embedded in their
+ * messages; the main loop polls pal_channel_fd() and calls pal_channel_recv()
+ * until it returns NULL. Messages are owned by the caller throughout.
+ */
+#ifndef QWIET_CHANNEL_H
+#define QWIET_CHANNEL_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/mpsc.h>
+#include <qwiet/platform/linux/waker.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  pal_waker_t waker;
+  struct pal_mpsc_queue queue;
+} pal_channel_t;
+
+void
+pal_channel_init(pal_channel_t *chan);
+
+void
+pal_channel_send(pal_channel_t *chan, struct pal_mpsc_node *node);
+
+struct pal_mpsc_node *
+pal_channel_recv(pal_channel_t *chan);
+
+int
+pal_channel_fd(pal_channel_t *chan);
+
+void
+pal_channel_cleanup(pal_channel_t *chan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
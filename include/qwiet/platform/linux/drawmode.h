@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Drawing/idle display mode controller.
+ *
+ * An e-ink panel drawn on in its normal waveforms lags behind the pen; the
+ * fast waveforms keep up but ghost, so the display should run fast only
+ * while the user is drawing. pal_drawmode_feed() takes every stylus sample
+ * and pal_drawmode_t decides when to switch:
+ *
+ *   - FAST once the tip has touched for enter_samples reports in a row, so
+ *     a brush of the tip or a hovering pen does not flip the panel
+ *   - back to NORMAL after idle without the pen touching or in range, and
+ *     never sooner than hold after entering FAST, so the pauses between
+ *     strokes and letters do not make it flap
+ *
+ * The switch itself is the caller's: the set hook issues the driver's mode
+ * ioctl (e.g. ROCKCHIP_EBC_DRIVER_MODE_FAST/NORMAL) and may fail, in which
+ * case the controller stays in the old mode and retries on the next
+ * sample or timeout. The idle timeout runs on a pal_timer_t; poll
+ * pal_drawmode_fd() and call pal_drawmode_dispatch() when it is readable.
+ *
+ *   pal_drawmode_init(&dm, NULL, set_ebc_mode, &drm);
+ *   ...
+ *   if (pal_stylus_feed(&pen, &ev, &sample)) {
+ *     pal_drawmode_feed(&dm, &sample);
+ *   }
+ *
+ * Not thread safe.
+ */
+#ifndef QWIET_DRAWMODE_H
+#define QWIET_DRAWMODE_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/linux/input/stylus.h>
+#include <qwiet/platform/linux/timer.h>
+#include <qwiet/platform/posix/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum pal_drawmode {
+  PAL_DRAWMODE_NORMAL,
+  PAL_DRAWMODE_FAST,
+};
+
+/* Switch the display to @mode; 0 on success, -1 to stay in the old mode */
+typedef int (*pal_drawmode_set_fn)(void *ctx, enum pal_drawmode mode);
+
+typedef struct {
+  unsigned int enter_samples; /* touching reports before going FAST */
+  pal_timeout_t idle;         /* without activity before going NORMAL */
+  pal_timeout_t hold;         /* shortest stay in FAST */
+} pal_drawmode_config_t;
+
+#define PAL_DRAWMODE_CONFIG_DEFAULT                                            \
+  ((pal_drawmode_config_t){                                                    \
+      .enter_samples = 2, .idle = PAL_MSEC(800), .hold = PAL_MSEC(300)})
+
+typedef struct {
+  pal_drawmode_config_t cfg;
+  pal_drawmode_set_fn set;
+  void *ctx;
+  pal_timer_t timer;
+  enum pal_drawmode mode;
+  bool armed;          /* the timer is running */
+  unsigned int streak; /* consecutive touching reports */
+  int64_t entered;     /* when FAST began */
+  int64_t active;      /* last report with the pen touching or in range */
+} pal_drawmode_t;
+
+void
+pal_drawmode_init(pal_drawmode_t *dm,
+                  const pal_drawmode_config_t *cfg,
+                  pal_drawmode_set_fn set,
+                  void *ctx);
+
+void
+pal_drawmode_feed(pal_drawmode_t *dm, const pal_stylus_sample_t *sample);
+
+int
+pal_drawmode_fd(pal_drawmode_t *dm);
+
+void
+pal_drawmode_dispatch(pal_drawmode_t *dm);
+
+static inline enum pal_drawmode
+pal_drawmode_get(const pal_drawmode_t *dm)
+{
+  return dm->mode;
+}
+
+void
+pal_drawmode_cleanup(pal_drawmode_t *dm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
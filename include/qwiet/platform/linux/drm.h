@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Double buffered display output on DRM/KMS dumb buffers.
+ *
+ * pal_drm_open() picks the first connected connector of a card, allocates
+ * two XRGB8888 dumb buffers in its preferred mode, maps them and scans out
+ * the first. The application draws into pal_drm_back() and hands it over
+ * with pal_drm_present(), which queues a page flip and returns at once. The
+ * flip completes asynchronously: poll pal_drm_fd() for POLLIN and call
+ * pal_drm_dispatch(). While a flip is in flight pal_drm_back() returns
+ * NULL rather than waiting, since both buffers belong to the display until
+ * the flip lands.
+ *
+ *   if ((buf = pal_drm_back(&drm))) {
+ *     draw(buf->map, buf->pitch);
+ *     pal_drm_present(&drm);
+ *   }
+ *   ...
+ *   if (fds[i].revents & POLLIN) {
+ *     pal_drm_dispatch(&drm);
+ *   }
+ *
+ * pal_drm_open_headless() gives the same interface without a card: buffers
+ * are anonymous memory and each flip completes as soon as it is queued, so
+ * drawing code runs on any machine. For real scanout without hardware, load
+ * vkms and open its card.
+ */
+#ifndef QWIET_DRM_H
+#define QWIET_DRM_H
+
+#include <drm/drm_mode.h>
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/posix/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  uint8_t *map;
+  uint32_t pitch; /* bytes per row */
+  uint32_t handle;
+  uint32_t fb_id;
+  size_t size;
+} pal_drm_buffer_t;
+
+typedef struct {
+  int fd; /* the card, or an eventfd when headless */
+  bool headless;
+  bool pending; /* a flip is in flight */
+  unsigned int back;
+  uint32_t width;
+  uint32_t height;
+  uint32_t connector_id;
+  uint32_t crtc_id;
+  uint64_t flips; /* completed */
+  struct drm_mode_modeinfo mode;
+  struct drm_mode_crtc saved; /* restored on cleanup */
+  pal_drm_buffer_t buffers[2];
+} pal_drm_t;
+
+int
+pal_drm_open(pal_drm_t *drm, const char *path);
+
+int
+pal_drm_open_headless(pal_drm_t *drm, uint32_t width, uint32_t height);
+
+int
+pal_drm_fd(pal_drm_t *drm);
+
+pal_drm_buffer_t *
+pal_drm_back(pal_drm_t *drm);
+
+int
+pal_drm_present(pal_drm_t *drm);
+
+int
+pal_drm_dispatch(pal_drm_t *drm);
+
+int
+pal_drm_wait_ready(pal_drm_t *drm, pal_timeout_t timeout);
+
+void
+pal_drm_cleanup(pal_drm_t *drm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
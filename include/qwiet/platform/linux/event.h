@@ -10,6 +10,9 @@ extern "C" {
 int
 pal_event_fd();
 
+int
+pal_event_fd_counter(void);
+
 int
 pal_event_write(int sock, uint64_t val);
 
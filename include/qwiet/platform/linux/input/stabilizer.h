@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Streaming stroke stabilizer and short-horizon pen prediction.
+ *
+ * Sits between pal_stylus_feed() and whatever draws: each sample goes in,
+ * one comes out with x and y smoothed by the configured method.
+ *
+ *   - AVERAGE: mean of the last window positions; simple, lags by half the
+ *     window at any speed
+ *   - EURO: the 1-euro filter, a low pass whose cutoff rises with speed,
+ *     so a resting pen is steady and a fast one barely lags
+ *   - KALMAN: constant velocity model per axis, tracking speed as well
+ *
+ * Every method keeps a velocity estimate, which pal_stabilizer_predict()
+ * uses to extrapolate the pen a few milliseconds past the last report.
+ * Drawing predicted ink ahead of the pen and replacing it when the next
+ * report arrives hides part of the panel's latency:
+ *
+ *   if (pal_stylus_feed(&pen, &ev, &raw)) {
+ *     pal_stabilizer_feed(&st, &raw, &sample);
+ *     draw_to(&sample);                      (over last predicted ink)
+ *     if (pal_stabilizer_predict(&st, PAL_MSEC(8), &ahead)) {
+ *       draw_predicted(&sample, &ahead);
+ *     }
+ *   }
+ *
+ * Filtering runs per stroke: a sample without the tip touching passes
+ * through unchanged and resets the state, so a stroke never starts with
+ * the tail of the one before. Timestamps are the samples' time_ns; other
+ * fields are copied from the input. Nothing allocates.
+ *
+ * Not thread safe.
+ */
+#ifndef QWIET_STABILIZER_H
+#define QWIET_STABILIZER_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/linux/input/stylus.h>
+#include <qwiet/platform/posix/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Most positions AVERAGE can span */
+#define PAL_STABILIZER_WINDOW 16
+
+enum pal_stabilizer_method {
+  PAL_STABILIZER_NONE,
+  PAL_STABILIZER_AVERAGE,
+  PAL_STABILIZER_EURO,
+  PAL_STABILIZER_KALMAN,
+};
+
+/* Distances are in device units, rates per second */
+typedef struct {
+  enum pal_stabilizer_method method;
+  unsigned int window;     /* AVERAGE: positions averaged */
+  double min_cutoff;       /* EURO: cutoff at rest, Hz */
+  double beta;             /* EURO: cutoff gained per unit/s of speed */
+  double d_cutoff;         /* EURO: cutoff of the speed estimate, Hz */
+  double accel_noise;      /* KALMAN: hand acceleration, units/s^2 */
+  double position_noise;   /* KALMAN: digitizer jitter, units */
+  pal_timeout_t max_ahead; /* longest prediction */
+} pal_stabilizer_config_t;
+
+/* Tuned for a digitizer of about 100 units per millimetre */
+#define PAL_STABILIZER_CONFIG_DEFAULT                                          \
+  ((pal_stabilizer_config_t){.method = PAL_STABILIZER_EURO,                    \
+                             .window = 4,                                      \
+                             .min_cutoff = 1.0,                                \
+                             .beta = 0.005,                                    \
+                             .d_cutoff = 10.0,                                 \
+                             .accel_noise = 3e5,                               \
+                             .position_noise = 10.0,                           \
+                             .max_ahead = PAL_MSEC(20)})
+
+struct pal_stabilizer_axis {
+  double pos;       /* filtered position */
+  double vel;       /* units/s */
+  double cov[2][2]; /* KALMAN: of pos and vel */
+  int64_t sum;      /* AVERAGE: of the positions in the window */
+  int32_t raw;      /* last input */
+};
+
+typedef struct {
+  pal_stabilizer_config_t cfg;
+  struct pal_stabilizer_axis axis[2];
+  int32_t window[PAL_STABILIZER_WINDOW][2];
+  unsigned int count;       /* samples into the stroke */
+  pal_stylus_sample_t last; /* last output */
+} pal_stabilizer_t;
+
+void
+pal_stabilizer_init(pal_stabilizer_t *st, const pal_stabilizer_config_t *cfg);
+
+void
+pal_stabilizer_reset(pal_stabilizer_t *st);
+
+void
+pal_stabilizer_feed(pal_stabilizer_t *st,
+                    const pal_stylus_sample_t *in,
+                    pal_stylus_sample_t *out);
+
+bool
+pal_stabilizer_predict(const pal_stabilizer_t *st,
+                       pal_timeout_t ahead,
+                       pal_stylus_sample_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
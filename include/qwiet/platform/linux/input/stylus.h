@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Assemble evdev pen events into stylus samples.
+ *
+ * A tablet reports one pen position as a run of EV_ABS/EV_KEY events closed
+ * by SYN_REPORT, and only sends the axes that changed. pal_stylus_feed()
+ * folds each event into the pen state and hands out a complete sample at
+ * every SYN_REPORT. After SYN_DROPPED the partial report is discarded up to
+ * the next SYN_REPORT; the axes that changed while events were lost keep
+ * their last known value until the pen reports them again.
+ *
+ *   while (read(fd, &ev, sizeof(ev)) == sizeof(ev)) {
+ *     if (pal_stylus_feed(&pen, &ev, &sample)) {
+ *       draw(&sample);
+ *     }
+ *   }
+ */
+#ifndef QWIET_STYLUS_H
+#define QWIET_STYLUS_H
+
+#include <qwiet/platform/common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PAL_STYLUS_BUTTON_1 0x1 /* BTN_STYLUS */
+#define PAL_STYLUS_BUTTON_2 0x2 /* BTN_STYLUS2 */
+
+typedef struct {
+  int64_t time_ns; /* timestamp of the SYN_REPORT */
+  int32_t x;
+  int32_t y;
+  int32_t pressure;
+  int32_t distance;
+  int32_t tilt_x;
+  int32_t tilt_y;
+  uint8_t touching; /* BTN_TOUCH: tip on the surface */
+  uint8_t in_range; /* a tool is in proximity */
+  uint8_t eraser;   /* the tool is BTN_TOOL_RUBBER */
+  uint8_t buttons;  /* PAL_STYLUS_BUTTON_* */
+} pal_stylus_sample_t;
+
+typedef struct {
+  pal_stylus_sample_t state;
+  bool dropping; /* discarding up to the next SYN_REPORT */
+} pal_stylus_t;
+
+void
+pal_stylus_init(pal_stylus_t *pen);
+
+bool
+pal_stylus_feed(pal_stylus_t *pen,
+                const struct input_event *ev,
+                pal_stylus_sample_t *sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,168 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Stackless cooperative tasks on a single-threaded epoll executor.
+ *
+ * Tasks are protothreads: a task function is re-entered from the top on
+ * every resume and jumps back to the last await through a switch on the
+ * line number it stored. A task therefore costs only its own struct, but
+ * local variables do not survive an await; keep state in the struct that
+ * embeds the struct pal_task.
+ *
+ * Technique from Adam Dunkels' protothreads (Contiki OS).
+ *
+ *   struct echo {
+ *     struct pal_task task;
+ *     int sock;
+ *   };
+ *
+ *   static int
+ *   echo_run(struct pal_task *task)
+ *   {
+ *     struct echo *e = PAL_CONTAINER_OF(task, struct echo, task);
+ *     PAL_TASK_BEGIN(task);
+ *     for (;;) {
+ *       PAL_TASK_AWAIT_FD(task, e->sock, POLLIN, PAL_FOREVER);
+ *       ...
+ *     }
+ *     PAL_TASK_END(task);
+ *   }
+ *
+ * Every await leaves its outcome in task->result using the pal_sem_wait()
+ * convention: 1 = ready, 0 = timed out, -1 = error. Only one task may wait
+ * on a given fd at a time. Other threads reach a task through an fd, e.g.
+ * await pal_channel_fd().
+ */
+#ifndef QWIET_TASK_H
+#define QWIET_TASK_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/list.h>
+#include <qwiet/platform/common/rbtree.h>
+#include <qwiet/platform/linux/timer.h>
+#include <qwiet/platform/posix/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Return values of a task function */
+#define PAL_TASK_DONE 0
+#define PAL_TASK_READY 1   /* yielded, run again next pass */
+#define PAL_TASK_BLOCKED 2 /* parked on an await */
+
+struct pal_task;
+struct pal_executor;
+
+typedef int (*pal_task_fn)(struct pal_task *task);
+
+struct pal_task {
+  pal_task_fn fn;
+  struct pal_executor *exec;
+  unsigned int lc; /* resume point */
+  int result;      /* outcome of the last await */
+  int fd;          /* fd registered with epoll, -1 if none */
+  uint32_t revents;
+  uint8_t wait; /* what the task is parked on */
+  int64_t deadline;
+  struct pal_list_head node; /* ready list or semaphore wait list */
+  struct pal_rb_node timer;  /* in exec->timers while deadline >= 0 */
+};
+
+typedef struct pal_executor {
+  int epfd;
+  size_t ntasks;
+  struct pal_list_head ready;
+  struct pal_rb_root_cached timers; /* by deadline, FIFO among equals */
+} pal_executor_t;
+
+typedef struct {
+  unsigned int count;
+  struct pal_list_head waiters;
+} pal_task_sem_t;
+
+#define PAL_TASK_BEGIN(task)                                                   \
+  switch ((task)->lc) {                                                        \
+  case 0:
+
+#define PAL_TASK_END(task)                                                     \
+  }                                                                            \
+  (task)->lc = 0;                                                              \
+  return PAL_TASK_DONE
+
+#define PAL_TASK_EXIT(task)                                                    \
+  do {                                                                         \
+    (task)->lc = 0;                                                            \
+    return PAL_TASK_DONE;                                                      \
+  } while (0)
+
+#define __PAL_TASK_SUSPEND(task, status)                                       \
+  do {                                                                         \
+    (task)->lc = __LINE__;                                                     \
+    return (status);                                                           \
+  case __LINE__:;                                                              \
+  } while (0)
+
+#define PAL_TASK_YIELD(task) __PAL_TASK_SUSPEND(task, PAL_TASK_READY)
+
+#define PAL_TASK_AWAIT_FD(task, fd, events, timeout)                           \
+  do {                                                                         \
+    pal_task_wait_fd((task), (fd), (events), (timeout));                       \
+    __PAL_TASK_SUSPEND(task, PAL_TASK_BLOCKED);                                \
+  } while (0)
+
+#define PAL_TASK_AWAIT_TIMER(task, timer, timeout)                             \
+  PAL_TASK_AWAIT_FD(task, pal_timer_fd(timer), POLLIN, timeout)
+
+#define PAL_TASK_SLEEP(task, duration)                                         \
+  do {                                                                         \
+    pal_task_sleep((task), (duration));                                        \
+    __PAL_TASK_SUSPEND(task, PAL_TASK_BLOCKED);                                \
+  } while (0)
+
+#define PAL_TASK_AWAIT_SEM(task, sem, timeout)                                 \
+  do {                                                                         \
+    if (!pal_task_sem_take((task), (sem), (timeout))) {                        \
+      __PAL_TASK_SUSPEND(task, PAL_TASK_BLOCKED);                              \
+    }                                                                          \
+  } while (0)
+
+void
+pal_executor_init(pal_executor_t *exec);
+
+void
+pal_executor_cleanup(pal_executor_t *exec);
+
+size_t
+pal_executor_run_once(pal_executor_t *exec, pal_timeout_t timeout);
+
+void
+pal_executor_run(pal_executor_t *exec);
+
+void
+pal_task_spawn(pal_executor_t *exec, struct pal_task *task, pal_task_fn fn);
+
+void
+pal_task_wait_fd(struct pal_task *task,
+                 int fd,
+                 short events,
+                 pal_timeout_t timeout);
+
+void
+pal_task_sleep(struct pal_task *task, pal_timeout_t duration);
+
+void
+pal_task_sem_init(pal_task_sem_t *sem, unsigned int count);
+
+bool
+pal_task_sem_take(struct pal_task *task,
+                  pal_task_sem_t *sem,
+                  pal_timeout_t timeout);
+
+void
+pal_task_sem_give(pal_task_sem_t *sem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
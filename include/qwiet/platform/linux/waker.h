@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Coalescing cross-thread wakeup built on a counter-mode eventfd.
+ *
+ * Wakes are counted in an atomic; only the wake that moves the waker from
+ * idle to pending touches the eventfd, so N wakes between two drains cost
+ * one write(2) and one read(2) instead of N of each.
+ */
+#ifndef QWIET_WAKER_H
+#define QWIET_WAKER_H
+
+#include <stdatomic.h>
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/posix/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  int fd;
+  _Atomic uint32_t pending;
+} pal_waker_t;
+
+void
+pal_waker_init(pal_waker_t *waker);
+
+void
+pal_waker_wake(pal_waker_t *waker);
+
+uint32_t
+pal_waker_drain(pal_waker_t *waker);
+
+int
+pal_waker_fd(pal_waker_t *waker);
+
+int
+pal_waker_wait(pal_waker_t *waker, pal_timeout_t timeout);
+
+void
+pal_waker_cleanup(pal_waker_t *waker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
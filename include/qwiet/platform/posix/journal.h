@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Append-only record journal, for strokes as they are drawn.
+ *
+ * The journal file is sized up front (sparse, so unused space costs no
+ * disk). pal_journal_append() is a checksum and a memcpy into a buffer
+ * allocated and touched at open, so the input thread can log every stylus
+ * report without a system call or a fault on the file's pages. A flusher
+ * thread writes out and fdatasyncs everything appended since its last pass
+ * every interval, one write-back for a whole batch of records; block
+ * allocation and any wait on the filesystem happen on that thread.
+ * pal_journal_flush() asks it to go now, e.g. on pen up. Appends that would
+ * overrun records not yet on disk fail rather than wait for them.
+ *
+ *   pal_journal_open(&log, "/home/user/notes/page1.jnl", NULL);
+ *   pal_journal_replay(&log, redraw, &canvas);
+ *   ...
+ *   pal_journal_append_stroke(&log, samples, n);
+ *
+ * Each record carries a CRC-32C. Opening scans to the first record that is
+ * torn, corrupt or left over from before the last open and appends from
+ * there; recovery is a linear pass over a read-only mapping of the file.
+ * Records are in host byte order.
+ *
+ * One thread appends; pal_journal_sync() may be called from any thread.
+ */
+#ifndef QWIET_JOURNAL_H
+#define QWIET_JOURNAL_H
+
+#include <pthread.h>
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/posix/sem.h>
+#include <qwiet/platform/posix/time.h>
+#ifdef CONFIG_PAL_LINUX_STYLUS
+#include <qwiet/platform/linux/input/stylus.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Record types; 0 never appears in a valid record */
+enum pal_journal_type {
+  PAL_JOURNAL_STROKE = 1, /* a run of pal_stylus_sample_t */
+  PAL_JOURNAL_USER = 256, /* first type free for applications */
+};
+
+struct pal_journal_record {
+  uint32_t crc;   /* CRC-32C of the rest of the header and the payload */
+  uint32_t len;   /* payload bytes, padded to 8 in the file */
+  uint32_t seq;   /* 0 for the first record, then consecutive */
+  uint32_t epoch; /* open count of the file when appended, wrapping */
+  uint16_t type;
+  uint16_t reserved;
+};
+
+/* Default bytes appended ahead of the disk, minutes of stylus reports */
+#define PAL_JOURNAL_BUFFER (1 << 20)
+
+typedef struct {
+  size_t capacity;        /* file size, bytes */
+  pal_timeout_t interval; /* group commit period, PAL_FOREVER for none */
+  size_t buffer;          /* bytes appended ahead of the disk, 0 default */
+} pal_journal_config_t;
+
+#define PAL_JOURNAL_CONFIG_DEFAULT                                             \
+  ((pal_journal_config_t){                                                     \
+      .capacity = (size_t)CONFIG_PAL_POSIX_JOURNAL_MB << 20,                   \
+      .interval = PAL_MSEC(100),                                               \
+      .buffer = PAL_JOURNAL_BUFFER})
+
+typedef struct {
+  int fd;
+  const uint8_t *map; /* the file, read only */
+  uint8_t *ring;      /* records from synced on, at their offset % size */
+  size_t ring_size;
+  size_t capacity;
+  size_t head;      /* next append, writer only */
+  size_t published; /* end of complete records */
+  size_t synced;    /* end of records on disk */
+  size_t recovered; /* records found by pal_journal_open() */
+  uint32_t seq;
+  uint32_t epoch;
+  pal_timeout_t interval;
+  pthread_mutex_t sync_lock;
+  pal_sem_t kick;
+  pthread_t flusher;
+  bool stop;
+} pal_journal_t;
+
+/* Called per record by pal_journal_replay(); nonzero stops the replay */
+typedef int (*pal_journal_visit_fn)(void *ctx,
+                                    const struct pal_journal_record *rec,
+                                    const void *data);
+
+int
+pal_journal_open(pal_journal_t *journal,
+                 const char *path,
+                 const pal_journal_config_t *cfg);
+
+int
+pal_journal_append(pal_journal_t *journal,
+                   uint16_t type,
+                   const void *data,
+                   size_t len);
+
+#ifdef CONFIG_PAL_LINUX_STYLUS
+static inline int
+pal_journal_append_stroke(pal_journal_t *journal,
+                          const pal_stylus_sample_t *samples,
+                          size_t n)
+{
+  return pal_journal_append(
+      journal, PAL_JOURNAL_STROKE, samples, n * sizeof(*samples));
+}
+#endif
+
+int
+pal_journal_sync(pal_journal_t *journal);
+
+void
+pal_journal_flush(pal_journal_t *journal);
+
+/* Bytes of records known to be on disk */
+static inline size_t
+pal_journal_synced(pal_journal_t *journal)
+{
+  return __atomic_load_n(&journal->synced, __ATOMIC_ACQUIRE);
+}
+
+size_t
+pal_journal_replay(pal_journal_t *journal,
+                   pal_journal_visit_fn visit,
+                   void *ctx);
+
+void
+pal_journal_close(pal_journal_t *journal);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
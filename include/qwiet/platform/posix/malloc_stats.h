@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Allocation accounting behind pal_malloc()/pal_free().
+ *
+ * With CONFIG_PAL_MALLOC_STATS, every pal_malloc() expansion owns a static
+ * struct pal_malloc_site that counts the allocations made there, and each
+ * block carries a small header naming its site and size so pal_free() can
+ * credit it back. Per site this gives the number of allocations and frees,
+ * the bytes requested, and the live and peak live bytes (the site's share
+ * of the heap high water mark). Process-wide, a histogram of allocations per
+ * second shows whether a path allocates in bursts or steadily.
+ *
+ * The report goes to stderr at exit, and whenever the process receives
+ * CONFIG_PAL_MALLOC_STATS_SIGNAL (unless the application installed its own
+ * handler for it first), or can be written with pal_malloc_stats_print().
+ *
+ * The header is layered on whichever allocator the subsystem routes to, so
+ * this composes with PAL_MALLOC_SLAB; requests there land one size class
+ * higher. Counters are atomic; sites and the histogram are approximate only
+ * in the sense that a concurrent report may see a half-applied update.
+ */
+#ifndef QWIET_MALLOC_STATS_H
+#define QWIET_MALLOC_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Buckets of the allocations-per-second histogram: 0, then powers of two */
+#define PAL_MALLOC_RATE_BUCKETS 24
+
+struct pal_malloc_site {
+  const char *file;
+  const char *func;
+  int line;
+  int registered;
+  struct pal_malloc_site *next; /* registry of sites that allocated */
+  uint64_t allocs;
+  uint64_t frees;
+  uint64_t bytes; /* requested over the process lifetime */
+  int64_t live;   /* bytes currently allocated */
+  int64_t peak;   /* high water mark of live */
+};
+
+/* Prepended to each block; the user pointer keeps malloc()'s alignment */
+struct pal_malloc_hdr {
+  _Alignas(max_align_t) struct pal_malloc_site *site;
+  size_t size;
+};
+
+struct pal_malloc_stats {
+  size_t sites;    /* call sites that allocated at least once */
+  uint64_t allocs; /* all sites */
+  uint64_t frees;
+  int64_t live; /* bytes */
+  int64_t peak;
+  uint64_t seconds[PAL_MALLOC_RATE_BUCKETS]; /* seconds by allocation rate */
+};
+
+void *
+pal_malloc_stats_record(struct pal_malloc_site *site, void *raw, size_t size);
+
+void *
+pal_malloc_stats_forget(void *ptr);
+
+void
+pal_malloc_stats(struct pal_malloc_stats *stats);
+
+void
+pal_malloc_stats_print(FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Latency distributions of the PAL's blocking calls.
+ *
+ * With CONFIG_PAL_METRICS each thread records into its own set of
+ * histograms (see qwiet/platform/common/histogram.h), so recording takes no
+ * lock; pal_metrics_snapshot() merges every thread's set, including those of
+ * threads that have exited. Without it the PAL_METRIC_* macros compile to
+ * nothing.
+ *
+ *   PAL_METRIC_BEGIN(start);
+ *   ret = send(...);
+ *   PAL_METRIC_END(PAL_METRIC_NET_SEND, start);
+ */
+#ifndef QWIET_METRICS_H
+#define QWIET_METRICS_H
+
+#include <qwiet/platform/common/histogram.h>
+#include <qwiet/platform/posix/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum pal_metric {
+  PAL_METRIC_SEM_WAIT,       /* time blocked in pal_sem_wait() */
+  PAL_METRIC_TIMER_LATENESS, /* pal_timer_wait_ready() wakeup past expiry */
+  PAL_METRIC_NET_SEND,       /* pal_net_send() call duration */
+  PAL_METRIC_NET_RECV,       /* pal_net_recv() call duration */
+  PAL_METRIC_COUNT,
+};
+
+#ifdef CONFIG_PAL_METRICS
+
+void
+pal_metrics_record(enum pal_metric metric, uint64_t ns);
+
+void
+pal_metrics_record_since(enum pal_metric metric, int64_t start);
+
+void
+pal_metrics_snapshot(enum pal_metric metric, pal_histogram_t *out);
+
+void
+pal_metrics_reset(void);
+
+void
+pal_metrics_print(FILE *out);
+
+#define PAL_METRIC_BEGIN(var) int64_t var = pal_uptime_ns()
+#define PAL_METRIC_END(metric, var) pal_metrics_record_since(metric, var)
+
+#else
+
+#define PAL_METRIC_BEGIN(var) ((void)0)
+#define PAL_METRIC_END(metric, var) ((void)0)
+
+#endif /* CONFIG_PAL_METRICS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Work-stealing thread pool for blocking background jobs.
+ *
+ * Each worker owns a Chase-Lev deque. Jobs submitted from a worker go to its
+ * own deque (LIFO for the owner, FIFO for thieves); jobs submitted from any
+ * other thread go through a shared injection queue. Idle workers steal.
+ *
+ * Jobs are intrusive and owned by the caller. A job's optional done()
+ * callback runs on whichever thread calls pal_pool_dispatch(), normally the
+ * main reactor after pal_pool_fd() polls readable.
+ */
+#ifndef QWIET_POOL_H
+#define QWIET_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/list.h>
+#include <qwiet/platform/posix/sem.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pal_pool_job {
+  void (*work)(struct pal_pool_job *job);
+  void (*done)(struct pal_pool_job *job); /* optional, see pal_pool_dispatch */
+  struct pal_list_head node;
+};
+
+struct pal_pool_worker;
+
+typedef struct {
+  struct pal_pool_worker *workers;
+  int nworkers;
+
+  /* Jobs submitted from outside the pool */
+  pthread_mutex_t inject_lock;
+  struct pal_list_head inject;
+
+  /* Idle workers park here */
+  pal_sem_t idle;
+  _Atomic int sleepers;
+  _Atomic bool stop;
+
+  /* Finished jobs waiting for pal_pool_dispatch() */
+  pthread_mutex_t done_lock;
+  struct pal_list_head done;
+  int notify[2];
+} pal_pool_t;
+
+static inline void
+pal_pool_job_init(struct pal_pool_job *job,
+                  void (*work)(struct pal_pool_job *),
+                  void (*done)(struct pal_pool_job *))
+{
+  job->work = work;
+  job->done = done;
+  pal_list_init(&job->node);
+}
+
+void
+pal_pool_init(pal_pool_t *pool, int nworkers);
+
+void
+pal_pool_submit(pal_pool_t *pool, struct pal_pool_job *job);
+
+int
+pal_pool_fd(pal_pool_t *pool);
+
+int
+pal_pool_dispatch(pal_pool_t *pool);
+
+void
+pal_pool_parallel_for(pal_pool_t *pool,
+                      size_t begin,
+                      size_t end,
+                      size_t grain,
+                      void (*fn)(void *arg, size_t begin, size_t end),
+                      void *arg);
+
+void
+pal_pool_cleanup(pal_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
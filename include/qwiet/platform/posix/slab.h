@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Size-class slab allocator for small, frequently recycled objects.
+ *
+ * Slabs are 64 KiB, carved from one address range reserved up front
+ * (CONFIG_PAL_POSIX_SLAB_ARENA_MB), and hold objects of a single size
+ * class. Because every slab pointer falls inside that range,
+ * pal_pool_free() tells slab objects from libc ones with a range check and
+ * accepts both; requests above the largest class, or made once the arena is
+ * exhausted, simply go to malloc(). Empty slabs beyond one spare per class
+ * are handed back to the kernel with MADV_DONTNEED and reused by any class.
+ *
+ * With CONFIG_PAL_POSIX_SLAB_TLS_CACHE each thread keeps a small stack of
+ * free objects per class, so the common alloc/free pair takes no lock.
+ *
+ * A subsystem opts in by compiling with PAL_MALLOC_SLAB defined, which maps
+ * its pal_malloc()/pal_free() here (see common.h). Memory from an opted-in
+ * subsystem must not reach a plain free().
+ */
+#ifndef QWIET_SLAB_H
+#define QWIET_SLAB_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PAL_POOL_CLASSES 14
+#define PAL_POOL_MAX_SIZE 2048
+
+struct pal_pool_class_stats {
+  size_t size;     /* object size of the class */
+  size_t slabs;    /* slabs owned by the class */
+  size_t capacity; /* objects those slabs hold */
+  size_t inuse;    /* objects handed out, including thread-cached ones */
+};
+
+struct pal_pool_stats {
+  size_t reserved;   /* arena address space */
+  size_t committed;  /* arena bytes backed by memory */
+  size_t used;       /* bytes in objects handed out, at class granularity */
+  size_t free_slabs; /* empty slabs released to the kernel */
+  struct pal_pool_class_stats classes[PAL_POOL_CLASSES];
+};
+
+void *
+pal_pool_alloc(size_t size);
+
+void
+pal_pool_free(void *ptr);
+
+void
+pal_pool_stats(struct pal_pool_stats *stats);
+
+void
+pal_pool_stats_print(FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
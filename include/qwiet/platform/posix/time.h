@@ -51,6 +51,9 @@ pal_timeout_to_timespec(pal_timeout_t t, struct timespec *out);
 void
 pal_sleep(pal_timeout_t duration);
 
+int64_t
+pal_uptime_ns(void);
+
 #ifdef __cplusplus
 }
 #endif
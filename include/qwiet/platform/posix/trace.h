@@ -0,0 +1,139 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Low overhead event tracing with a Chrome trace exporter.
+ *
+ *   PAL_TRACE_BEGIN("frame");
+ *   ...
+ *   PAL_TRACE_COUNTER("queue.depth", depth);
+ *   PAL_TRACE_END("frame");
+ *
+ * Each thread writes fixed-size records into its own ring, so recording
+ * takes no lock: a cycle counter read and a handful of stores. Between
+ * pal_trace_start() and pal_trace_stop() a flusher thread drains the rings
+ * into a Chrome trace JSON file, which chrome://tracing and the Perfetto UI
+ * open directly. A thread that outruns the flusher loses records; the count
+ * lands in the trace as the "trace.dropped" counter.
+ *
+ * Outside a session the macros cost one relaxed load. Without
+ * CONFIG_PAL_TRACE they compile to nothing and their arguments are not
+ * evaluated.
+ *
+ * Names must be string literals (or otherwise outlive the session) and need
+ * no JSON escaping.
+ */
+#ifndef QWIET_TRACE_H
+#define QWIET_TRACE_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/list.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef CONFIG_PAL_TRACE
+
+enum pal_trace_type {
+  PAL_TRACE_TYPE_BEGIN,
+  PAL_TRACE_TYPE_END,
+  PAL_TRACE_TYPE_INSTANT,
+  PAL_TRACE_TYPE_COUNTER,
+};
+
+struct pal_trace_record {
+  uint64_t ticks; /* raw cycle counter, converted to time by the flusher */
+  const char *name;
+  int64_t value;
+  uint32_t type;
+};
+
+struct pal_trace_ring {
+  struct pal_list_head node; /* on the list of all rings */
+  uint32_t head;             /* written by the owning thread only */
+  uint32_t tail;             /* written by the flusher only */
+  uint32_t dropped;
+  bool orphaned; /* owning thread exited */
+  int tid;
+  char thread_name[16];
+  struct pal_trace_record records[];
+};
+
+extern bool pal_trace_enabled;
+extern _Thread_local struct pal_trace_ring *pal_trace_ring;
+
+struct pal_trace_ring *
+pal_trace_ring_attach(void);
+
+static inline uint64_t
+pal_trace_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+  uint64_t ticks;
+  __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static inline void
+pal_trace_emit(enum pal_trace_type type, const char *name, int64_t value)
+{
+  struct pal_trace_ring *ring = pal_trace_ring;
+  struct pal_trace_record *rec;
+  uint32_t head;
+
+  if (!__atomic_load_n(&pal_trace_enabled, __ATOMIC_RELAXED)) {
+    return;
+  }
+  if (!ring && !(ring = pal_trace_ring_attach())) {
+    return;
+  }
+
+  head = ring->head;
+  if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >
+      CONFIG_PAL_TRACE_RING_RECORDS - 1) {
+    __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  rec = &ring->records[head & (CONFIG_PAL_TRACE_RING_RECORDS - 1)];
+  rec->ticks = pal_trace_ticks();
+  rec->name = name;
+  rec->value = value;
+  rec->type = type;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+int
+pal_trace_start(const char *path);
+
+void
+pal_trace_stop(void);
+
+void
+pal_trace_thread_name(const char *name);
+
+#define PAL_TRACE_BEGIN(name) pal_trace_emit(PAL_TRACE_TYPE_BEGIN, name, 0)
+#define PAL_TRACE_END(name) pal_trace_emit(PAL_TRACE_TYPE_END, name, 0)
+#define PAL_TRACE_INSTANT(name) pal_trace_emit(PAL_TRACE_TYPE_INSTANT, name, 0)
+#define PAL_TRACE_COUNTER(name, value)                                         \
+  pal_trace_emit(PAL_TRACE_TYPE_COUNTER, name, (int64_t)(value))
+
+#else
+
+#define PAL_TRACE_BEGIN(name) ((void)0)
+#define PAL_TRACE_END(name) ((void)0)
+#define PAL_TRACE_INSTANT(name) ((void)0)
+#define PAL_TRACE_COUNTER(name, value) ((void)0)
+
+#endif /* CONFIG_PAL_TRACE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef DIODE_CLOCK_H
+#define DIODE_CLOCK_H
+
+#include <qwiet/platform/posix/time.h>
+
+/*
+ * Virtual clock
+ *
+ * Between diode_clock_init() and diode_clock_cleanup(), pal_uptime_ns()
+ * reads a virtual clock that starts at zero and only moves forward when the
+ * test calls diode_clock_advance() or when a call would otherwise block for
+ * a bounded time:
+ *
+ *   pal_sleep(d)                      advances by d
+ *   pal_sem_wait(s, d)                if s is not available, advances by d
+ *                                     and times out
+ *   pal_timer_wait_ready(t, d)        advances to t's next expiry if that is
+ *                                     within d, else by d and times out
+ *
+ * Timers initialized in virtual mode are backed by an eventfd: expiries
+ * land on it as the clock passes them, so pal_timer_read(),
+ * pal_timer_is_ready() and polling pal_timer_fd() behave as with a timerfd.
+ * Waiting forever on something only time could satisfy fails the test.
+ *
+ * Nothing waits on wall time, so timing tests are instant and exact, and
+ * unaffected by machine load.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void
+diode_clock_init(void);
+
+void
+diode_clock_cleanup(void);
+
+void
+diode_clock_advance(pal_timeout_t duration);
+
+int64_t
+diode_clock_next_expiry(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef DIODE_DRAWMODE_H
+#define DIODE_DRAWMODE_H
+
+#include <qwiet/platform/common/list.h>
+#include <qwiet/platform/linux/drawmode.h>
+
+/*
+ * Fake mode ioctl for pal_drawmode_t
+ *
+ * Pass diode_drawmode_set as the controller's set hook; every switch must
+ * match the next expectation, in order. With the virtual clock running, an
+ * expectation may also pin the virtual time of the switch.
+ *
+ *   pal_drawmode_init(&dm, NULL, diode_drawmode_set, NULL);
+ *   EXPECT_DRAWMODE_SET(PAL_DRAWMODE_FAST, DIODE_DRAWMODE_ANYTIME);
+ *   EXPECT_DRAWMODE_SET(PAL_DRAWMODE_NORMAL, PAL_MSEC(800));
+ */
+
+#define DIODE_DRAWMODE_ANYTIME PAL_FOREVER
+
+struct drawmode_expectation {
+  struct pal_list_head node;
+  enum pal_drawmode mode;
+  int64_t ns; /* virtual time of the switch, -1 for any */
+  int ret;
+};
+
+#define EXPECT_DRAWMODE_SET(__mode, __at)                                      \
+  diode_drawmode_create_expectation(__mode, __at, 0)
+
+#define EXPECT_DRAWMODE_SET_ERR(__mode, __at)                                  \
+  diode_drawmode_create_expectation(__mode, __at, -1)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void
+diode_drawmode_init(void);
+
+void
+diode_drawmode_cleanup(void);
+
+void
+diode_drawmode_verify(void);
+
+int
+diode_drawmode_set(void *ctx, enum pal_drawmode mode);
+
+struct drawmode_expectation *
+diode_drawmode_create_expectation(enum pal_drawmode mode,
+                                  pal_timeout_t at,
+                                  int ret);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
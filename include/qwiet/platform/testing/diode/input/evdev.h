@@ -5,10 +5,22 @@
 #include <qwiet/platform/common/list.h>
 #include <qwiet/platform/linux/input/evdev.h>
 
+/* A recorded capture, memory-mapped and parsed one line at a time */
+struct evdev_replay {
+  void *map;
+  size_t size;
+  const char *cur; /* first unparsed byte */
+  const char *end;
+  size_t events;       /* in the capture */
+  size_t replayed;     /* returned so far */
+  struct timeval time; /* of the last timestamped line */
+};
+
 struct evdev_expectation {
   struct pal_list_head node;
   int ret;
   struct input_event ev;
+  struct evdev_replay *replay; /* stands for every event of a capture */
 };
 
 /*
@@ -25,6 +37,20 @@ struct evdev_expectation {
   diode_evdev_create_expectation(                                              \
       LIBEVDEV_READ_STATUS_SYNC, (__type), (__code), (__value))
 
+/*
+ * Replay a recorded capture
+ *
+ * Every event of the file at __path is returned, in order and with its
+ * recorded timestamp, before the expectations declared after it. Accepts
+ * the text output of evemu-record ("E: 0.012000 0003 0000 512"),
+ * libevdev-tools' libevdev-record ("- [ 0, 12000, 3, 0, 512]") and evtest
+ * ("Event: time 0.012000, type 3 (EV_ABS), code 0 (ABS_X), value 512");
+ * other lines are skipped. The file is mapped, not copied, and events are
+ * parsed as they are consumed.
+ */
+
+#define EXPECT_EVDEV_REPLAY(__path) diode_evdev_create_replay(__path)
+
 /*
  * High-level touch expectations
  *
@@ -98,6 +124,9 @@ diode_evdev_verify(void);
 struct evdev_expectation *
 diode_evdev_create_expectation(int ret, int type, int code, int value);
 
+struct evdev_expectation *
+diode_evdev_create_replay(const char *path);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,67 @@
+#ifndef DIODE_NET_SIM_H
+#define DIODE_NET_SIM_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/list.h>
+#include <qwiet/platform/posix/net.h>
+#include <qwiet/platform/testing/diode/queue.h>
+
+/*
+ * In-memory network simulator
+ *
+ * An alternative to scripting every pal_net_* call: after diode_netsim_init()
+ * the net mocks route pal_net_send(), pal_net_recv(), pal_net_socket_poll(),
+ * pal_net_socket_ready() and pal_net_close() on simulated descriptors to a
+ * pair of in-memory endpoints, and everything else to the real functions.
+ *
+ *   diode_clock_init();
+ *   diode_netsim_init();
+ *   diode_netsim_pair(sv, &(struct diode_netsim_link){
+ *                             .latency = PAL_MSEC(20),
+ *                             .bandwidth = 1 << 20,
+ *                         }, NULL);
+ *
+ * Each direction of a pair is shaped by its own link: bytes are serialized
+ * at the link's bandwidth and arrive after its latency, measured on the
+ * virtual clock. Sends beyond the buffer are cut short or fail with EAGAIN,
+ * as on a non-blocking socket. A poll with nothing ready advances the
+ * virtual clock to the next arrival, virtual timer expiry or its timeout.
+ *
+ * Simulated descriptors are non-blocking; send and recv flags are ignored.
+ * A poll over real descriptors only goes to the real pal_net_socket_poll()
+ * and waits in wall time. A poll may mix the two only with PAL_NO_WAIT,
+ * since the simulation cannot wait on both clocks; otherwise it fails the
+ * test.
+ */
+
+#define DIODE_NETSIM_BUFFER (64 * 1024)
+
+struct diode_netsim_link {
+  pal_timeout_t latency;     /* one way, for every byte */
+  uint64_t bandwidth;        /* bytes per second, 0 for unlimited */
+  size_t buffer;             /* bytes in flight or unread, 0 for default */
+  uint16_t max_send;         /* accepted per send, 0 for no limit */
+  uint16_t max_recv;         /* returned per recv, 0 for no limit */
+  unsigned int eagain_every; /* fail every Nth send and recv, 0 for never */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void
+diode_netsim_init(void);
+
+void
+diode_netsim_cleanup(void);
+
+void
+diode_netsim_pair(int sv[2],
+                  const struct diode_netsim_link *a_to_b,
+                  const struct diode_netsim_link *b_to_a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,10 +1,25 @@
 #ifndef DIODE_PRIVATE_H
 #define DIODE_PRIVATE_H
 
+#include <qwiet/platform/common.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#ifdef CONFIG_PAL_LINUX_EVDEV
+struct evdev_replay;
+
+struct evdev_replay *
+diode_evdev_replay_open(const char *path);
+
+bool
+diode_evdev_replay_next(struct evdev_replay *replay, struct input_event *ev);
+
+void
+diode_evdev_replay_close(struct evdev_replay *replay);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,61 @@
+#ifndef DIODE_QUEUE_H
+#define DIODE_QUEUE_H
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/list.h>
+
+/*
+ * Expectation queue shared by the heap pattern mocks
+ *
+ * Expectations are consumed in the order they were declared. Slots come from
+ * chunks of DIODE_QUEUE_CHUNK and a consumed slot is reused by the next
+ * push, so a scripted scenario costs one allocation per chunk rather than
+ * one per expectation. Pushes larger than the queue's slot size (e.g. a poll
+ * over many descriptors) are allocated individually.
+ *
+ * An expectation type must begin with a struct pal_list_head, which the
+ * queue links through.
+ */
+
+#define DIODE_QUEUE_CHUNK 256
+
+struct diode_queue {
+  struct pal_list_head pending; /* declared, not yet consumed, oldest first */
+  struct pal_list_head free;    /* slots ready for reuse */
+  struct pal_list_head chunks;
+  size_t size; /* slot size */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void
+diode_queue_init(struct diode_queue *q, size_t size);
+
+void
+diode_queue_cleanup(struct diode_queue *q);
+
+void *
+diode_queue_push(struct diode_queue *q, size_t size);
+
+void
+diode_queue_pop(struct diode_queue *q, void *expectation);
+
+static inline void *
+diode_queue_peek(struct diode_queue *q)
+{
+  return pal_list_empty(&q->pending) ? NULL : q->pending.next;
+}
+
+static inline bool
+diode_queue_empty(struct diode_queue *q)
+{
+  return pal_list_empty(&q->pending);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
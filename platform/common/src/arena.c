@@ -0,0 +1,184 @@
+#include <qwiet/platform/common/arena.h>
+
+/* Smallest chunk worth allocating for an arena created with no size hint */
+#define ARENA_MIN_CHUNK 4096
+
+static struct pal_arena_chunk *
+arena_chunk_new(size_t size)
+{
+  struct pal_arena_chunk *chunk = pal_malloc(sizeof(*chunk) + size);
+
+  if (chunk) {
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->flags = 0;
+  }
+  return chunk;
+}
+
+/**
+ * pal_arena_init - initialize an empty arena backed by pal_malloc()
+ * @arena:      arena to initialize
+ * @chunk_size: bytes per chunk, sized for a typical round of allocations
+ *
+ * No memory is allocated until the first pal_arena_alloc().
+ */
+void
+pal_arena_init(pal_arena_t *arena, size_t chunk_size)
+{
+  arena->first = arena->cur = NULL;
+  arena->used = 0;
+  arena->grow_size =
+      chunk_size > ARENA_MIN_CHUNK ? chunk_size : ARENA_MIN_CHUNK;
+}
+
+/**
+ * pal_arena_init_static - initialize an arena over a caller-owned buffer
+ * @arena:     arena to initialize
+ * @buf:       memory for the first chunk, must outlive the arena
+ * @size:      bytes at @buf
+ * @grow_size: bytes per chunk allocated once @buf is full, 0 to never grow
+ */
+void
+pal_arena_init_static(pal_arena_t *arena,
+                      void *buf,
+                      size_t size,
+                      size_t grow_size)
+{
+  uintptr_t start = ((uintptr_t)buf + PAL_ARENA_ALIGN - 1) &
+                    ~(uintptr_t)(PAL_ARENA_ALIGN - 1);
+  struct pal_arena_chunk *chunk = (struct pal_arena_chunk *)start;
+  size_t waste = start - (uintptr_t)buf + sizeof(*chunk);
+
+  pal_assert(size > waste, "arena buffer of %zu bytes too small", size);
+  chunk->next = NULL;
+  chunk->size = size - waste;
+  chunk->flags = PAL_ARENA_CHUNK_STATIC;
+
+  arena->first = arena->cur = chunk;
+  arena->used = 0;
+  arena->grow_size = grow_size;
+}
+
+/* Offset in @chunk of an @align aligned block of @size at or past @used, or
+ * SIZE_MAX if it does not fit */
+static inline size_t
+arena_fit(const struct pal_arena_chunk *chunk,
+          size_t used,
+          size_t size,
+          size_t align)
+{
+  uintptr_t base = (uintptr_t)chunk->data;
+  size_t off = ((base + used + align - 1) & ~(uintptr_t)(align - 1)) - base;
+
+  return off <= chunk->size && size <= chunk->size - off ? off : SIZE_MAX;
+}
+
+void *
+pal_arena_alloc_aligned(pal_arena_t *arena, size_t size, size_t align)
+{
+  struct pal_arena_chunk *chunk;
+  size_t off;
+
+  pal_assert(align && !(align & (align - 1)), "bad alignment %zu", align);
+
+  /* Past this the chunk size below wraps */
+  if (size > SIZE_MAX - align - sizeof(*chunk)) {
+    return NULL;
+  }
+
+  if (arena->cur &&
+      (off = arena_fit(arena->cur, arena->used, size, align)) != SIZE_MAX) {
+    arena->used = off + size;
+    return arena->cur->data + off;
+  }
+
+  /* Move on to a chunk kept from an earlier, larger round if it fits */
+  chunk = arena->cur ? arena->cur->next : arena->first;
+  if (chunk && (off = arena_fit(chunk, 0, size, align)) != SIZE_MAX) {
+    arena->cur = chunk;
+    arena->used = off + size;
+    return chunk->data + off;
+  }
+
+  if (!arena->grow_size) {
+    return NULL;
+  }
+
+  /* Oversized requests get a chunk of their own. The new chunk goes right
+   * after the cursor so chunks kept for reuse stay chained behind it. */
+  chunk = arena_chunk_new(size + align > arena->grow_size ? size + align
+                                                          : arena->grow_size);
+  if (!chunk) {
+    return NULL;
+  }
+  off = arena_fit(chunk, 0, size, align);
+  if (off == SIZE_MAX) {
+    pal_free(chunk);
+    return NULL;
+  }
+  if (arena->cur) {
+    chunk->next = arena->cur->next;
+    arena->cur->next = chunk;
+  } else {
+    chunk->next = arena->first;
+    arena->first = chunk;
+  }
+  arena->cur = chunk;
+  arena->used = off + size;
+  return chunk->data + off;
+}
+
+/**
+ * pal_arena_trim - release chunks kept past the cursor
+ * @arena: arena to trim
+ *
+ * After a spike, call at a reset point to give the extra chunks back.
+ */
+void
+pal_arena_trim(pal_arena_t *arena)
+{
+  struct pal_arena_chunk *chunk, *next;
+
+  chunk = arena->cur ? arena->cur->next : arena->first;
+  while (chunk) {
+    next = chunk->next;
+    if (!(chunk->flags & PAL_ARENA_CHUNK_STATIC)) {
+      pal_free(chunk);
+    }
+    chunk = next;
+  }
+  if (arena->cur) {
+    arena->cur->next = NULL;
+  } else {
+    arena->first = NULL;
+  }
+}
+
+/**
+ * pal_arena_cleanup - release every chunk the arena allocated
+ * @arena: arena to clean up
+ */
+void
+pal_arena_cleanup(pal_arena_t *arena)
+{
+  pal_arena_reset(arena);
+  arena->cur = NULL;
+  pal_arena_trim(arena);
+  arena->used = 0;
+}
+
+/**
+ * pal_arena_footprint - bytes of chunk memory held by the arena
+ * @arena: arena to query
+ */
+size_t
+pal_arena_footprint(const pal_arena_t *arena)
+{
+  size_t bytes = 0;
+
+  for (struct pal_arena_chunk *c = arena->first; c; c = c->next) {
+    bytes += c->size;
+  }
+  return bytes;
+}
@@ -0,0 +1,466 @@
+#include <math.h>
+
+#include <qwiet/platform/common/canvas.h>
+
+struct pal_canvas_change {
+  uint32_t index;
+  struct pal_canvas_tile *before;
+  struct pal_canvas_tile *after;
+};
+
+struct pal_canvas_step {
+  size_t count;
+  struct pal_canvas_change changes[];
+};
+
+static inline size_t
+canvas_ntiles(const pal_canvas_t *canvas)
+{
+  return (size_t)canvas->cols * canvas->rows;
+}
+
+static inline size_t
+canvas_nwords(const pal_canvas_t *canvas)
+{
+  return (canvas_ntiles(canvas) + 63) / 64;
+}
+
+static inline void
+canvas_mark(pal_canvas_t *canvas, size_t i)
+{
+  canvas->dirty[i / 64] |= 1ULL << (i % 64);
+  canvas->changed[i / 64] |= 1ULL << (i % 64);
+}
+
+static inline struct pal_canvas_tile *
+canvas_get(struct pal_canvas_tile *tile)
+{
+  if (tile) {
+    tile->refs++;
+  }
+  return tile;
+}
+
+static inline void
+canvas_put(pal_canvas_t *canvas, struct pal_canvas_tile *tile)
+{
+  if (tile && --tile->refs == 0) {
+    pal_free(tile);
+    canvas->ntiles--;
+  }
+}
+
+/* Point slot @i at @tile, taking a reference */
+static void
+canvas_set(pal_canvas_t *canvas, size_t i, struct pal_canvas_tile *tile)
+{
+  struct pal_canvas_tile *old = canvas->tiles[i];
+
+  if (old != tile) {
+    canvas->tiles[i] = canvas_get(tile);
+    canvas_put(canvas, old);
+    canvas_mark(canvas, i);
+  }
+}
+
+/**
+ * pal_canvas_init - create a blank canvas
+ * @canvas:     canvas to initialize
+ * @width:      pixels
+ * @height:     pixels
+ * @background: level every pixel starts at, 0 (black) to 15 (white)
+ *
+ * Only the tile table is allocated; tiles appear as they are drawn on.
+ */
+void
+pal_canvas_init(pal_canvas_t *canvas,
+                uint32_t width,
+                uint32_t height,
+                uint8_t background)
+{
+  memset(canvas, 0, sizeof(*canvas));
+  canvas->width = width;
+  canvas->height = height;
+  canvas->cols = (width + PAL_CANVAS_TILE - 1) / PAL_CANVAS_TILE;
+  canvas->rows = (height + PAL_CANVAS_TILE - 1) / PAL_CANVAS_TILE;
+  canvas->background = background & 0xf;
+  canvas->tiles = pal_malloc(sizeof(*canvas->tiles) * canvas_ntiles(canvas));
+  canvas->dirty = pal_malloc(sizeof(uint64_t) * canvas_nwords(canvas));
+  canvas->changed = pal_malloc(sizeof(uint64_t) * canvas_nwords(canvas));
+  pal_assert(canvas->tiles && canvas->dirty && canvas->changed,
+             "failed to allocate %ux%u canvas",
+             width,
+             height);
+  memset(canvas->tiles, 0, sizeof(*canvas->tiles) * canvas_ntiles(canvas));
+  memset(canvas->dirty, 0, sizeof(uint64_t) * canvas_nwords(canvas));
+  memset(canvas->changed, 0, sizeof(uint64_t) * canvas_nwords(canvas));
+}
+
+void
+pal_canvas_cleanup(pal_canvas_t *canvas)
+{
+  for (size_t i = 0; i < canvas_ntiles(canvas); i++) {
+    canvas_put(canvas, canvas->tiles[i]);
+  }
+  pal_free(canvas->changed);
+  pal_free(canvas->dirty);
+  pal_free(canvas->tiles);
+}
+
+/**
+ * pal_canvas_tile_write - get a tile's pixels for writing
+ * @canvas: canvas
+ * @col:    tile column
+ * @row:    tile row
+ *
+ * A blank tile is allocated and filled with the background; a tile still
+ * held by the history is copied first. The tile is reported as damaged.
+ * The pointer is good until the next call into the canvas.
+ */
+uint8_t *
+pal_canvas_tile_write(pal_canvas_t *canvas, uint32_t col, uint32_t row)
+{
+  size_t i = (size_t)row * canvas->cols + col;
+  struct pal_canvas_tile *tile = canvas->tiles[i], *copy;
+
+  if (!tile || tile->refs > 1) {
+    copy = pal_malloc(sizeof(*copy));
+    pal_assert(copy, "failed to allocate canvas tile");
+    canvas->ntiles++;
+    copy->refs = 1;
+    if (tile) {
+      memcpy(copy->px, tile->px, sizeof(copy->px));
+      canvas_put(canvas, tile);
+    } else {
+      memset(copy->px, canvas->background * 0x11, sizeof(copy->px));
+    }
+    canvas->tiles[i] = tile = copy;
+  }
+  canvas_mark(canvas, i);
+  return tile->px;
+}
+
+/**
+ * pal_canvas_segment - draw a stroke segment, see pal_raster_segment()
+ * @canvas: canvas
+ * @pen:    width range and ink
+ * @a:      start, in canvas pixels
+ * @b:      end
+ *
+ * Only the tiles within reach of the segment are written.
+ */
+void
+pal_canvas_segment(pal_canvas_t *canvas,
+                   const pal_raster_pen_t *pen,
+                   pal_raster_point_t a,
+                   pal_raster_point_t b)
+{
+  float span = pen->max_width - pen->min_width;
+  float ra = (pen->min_width + span * a.pressure) * 0.5f;
+  float rb = (pen->min_width + span * b.pressure) * 0.5f;
+  float reach = (ra > rb ? ra : rb) + 1.0f;
+  float fx0 = floorf((a.x < b.x ? a.x : b.x) - reach);
+  float fy0 = floorf((a.y < b.y ? a.y : b.y) - reach);
+  float fx1 = ceilf((a.x > b.x ? a.x : b.x) + reach);
+  float fy1 = ceilf((a.y > b.y ? a.y : b.y) + reach);
+  float w = (float)canvas->width, h = (float)canvas->height;
+  uint32_t x0, y0, x1, y1;
+
+  /* The rasterizer's bounding box, clipped in float like it does */
+  x0 = fx0 < 0.0f ? 0 : fx0 > w ? canvas->width : (uint32_t)fx0;
+  y0 = fy0 < 0.0f ? 0 : fy0 > h ? canvas->height : (uint32_t)fy0;
+  x1 = fx1 < 0.0f ? 0 : fx1 > w ? canvas->width : (uint32_t)fx1;
+  y1 = fy1 < 0.0f ? 0 : fy1 > h ? canvas->height : (uint32_t)fy1;
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+
+  for (uint32_t row = y0 / PAL_CANVAS_TILE; row <= (y1 - 1) / PAL_CANVAS_TILE;
+       row++) {
+    for (uint32_t col = x0 / PAL_CANVAS_TILE;
+         col <= (x1 - 1) / PAL_CANVAS_TILE;
+         col++) {
+      uint32_t ox = col * PAL_CANVAS_TILE, oy = row * PAL_CANVAS_TILE;
+      pal_raster_fb_t fb = {
+          .buf = pal_canvas_tile_write(canvas, col, row),
+          .width = canvas->width - ox < PAL_CANVAS_TILE ? canvas->width - ox
+                                                        : PAL_CANVAS_TILE,
+          .height = canvas->height - oy < PAL_CANVAS_TILE
+                        ? canvas->height - oy
+                        : PAL_CANVAS_TILE,
+          .pitch = PAL_CANVAS_TILE_PITCH,
+      };
+      pal_raster_point_t ta = {a.x - (float)ox, a.y - (float)oy, a.pressure};
+      pal_raster_point_t tb = {b.x - (float)ox, b.y - (float)oy, b.pressure};
+      pal_raster_segment(&fb, pen, ta, tb);
+    }
+  }
+}
+
+/* Back to the background everywhere; the history can undo it */
+void
+pal_canvas_clear(pal_canvas_t *canvas)
+{
+  for (size_t i = 0; i < canvas_ntiles(canvas); i++) {
+    canvas_set(canvas, i, NULL);
+  }
+}
+
+/**
+ * pal_canvas_damage - report the tiles written since the last call
+ * @canvas: canvas
+ * @damage: tracker to add the tiles to
+ */
+void
+pal_canvas_damage(pal_canvas_t *canvas, pal_damage_t *damage)
+{
+  for (size_t w = 0; w < canvas_nwords(canvas); w++) {
+    uint64_t bits = canvas->dirty[w];
+
+    canvas->dirty[w] = 0;
+    while (bits) {
+      size_t i = w * 64 + __builtin_ctzll(bits);
+      int32_t x = (int32_t)(i % canvas->cols * PAL_CANVAS_TILE);
+      int32_t y = (int32_t)(i / canvas->cols * PAL_CANVAS_TILE);
+
+      bits &= bits - 1;
+      pal_damage_add(
+          damage, PAL_RECT(x, y, x + PAL_CANVAS_TILE, y + PAL_CANVAS_TILE));
+    }
+  }
+}
+
+/**
+ * pal_canvas_blit - copy part of the canvas to a framebuffer
+ * @canvas: canvas
+ * @fb:     Y4 framebuffer, the same size as the canvas
+ * @rect:   area to copy, widened to even columns
+ */
+void
+pal_canvas_blit(const pal_canvas_t *canvas,
+                const pal_raster_fb_t *fb,
+                pal_rect_t rect)
+{
+  rect = pal_rect_intersect(
+      rect, PAL_RECT(0, 0, (int32_t)canvas->width, (int32_t)canvas->height));
+  if (pal_rect_empty(rect)) {
+    return;
+  }
+  rect.x1 &= ~1;
+  rect.x2 += rect.x2 & 1;
+
+  for (int32_t row = rect.y1 / PAL_CANVAS_TILE;
+       row <= (rect.y2 - 1) / PAL_CANVAS_TILE;
+       row++) {
+    for (int32_t col = rect.x1 / PAL_CANVAS_TILE;
+         col <= (rect.x2 - 1) / PAL_CANVAS_TILE;
+         col++) {
+      const struct pal_canvas_tile *tile = pal_canvas_tile(canvas, col, row);
+      pal_rect_t r = pal_rect_intersect(
+          rect,
+          PAL_RECT(col * PAL_CANVAS_TILE,
+                   row * PAL_CANVAS_TILE,
+                   (col + 1) * PAL_CANVAS_TILE,
+                   (row + 1) * PAL_CANVAS_TILE));
+      size_t n = (size_t)(r.x2 - r.x1) / 2;
+
+      for (int32_t y = r.y1; y < r.y2; y++) {
+        uint8_t *dst = fb->buf + (size_t)y * fb->pitch + r.x1 / 2;
+        if (tile) {
+          memcpy(dst,
+                 tile->px + y % PAL_CANVAS_TILE * PAL_CANVAS_TILE_PITCH +
+                     r.x1 % PAL_CANVAS_TILE / 2,
+                 n);
+        } else {
+          memset(dst, canvas->background * 0x11, n);
+        }
+      }
+    }
+  }
+}
+
+static void
+canvas_step_free(pal_canvas_t *canvas, struct pal_canvas_step *step)
+{
+  for (size_t i = 0; i < step->count; i++) {
+    canvas_put(canvas, step->changes[i].before);
+    canvas_put(canvas, step->changes[i].after);
+  }
+  pal_free(step);
+}
+
+static inline struct pal_canvas_step **
+history_step(pal_canvas_history_t *history, size_t n)
+{
+  return &history->steps[(history->first + n) % history->depth];
+}
+
+/* Put the canvas back to the last commit */
+static void
+history_revert(pal_canvas_history_t *history)
+{
+  pal_canvas_t *canvas = history->canvas;
+
+  for (size_t w = 0; w < canvas_nwords(canvas); w++) {
+    uint64_t bits = canvas->changed[w];
+    while (bits) {
+      size_t i = w * 64 + __builtin_ctzll(bits);
+      bits &= bits - 1;
+      canvas_set(canvas, i, history->base[i]);
+    }
+    canvas->changed[w] = 0;
+  }
+}
+
+/* Move canvas and base to one side of @step */
+static void
+history_apply(pal_canvas_history_t *history,
+              const struct pal_canvas_step *step,
+              bool undo)
+{
+  pal_canvas_t *canvas = history->canvas;
+
+  for (size_t n = 0; n < step->count; n++) {
+    const struct pal_canvas_change *c = &step->changes[n];
+    struct pal_canvas_tile *tile = undo ? c->before : c->after;
+
+    canvas_set(canvas, c->index, tile);
+    canvas_put(canvas, history->base[c->index]);
+    history->base[c->index] = canvas_get(tile);
+  }
+  memset(canvas->changed, 0, sizeof(uint64_t) * canvas_nwords(canvas));
+}
+
+/**
+ * pal_canvas_history_init - start recording undo steps
+ * @history: history to initialize
+ * @canvas:  canvas, its current content is the oldest state
+ * @depth:   steps to keep; older ones are forgotten
+ */
+void
+pal_canvas_history_init(pal_canvas_history_t *history,
+                        pal_canvas_t *canvas,
+                        size_t depth)
+{
+  size_t n = canvas_ntiles(canvas);
+
+  pal_assert(depth > 0, "undo history needs a depth");
+  memset(history, 0, sizeof(*history));
+  history->canvas = canvas;
+  history->depth = depth;
+  history->base = pal_malloc(sizeof(*history->base) * n);
+  history->steps = pal_malloc(sizeof(*history->steps) * depth);
+  pal_assert(history->base && history->steps,
+             "failed to allocate undo history");
+  for (size_t i = 0; i < n; i++) {
+    history->base[i] = canvas_get(canvas->tiles[i]);
+  }
+  memset(canvas->changed, 0, sizeof(uint64_t) * canvas_nwords(canvas));
+}
+
+/**
+ * pal_canvas_commit - record what changed since the last commit as a step
+ * @history: history
+ *
+ * Steps that were undone are dropped. Nothing is recorded if no tile
+ * changed.
+ */
+void
+pal_canvas_commit(pal_canvas_history_t *history)
+{
+  pal_canvas_t *canvas = history->canvas;
+  struct pal_canvas_step *step;
+  size_t count = 0;
+
+  for (size_t w = 0; w < canvas_nwords(canvas); w++) {
+    count += __builtin_popcountll(canvas->changed[w]);
+  }
+  if (count == 0) {
+    return;
+  }
+  step = pal_malloc(sizeof(*step) + sizeof(step->changes[0]) * count);
+  pal_assert(step, "failed to allocate undo step");
+  step->count = 0;
+
+  for (size_t w = 0; w < canvas_nwords(canvas); w++) {
+    uint64_t bits = canvas->changed[w];
+    canvas->changed[w] = 0;
+    while (bits) {
+      size_t i = w * 64 + __builtin_ctzll(bits);
+      struct pal_canvas_tile *tile = canvas->tiles[i];
+
+      bits &= bits - 1;
+      if (tile == history->base[i]) {
+        continue; /* written and then put back */
+      }
+      /* The base's reference on the old tile moves to the step */
+      step->changes[step->count++] = (struct pal_canvas_change){
+          .index = (uint32_t)i,
+          .before = history->base[i],
+          .after = canvas_get(tile),
+      };
+      history->base[i] = canvas_get(tile);
+    }
+  }
+  if (step->count == 0) {
+    pal_free(step);
+    return;
+  }
+
+  while (history->count > history->cur) {
+    canvas_step_free(canvas, *history_step(history, --history->count));
+  }
+  if (history->count == history->depth) {
+    canvas_step_free(canvas, *history_step(history, 0));
+    history->first = (history->first + 1) % history->depth;
+    history->count--;
+    history->cur--;
+  }
+  *history_step(history, history->count++) = step;
+  history->cur++;
+}
+
+/**
+ * pal_canvas_undo - go back one step
+ * @history: history
+ *
+ * Drawing since the last commit is dropped. Returns 0, or -1 if there is
+ * nothing left to undo.
+ */
+int
+pal_canvas_undo(pal_canvas_history_t *history)
+{
+  history_revert(history);
+  if (history->cur == 0) {
+    return -1;
+  }
+  history_apply(history, *history_step(history, --history->cur), true);
+  return 0;
+}
+
+/* Returns 0, or -1 if there is nothing to redo */
+int
+pal_canvas_redo(pal_canvas_history_t *history)
+{
+  history_revert(history);
+  if (history->cur == history->count) {
+    return -1;
+  }
+  history_apply(history, *history_step(history, history->cur++), false);
+  return 0;
+}
+
+void
+pal_canvas_history_cleanup(pal_canvas_history_t *history)
+{
+  pal_canvas_t *canvas = history->canvas;
+
+  for (size_t n = 0; n < history->count; n++) {
+    canvas_step_free(canvas, *history_step(history, n));
+  }
+  for (size_t i = 0; i < canvas_ntiles(canvas); i++) {
+    canvas_put(canvas, history->base[i]);
+  }
+  pal_free(history->steps);
+  pal_free(history->base);
+}
@@ -0,0 +1,123 @@
+#include <qwiet/platform/common/damage.h>
+
+/* Pixels the union of @a and @b refreshes that neither of them needs */
+static uint64_t
+damage_waste(pal_rect_t a, pal_rect_t b)
+{
+  uint64_t covered = pal_rect_area(a) + pal_rect_area(b) -
+                     pal_rect_area(pal_rect_intersect(a, b));
+  return pal_rect_area(pal_rect_union(a, b)) - covered;
+}
+
+static void
+damage_remove(pal_damage_t *damage, size_t i)
+{
+  damage->rects[i] = damage->rects[--damage->count];
+}
+
+/* Merge the pair that wastes the fewest pixels */
+static void
+damage_merge_cheapest(pal_damage_t *damage)
+{
+  uint64_t best = UINT64_MAX;
+  size_t bi = 0, bj = 1;
+
+  for (size_t i = 0; i < damage->count; i++) {
+    for (size_t j = i + 1; j < damage->count; j++) {
+      uint64_t waste = damage_waste(damage->rects[i], damage->rects[j]);
+      if (waste < best) {
+        best = waste;
+        bi = i;
+        bj = j;
+      }
+    }
+  }
+  damage->rects[bi] = pal_rect_union(damage->rects[bi], damage->rects[bj]);
+  damage_remove(damage, bj);
+}
+
+/**
+ * pal_damage_init - start tracking an empty frame
+ * @damage: tracker to initialize
+ * @width:  surface width, rectangles are clipped to it
+ * @height: surface height
+ */
+void
+pal_damage_init(pal_damage_t *damage, int32_t width, int32_t height)
+{
+  damage->bounds = PAL_RECT(0, 0, width, height);
+  damage->rect_cost = PAL_DAMAGE_RECT_COST;
+  damage->count = 0;
+}
+
+/**
+ * pal_damage_add - record that @rect changed this frame
+ * @damage: tracker
+ * @rect:   changed area, may extend past the surface
+ */
+void
+pal_damage_add(pal_damage_t *damage, pal_rect_t rect)
+{
+  size_t i = 0;
+
+  rect = pal_rect_intersect(rect, damage->bounds);
+  if (pal_rect_empty(rect)) {
+    return;
+  }
+
+  /*
+   * Fold in every rectangle that is covered, or cheap enough to cover. A
+   * merge grows the rectangle, so start over until nothing more joins.
+   */
+  while (i < damage->count) {
+    pal_rect_t r = damage->rects[i];
+    if (pal_rect_contains(r, rect)) {
+      return;
+    }
+    if (pal_rect_contains(rect, r) ||
+        damage_waste(rect, r) <= damage->rect_cost) {
+      rect = pal_rect_union(rect, r);
+      damage_remove(damage, i);
+      i = 0;
+    } else {
+      i++;
+    }
+  }
+
+  if (damage->count == PAL_DAMAGE_RECTS) {
+    damage_merge_cheapest(damage);
+  }
+  damage->rects[damage->count++] = rect;
+}
+
+/* The whole surface changed, e.g. a full redraw */
+void
+pal_damage_add_all(pal_damage_t *damage)
+{
+  damage->rects[0] = damage->bounds;
+  damage->count = pal_rect_empty(damage->bounds) ? 0 : 1;
+}
+
+/**
+ * pal_damage_take - hand out the frame's damage and start the next frame
+ * @damage: tracker
+ * @out:    receives the rectangles
+ * @max:    room at @out, at least 1
+ *
+ * Returns the number of rectangles written; together they cover every
+ * rectangle added since the last call.
+ */
+size_t
+pal_damage_take(pal_damage_t *damage, pal_rect_t *out, size_t max)
+{
+  size_t n;
+
+  pal_assert(max > 0, "no room for damage");
+  while (damage->count > max) {
+    damage_merge_cheapest(damage);
+  }
+  n = damage->count;
+  memcpy(out, damage->rects, n * sizeof(*out));
+  damage->count = 0;
+  return n;
+}
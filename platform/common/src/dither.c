@@ -0,0 +1,407 @@
+#include <qwiet/platform/common/dither.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DITHER_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DITHER_NEON 1
+#endif
+
+#include "dither_noise.h"
+
+/*
+ * Threshold dithering to L levels maps a pixel v and threshold t in [0, 256)
+ * to ((v + (v >> 7)) * (L - 1) + t) >> 8. Stretching v to [0, 256] makes
+ * white land on L - 1 for every t and keeps black at 0; everything fits in
+ * 16 bits, so the vector kernels work on u16 lanes and match exactly.
+ */
+
+/* Pixels per kernel call; threshold rows repeat with this period */
+#define DITHER_SPAN DITHER_NOISE_SIZE
+
+static const uint8_t __dither_bayer[8][8] = {
+    {0, 128, 32, 160, 8, 136, 40, 168},
+    {192, 64, 224, 96, 200, 72, 232, 104},
+    {48, 176, 16, 144, 56, 184, 24, 152},
+    {240, 112, 208, 80, 248, 120, 216, 88},
+    {12, 140, 44, 172, 4, 132, 36, 164},
+    {204, 76, 236, 108, 196, 68, 228, 100},
+    {60, 188, 28, 156, 52, 180, 20, 148},
+    {252, 124, 220, 92, 244, 116, 212, 84},
+};
+
+/* Levels for @n pixels of @src against thresholds @thr */
+typedef void (*dither_threshold_fn)(const uint8_t *src,
+                                    const uint8_t *thr,
+                                    uint32_t n,
+                                    uint16_t max,
+                                    uint8_t *out);
+
+static inline uint8_t
+dither_threshold_one(uint8_t v, uint8_t t, uint16_t max)
+{
+  return (uint8_t)(((v + (v >> 7)) * max + t) >> 8);
+}
+
+static void
+dither_threshold_scalar(const uint8_t *src,
+                        const uint8_t *thr,
+                        uint32_t n,
+                        uint16_t max,
+                        uint8_t *out)
+{
+  for (uint32_t i = 0; i < n; i++) {
+    out[i] = dither_threshold_one(src[i], thr[i], max);
+  }
+}
+
+#ifdef DITHER_X86
+__attribute__((target("sse2"))) static inline __m128i
+dither_threshold_sse2_u16(__m128i v, __m128i t, __m128i max)
+{
+  v = _mm_add_epi16(v, _mm_srli_epi16(v, 7));
+  return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(v, max), t), 8);
+}
+
+__attribute__((target("sse2"))) static void
+dither_threshold_sse2(const uint8_t *src,
+                      const uint8_t *thr,
+                      uint32_t n,
+                      uint16_t max,
+                      uint8_t *out)
+{
+  const __m128i zero = _mm_setzero_si128(), m = _mm_set1_epi16(max);
+  uint32_t i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i t = _mm_loadu_si128((const __m128i *)(thr + i));
+    __m128i lo = dither_threshold_sse2_u16(
+        _mm_unpacklo_epi8(v, zero), _mm_unpacklo_epi8(t, zero), m);
+    __m128i hi = dither_threshold_sse2_u16(
+        _mm_unpackhi_epi8(v, zero), _mm_unpackhi_epi8(t, zero), m);
+    _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi));
+  }
+  for (; i < n; i++) {
+    out[i] = dither_threshold_one(src[i], thr[i], max);
+  }
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+dither_threshold_avx2_u16(__m256i v, __m256i t, __m256i max)
+{
+  v = _mm256_add_epi16(v, _mm256_srli_epi16(v, 7));
+  return _mm256_srli_epi16(
+      _mm256_add_epi16(_mm256_mullo_epi16(v, max), t), 8);
+}
+
+/* Unpack and pack both work within 128-bit lanes, so the order survives */
+__attribute__((target("avx2"))) static void
+dither_threshold_avx2(const uint8_t *src,
+                      const uint8_t *thr,
+                      uint32_t n,
+                      uint16_t max,
+                      uint8_t *out)
+{
+  const __m256i zero = _mm256_setzero_si256(), m = _mm256_set1_epi16(max);
+  uint32_t i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i t = _mm256_loadu_si256((const __m256i *)(thr + i));
+    __m256i lo = dither_threshold_avx2_u16(
+        _mm256_unpacklo_epi8(v, zero), _mm256_unpacklo_epi8(t, zero), m);
+    __m256i hi = dither_threshold_avx2_u16(
+        _mm256_unpackhi_epi8(v, zero), _mm256_unpackhi_epi8(t, zero), m);
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_packus_epi16(lo, hi));
+  }
+  for (; i < n; i++) {
+    out[i] = dither_threshold_one(src[i], thr[i], max);
+  }
+}
+#endif
+
+#ifdef DITHER_NEON
+static inline uint8x8_t
+dither_threshold_neon_u16(uint8x8_t v8, uint8x8_t t, uint16_t max)
+{
+  uint16x8_t v = vmovl_u8(v8);
+  v = vaddq_u16(v, vshrq_n_u16(v, 7));
+  return vshrn_n_u16(vaddw_u8(vmulq_n_u16(v, max), t), 8);
+}
+
+static void
+dither_threshold_neon(const uint8_t *src,
+                      const uint8_t *thr,
+                      uint32_t n,
+                      uint16_t max,
+                      uint8_t *out)
+{
+  uint32_t i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t v = vld1q_u8(src + i), t = vld1q_u8(thr + i);
+    uint8x8_t lo =
+        dither_threshold_neon_u16(vget_low_u8(v), vget_low_u8(t), max);
+    uint8x8_t hi =
+        dither_threshold_neon_u16(vget_high_u8(v), vget_high_u8(t), max);
+    vst1q_u8(out + i, vcombine_u8(lo, hi));
+  }
+  for (; i < n; i++) {
+    out[i] = dither_threshold_one(src[i], thr[i], max);
+  }
+}
+#endif
+
+static const dither_threshold_fn __dither_kernels[] = {
+    [PAL_DITHER_SCALAR] = dither_threshold_scalar,
+#ifdef DITHER_X86
+    [PAL_DITHER_SSE2] = dither_threshold_sse2,
+    [PAL_DITHER_AVX2] = dither_threshold_avx2,
+#endif
+#ifdef DITHER_NEON
+    [PAL_DITHER_NEON] = dither_threshold_neon,
+#endif
+};
+
+static const char *const __dither_names[] = {
+    [PAL_DITHER_SCALAR] = "scalar",
+    [PAL_DITHER_SSE2] = "sse2",
+    [PAL_DITHER_AVX2] = "avx2",
+    [PAL_DITHER_NEON] = "neon",
+};
+
+static int __dither_impl = -1; /* not selected yet */
+
+bool
+pal_dither_supported(enum pal_dither_impl impl)
+{
+  switch (impl) {
+  case PAL_DITHER_SCALAR:
+    return true;
+#ifdef DITHER_X86
+  case PAL_DITHER_SSE2:
+    return __builtin_cpu_supports("sse2");
+  case PAL_DITHER_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+#ifdef DITHER_NEON
+  case PAL_DITHER_NEON:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+/* Fastest kernel this CPU runs */
+enum pal_dither_impl
+pal_dither_selected(void)
+{
+  int impl = __atomic_load_n(&__dither_impl, __ATOMIC_RELAXED);
+
+  if (impl < 0) {
+    impl = pal_dither_supported(PAL_DITHER_AVX2)   ? PAL_DITHER_AVX2
+           : pal_dither_supported(PAL_DITHER_NEON) ? PAL_DITHER_NEON
+           : pal_dither_supported(PAL_DITHER_SSE2) ? PAL_DITHER_SSE2
+                                                   : PAL_DITHER_SCALAR;
+    __atomic_store_n(&__dither_impl, impl, __ATOMIC_RELAXED);
+  }
+  return impl;
+}
+
+/* Returns 0, or -1 if the CPU lacks @impl */
+int
+pal_dither_select(enum pal_dither_impl impl)
+{
+  if (!pal_dither_supported(impl)) {
+    return -1;
+  }
+  __atomic_store_n(&__dither_impl, impl, __ATOMIC_RELAXED);
+  return 0;
+}
+
+const char *
+pal_dither_impl_name(enum pal_dither_impl impl)
+{
+  size_t n = sizeof(__dither_names) / sizeof(__dither_names[0]);
+  return (size_t)impl < n ? __dither_names[impl] : "unknown";
+}
+
+/*
+ * Pack 8 levels, one per byte of @x, into @depth bytes, first pixel in the
+ * low bits: neighbours merge pairwise into 16, 32 and then 64-bit lanes.
+ * Loads are little endian, as on every target this runs on.
+ */
+static inline uint64_t
+dither_pack8(uint64_t x, unsigned int depth)
+{
+  uint64_t m1 = 0x0001000100010001ULL * ((1ULL << (2 * depth)) - 1);
+  uint64_t m2 = 0x0000000100000001ULL * ((1ULL << (4 * depth)) - 1);
+  uint64_t m3 = (1ULL << (8 * depth)) - 1;
+
+  x = (x | x >> (8 - depth)) & m1;
+  x = (x | x >> (16 - 2 * depth)) & m2;
+  return (x | x >> (32 - 4 * depth)) & m3;
+}
+
+/* Pack @n levels into @row from pixel @x, a multiple of 8 */
+static void
+dither_pack(const uint8_t *levels,
+            uint32_t n,
+            uint8_t *row,
+            uint32_t x,
+            unsigned int depth)
+{
+  uint8_t *out = row + x / 8 * depth;
+  uint32_t i = 0;
+  uint64_t v;
+
+  for (; i + 8 <= n; i += 8, out += depth) {
+    memcpy(&v, levels + i, sizeof(v));
+    v = dither_pack8(v, depth);
+    memcpy(out, &v, depth);
+  }
+  if (i < n) {
+    uint8_t tail[8] = {0};
+    memcpy(tail, levels + i, n - i);
+    memcpy(&v, tail, sizeof(v));
+    v = dither_pack8(v, depth);
+    memcpy(out, &v, ((n - i) * depth + 7) / 8);
+  }
+}
+
+static void
+dither_threshold(const pal_dither_src_t *src,
+                 const pal_dither_dst_t *dst,
+                 enum pal_dither_method method,
+                 uint32_t y0,
+                 uint32_t y1)
+{
+  dither_threshold_fn kernel = __dither_kernels[pal_dither_selected()];
+  uint16_t max = (1 << dst->depth) - 1;
+  uint8_t thr[DITHER_SPAN], levels[DITHER_SPAN];
+
+  for (uint32_t y = y0; y < y1; y++) {
+    const uint8_t *in = src->buf + (size_t)y * src->pitch;
+    uint8_t *out = dst->buf + (size_t)y * dst->pitch;
+    const uint8_t *t;
+
+    if (method == PAL_DITHER_BAYER) {
+      for (uint32_t i = 0; i < DITHER_SPAN; i++) {
+        thr[i] = __dither_bayer[y % 8][i % 8];
+      }
+      t = thr;
+    } else {
+      t = &__dither_noise[y % DITHER_NOISE_SIZE * DITHER_NOISE_SIZE];
+    }
+    for (uint32_t x = 0; x < src->width; x += DITHER_SPAN) {
+      uint32_t n =
+          src->width - x < DITHER_SPAN ? src->width - x : DITHER_SPAN;
+      kernel(in + x, t, n, max, levels);
+      dither_pack(levels, n, out, x, dst->depth);
+    }
+  }
+}
+
+/*
+ * Serpentine Floyd-Steinberg. Errors are kept in sixteenths, indexed from
+ * -1 to width so the kernel never needs an edge check; a band starts with
+ * no error so bands are independent.
+ */
+static void
+dither_floyd(const pal_dither_src_t *src,
+             const pal_dither_dst_t *dst,
+             uint32_t y0,
+             uint32_t y1,
+             uint8_t *levels,
+             int32_t *err)
+{
+  int32_t max = (1 << dst->depth) - 1;
+  int32_t *cur = err + 1, *next = err + src->width + 3;
+  uint8_t quant[256];
+  int16_t residue[256];
+
+  /* Nearest level and what it leaves over, for every clamped value */
+  for (int32_t v = 0; v < 256; v++) {
+    quant[v] = (uint8_t)((v * max + 127) / 255);
+    residue[v] = (int16_t)(v - quant[v] * 255 / max);
+  }
+  memset(err, 0, sizeof(*err) * 2 * (src->width + 2));
+  for (uint32_t y = y0; y < y1; y++) {
+    const uint8_t *in = src->buf + (size_t)y * src->pitch;
+    int32_t dir = y & 1 ? -1 : 1;
+    int32_t x = y & 1 ? (int32_t)src->width - 1 : 0;
+    int32_t ahead = 0; /* 7/16 of the last error, for the next pixel */
+    int32_t e = 0;     /* the last error */
+    int32_t *swap;
+
+    for (uint32_t i = 0; i < src->width; i++, x += dir) {
+      int32_t v = in[x] + ((cur[x] + ahead + 8) >> 4);
+
+      v = v < 0 ? 0 : v > 255 ? 255 : v;
+      /* The previous pixel's 1/16 lands below this one */
+      next[x] += e + residue[v] * 5;
+      e = residue[v];
+      levels[x] = quant[v];
+      ahead = e * 7;
+      next[x - dir] += e * 3;
+    }
+    for (uint32_t col = 0; col < src->width; col += DITHER_SPAN) {
+      uint32_t n =
+          src->width - col < DITHER_SPAN ? src->width - col : DITHER_SPAN;
+      dither_pack(levels + col,
+                  n,
+                  dst->buf + (size_t)y * dst->pitch,
+                  col,
+                  dst->depth);
+    }
+    swap = cur;
+    cur = next;
+    next = swap;
+    memset(next - 1, 0, sizeof(*next) * (src->width + 2));
+  }
+}
+
+/**
+ * pal_dither_bands - dither bands [@begin, @end) of @src into @dst
+ * @src:    8-bit source
+ * @dst:    packed output, same size
+ * @method: algorithm
+ * @begin:  first band, of PAL_DITHER_BAND rows each
+ * @end:    one past the last band
+ *
+ * Bands touch disjoint rows of @dst, so ranges may run concurrently.
+ */
+void
+pal_dither_bands(const pal_dither_src_t *src,
+                 const pal_dither_dst_t *dst,
+                 enum pal_dither_method method,
+                 size_t begin,
+                 size_t end)
+{
+  uint8_t *levels = NULL;
+  int32_t *err = NULL;
+
+  if (!src->width) {
+    return;
+  }
+  if (method == PAL_DITHER_FLOYD) {
+    levels = pal_malloc(src->width);
+    err = pal_malloc(sizeof(*err) * 2 * (src->width + 2));
+    pal_assert(levels && err, "failed to allocate dither rows");
+  }
+  for (size_t b = begin; b < end; b++) {
+    uint32_t y0 = b * PAL_DITHER_BAND;
+    uint32_t y1 = y0 + PAL_DITHER_BAND < src->height ? y0 + PAL_DITHER_BAND
+                                                     : src->height;
+    if (method == PAL_DITHER_FLOYD) {
+      dither_floyd(src, dst, y0, y1, levels, err);
+    } else {
+      dither_threshold(src, dst, method, y0, y1);
+    }
+  }
+  pal_free(err);
+  pal_free(levels);
+}
@@ -0,0 +1,359 @@
+#include <math.h>
+
+#include <qwiet/platform/common/raster.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RASTER_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define RASTER_NEON 1
+#endif
+
+/*
+ * Every kernel evaluates the same float expressions in the same order and
+ * this file is built without FP contraction, so the vector lanes round
+ * exactly like the scalar reference and the pixels match bit for bit.
+ */
+
+/* Pixels whose coverage is computed per kernel call */
+#define RASTER_SPAN 256
+
+/* Lanes of the widest kernel */
+#define RASTER_LANES 8
+
+/* A segment prepared for coverage tests */
+struct raster_seg {
+  float ax, ay, ar; /* start and radius there */
+  float dx, dy, dr; /* to the end */
+  float inv;        /* 1 / |d|^2, 0 for a dot */
+};
+
+/* Sixteenths of coverage for @n pixels of the row at @cy, from @x0 */
+typedef void (*raster_cover_fn)(const struct raster_seg *s,
+                                int32_t x0,
+                                int32_t n,
+                                float cy,
+                                uint8_t *c16);
+
+static inline uint8_t
+raster_cover_one(const struct raster_seg *s, float cx, float cy)
+{
+  float qx = cx - s->ax, qy = cy - s->ay;
+  float t = (qx * s->dx + qy * s->dy) * s->inv;
+  float ex, ey, d, cov;
+
+  t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+  ex = qx - t * s->dx;
+  ey = qy - t * s->dy;
+  d = sqrtf(ex * ex + ey * ey);
+  cov = (s->ar + t * s->dr + 0.5f) - d;
+  cov = cov < 0.0f ? 0.0f : cov > 1.0f ? 1.0f : cov;
+  return (uint8_t)(int32_t)(cov * 16.0f + 0.5f);
+}
+
+static void
+raster_cover_scalar(const struct raster_seg *s,
+                    int32_t x0,
+                    int32_t n,
+                    float cy,
+                    uint8_t *c16)
+{
+  for (int32_t i = 0; i < n; i++) {
+    c16[i] = raster_cover_one(s, (float)(x0 + i) + 0.5f, cy);
+  }
+}
+
+#ifdef RASTER_X86
+__attribute__((target("sse2"))) static void
+raster_cover_sse2(const struct raster_seg *s,
+                  int32_t x0,
+                  int32_t n,
+                  float cy,
+                  uint8_t *c16)
+{
+  const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+  const __m128 half = _mm_set1_ps(0.5f), sixteen = _mm_set1_ps(16.0f);
+  const __m128 dx = _mm_set1_ps(s->dx), dy = _mm_set1_ps(s->dy);
+  const __m128 dr = _mm_set1_ps(s->dr), inv = _mm_set1_ps(s->inv);
+  const __m128 ar = _mm_set1_ps(s->ar);
+  const __m128 qy = _mm_set1_ps(cy - s->ay);
+  const __m128 step = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+  int32_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    __m128 cx = _mm_add_ps(_mm_add_ps(_mm_set1_ps((float)(x0 + i)), step),
+                           half);
+    __m128 qx = _mm_sub_ps(cx, _mm_set1_ps(s->ax));
+    __m128 t = _mm_mul_ps(
+        _mm_add_ps(_mm_mul_ps(qx, dx), _mm_mul_ps(qy, dy)), inv);
+    __m128 ex, ey, d, cov;
+    __m128i c;
+    int32_t packed;
+
+    t = _mm_min_ps(_mm_max_ps(t, zero), one);
+    ex = _mm_sub_ps(qx, _mm_mul_ps(t, dx));
+    ey = _mm_sub_ps(qy, _mm_mul_ps(t, dy));
+    d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)));
+    cov = _mm_sub_ps(_mm_add_ps(_mm_add_ps(ar, _mm_mul_ps(t, dr)), half), d);
+    cov = _mm_min_ps(_mm_max_ps(cov, zero), one);
+    c = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(cov, sixteen), half));
+    c = _mm_packs_epi32(c, c);
+    c = _mm_packus_epi16(c, c);
+    packed = _mm_cvtsi128_si32(c);
+    memcpy(c16 + i, &packed, sizeof(packed));
+  }
+  for (; i < n; i++) {
+    c16[i] = raster_cover_one(s, (float)(x0 + i) + 0.5f, cy);
+  }
+}
+
+__attribute__((target("avx2"))) static void
+raster_cover_avx2(const struct raster_seg *s,
+                  int32_t x0,
+                  int32_t n,
+                  float cy,
+                  uint8_t *c16)
+{
+  const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+  const __m256 half = _mm256_set1_ps(0.5f), sixteen = _mm256_set1_ps(16.0f);
+  const __m256 dx = _mm256_set1_ps(s->dx), dy = _mm256_set1_ps(s->dy);
+  const __m256 dr = _mm256_set1_ps(s->dr), inv = _mm256_set1_ps(s->inv);
+  const __m256 ar = _mm256_set1_ps(s->ar);
+  const __m256 qy = _mm256_set1_ps(cy - s->ay);
+  const __m256 step =
+      _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+  int32_t i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256 cx = _mm256_add_ps(
+        _mm256_add_ps(_mm256_set1_ps((float)(x0 + i)), step), half);
+    __m256 qx = _mm256_sub_ps(cx, _mm256_set1_ps(s->ax));
+    __m256 t = _mm256_mul_ps(
+        _mm256_add_ps(_mm256_mul_ps(qx, dx), _mm256_mul_ps(qy, dy)), inv);
+    __m256 ex, ey, d, cov;
+    __m256i c;
+    __m128i lo, hi;
+
+    t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+    ex = _mm256_sub_ps(qx, _mm256_mul_ps(t, dx));
+    ey = _mm256_sub_ps(qy, _mm256_mul_ps(t, dy));
+    d = _mm256_sqrt_ps(
+        _mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)));
+    cov = _mm256_sub_ps(
+        _mm256_add_ps(_mm256_add_ps(ar, _mm256_mul_ps(t, dr)), half), d);
+    cov = _mm256_min_ps(_mm256_max_ps(cov, zero), one);
+    c = _mm256_cvttps_epi32(
+        _mm256_add_ps(_mm256_mul_ps(cov, sixteen), half));
+    lo = _mm256_castsi256_si128(c);
+    hi = _mm256_extracti128_si256(c, 1);
+    lo = _mm_packs_epi32(lo, hi);
+    lo = _mm_packus_epi16(lo, lo);
+    _mm_storel_epi64((__m128i *)(c16 + i), lo);
+  }
+  for (; i < n; i++) {
+    c16[i] = raster_cover_one(s, (float)(x0 + i) + 0.5f, cy);
+  }
+}
+#endif
+
+#ifdef RASTER_NEON
+static void
+raster_cover_neon(const struct raster_seg *s,
+                  int32_t x0,
+                  int32_t n,
+                  float cy,
+                  uint8_t *c16)
+{
+  const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f);
+  const float32x4_t half = vdupq_n_f32(0.5f), sixteen = vdupq_n_f32(16.0f);
+  const float32x4_t dx = vdupq_n_f32(s->dx), dy = vdupq_n_f32(s->dy);
+  const float32x4_t dr = vdupq_n_f32(s->dr), inv = vdupq_n_f32(s->inv);
+  const float32x4_t ar = vdupq_n_f32(s->ar);
+  const float32x4_t qy = vdupq_n_f32(cy - s->ay);
+  const float steps[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+  const float32x4_t step = vld1q_f32(steps);
+  int32_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t cx =
+        vaddq_f32(vaddq_f32(vdupq_n_f32((float)(x0 + i)), step), half);
+    float32x4_t qx = vsubq_f32(cx, vdupq_n_f32(s->ax));
+    float32x4_t t =
+        vmulq_f32(vaddq_f32(vmulq_f32(qx, dx), vmulq_f32(qy, dy)), inv);
+    float32x4_t ex, ey, d, cov;
+    uint16x4_t c;
+
+    t = vminq_f32(vmaxq_f32(t, zero), one);
+    ex = vsubq_f32(qx, vmulq_f32(t, dx));
+    ey = vsubq_f32(qy, vmulq_f32(t, dy));
+    d = vsqrtq_f32(vaddq_f32(vmulq_f32(ex, ex), vmulq_f32(ey, ey)));
+    cov = vsubq_f32(vaddq_f32(vaddq_f32(ar, vmulq_f32(t, dr)), half), d);
+    cov = vminq_f32(vmaxq_f32(cov, zero), one);
+    c = vmovn_u32(vcvtq_u32_f32(vaddq_f32(vmulq_f32(cov, sixteen), half)));
+    c16[i] = vget_lane_u16(c, 0);
+    c16[i + 1] = vget_lane_u16(c, 1);
+    c16[i + 2] = vget_lane_u16(c, 2);
+    c16[i + 3] = vget_lane_u16(c, 3);
+  }
+  for (; i < n; i++) {
+    c16[i] = raster_cover_one(s, (float)(x0 + i) + 0.5f, cy);
+  }
+}
+#endif
+
+static const raster_cover_fn __raster_kernels[] = {
+    [PAL_RASTER_SCALAR] = raster_cover_scalar,
+#ifdef RASTER_X86
+    [PAL_RASTER_SSE2] = raster_cover_sse2,
+    [PAL_RASTER_AVX2] = raster_cover_avx2,
+#endif
+#ifdef RASTER_NEON
+    [PAL_RASTER_NEON] = raster_cover_neon,
+#endif
+};
+
+/* Kernels are handed whole vectors, coverage past the segment's box
+ * included, so none falls into its scalar tail on the short rows of a pen
+ * segment */
+static const int32_t __raster_lanes[] = {
+    [PAL_RASTER_SCALAR] = 1,
+    [PAL_RASTER_SSE2] = 4,
+    [PAL_RASTER_AVX2] = RASTER_LANES,
+    [PAL_RASTER_NEON] = 4,
+};
+
+static const char *const __raster_names[] = {
+    [PAL_RASTER_SCALAR] = "scalar",
+    [PAL_RASTER_SSE2] = "sse2",
+    [PAL_RASTER_AVX2] = "avx2",
+    [PAL_RASTER_NEON] = "neon",
+};
+
+static int __raster_impl = -1; /* not selected yet */
+
+bool
+pal_raster_supported(enum pal_raster_impl impl)
+{
+  switch (impl) {
+  case PAL_RASTER_SCALAR:
+    return true;
+#ifdef RASTER_X86
+  case PAL_RASTER_SSE2:
+    return __builtin_cpu_supports("sse2");
+  case PAL_RASTER_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+#ifdef RASTER_NEON
+  case PAL_RASTER_NEON:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+/* Fastest kernel this CPU runs */
+enum pal_raster_impl
+pal_raster_selected(void)
+{
+  int impl = __atomic_load_n(&__raster_impl, __ATOMIC_RELAXED);
+
+  if (impl < 0) {
+    impl = pal_raster_supported(PAL_RASTER_AVX2)   ? PAL_RASTER_AVX2
+           : pal_raster_supported(PAL_RASTER_NEON) ? PAL_RASTER_NEON
+           : pal_raster_supported(PAL_RASTER_SSE2) ? PAL_RASTER_SSE2
+                                                   : PAL_RASTER_SCALAR;
+    __atomic_store_n(&__raster_impl, impl, __ATOMIC_RELAXED);
+  }
+  return impl;
+}
+
+/* Returns 0, or -1 if the CPU lacks @impl */
+int
+pal_raster_select(enum pal_raster_impl impl)
+{
+  if (!pal_raster_supported(impl)) {
+    return -1;
+  }
+  __atomic_store_n(&__raster_impl, impl, __ATOMIC_RELAXED);
+  return 0;
+}
+
+const char *
+pal_raster_impl_name(enum pal_raster_impl impl)
+{
+  size_t n = sizeof(__raster_names) / sizeof(__raster_names[0]);
+  return (size_t)impl < n ? __raster_names[impl] : "unknown";
+}
+
+static inline void
+raster_blend(uint8_t *row, int32_t x, uint8_t c16, uint8_t ink)
+{
+  uint8_t *byte = &row[x >> 1];
+  int shift = (x & 1) << 2;
+  uint32_t old = (*byte >> shift) & 0xf;
+  uint32_t v = ((old * (16 - c16) + ink * c16 + 8) >> 4) & 0xf;
+
+  *byte = (uint8_t)((*byte & ~(0xf << shift)) | (v << shift));
+}
+
+/**
+ * pal_raster_segment - draw the stroke segment from @a to @b
+ * @fb:  Y4 framebuffer
+ * @pen: width range and ink
+ * @a:   start, in pixels; pixel (x, y) covers [x, x + 1) x [y, y + 1)
+ * @b:   end
+ *
+ * The end caps are drawn too, so a stroke of one sample is a dot.
+ */
+void
+pal_raster_segment(const pal_raster_fb_t *fb,
+                   const pal_raster_pen_t *pen,
+                   pal_raster_point_t a,
+                   pal_raster_point_t b)
+{
+  enum pal_raster_impl impl = pal_raster_selected();
+  raster_cover_fn cover = __raster_kernels[impl];
+  int32_t lanes = __raster_lanes[impl];
+  float span = pen->max_width - pen->min_width;
+  float ra = (pen->min_width + span * a.pressure) * 0.5f;
+  float rb = (pen->min_width + span * b.pressure) * 0.5f;
+  float reach = (ra > rb ? ra : rb) + 1.0f;
+  float len2 = (b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y);
+  struct raster_seg s = {
+      .ax = a.x,
+      .ay = a.y,
+      .ar = ra,
+      .dx = b.x - a.x,
+      .dy = b.y - a.y,
+      .dr = rb - ra,
+      .inv = len2 > 0.0f ? 1.0f / len2 : 0.0f,
+  };
+  float fx0 = floorf((a.x < b.x ? a.x : b.x) - reach);
+  float fy0 = floorf((a.y < b.y ? a.y : b.y) - reach);
+  float fx1 = ceilf((a.x > b.x ? a.x : b.x) + reach);
+  float fy1 = ceilf((a.y > b.y ? a.y : b.y) + reach);
+  int32_t x0, y0, x1, y1;
+  uint8_t c16[RASTER_SPAN + RASTER_LANES];
+
+  /* Clip in float first: a wild sample must not overflow the casts */
+  x0 = fx0 < 0.0f ? 0 : fx0 > (float)fb->width ? (int32_t)fb->width : fx0;
+  y0 = fy0 < 0.0f ? 0 : fy0 > (float)fb->height ? (int32_t)fb->height : fy0;
+  x1 = fx1 < 0.0f ? 0 : fx1 > (float)fb->width ? (int32_t)fb->width : fx1;
+  y1 = fy1 < 0.0f ? 0 : fy1 > (float)fb->height ? (int32_t)fb->height : fy1;
+
+  for (int32_t y = y0; y < y1; y++) {
+    uint8_t *row = fb->buf + (size_t)y * fb->pitch;
+    float cy = (float)y + 0.5f;
+    for (int32_t x = x0; x < x1; x += RASTER_SPAN) {
+      int32_t n = x1 - x < RASTER_SPAN ? x1 - x : RASTER_SPAN;
+      cover(&s, x, (n + lanes - 1) & ~(lanes - 1), cy, c16);
+      for (int32_t i = 0; i < n; i++) {
+        if (c16[i]) {
+          raster_blend(row, x + i, c16[i], pen->ink);
+        }
+      }
+    }
+  }
+}
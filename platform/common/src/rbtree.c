@@ -0,0 +1,647 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Red Black Trees
+ *
+ * Adapted from the Linux kernel (lib/rbtree.c) for userspace use, without
+ * the augmented callbacks.
+ * (C) 1999  Andrea Arcangeli <andrea@suse.de>
+ * (C) 2002  David Woodhouse <dwmw2@infradead.org>
+ * (C) 2012  Michel Lespinasse <walken@google.com>
+ */
+#include <qwiet/platform/common/rbtree.h>
+
+/*
+ * red-black trees properties:  https://en.wikipedia.org/wiki/Rbtree
+ *
+ *  1) A node is either red or black
+ *  2) The root is black
+ *  3) All leaves (NULL) are black
+ *  4) Both children of every red node are black
+ *  5) Every simple path from root to leaves contains the same number
+ *     of black nodes.
+ *
+ *  4 and 5 give the O(log n) guarantee, since 4 implies you cannot have two
+ *  consecutive red nodes in a path and every red node is therefore followed by
+ *  a black. So if B is the number of black nodes on every simple path (as per
+ *  5), then the longest possible path due to 4 is 2B.
+ *
+ *  We shall indicate color with case, where black nodes are uppercase and red
+ *  nodes will be lowercase. Unknown color nodes shall be drawn as red within
+ *  parentheses and have some accompanying text comment.
+ */
+
+#define RB_RED 0
+#define RB_BLACK 1
+
+#define __rb_parent(pc) ((struct pal_rb_node *)(pc & ~3))
+
+#define __rb_color(pc) ((pc) & 1)
+#define __rb_is_black(pc) __rb_color(pc)
+#define __rb_is_red(pc) (!__rb_color(pc))
+#define rb_color(rb) __rb_color((rb)->__rb_parent_color)
+#define rb_is_red(rb) __rb_is_red((rb)->__rb_parent_color)
+#define rb_is_black(rb) __rb_is_black((rb)->__rb_parent_color)
+
+static inline void
+rb_set_parent(struct pal_rb_node *rb, struct pal_rb_node *p)
+{
+  rb->__rb_parent_color = rb_color(rb) + (unsigned long)p;
+}
+
+static inline void
+rb_set_parent_color(struct pal_rb_node *rb, struct pal_rb_node *p, int color)
+{
+  rb->__rb_parent_color = (unsigned long)p + color;
+}
+
+static inline void
+rb_set_black(struct pal_rb_node *rb)
+{
+  rb->__rb_parent_color += RB_BLACK;
+}
+
+static inline struct pal_rb_node *
+rb_red_parent(struct pal_rb_node *red)
+{
+  return (struct pal_rb_node *)red->__rb_parent_color;
+}
+
+static inline void
+__rb_change_child(struct pal_rb_node *old,
+                  struct pal_rb_node *new,
+                  struct pal_rb_node *parent,
+                  struct pal_rb_root *root)
+{
+  if (parent) {
+    if (parent->rb_left == old)
+      parent->rb_left = new;
+    else
+      parent->rb_right = new;
+  } else
+    root->rb_node = new;
+}
+
+/*
+ * Helper function for rotations:
+ * - old's parent and color get assigned to new
+ * - old gets assigned new as a parent and 'color' as a color.
+ */
+static inline void
+__rb_rotate_set_parents(struct pal_rb_node *old,
+                        struct pal_rb_node *new,
+                        struct pal_rb_root *root,
+                        int color)
+{
+  struct pal_rb_node *parent = pal_rb_parent(old);
+  new->__rb_parent_color = old->__rb_parent_color;
+  rb_set_parent_color(old, new, color);
+  __rb_change_child(old, new, parent, root);
+}
+
+void
+pal_rb_insert_color(struct pal_rb_node *node, struct pal_rb_root *root)
+{
+  struct pal_rb_node *parent = rb_red_parent(node), *gparent, *tmp;
+
+  while (true) {
+    /*
+     * Loop invariant: node is red.
+     */
+    if (!parent) {
+      /*
+       * The inserted node is root. Either this is the
+       * first node, or we recursed at Case 1 below and
+       * are no longer violating 4).
+       */
+      rb_set_parent_color(node, NULL, RB_BLACK);
+      break;
+    }
+
+    /*
+     * If there is a black parent, we are done.
+     * Otherwise, take some corrective action as,
+     * per 4), we don't want a red root or two
+     * consecutive red nodes.
+     */
+    if (rb_is_black(parent))
+      break;
+
+    gparent = rb_red_parent(parent);
+
+    tmp = gparent->rb_right;
+    if (parent != tmp) { /* parent == gparent->rb_left */
+      if (tmp && rb_is_red(tmp)) {
+        /*
+         * Case 1 - node's uncle is red (color flips).
+         *
+         *       G            g
+         *      / \          / \
+         *     p   u  -->   P   U
+         *    /            /
+         *   n            n
+         *
+         * However, since g's parent might be red, and
+         * 4) does not allow this, we need to recurse
+         * at g.
+         */
+        rb_set_parent_color(tmp, gparent, RB_BLACK);
+        rb_set_parent_color(parent, gparent, RB_BLACK);
+        node = gparent;
+        parent = pal_rb_parent(node);
+        rb_set_parent_color(node, parent, RB_RED);
+        continue;
+      }
+
+      tmp = parent->rb_right;
+      if (node == tmp) {
+        /*
+         * Case 2 - node's uncle is black and node is
+         * the parent's right child (left rotate at parent).
+         *
+         *      G             G
+         *     / \           / \
+         *    p   U  -->    n   U
+         *     \           /
+         *      n         p
+         *
+         * This still leaves us in violation of 4), the
+         * continuation into Case 3 will fix that.
+         */
+        tmp = node->rb_left;
+        parent->rb_right = tmp;
+        node->rb_left = parent;
+        if (tmp)
+          rb_set_parent_color(tmp, parent, RB_BLACK);
+        rb_set_parent_color(parent, node, RB_RED);
+        parent = node;
+        tmp = node->rb_right;
+      }
+
+      /*
+       * Case 3 - node's uncle is black and node is
+       * the parent's left child (right rotate at gparent).
+       *
+       *        G           P
+       *       / \         / \
+       *      p   U  -->  n   g
+       *     /                 \
+       *    n                   U
+       */
+      gparent->rb_left = tmp; /* == parent->rb_right */
+      parent->rb_right = gparent;
+      if (tmp)
+        rb_set_parent_color(tmp, gparent, RB_BLACK);
+      __rb_rotate_set_parents(gparent, parent, root, RB_RED);
+      break;
+    } else {
+      tmp = gparent->rb_left;
+      if (tmp && rb_is_red(tmp)) {
+        /* Case 1 - color flips */
+        rb_set_parent_color(tmp, gparent, RB_BLACK);
+        rb_set_parent_color(parent, gparent, RB_BLACK);
+        node = gparent;
+        parent = pal_rb_parent(node);
+        rb_set_parent_color(node, parent, RB_RED);
+        continue;
+      }
+
+      tmp = parent->rb_left;
+      if (node == tmp) {
+        /* Case 2 - right rotate at parent */
+        tmp = node->rb_right;
+        parent->rb_left = tmp;
+        node->rb_right = parent;
+        if (tmp)
+          rb_set_parent_color(tmp, parent, RB_BLACK);
+        rb_set_parent_color(parent, node, RB_RED);
+        parent = node;
+        tmp = node->rb_left;
+      }
+
+      /* Case 3 - left rotate at gparent */
+      gparent->rb_right = tmp; /* == parent->rb_left */
+      parent->rb_left = gparent;
+      if (tmp)
+        rb_set_parent_color(tmp, gparent, RB_BLACK);
+      __rb_rotate_set_parents(gparent, parent, root, RB_RED);
+      break;
+    }
+  }
+}
+
+/*
+ * Restore 5) after __rb_erase() removed a black node from below @parent.
+ */
+static void
+__rb_erase_color(struct pal_rb_node *parent, struct pal_rb_root *root)
+{
+  struct pal_rb_node *node = NULL, *sibling, *tmp1, *tmp2;
+
+  while (true) {
+    /*
+     * Loop invariants:
+     * - node is black (or NULL on first iteration)
+     * - node is not the root (parent is not NULL)
+     * - All leaf paths going through parent and node have a
+     *   black node count that is 1 lower than other leaf paths.
+     */
+    sibling = parent->rb_right;
+    if (node != sibling) { /* node == parent->rb_left */
+      if (rb_is_red(sibling)) {
+        /*
+         * Case 1 - left rotate at parent
+         *
+         *     P               S
+         *    / \             / \
+         *   N   s    -->    p   Sr
+         *      / \         / \
+         *     Sl  Sr      N   Sl
+         */
+        tmp1 = sibling->rb_left;
+        parent->rb_right = tmp1;
+        sibling->rb_left = parent;
+        rb_set_parent_color(tmp1, parent, RB_BLACK);
+        __rb_rotate_set_parents(parent, sibling, root, RB_RED);
+        sibling = tmp1;
+      }
+      tmp1 = sibling->rb_right;
+      if (!tmp1 || rb_is_black(tmp1)) {
+        tmp2 = sibling->rb_left;
+        if (!tmp2 || rb_is_black(tmp2)) {
+          /*
+           * Case 2 - sibling color flip
+           * (p could be either color here)
+           *
+           *    (p)           (p)
+           *    / \           / \
+           *   N   S    -->  N   s
+           *      / \           / \
+           *     Sl  Sr        Sl  Sr
+           *
+           * This leaves us violating 5) which
+           * can be fixed by flipping p to black
+           * if it was red, or by recursing at p.
+           * p is red when coming from Case 1.
+           */
+          rb_set_parent_color(sibling, parent, RB_RED);
+          if (rb_is_red(parent))
+            rb_set_black(parent);
+          else {
+            node = parent;
+            parent = pal_rb_parent(node);
+            if (parent)
+              continue;
+          }
+          break;
+        }
+        /*
+         * Case 3 - right rotate at sibling
+         * (p could be either color here)
+         *
+         *   (p)           (p)
+         *   / \           / \
+         *  N   S    -->  N   sl
+         *     / \             \
+         *    sl  Sr            S
+         *                       \
+         *                        Sr
+         *
+         * Note: p might be red, and then both
+         * p and sl are red after rotation(which
+         * breaks property 4). This is fixed in
+         * Case 4 (in __rb_rotate_set_parents()
+         *         which set sl the color of p
+         *         and set p RB_BLACK)
+         */
+        tmp1 = tmp2->rb_right;
+        sibling->rb_left = tmp1;
+        tmp2->rb_right = sibling;
+        parent->rb_right = tmp2;
+        if (tmp1)
+          rb_set_parent_color(tmp1, sibling, RB_BLACK);
+        tmp1 = sibling;
+        sibling = tmp2;
+      }
+      /*
+       * Case 4 - left rotate at parent + color flips
+       * (p and sl could be either color here.
+       *  After rotation, p becomes black, s acquires
+       *  p's color, and sl keeps its color)
+       *
+       *      (p)             (s)
+       *      / \             / \
+       *     N   S     -->   P   Sr
+       *        / \         / \
+       *      (sl) sr      N  (sl)
+       */
+      tmp2 = sibling->rb_left;
+      parent->rb_right = tmp2;
+      sibling->rb_left = parent;
+      rb_set_parent_color(tmp1, sibling, RB_BLACK);
+      if (tmp2)
+        rb_set_parent(tmp2, parent);
+      __rb_rotate_set_parents(parent, sibling, root, RB_BLACK);
+      break;
+    } else {
+      sibling = parent->rb_left;
+      if (rb_is_red(sibling)) {
+        /* Case 1 - right rotate at parent */
+        tmp1 = sibling->rb_right;
+        parent->rb_left = tmp1;
+        sibling->rb_right = parent;
+        rb_set_parent_color(tmp1, parent, RB_BLACK);
+        __rb_rotate_set_parents(parent, sibling, root, RB_RED);
+        sibling = tmp1;
+      }
+      tmp1 = sibling->rb_left;
+      if (!tmp1 || rb_is_black(tmp1)) {
+        tmp2 = sibling->rb_right;
+        if (!tmp2 || rb_is_black(tmp2)) {
+          /* Case 2 - sibling color flip */
+          rb_set_parent_color(sibling, parent, RB_RED);
+          if (rb_is_red(parent))
+            rb_set_black(parent);
+          else {
+            node = parent;
+            parent = pal_rb_parent(node);
+            if (parent)
+              continue;
+          }
+          break;
+        }
+        /* Case 3 - left rotate at sibling */
+        tmp1 = tmp2->rb_left;
+        sibling->rb_right = tmp1;
+        tmp2->rb_left = sibling;
+        parent->rb_left = tmp2;
+        if (tmp1)
+          rb_set_parent_color(tmp1, sibling, RB_BLACK);
+        tmp1 = sibling;
+        sibling = tmp2;
+      }
+      /* Case 4 - right rotate at parent + color flips */
+      tmp2 = sibling->rb_right;
+      parent->rb_left = tmp2;
+      sibling->rb_right = parent;
+      rb_set_parent_color(tmp1, sibling, RB_BLACK);
+      if (tmp2)
+        rb_set_parent(tmp2, parent);
+      __rb_rotate_set_parents(parent, sibling, root, RB_BLACK);
+      break;
+    }
+  }
+}
+
+/*
+ * Unlink @node and return the node to rebalance from, or NULL if the tree
+ * is still valid.
+ */
+static struct pal_rb_node *
+__rb_erase(struct pal_rb_node *node, struct pal_rb_root *root)
+{
+  struct pal_rb_node *child = node->rb_right;
+  struct pal_rb_node *tmp = node->rb_left;
+  struct pal_rb_node *parent, *rebalance;
+  unsigned long pc;
+
+  if (!tmp) {
+    /*
+     * Case 1: node to erase has no more than 1 child (easy!)
+     *
+     * Note that if there is one child it must be red due to 5)
+     * and node must be black due to 4). We adjust colors locally
+     * so as to bypass __rb_erase_color() later on.
+     */
+    pc = node->__rb_parent_color;
+    parent = __rb_parent(pc);
+    __rb_change_child(node, child, parent, root);
+    if (child) {
+      child->__rb_parent_color = pc;
+      rebalance = NULL;
+    } else
+      rebalance = __rb_is_black(pc) ? parent : NULL;
+  } else if (!child) {
+    /* Still case 1, but this time the child is node->rb_left */
+    tmp->__rb_parent_color = pc = node->__rb_parent_color;
+    parent = __rb_parent(pc);
+    __rb_change_child(node, tmp, parent, root);
+    rebalance = NULL;
+  } else {
+    struct pal_rb_node *successor = child, *child2;
+
+    tmp = child->rb_left;
+    if (!tmp) {
+      /*
+       * Case 2: node's successor is its right child
+       *
+       *    (n)          (s)
+       *    / \          / \
+       *  (x) (s)  ->  (x) (c)
+       *        \
+       *        (c)
+       */
+      parent = successor;
+      child2 = successor->rb_right;
+    } else {
+      /*
+       * Case 3: node's successor is leftmost under
+       * node's right child subtree
+       *
+       *    (n)          (s)
+       *    / \          / \
+       *  (x) (y)  ->  (x) (y)
+       *      /            /
+       *    (p)          (p)
+       *    /            /
+       *  (s)          (c)
+       *    \
+       *    (c)
+       */
+      do {
+        parent = successor;
+        successor = tmp;
+        tmp = tmp->rb_left;
+      } while (tmp);
+      child2 = successor->rb_right;
+      parent->rb_left = child2;
+      successor->rb_right = child;
+      rb_set_parent(child, successor);
+    }
+
+    tmp = node->rb_left;
+    successor->rb_left = tmp;
+    rb_set_parent(tmp, successor);
+
+    pc = node->__rb_parent_color;
+    tmp = __rb_parent(pc);
+    __rb_change_child(node, successor, tmp, root);
+
+    if (child2) {
+      rb_set_parent_color(child2, parent, RB_BLACK);
+      rebalance = NULL;
+    } else {
+      rebalance = rb_is_black(successor) ? parent : NULL;
+    }
+    successor->__rb_parent_color = pc;
+  }
+
+  return rebalance;
+}
+
+void
+pal_rb_erase(struct pal_rb_node *node, struct pal_rb_root *root)
+{
+  struct pal_rb_node *rebalance;
+  rebalance = __rb_erase(node, root);
+  if (rebalance)
+    __rb_erase_color(rebalance, root);
+}
+
+/*
+ * This function returns the first node (in sort order) of the tree.
+ */
+struct pal_rb_node *
+pal_rb_first(const struct pal_rb_root *root)
+{
+  struct pal_rb_node *n;
+
+  n = root->rb_node;
+  if (!n)
+    return NULL;
+  while (n->rb_left)
+    n = n->rb_left;
+  return n;
+}
+
+struct pal_rb_node *
+pal_rb_last(const struct pal_rb_root *root)
+{
+  struct pal_rb_node *n;
+
+  n = root->rb_node;
+  if (!n)
+    return NULL;
+  while (n->rb_right)
+    n = n->rb_right;
+  return n;
+}
+
+struct pal_rb_node *
+pal_rb_next(const struct pal_rb_node *node)
+{
+  struct pal_rb_node *parent;
+
+  if (PAL_RB_EMPTY_NODE(node))
+    return NULL;
+
+  /*
+   * If we have a right-hand child, go down and then left as far
+   * as we can.
+   */
+  if (node->rb_right) {
+    node = node->rb_right;
+    while (node->rb_left)
+      node = node->rb_left;
+    return (struct pal_rb_node *)node;
+  }
+
+  /*
+   * No right-hand children. Everything down and left is smaller than us,
+   * so any 'next' node must be in the general direction of our parent.
+   * Go up the tree; any time the ancestor is a right-hand child of its
+   * parent, keep going up. First time it's a left-hand child of its
+   * parent, said parent is our 'next' node.
+   */
+  while ((parent = pal_rb_parent(node)) && node == parent->rb_right)
+    node = parent;
+
+  return parent;
+}
+
+struct pal_rb_node *
+pal_rb_prev(const struct pal_rb_node *node)
+{
+  struct pal_rb_node *parent;
+
+  if (PAL_RB_EMPTY_NODE(node))
+    return NULL;
+
+  /*
+   * If we have a left-hand child, go down and then right as far
+   * as we can.
+   */
+  if (node->rb_left) {
+    node = node->rb_left;
+    while (node->rb_right)
+      node = node->rb_right;
+    return (struct pal_rb_node *)node;
+  }
+
+  /*
+   * No left-hand children. Go up till we find an ancestor which
+   * is a right-hand child of its parent.
+   */
+  while ((parent = pal_rb_parent(node)) && node == parent->rb_left)
+    node = parent;
+
+  return parent;
+}
+
+void
+pal_rb_replace_node(struct pal_rb_node *victim,
+                    struct pal_rb_node *new,
+                    struct pal_rb_root *root)
+{
+  struct pal_rb_node *parent = pal_rb_parent(victim);
+
+  /* Copy the pointers/colour from the victim to the replacement */
+  *new = *victim;
+
+  /* Set the surrounding nodes to point to the replacement */
+  if (victim->rb_left)
+    rb_set_parent(victim->rb_left, new);
+  if (victim->rb_right)
+    rb_set_parent(victim->rb_right, new);
+  __rb_change_child(victim, new, parent, root);
+}
+
+static struct pal_rb_node *
+rb_left_deepest_node(const struct pal_rb_node *node)
+{
+  for (;;) {
+    if (node->rb_left)
+      node = node->rb_left;
+    else if (node->rb_right)
+      node = node->rb_right;
+    else
+      return (struct pal_rb_node *)node;
+  }
+}
+
+struct pal_rb_node *
+pal_rb_next_postorder(const struct pal_rb_node *node)
+{
+  const struct pal_rb_node *parent;
+  if (!node)
+    return NULL;
+  parent = pal_rb_parent(node);
+
+  /* If we're sitting on node, we've already seen our children */
+  if (parent && node == parent->rb_left && parent->rb_right) {
+    /* If we are the parent's left node, go to the parent's right
+     * node then all the way down to the left */
+    return rb_left_deepest_node(parent->rb_right);
+  } else
+    /* Otherwise we are the parent's right node, and the parent
+     * should be next */
+    return (struct pal_rb_node *)parent;
+}
+
+struct pal_rb_node *
+pal_rb_first_postorder(const struct pal_rb_root *root)
+{
+  if (!root->rb_node)
+    return NULL;
+
+  return rb_left_deepest_node(root->rb_node);
+}
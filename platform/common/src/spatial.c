@@ -0,0 +1,402 @@
+#include <math.h>
+
+#include <qwiet/platform/common/spatial.h>
+
+struct spatial_segment {
+  float ax, ay;
+  float bx, by;
+  float ar, br; /* half widths at a and b */
+};
+
+struct spatial_stroke {
+  struct pal_hash_node hnode;
+  uint32_t id;
+  uint32_t stamp;
+  pal_rect_t bounds;
+  struct spatial_segment *segs;
+  uint32_t count;
+  uint32_t cap;
+};
+
+/* A segment as listed in a cell: its box inline, so most candidates are
+ * rejected without touching the stroke */
+struct spatial_ref {
+  pal_rect_t box;
+  struct spatial_stroke *stroke;
+  uint32_t seg;
+};
+
+struct pal_spatial_cell {
+  struct spatial_ref *refs;
+  uint32_t count;
+  uint32_t cap;
+};
+
+static bool
+spatial_eq(const struct pal_hash_node *node, const void *key)
+{
+  const struct spatial_stroke *s =
+      PAL_CONTAINER_OF(node, struct spatial_stroke, hnode);
+  return s->id == *(const uint32_t *)key;
+}
+
+static struct spatial_stroke *
+spatial_find(const pal_spatial_t *index, uint32_t id)
+{
+  struct pal_hash_node *node = pal_hashtable_find(
+      &index->strokes, pal_hash_u32(id), spatial_eq, &id);
+  return node ? PAL_CONTAINER_OF(node, struct spatial_stroke, hnode) : NULL;
+}
+
+/* Double the array at @*p of @*cap elements of @size bytes */
+static void
+spatial_grow(void **p, uint32_t *cap, size_t size)
+{
+  uint32_t n = *cap ? *cap * 2 : 4;
+  void *grown = pal_malloc(n * size);
+
+  pal_assert(grown, "failed to grow spatial index");
+  if (*p) {
+    memcpy(grown, *p, *cap * size);
+    pal_free(*p);
+  }
+  *p = grown;
+  *cap = n;
+}
+
+/* Cells under @box, clamped to the grid; false if it misses the grid */
+static bool
+spatial_cells(const pal_spatial_t *index,
+              pal_rect_t box,
+              uint32_t *c0,
+              uint32_t *r0,
+              uint32_t *c1,
+              uint32_t *r1)
+{
+  int32_t w = (int32_t)(index->cols << index->shift);
+  int32_t h = (int32_t)(index->rows << index->shift);
+
+  box = pal_rect_intersect(box, PAL_RECT(0, 0, w, h));
+  if (pal_rect_empty(box)) {
+    return false;
+  }
+  *c0 = (uint32_t)box.x1 >> index->shift;
+  *r0 = (uint32_t)box.y1 >> index->shift;
+  *c1 = (uint32_t)(box.x2 - 1) >> index->shift;
+  *r1 = (uint32_t)(box.y2 - 1) >> index->shift;
+  return true;
+}
+
+/* Next query stamp; strokes are reset when it wraps */
+static uint32_t
+spatial_stamp(pal_spatial_t *index)
+{
+  if (++index->stamp == 0) {
+    struct pal_hash_node *pos;
+    size_t bkt;
+
+    pal_hashtable_for_each(&index->strokes, bkt, pos)
+    {
+      PAL_CONTAINER_OF(pos, struct spatial_stroke, hnode)->stamp = 0;
+    }
+    index->stamp = 1;
+  }
+  return index->stamp;
+}
+
+/**
+ * pal_spatial_init - create an empty index
+ * @index:  index to initialize
+ * @width:  page width, pixels
+ * @height: page height, pixels
+ * @shift:  log2 of the cell size, e.g. PAL_SPATIAL_CELL_SHIFT
+ *
+ * Segments reaching past the page are listed in the edge cells; parts
+ * wholly off the page are kept with their stroke but no query finds them.
+ */
+void
+pal_spatial_init(pal_spatial_t *index,
+                 uint32_t width,
+                 uint32_t height,
+                 uint32_t shift)
+{
+  size_t ncells;
+
+  memset(index, 0, sizeof(*index));
+  pal_hashtable_init(&index->strokes, 0);
+  index->shift = shift;
+  index->cols = (width + (1u << shift) - 1) >> shift;
+  index->rows = (height + (1u << shift) - 1) >> shift;
+  pal_assert(index->cols && index->rows, "empty page");
+  ncells = (size_t)index->cols * index->rows;
+  index->cells = pal_malloc(ncells * sizeof(*index->cells));
+  pal_assert(index->cells, "failed to allocate spatial index");
+  memset(index->cells, 0, ncells * sizeof(*index->cells));
+}
+
+void
+pal_spatial_cleanup(pal_spatial_t *index)
+{
+  struct pal_hlist_node *tmp;
+  struct pal_hash_node *pos;
+  size_t bkt;
+
+  pal_hashtable_for_each_safe(&index->strokes, bkt, tmp, pos)
+  {
+    struct spatial_stroke *s =
+        PAL_CONTAINER_OF(pos, struct spatial_stroke, hnode);
+    pal_hashtable_del(&index->strokes, &s->hnode);
+    pal_free(s->segs);
+    pal_free(s);
+  }
+  pal_hashtable_cleanup(&index->strokes);
+  for (size_t i = 0; i < (size_t)index->cols * index->rows; i++) {
+    pal_free(index->cells[i].refs);
+  }
+  pal_free(index->cells);
+}
+
+/**
+ * pal_spatial_add - add a segment to a stroke
+ * @index: index
+ * @id:    stroke, created by its first segment
+ * @pen:   pen the segment is drawn with
+ * @a:     start
+ * @b:     end
+ *
+ * Takes the same arguments as pal_canvas_segment(), so the two can be
+ * called side by side as the pen moves.
+ */
+void
+pal_spatial_add(pal_spatial_t *index,
+                uint32_t id,
+                const pal_raster_pen_t *pen,
+                pal_raster_point_t a,
+                pal_raster_point_t b)
+{
+  struct spatial_stroke *s = spatial_find(index, id);
+  float span = pen->max_width - pen->min_width;
+  float ar = (pen->min_width + span * a.pressure) * 0.5f;
+  float br = (pen->min_width + span * b.pressure) * 0.5f;
+  float r = ar > br ? ar : br;
+  pal_rect_t box = PAL_RECT((int32_t)floorf(fminf(a.x, b.x) - r),
+                            (int32_t)floorf(fminf(a.y, b.y) - r),
+                            (int32_t)ceilf(fmaxf(a.x, b.x) + r) + 1,
+                            (int32_t)ceilf(fmaxf(a.y, b.y) + r) + 1);
+  uint32_t c0, r0, c1, r1;
+
+  if (!s) {
+    s = pal_malloc(sizeof(*s));
+    pal_assert(s, "failed to allocate stroke");
+    memset(s, 0, sizeof(*s));
+    s->id = id;
+    s->bounds = box;
+    pal_hashtable_add(&index->strokes, &s->hnode, pal_hash_u32(id));
+  }
+  if (s->count == s->cap) {
+    spatial_grow((void **)&s->segs, &s->cap, sizeof(*s->segs));
+  }
+  s->segs[s->count] = (struct spatial_segment){a.x, a.y, b.x, b.y, ar, br};
+  s->bounds = pal_rect_union(s->bounds, box);
+
+  if (spatial_cells(index, box, &c0, &r0, &c1, &r1)) {
+    for (uint32_t row = r0; row <= r1; row++) {
+      for (uint32_t col = c0; col <= c1; col++) {
+        struct pal_spatial_cell *cell =
+            &index->cells[(size_t)row * index->cols + col];
+        if (cell->count == cell->cap) {
+          spatial_grow(
+              (void **)&cell->refs, &cell->cap, sizeof(*cell->refs));
+        }
+        cell->refs[cell->count++] = (struct spatial_ref){box, s, s->count};
+      }
+    }
+  }
+  s->count++;
+  index->segments++;
+}
+
+/**
+ * pal_spatial_remove - remove a stroke and all its segments
+ * @index: index
+ * @id:    stroke
+ *
+ * Returns false if the stroke is not in the index.
+ */
+bool
+pal_spatial_remove(pal_spatial_t *index, uint32_t id)
+{
+  struct spatial_stroke *s = spatial_find(index, id);
+  uint32_t c0, r0, c1, r1;
+
+  if (!s) {
+    return false;
+  }
+  /* Every cell listing the stroke lies under its bounds, so each is swept
+   * once rather than once per segment crossing it */
+  if (spatial_cells(index, s->bounds, &c0, &r0, &c1, &r1)) {
+    for (uint32_t row = r0; row <= r1; row++) {
+      for (uint32_t col = c0; col <= c1; col++) {
+        struct pal_spatial_cell *cell =
+            &index->cells[(size_t)row * index->cols + col];
+        for (uint32_t i = 0; i < cell->count;) {
+          if (cell->refs[i].stroke == s) {
+            cell->refs[i] = cell->refs[--cell->count];
+          } else {
+            i++;
+          }
+        }
+      }
+    }
+  }
+  index->segments -= s->count;
+  pal_hashtable_del(&index->strokes, &s->hnode);
+  pal_free(s->segs);
+  pal_free(s);
+  return true;
+}
+
+/**
+ * pal_spatial_bounds - bounding box of a stroke, e.g. to damage on erase
+ * @index: index
+ * @id:    stroke
+ * @out:   the box, half open
+ *
+ * Returns false if the stroke is not in the index.
+ */
+bool
+pal_spatial_bounds(const pal_spatial_t *index, uint32_t id, pal_rect_t *out)
+{
+  struct spatial_stroke *s = spatial_find(index, id);
+
+  if (!s) {
+    return false;
+  }
+  *out = s->bounds;
+  return true;
+}
+
+/**
+ * pal_spatial_query_rect - find the strokes with a segment box in @rect
+ * @index: index
+ * @rect:  region, half open
+ * @visit: called once per stroke found
+ * @ctx:   passed to @visit
+ *
+ * @visit must not change the index. Returns the number of strokes visited.
+ */
+size_t
+pal_spatial_query_rect(pal_spatial_t *index,
+                       pal_rect_t rect,
+                       pal_spatial_visit_fn visit,
+                       void *ctx)
+{
+  uint32_t stamp = spatial_stamp(index);
+  uint32_t c0, r0, c1, r1;
+  size_t n = 0;
+
+  if (!spatial_cells(index, rect, &c0, &r0, &c1, &r1)) {
+    return 0;
+  }
+  for (uint32_t row = r0; row <= r1; row++) {
+    for (uint32_t col = c0; col <= c1; col++) {
+      const struct pal_spatial_cell *cell =
+          &index->cells[(size_t)row * index->cols + col];
+      pal_rect_t area = PAL_RECT((int32_t)(col << index->shift),
+                                 (int32_t)(row << index->shift),
+                                 (int32_t)((col + 1) << index->shift),
+                                 (int32_t)((row + 1) << index->shift));
+      /* Every box listed in a cell within @rect meets it */
+      bool inside = pal_rect_area(pal_rect_intersect(area, rect)) ==
+                    pal_rect_area(area);
+
+      for (uint32_t i = 0; i < cell->count; i++) {
+        const struct spatial_ref *ref = &cell->refs[i];
+        if (ref->stroke->stamp == stamp ||
+            (!inside &&
+             pal_rect_empty(pal_rect_intersect(ref->box, rect)))) {
+          continue;
+        }
+        ref->stroke->stamp = stamp;
+        n++;
+        if (visit(ctx, ref->stroke->id)) {
+          return n;
+        }
+      }
+    }
+  }
+  return n;
+}
+
+/* Whether the circle at (@x, @y) of radius @r touches @seg, taking its
+ * width at the point of the centreline nearest the circle, as the
+ * rasterizer does */
+static inline bool
+spatial_hit(const struct spatial_segment *seg, float x, float y, float r)
+{
+  float dx = seg->bx - seg->ax, dy = seg->by - seg->ay;
+  float px = x - seg->ax, py = y - seg->ay;
+  float len2 = dx * dx + dy * dy;
+  float t = len2 > 0.0f ? (px * dx + py * dy) / len2 : 0.0f;
+  float reach;
+
+  t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+  reach = r + seg->ar + t * (seg->br - seg->ar);
+  px -= t * dx;
+  py -= t * dy;
+  return px * px + py * py <= reach * reach;
+}
+
+/**
+ * pal_spatial_query_circle - find the strokes a circle touches
+ * @index: index
+ * @x:     center
+ * @y:     center
+ * @r:     radius, pixels
+ * @visit: called once per stroke found
+ * @ctx:   passed to @visit
+ *
+ * @visit must not change the index; collect the ids and remove them after.
+ * Returns the number of strokes visited.
+ */
+size_t
+pal_spatial_query_circle(pal_spatial_t *index,
+                         float x,
+                         float y,
+                         float r,
+                         pal_spatial_visit_fn visit,
+                         void *ctx)
+{
+  pal_rect_t box = PAL_RECT((int32_t)floorf(x - r),
+                            (int32_t)floorf(y - r),
+                            (int32_t)ceilf(x + r) + 1,
+                            (int32_t)ceilf(y + r) + 1);
+  uint32_t stamp = spatial_stamp(index);
+  uint32_t c0, r0, c1, r1;
+  size_t n = 0;
+
+  if (!spatial_cells(index, box, &c0, &r0, &c1, &r1)) {
+    return 0;
+  }
+  for (uint32_t row = r0; row <= r1; row++) {
+    for (uint32_t col = c0; col <= c1; col++) {
+      const struct pal_spatial_cell *cell =
+          &index->cells[(size_t)row * index->cols + col];
+      for (uint32_t i = 0; i < cell->count; i++) {
+        const struct spatial_ref *ref = &cell->refs[i];
+        struct spatial_stroke *s = ref->stroke;
+        if (s->stamp == stamp ||
+            pal_rect_empty(pal_rect_intersect(ref->box, box)) ||
+            !spatial_hit(&s->segs[ref->seg], x, y, r)) {
+          continue;
+        }
+        s->stamp = stamp;
+        n++;
+        if (visit(ctx, s->id)) {
+          return n;
+        }
+      }
+    }
+  }
+  return n;
+}
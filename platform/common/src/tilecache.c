@@ -0,0 +1,343 @@
+#include <qwiet/platform/common/tilecache.h>
+
+/* Worst case PackBits output: one control byte per 128 literals */
+#define TILECACHE_MAX_ENCODED                                                  \
+  (PAL_CANVAS_TILE_BYTES + (PAL_CANVAS_TILE_BYTES + 127) / 128)
+
+struct tilecache_entry {
+  struct pal_hash_node hnode;
+  struct pal_list_head lru; /* on the cache's list while raw */
+  uint32_t page;
+  uint32_t tile;
+  uint8_t *raw;
+  uint8_t *packed; /* NULL once raw was rewritten */
+  size_t packed_size;
+};
+
+struct tilecache_key {
+  uint32_t page;
+  uint32_t tile;
+};
+
+static inline uint32_t
+tilecache_hash(uint32_t page, uint32_t tile)
+{
+  return pal_hash_u64((uint64_t)page << 32 | tile);
+}
+
+static bool
+tilecache_eq(const struct pal_hash_node *node, const void *key)
+{
+  const struct tilecache_entry *e =
+      PAL_CONTAINER_OF(node, struct tilecache_entry, hnode);
+  const struct tilecache_key *k = key;
+  return e->page == k->page && e->tile == k->tile;
+}
+
+/*
+ * PackBits: a control byte c below 128 is followed by c + 1 literal bytes,
+ * one above 128 by a byte repeated 257 - c times. Runs shorter than three
+ * stay in the literals.
+ */
+static size_t
+tilecache_pack(const uint8_t *in, size_t n, uint8_t *out)
+{
+  size_t i = 0, o = 0;
+
+  while (i < n) {
+    size_t run = 1, start = i;
+
+    while (i + run < n && run < 128 && in[i + run] == in[i]) {
+      run++;
+    }
+    if (run >= 3) {
+      out[o++] = (uint8_t)(257 - run);
+      out[o++] = in[i];
+      i += run;
+      continue;
+    }
+    while (i < n && i - start < 128 &&
+           !(i + 2 < n && in[i] == in[i + 1] && in[i] == in[i + 2])) {
+      i++;
+    }
+    out[o++] = (uint8_t)(i - start - 1);
+    memcpy(&out[o], &in[start], i - start);
+    o += i - start;
+  }
+  return o;
+}
+
+static void
+tilecache_unpack(const uint8_t *in, size_t n, uint8_t *out)
+{
+  size_t i = 0, o = 0;
+
+  while (i < n) {
+    uint8_t c = in[i++];
+    if (c < 128) {
+      memcpy(&out[o], &in[i], c + 1);
+      i += c + 1;
+      o += c + 1;
+    } else {
+      memset(&out[o], in[i++], 257 - c);
+      o += 257 - c;
+    }
+  }
+  pal_assert(o == PAL_CANVAS_TILE_BYTES, "corrupt tile, %zu bytes", o);
+}
+
+static struct tilecache_entry *
+tilecache_find(pal_tilecache_t *cache, uint32_t page, uint32_t tile)
+{
+  struct tilecache_key key = {page, tile};
+  struct pal_hash_node *node = pal_hashtable_find(
+      &cache->table, tilecache_hash(page, tile), tilecache_eq, &key);
+  return node ? PAL_CONTAINER_OF(node, struct tilecache_entry, hnode) : NULL;
+}
+
+static void
+tilecache_drop_packed(pal_tilecache_t *cache, struct tilecache_entry *e)
+{
+  if (e->packed) {
+    cache->compressed--;
+    cache->compressed_size -= e->packed_size;
+    pal_free(e->packed);
+    e->packed = NULL;
+  }
+}
+
+/* Keep only the compressed copy of @e, making one if needed */
+static void
+tilecache_freeze(pal_tilecache_t *cache, struct tilecache_entry *e)
+{
+  if (!e->packed) {
+    uint8_t buf[TILECACHE_MAX_ENCODED];
+    size_t n = tilecache_pack(e->raw, PAL_CANVAS_TILE_BYTES, buf);
+
+    e->packed = pal_malloc(n);
+    pal_assert(e->packed, "failed to allocate compressed tile");
+    memcpy(e->packed, buf, n);
+    e->packed_size = n;
+    cache->compressed++;
+    cache->compressed_size += n;
+  }
+  pal_free(e->raw);
+  e->raw = NULL;
+  pal_list_del_init(&e->lru);
+  cache->raw--;
+}
+
+/* Compress the least recently used tiles until the raw ones fit, sparing
+ * @keep, whose pixels the caller is about to use */
+static void
+tilecache_trim(pal_tilecache_t *cache, struct tilecache_entry *keep)
+{
+  while (cache->raw * PAL_CANVAS_TILE_BYTES > cache->budget) {
+    struct tilecache_entry *e =
+        pal_list_last_entry(&cache->lru, struct tilecache_entry, lru);
+    if (e == keep) {
+      break;
+    }
+    tilecache_freeze(cache, e);
+  }
+}
+
+/* Give @e raw pixels at the front of the LRU, contents undefined */
+static void
+tilecache_thaw(pal_tilecache_t *cache, struct tilecache_entry *e)
+{
+  if (e->raw) {
+    pal_list_move(&e->lru, &cache->lru);
+    return;
+  }
+  e->raw = pal_malloc(PAL_CANVAS_TILE_BYTES);
+  pal_assert(e->raw, "failed to allocate tile");
+  pal_list_add(&e->lru, &cache->lru);
+  cache->raw++;
+}
+
+static void
+tilecache_free(pal_tilecache_t *cache, struct tilecache_entry *e)
+{
+  pal_hashtable_del(&cache->table, &e->hnode);
+  tilecache_drop_packed(cache, e);
+  if (e->raw) {
+    pal_list_del(&e->lru);
+    pal_free(e->raw);
+    cache->raw--;
+  }
+  pal_free(e);
+  cache->tiles--;
+}
+
+/**
+ * pal_tilecache_init - create an empty cache
+ * @cache:  cache to initialize
+ * @budget: bytes of raw tiles to keep, e.g. PAL_TILECACHE_BUDGET
+ *
+ * The tile most recently read or written is always raw, even with a
+ * budget of 0.
+ */
+void
+pal_tilecache_init(pal_tilecache_t *cache, size_t budget)
+{
+  memset(cache, 0, sizeof(*cache));
+  pal_hashtable_init(&cache->table, 0);
+  pal_list_init(&cache->lru);
+  cache->budget = budget;
+}
+
+void
+pal_tilecache_cleanup(pal_tilecache_t *cache)
+{
+  struct pal_hlist_node *tmp;
+  struct pal_hash_node *pos;
+  size_t bkt;
+
+  pal_hashtable_for_each_safe(&cache->table, bkt, tmp, pos)
+  {
+    tilecache_free(cache,
+                   PAL_CONTAINER_OF(pos, struct tilecache_entry, hnode));
+  }
+  pal_hashtable_cleanup(&cache->table);
+}
+
+/**
+ * pal_tilecache_put - store a tile
+ * @cache: cache
+ * @page:  page the tile belongs to
+ * @tile:  tile index within the page
+ * @px:    PAL_CANVAS_TILE_BYTES of packed pixels, copied
+ */
+void
+pal_tilecache_put(pal_tilecache_t *cache,
+                  uint32_t page,
+                  uint32_t tile,
+                  const uint8_t *px)
+{
+  struct tilecache_entry *e = tilecache_find(cache, page, tile);
+
+  if (!e) {
+    e = pal_malloc(sizeof(*e));
+    pal_assert(e, "failed to allocate tile entry");
+    memset(e, 0, sizeof(*e));
+    e->page = page;
+    e->tile = tile;
+    pal_list_init(&e->lru);
+    pal_hashtable_add(&cache->table, &e->hnode, tilecache_hash(page, tile));
+    cache->tiles++;
+  }
+  tilecache_drop_packed(cache, e);
+  tilecache_thaw(cache, e);
+  memcpy(e->raw, px, PAL_CANVAS_TILE_BYTES);
+  tilecache_trim(cache, e);
+}
+
+/**
+ * pal_tilecache_get - read a tile
+ * @cache: cache
+ * @page:  page the tile belongs to
+ * @tile:  tile index within the page
+ *
+ * Returns the packed pixels, good until the next call into the cache, or
+ * NULL if the tile is not stored.
+ */
+const uint8_t *
+pal_tilecache_get(pal_tilecache_t *cache, uint32_t page, uint32_t tile)
+{
+  struct tilecache_entry *e = tilecache_find(cache, page, tile);
+
+  if (!e) {
+    return NULL;
+  }
+  if (e->raw) {
+    cache->hits++;
+    tilecache_thaw(cache, e);
+  } else {
+    cache->misses++;
+    tilecache_thaw(cache, e);
+    tilecache_unpack(e->packed, e->packed_size, e->raw);
+  }
+  tilecache_trim(cache, e);
+  return e->raw;
+}
+
+void
+pal_tilecache_drop(pal_tilecache_t *cache, uint32_t page, uint32_t tile)
+{
+  struct tilecache_entry *e = tilecache_find(cache, page, tile);
+
+  if (e) {
+    tilecache_free(cache, e);
+  }
+}
+
+void
+pal_tilecache_drop_page(pal_tilecache_t *cache, uint32_t page)
+{
+  struct pal_hlist_node *tmp;
+  struct pal_hash_node *pos;
+  size_t bkt;
+
+  pal_hashtable_for_each_safe(&cache->table, bkt, tmp, pos)
+  {
+    struct tilecache_entry *e =
+        PAL_CONTAINER_OF(pos, struct tilecache_entry, hnode);
+    if (e->page == page) {
+      tilecache_free(cache, e);
+    }
+  }
+}
+
+/**
+ * pal_canvas_save - store a canvas as @page, replacing what was there
+ * @canvas: canvas to copy from
+ * @cache:  cache
+ * @page:   page number
+ *
+ * Blank tiles are not stored.
+ */
+void
+pal_canvas_save(const pal_canvas_t *canvas,
+                pal_tilecache_t *cache,
+                uint32_t page)
+{
+  for (uint32_t row = 0; row < canvas->rows; row++) {
+    for (uint32_t col = 0; col < canvas->cols; col++) {
+      const struct pal_canvas_tile *tile = pal_canvas_tile(canvas, col, row);
+      uint32_t i = row * canvas->cols + col;
+
+      if (tile) {
+        pal_tilecache_put(cache, page, i, tile->px);
+      } else {
+        pal_tilecache_drop(cache, page, i);
+      }
+    }
+  }
+}
+
+/**
+ * pal_canvas_load - replace a canvas with @page
+ * @canvas: canvas of the same size the page was saved from
+ * @cache:  cache
+ * @page:   page number; a page never saved loads blank
+ *
+ * The whole canvas is reported as damaged. An undo history on @canvas sees
+ * the load as uncommitted drawing, so start a new one.
+ */
+void
+pal_canvas_load(pal_canvas_t *canvas, pal_tilecache_t *cache, uint32_t page)
+{
+  pal_canvas_clear(canvas);
+  for (uint32_t row = 0; row < canvas->rows; row++) {
+    for (uint32_t col = 0; col < canvas->cols; col++) {
+      const uint8_t *px =
+          pal_tilecache_get(cache, page, row * canvas->cols + col);
+      if (px) {
+        memcpy(pal_canvas_tile_write(canvas, col, row),
+               px,
+               PAL_CANVAS_TILE_BYTES);
+      }
+    }
+  }
+}
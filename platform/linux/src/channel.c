@@ -0,0 +1,44 @@
+#include <qwiet/platform/linux/channel.h>
+
+void
+pal_channel_init(pal_channel_t *chan)
+{
+  pal_waker_init(&chan->waker);
+  pal_mpsc_init(&chan->queue);
+}
+
+void
+pal_channel_send(pal_channel_t *chan, struct pal_mpsc_node *node)
+{
+  /* Wake after the push so the consumer never drains before it can pop */
+  pal_mpsc_push(&chan->queue, node);
+  pal_waker_wake(&chan->waker);
+}
+
+struct pal_mpsc_node *
+pal_channel_recv(pal_channel_t *chan)
+{
+  struct pal_mpsc_node *node = pal_mpsc_pop(&chan->queue);
+  if (node) {
+    return node;
+  }
+
+  /*
+   * Looks empty: re-arm the fd, then look again. Anything pushed after the
+   * drain wakes us afresh, including a push that was still being linked in.
+   */
+  pal_waker_drain(&chan->waker);
+  return pal_mpsc_pop(&chan->queue);
+}
+
+int
+pal_channel_fd(pal_channel_t *chan)
+{
+  return pal_waker_fd(&chan->waker);
+}
+
+void
+pal_channel_cleanup(pal_channel_t *chan)
+{
+  pal_waker_cleanup(&chan->waker);
+}
@@ -0,0 +1,111 @@
+#include <qwiet/platform/linux/drawmode.h>
+#include <qwiet/platform/posix/trace.h>
+
+static bool
+drawmode_switch(pal_drawmode_t *dm, enum pal_drawmode mode)
+{
+  if (dm->set(dm->ctx, mode)) {
+    return false;
+  }
+  dm->mode = mode;
+  PAL_TRACE_COUNTER("drawmode", mode);
+  return true;
+}
+
+/* Earliest time FAST may end: idle after the pen was last seen, and no
+ * sooner than hold after entering */
+static int64_t
+drawmode_deadline(pal_drawmode_t *dm)
+{
+  int64_t idle = dm->active + dm->cfg.idle.ns;
+  int64_t hold = dm->entered + dm->cfg.hold.ns;
+  return idle > hold ? idle : hold;
+}
+
+static void
+drawmode_arm(pal_drawmode_t *dm, int64_t at, int64_t now)
+{
+  pal_timer_start_oneshot(&dm->timer, PAL_NSEC(at > now ? at - now : 1));
+  dm->armed = true;
+}
+
+/**
+ * pal_drawmode_init - start in NORMAL mode
+ * @dm:  controller to initialize
+ * @cfg: thresholds, NULL for PAL_DRAWMODE_CONFIG_DEFAULT
+ * @set: switches the display, called only on a change of mode
+ * @ctx: passed to @set
+ */
+void
+pal_drawmode_init(pal_drawmode_t *dm,
+                  const pal_drawmode_config_t *cfg,
+                  pal_drawmode_set_fn set,
+                  void *ctx)
+{
+  memset(dm, 0, sizeof(*dm));
+  dm->cfg = cfg ? *cfg : PAL_DRAWMODE_CONFIG_DEFAULT;
+  dm->set = set;
+  dm->ctx = ctx;
+  dm->mode = PAL_DRAWMODE_NORMAL;
+  pal_timer_init(&dm->timer);
+}
+
+void
+pal_drawmode_feed(pal_drawmode_t *dm, const pal_stylus_sample_t *sample)
+{
+  int64_t now = pal_uptime_ns();
+
+  dm->streak = sample->touching ? dm->streak + 1 : 0;
+  if (sample->touching || sample->in_range) {
+    dm->active = now;
+  }
+
+  if (dm->mode == PAL_DRAWMODE_NORMAL) {
+    if (dm->streak < dm->cfg.enter_samples ||
+        !drawmode_switch(dm, PAL_DRAWMODE_FAST)) {
+      return;
+    }
+    dm->entered = now;
+  }
+  /* The deadline only moves later, so one timer is enough: when it fires
+   * early, pal_drawmode_dispatch() arms it again */
+  if (!dm->armed) {
+    drawmode_arm(dm, drawmode_deadline(dm), now);
+  }
+}
+
+int
+pal_drawmode_fd(pal_drawmode_t *dm)
+{
+  return pal_timer_fd(&dm->timer);
+}
+
+/* The idle timer fired: leave FAST if the pen has been away long enough */
+void
+pal_drawmode_dispatch(pal_drawmode_t *dm)
+{
+  int64_t now = pal_uptime_ns(), deadline;
+
+  if (!pal_timer_read(&dm->timer)) {
+    return;
+  }
+  dm->armed = false;
+  if (dm->mode != PAL_DRAWMODE_FAST) {
+    return;
+  }
+  deadline = drawmode_deadline(dm);
+  if (now < deadline) {
+    drawmode_arm(dm, deadline, now);
+  } else if (!drawmode_switch(dm, PAL_DRAWMODE_NORMAL)) {
+    drawmode_arm(dm, now + dm->cfg.idle.ns, now); /* retry */
+  }
+}
+
+void
+pal_drawmode_cleanup(pal_drawmode_t *dm)
+{
+  if (dm->mode == PAL_DRAWMODE_FAST) {
+    drawmode_switch(dm, PAL_DRAWMODE_NORMAL);
+  }
+  pal_timer_cleanup(&dm->timer);
+}
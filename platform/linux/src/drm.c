@@ -0,0 +1,424 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <drm/drm.h>
+#include <qwiet/platform/linux/drm.h>
+#include <qwiet/platform/posix/trace.h>
+
+#define DRM_BPP 32
+#define DRM_DEPTH 24 /* XRGB8888 */
+#define DRM_MAX_CARDS 8
+#define DRM_MAX_OBJECTS 32 /* connectors, CRTCs or modes looked at */
+#define DRM_CLAMP(n) ((n) < DRM_MAX_OBJECTS ? (n) : DRM_MAX_OBJECTS)
+
+/* ioctl restarted on signals, as libdrm's drmIoctl() does */
+static int
+drm_ioctl(int fd, unsigned long request, void *arg)
+{
+  int ret;
+
+  do {
+    ret = ioctl(fd, request, arg);
+  } while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+  return ret;
+}
+
+static int
+drm_buffer_create(pal_drm_t *drm, pal_drm_buffer_t *buf)
+{
+  struct drm_mode_create_dumb create = {
+      .width = drm->width, .height = drm->height, .bpp = DRM_BPP};
+  struct drm_mode_fb_cmd fb = {.width = drm->width,
+                               .height = drm->height,
+                               .bpp = DRM_BPP,
+                               .depth = DRM_DEPTH};
+  struct drm_mode_map_dumb map = {0};
+
+  if (drm_ioctl(drm->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create)) {
+    return -1;
+  }
+  buf->handle = create.handle;
+  buf->pitch = create.pitch;
+  buf->size = create.size;
+
+  fb.pitch = buf->pitch;
+  fb.handle = buf->handle;
+  if (drm_ioctl(drm->fd, DRM_IOCTL_MODE_ADDFB, &fb)) {
+    return -1;
+  }
+  buf->fb_id = fb.fb_id;
+
+  map.handle = buf->handle;
+  if (drm_ioctl(drm->fd, DRM_IOCTL_MODE_MAP_DUMB, &map)) {
+    return -1;
+  }
+  buf->map = mmap(
+      NULL, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED, drm->fd, map.offset);
+  if (buf->map == MAP_FAILED) {
+    buf->map = NULL;
+    return -1;
+  }
+  memset(buf->map, 0, buf->size);
+  return 0;
+}
+
+static void
+drm_buffer_destroy(pal_drm_t *drm, pal_drm_buffer_t *buf)
+{
+  struct drm_mode_destroy_dumb destroy = {.handle = buf->handle};
+
+  if (buf->map) {
+    munmap(buf->map, buf->size);
+  }
+  if (drm->headless) {
+    return;
+  }
+  if (buf->fb_id) {
+    drm_ioctl(drm->fd, DRM_IOCTL_MODE_RMFB, &buf->fb_id);
+  }
+  if (buf->handle) {
+    drm_ioctl(drm->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+  }
+}
+
+/* A CRTC the connector's current or first usable encoder can drive */
+static uint32_t
+drm_find_crtc(int fd,
+              const struct drm_mode_get_connector *conn,
+              const uint32_t *encoders,
+              const struct drm_mode_card_res *res,
+              const uint32_t *crtcs)
+{
+  for (uint32_t i = 0; i < conn->count_encoders; i++) {
+    struct drm_mode_get_encoder enc = {.encoder_id = encoders[i]};
+    if (drm_ioctl(fd, DRM_IOCTL_MODE_GETENCODER, &enc)) {
+      continue;
+    }
+    if (enc.encoder_id == conn->encoder_id && enc.crtc_id) {
+      return enc.crtc_id;
+    }
+    for (uint32_t c = 0; c < res->count_crtcs; c++) {
+      if (enc.possible_crtcs & (1U << c)) {
+        return crtcs[c];
+      }
+    }
+  }
+  return 0;
+}
+
+/* First connected connector with a mode and a CRTC; fills in drm */
+static int
+drm_find_output(pal_drm_t *drm)
+{
+  uint32_t connectors[DRM_MAX_OBJECTS], crtcs[DRM_MAX_OBJECTS];
+  uint32_t encoders[DRM_MAX_OBJECTS];
+  struct drm_mode_modeinfo modes[DRM_MAX_OBJECTS];
+  struct drm_mode_card_res res = {0};
+
+  if (drm_ioctl(drm->fd, DRM_IOCTL_MODE_GETRESOURCES, &res)) {
+    return -1;
+  }
+  res.count_fbs = res.count_encoders = 0;
+  res.count_connectors = DRM_CLAMP(res.count_connectors);
+  res.count_crtcs = DRM_CLAMP(res.count_crtcs);
+  res.connector_id_ptr = (uintptr_t)connectors;
+  res.crtc_id_ptr = (uintptr_t)crtcs;
+  if (drm_ioctl(drm->fd, DRM_IOCTL_MODE_GETRESOURCES, &res)) {
+    return -1;
+  }
+  res.count_connectors = DRM_CLAMP(res.count_connectors);
+  res.count_crtcs = DRM_CLAMP(res.count_crtcs);
+
+  for (uint32_t i = 0; i < res.count_connectors; i++) {
+    struct drm_mode_get_connector conn = {.connector_id = connectors[i]};
+    uint32_t crtc;
+    if (drm_ioctl(drm->fd, DRM_IOCTL_MODE_GETCONNECTOR, &conn)) {
+      continue;
+    }
+    conn.count_props = 0;
+    conn.count_modes = DRM_CLAMP(conn.count_modes);
+    conn.count_encoders = DRM_CLAMP(conn.count_encoders);
+    conn.modes_ptr = (uintptr_t)modes;
+    conn.encoders_ptr = (uintptr_t)encoders;
+    /* Arrays are only filled in when they are large enough */
+    if (drm_ioctl(drm->fd, DRM_IOCTL_MODE_GETCONNECTOR, &conn) ||
+        conn.count_modes > DRM_MAX_OBJECTS ||
+        conn.count_encoders > DRM_MAX_OBJECTS || conn.connection != 1 ||
+        !conn.count_modes) {
+      continue;
+    }
+    crtc = drm_find_crtc(drm->fd, &conn, encoders, &res, crtcs);
+    if (!crtc) {
+      continue;
+    }
+    drm->connector_id = conn.connector_id;
+    drm->crtc_id = crtc;
+    drm->mode = modes[0];
+    for (uint32_t m = 0; m < conn.count_modes; m++) {
+      if (modes[m].type & DRM_MODE_TYPE_PREFERRED) {
+        drm->mode = modes[m];
+        break;
+      }
+    }
+    drm->width = drm->mode.hdisplay;
+    drm->height = drm->mode.vdisplay;
+    return 0;
+  }
+  return -1;
+}
+
+static int
+drm_open_card(pal_drm_t *drm, const char *path)
+{
+  struct drm_get_cap cap = {.capability = DRM_CAP_DUMB_BUFFER};
+  struct drm_mode_crtc set = {0};
+
+  drm->fd = open(path, O_RDWR | O_CLOEXEC | O_NONBLOCK);
+  if (drm->fd < 0) {
+    return -1;
+  }
+  if (drm_ioctl(drm->fd, DRM_IOCTL_GET_CAP, &cap) || !cap.value ||
+      drm_find_output(drm)) {
+    goto fail;
+  }
+
+  drm->saved.crtc_id = drm->crtc_id;
+  drm_ioctl(drm->fd, DRM_IOCTL_MODE_GETCRTC, &drm->saved);
+
+  for (int i = 0; i < 2; i++) {
+    if (drm_buffer_create(drm, &drm->buffers[i])) {
+      goto fail;
+    }
+  }
+
+  /* Scan out the first buffer; drawing starts in the second */
+  set.crtc_id = drm->crtc_id;
+  set.fb_id = drm->buffers[0].fb_id;
+  set.set_connectors_ptr = (uintptr_t)&drm->connector_id;
+  set.count_connectors = 1;
+  set.mode = drm->mode;
+  set.mode_valid = 1;
+  if (drm_ioctl(drm->fd, DRM_IOCTL_MODE_SETCRTC, &set)) {
+    goto fail;
+  }
+  drm->back = 1;
+  return 0;
+
+fail:
+  pal_drm_cleanup(drm);
+  return -1;
+}
+
+/**
+ * pal_drm_open - take over the display of a DRM card
+ * @drm:  display state to initialize
+ * @path: card device, or NULL for the first of /dev/dri/card* that has a
+ *        connected output
+ *
+ * Returns 0, or -1 when no card or output could be set up.
+ */
+int
+pal_drm_open(pal_drm_t *drm, const char *path)
+{
+  char card[32];
+
+  memset(drm, 0, sizeof(*drm));
+  drm->fd = -1;
+  if (path) {
+    return drm_open_card(drm, path);
+  }
+  for (int i = 0; i < DRM_MAX_CARDS; i++) {
+    snprintf(card, sizeof(card), "/dev/dri/card%d", i);
+    if (!drm_open_card(drm, card)) {
+      return 0;
+    }
+  }
+  return -1;
+}
+
+int
+pal_drm_open_headless(pal_drm_t *drm, uint32_t width, uint32_t height)
+{
+  memset(drm, 0, sizeof(*drm));
+  drm->headless = true;
+  drm->width = width;
+  drm->height = height;
+  drm->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (drm->fd < 0) {
+    return -1;
+  }
+  for (int i = 0; i < 2; i++) {
+    pal_drm_buffer_t *buf = &drm->buffers[i];
+    buf->pitch = width * (DRM_BPP / 8);
+    buf->size = (size_t)buf->pitch * height;
+    buf->map = mmap(NULL,
+                    buf->size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1,
+                    0);
+    if (buf->map == MAP_FAILED) {
+      buf->map = NULL;
+      pal_drm_cleanup(drm);
+      return -1;
+    }
+  }
+  drm->back = 1;
+  return 0;
+}
+
+int
+pal_drm_fd(pal_drm_t *drm)
+{
+  return drm->fd;
+}
+
+/**
+ * pal_drm_back - buffer to draw the next frame into
+ *
+ * Returns NULL while a flip is in flight: the buffer just presented is
+ * queued and the other is still on screen.
+ */
+pal_drm_buffer_t *
+pal_drm_back(pal_drm_t *drm)
+{
+  return drm->pending ? NULL : &drm->buffers[drm->back];
+}
+
+/**
+ * pal_drm_present - queue a flip to the back buffer
+ *
+ * Does not wait for the flip. Returns 0, or -1 with errno EBUSY if a flip is
+ * already in flight.
+ */
+int
+pal_drm_present(pal_drm_t *drm)
+{
+  struct drm_mode_crtc_page_flip flip = {
+      .crtc_id = drm->crtc_id,
+      .fb_id = drm->buffers[drm->back].fb_id,
+      .flags = DRM_MODE_PAGE_FLIP_EVENT,
+      .user_data = (uintptr_t)drm,
+  };
+
+  if (drm->pending) {
+    errno = EBUSY;
+    return -1;
+  }
+  PAL_TRACE_INSTANT("drm.present");
+  if (drm->headless) {
+    uint64_t one = 1;
+    if (write(drm->fd, &one, sizeof(one)) != sizeof(one)) {
+      return -1;
+    }
+  } else if (drm_ioctl(drm->fd, DRM_IOCTL_MODE_PAGE_FLIP, &flip)) {
+    return -1;
+  }
+  drm->pending = true;
+  return 0;
+}
+
+static void
+drm_flip_done(pal_drm_t *drm)
+{
+  drm->pending = false;
+  drm->back ^= 1;
+  drm->flips++;
+  PAL_TRACE_INSTANT("drm.flip");
+}
+
+/**
+ * pal_drm_dispatch - handle completed flips, without blocking
+ *
+ * Returns 1 if a flip completed, 0 if none has, -1 on error.
+ */
+int
+pal_drm_dispatch(pal_drm_t *drm)
+{
+  uint8_t events[1024];
+  ssize_t len;
+  int done = 0;
+
+  if (drm->headless) {
+    uint64_t n;
+    if (read(drm->fd, &n, sizeof(n)) != sizeof(n)) {
+      return errno == EAGAIN ? 0 : -1;
+    }
+    drm_flip_done(drm);
+    return 1;
+  }
+
+  len = read(drm->fd, events, sizeof(events));
+  if (len < 0) {
+    return errno == EAGAIN ? 0 : -1;
+  }
+  for (ssize_t off = 0; off + (ssize_t)sizeof(struct drm_event) <= len;) {
+    struct drm_event ev;
+    memcpy(&ev, events + off, sizeof(ev));
+    if (ev.length < sizeof(ev)) {
+      return -1;
+    }
+    if (ev.type == DRM_EVENT_FLIP_COMPLETE && drm->pending) {
+      drm_flip_done(drm);
+      done = 1;
+    }
+    off += ev.length;
+  }
+  return done;
+}
+
+/**
+ * pal_drm_wait_ready - wait for the flip in flight to complete
+ *
+ * Returns 1 once no flip is in flight, 0 on timeout, -1 on error.
+ */
+int
+pal_drm_wait_ready(pal_drm_t *drm, pal_timeout_t timeout)
+{
+  struct pollfd pfd = {.fd = drm->fd, .events = POLLIN};
+  int64_t deadline = pal_uptime_ns() + timeout.ns;
+  int ret;
+
+  while (drm->pending) {
+    int64_t left = deadline - pal_uptime_ns();
+    int ms = pal_timeout_is_forever(timeout)
+                 ? -1
+                 : pal_timeout_to_ms(PAL_NSEC(left > 0 ? left : 0));
+    ret = poll(&pfd, 1, ms);
+    if (ret < 0 && errno != EINTR) {
+      return -1;
+    }
+    if (ret > 0 && pal_drm_dispatch(drm) < 0) {
+      return -1;
+    }
+    if (ret == 0 && ms == 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void
+pal_drm_cleanup(pal_drm_t *drm)
+{
+  if (drm->fd < 0) {
+    return;
+  }
+  if (!drm->headless && drm->saved.mode_valid) {
+    /* Give the display back as we found it */
+    drm->saved.set_connectors_ptr = (uintptr_t)&drm->connector_id;
+    drm->saved.count_connectors = 1;
+    drm_ioctl(drm->fd, DRM_IOCTL_MODE_SETCRTC, &drm->saved);
+  }
+  for (int i = 0; i < 2; i++) {
+    drm_buffer_destroy(drm, &drm->buffers[i]);
+  }
+  close(drm->fd);
+  memset(drm, 0, sizeof(*drm));
+  drm->fd = -1;
+}
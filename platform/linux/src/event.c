@@ -1,4 +1,5 @@
 #include <qwiet/platform/linux/event.h>
+#include <qwiet/platform/posix/trace.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
 
@@ -10,11 +11,21 @@ pal_event_fd(void)
   return fd;
 }
 
+int
+pal_event_fd_counter(void)
+{
+  /* Counter mode: one read returns and clears the accumulated total */
+  int fd = eventfd(0, EFD_NONBLOCK);
+  pal_assert(fd >= 0, "failed to create eventfd");
+  return fd;
+}
+
 int
 pal_event_write(int fd, uint64_t val)
 {
   ssize_t ret = write(fd, &val, sizeof(val));
   if (ret == sizeof(val)) {
+    PAL_TRACE_INSTANT("event.write");
     return 0;
   } else {
     return -1;
@@ -26,6 +37,7 @@ pal_event_read(int fd, uint64_t *val)
 {
   ssize_t ret = read(fd, val, sizeof(*val));
   if (ret == sizeof(*val)) {
+    PAL_TRACE_INSTANT("event.read");
     return 0;
   } else {
     return -1; /* EAGAIN if nothing to read, or error */
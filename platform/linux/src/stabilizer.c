@@ -0,0 +1,211 @@
+#include <qwiet/platform/linux/input/stabilizer.h>
+
+#define STABILIZER_PI 3.14159265358979323846
+
+/* Shortest step between samples; reports sharing a timestamp would
+ * otherwise divide by zero */
+#define STABILIZER_MIN_DT 1e-4
+
+/* KALMAN: speed uncertainty at pen down, (units/s)^2 */
+#define STABILIZER_VEL_VAR 1e10
+
+static inline int32_t
+stabilizer_round(double v)
+{
+  return (int32_t)(v < 0 ? v - 0.5 : v + 0.5);
+}
+
+/* 1-euro smoothing factor of a first order low pass at @cutoff Hz */
+static inline double
+stabilizer_alpha(double cutoff, double dt)
+{
+  return 1.0 / (1.0 + 1.0 / (2.0 * STABILIZER_PI * cutoff * dt));
+}
+
+static void
+stabilizer_start(pal_stabilizer_t *st, struct pal_stabilizer_axis *a, int32_t z)
+{
+  double r = st->cfg.position_noise;
+
+  a->pos = z;
+  a->vel = 0.0;
+  a->cov[0][0] = r * r;
+  a->cov[0][1] = a->cov[1][0] = 0.0;
+  a->cov[1][1] = STABILIZER_VEL_VAR;
+  a->sum = 0;
+  a->raw = z;
+}
+
+static void
+stabilizer_average(pal_stabilizer_t *st, int k, int32_t z, double dt)
+{
+  struct pal_stabilizer_axis *a = &st->axis[k];
+  unsigned int window = st->cfg.window;
+  unsigned int slot = st->count % window;
+  unsigned int n = st->count < window ? st->count + 1 : window;
+  double pos;
+
+  if (st->count >= window) {
+    a->sum -= st->window[slot][k];
+  }
+  st->window[slot][k] = z;
+  a->sum += z;
+  pos = (double)a->sum / n;
+  a->vel = (pos - a->pos) / dt;
+  a->pos = pos;
+}
+
+static void
+stabilizer_euro(pal_stabilizer_t *st, int k, int32_t z, double dt)
+{
+  struct pal_stabilizer_axis *a = &st->axis[k];
+  double vel = (z - a->raw) / dt;
+  double cutoff;
+
+  a->vel += stabilizer_alpha(st->cfg.d_cutoff, dt) * (vel - a->vel);
+  cutoff = st->cfg.min_cutoff + st->cfg.beta * (a->vel < 0 ? -a->vel : a->vel);
+  a->pos += stabilizer_alpha(cutoff, dt) * (z - a->pos);
+}
+
+static void
+stabilizer_kalman(pal_stabilizer_t *st, int k, int32_t z, double dt)
+{
+  struct pal_stabilizer_axis *a = &st->axis[k];
+  double q = st->cfg.accel_noise * st->cfg.accel_noise;
+  double r = st->cfg.position_noise * st->cfg.position_noise;
+  double dt2 = dt * dt;
+  double (*p)[2] = a->cov;
+  double s, k0, k1, y;
+
+  /* Predict: pos moves by vel, uncertainty grows with unmodelled
+   * acceleration */
+  a->pos += a->vel * dt;
+  p[0][0] += dt * (2.0 * p[0][1] + dt * p[1][1]) + q * dt2 * dt2 / 4.0;
+  p[0][1] += dt * p[1][1] + q * dt2 * dt / 2.0;
+  p[1][1] += q * dt2;
+
+  /* Update with the measured position */
+  s = p[0][0] + r;
+  k0 = p[0][0] / s;
+  k1 = p[0][1] / s;
+  y = z - a->pos;
+  a->pos += k0 * y;
+  a->vel += k1 * y;
+  p[1][1] -= k1 * p[0][1];
+  p[0][0] -= k0 * p[0][0];
+  p[0][1] -= k0 * p[0][1];
+  p[1][0] = p[0][1];
+}
+
+/**
+ * pal_stabilizer_init - start with no stroke in progress
+ * @st:  stabilizer to initialize
+ * @cfg: method and tuning, NULL for PAL_STABILIZER_CONFIG_DEFAULT
+ */
+void
+pal_stabilizer_init(pal_stabilizer_t *st, const pal_stabilizer_config_t *cfg)
+{
+  memset(st, 0, sizeof(*st));
+  st->cfg = cfg ? *cfg : PAL_STABILIZER_CONFIG_DEFAULT;
+  pal_assert(st->cfg.window >= 1 && st->cfg.window <= PAL_STABILIZER_WINDOW,
+             "window of %u",
+             st->cfg.window);
+}
+
+/* Forget the stroke in progress; the next sample starts a new one */
+void
+pal_stabilizer_reset(pal_stabilizer_t *st)
+{
+  st->count = 0;
+}
+
+/**
+ * pal_stabilizer_feed - filter one sample
+ * @st:  stabilizer
+ * @in:  sample from pal_stylus_feed()
+ * @out: @in with x and y filtered, may be @in
+ *
+ * The first sample of a stroke comes out unchanged.
+ */
+void
+pal_stabilizer_feed(pal_stabilizer_t *st,
+                    const pal_stylus_sample_t *in,
+                    pal_stylus_sample_t *out)
+{
+  const int32_t z[2] = {in->x, in->y};
+  double dt;
+
+  if (!in->touching) {
+    pal_stabilizer_reset(st);
+    *out = *in;
+    return;
+  }
+  if (st->count == 0) {
+    for (int k = 0; k < 2; k++) {
+      stabilizer_start(st, &st->axis[k], z[k]);
+    }
+  }
+
+  dt = (double)(in->time_ns - st->last.time_ns) / 1e9;
+  dt = dt < STABILIZER_MIN_DT ? STABILIZER_MIN_DT : dt;
+  for (int k = 0; k < 2; k++) {
+    switch (st->cfg.method) {
+    case PAL_STABILIZER_AVERAGE:
+      stabilizer_average(st, k, z[k], dt);
+      break;
+    case PAL_STABILIZER_EURO:
+      if (st->count) {
+        stabilizer_euro(st, k, z[k], dt);
+      }
+      break;
+    case PAL_STABILIZER_KALMAN:
+      if (st->count) {
+        stabilizer_kalman(st, k, z[k], dt);
+      }
+      break;
+    default:
+      st->axis[k].vel = st->count ? (z[k] - st->axis[k].raw) / dt : 0.0;
+      st->axis[k].pos = z[k];
+      break;
+    }
+    st->axis[k].raw = z[k];
+  }
+  if (st->count == 0) {
+    st->axis[0].vel = st->axis[1].vel = 0.0;
+  }
+
+  *out = *in;
+  out->x = stabilizer_round(st->axis[0].pos);
+  out->y = stabilizer_round(st->axis[1].pos);
+  st->last = *out;
+  st->count++;
+}
+
+/**
+ * pal_stabilizer_predict - extrapolate the pen past the last sample
+ * @st:    stabilizer
+ * @ahead: how far, capped at the configured max_ahead
+ * @out:   the last output moved along the estimated velocity, its time_ns
+ *         advanced to match
+ *
+ * Returns false, leaving @out alone, until a stroke has two samples to
+ * estimate a velocity from.
+ */
+bool
+pal_stabilizer_predict(const pal_stabilizer_t *st,
+                       pal_timeout_t ahead,
+                       pal_stylus_sample_t *out)
+{
+  int64_t ns =
+      ahead.ns < st->cfg.max_ahead.ns ? ahead.ns : st->cfg.max_ahead.ns;
+  double t = (double)ns / 1e9;
+
+  if (st->count < 2) {
+    return false;
+  }
+  *out = st->last;
+  out->x = stabilizer_round(st->axis[0].pos + st->axis[0].vel * t);
+  out->y = stabilizer_round(st->axis[1].pos + st->axis[1].vel * t);
+  out->time_ns += ns;
+  return true;
+}
@@ -0,0 +1,110 @@
+#include <qwiet/platform/linux/input/stylus.h>
+#include <qwiet/platform/posix/trace.h>
+
+static void
+stylus_abs(pal_stylus_sample_t *s, unsigned int code, int32_t value)
+{
+  switch (code) {
+  case ABS_X:
+    s->x = value;
+    break;
+  case ABS_Y:
+    s->y = value;
+    break;
+  case ABS_PRESSURE:
+    s->pressure = value;
+    break;
+  case ABS_DISTANCE:
+    s->distance = value;
+    break;
+  case ABS_TILT_X:
+    s->tilt_x = value;
+    break;
+  case ABS_TILT_Y:
+    s->tilt_y = value;
+    break;
+  default:
+    break;
+  }
+}
+
+static void
+stylus_key(pal_stylus_sample_t *s, unsigned int code, int32_t value)
+{
+  switch (code) {
+  case BTN_TOUCH:
+    s->touching = value != 0;
+    break;
+  case BTN_TOOL_PEN:
+    s->in_range = value != 0;
+    s->eraser = 0;
+    break;
+  case BTN_TOOL_RUBBER:
+    s->in_range = value != 0;
+    s->eraser = value != 0;
+    break;
+  case BTN_STYLUS:
+    s->buttons = value ? s->buttons | PAL_STYLUS_BUTTON_1
+                       : s->buttons & ~PAL_STYLUS_BUTTON_1;
+    break;
+  case BTN_STYLUS2:
+    s->buttons = value ? s->buttons | PAL_STYLUS_BUTTON_2
+                       : s->buttons & ~PAL_STYLUS_BUTTON_2;
+    break;
+  default:
+    break;
+  }
+}
+
+void
+pal_stylus_init(pal_stylus_t *pen)
+{
+  memset(pen, 0, sizeof(*pen));
+}
+
+/**
+ * pal_stylus_feed - fold one event into the pen state
+ * @pen:    assembler state
+ * @ev:     next event from the device
+ * @sample: receives the pen state when @ev completes a report
+ *
+ * Returns true if @sample was filled.
+ */
+bool
+pal_stylus_feed(pal_stylus_t *pen,
+                const struct input_event *ev,
+                pal_stylus_sample_t *sample)
+{
+  switch (ev->type) {
+  case EV_SYN:
+    if (ev->code == SYN_DROPPED) {
+      pen->dropping = true;
+    } else if (ev->code == SYN_REPORT) {
+      if (pen->dropping) {
+        pen->dropping = false;
+        return false;
+      }
+      pen->state.time_ns = (int64_t)ev->time.tv_sec * 1000000000LL +
+                           (int64_t)ev->time.tv_usec * 1000LL;
+      /* The kernel's timestamp, against the record's own, gives the input
+       * leg of the pen-to-display latency */
+      PAL_TRACE_COUNTER("stylus_report_ns", pen->state.time_ns);
+      *sample = pen->state;
+      return true;
+    }
+    break;
+  case EV_ABS:
+    if (!pen->dropping) {
+      stylus_abs(&pen->state, ev->code, ev->value);
+    }
+    break;
+  case EV_KEY:
+    if (!pen->dropping) {
+      stylus_key(&pen->state, ev->code, ev->value);
+    }
+    break;
+  default:
+    break;
+  }
+  return false;
+}
@@ -0,0 +1,284 @@
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <qwiet/platform/linux/task.h>
+#include <qwiet/platform/posix/trace.h>
+
+#define TASK_EVENTS_MAX 64
+
+/* What a blocked task is parked on */
+enum {
+  TASK_WAIT_NONE,
+  TASK_WAIT_FD,
+  TASK_WAIT_SLEEP,
+  TASK_WAIT_SEM,
+};
+
+static bool
+task_deadline_less(struct pal_rb_node *a, const struct pal_rb_node *b)
+{
+  return pal_rb_entry(a, struct pal_task, timer)->deadline <
+         pal_rb_entry(b, struct pal_task, timer)->deadline;
+}
+
+static void
+task_wake(struct pal_task *task, int result)
+{
+  if (task->deadline >= 0) {
+    pal_rb_erase_cached(&task->timer, &task->exec->timers);
+    task->deadline = -1;
+  }
+  if (task->wait == TASK_WAIT_SEM) {
+    pal_list_del_init(&task->node);
+  }
+  task->wait = TASK_WAIT_NONE;
+  task->result = result;
+  pal_list_add_tail(&task->node, &task->exec->ready);
+}
+
+static void
+task_set_deadline(struct pal_task *task, pal_timeout_t timeout)
+{
+  if (pal_timeout_is_forever(timeout)) {
+    return;
+  }
+
+  task->deadline = pal_uptime_ns() + timeout.ns;
+  pal_rb_add_cached(&task->timer, &task->exec->timers, task_deadline_less);
+}
+
+static void
+task_unregister_fd(struct pal_task *task)
+{
+  if (task->fd >= 0) {
+    /* The fd may already be closed, in which case epoll dropped it */
+    (void)epoll_ctl(task->exec->epfd, EPOLL_CTL_DEL, task->fd, NULL);
+    task->fd = -1;
+  }
+}
+
+void
+pal_executor_init(pal_executor_t *exec)
+{
+  exec->epfd = epoll_create1(EPOLL_CLOEXEC);
+  pal_assert(exec->epfd >= 0, "epoll_create1 failed");
+  exec->ntasks = 0;
+  pal_list_init(&exec->ready);
+  exec->timers = PAL_RB_ROOT_CACHED;
+}
+
+void
+pal_executor_cleanup(pal_executor_t *exec)
+{
+  close(exec->epfd);
+}
+
+void
+pal_task_spawn(pal_executor_t *exec, struct pal_task *task, pal_task_fn fn)
+{
+  task->fn = fn;
+  task->exec = exec;
+  task->lc = 0;
+  task->result = 1;
+  task->fd = -1;
+  task->revents = 0;
+  task->wait = TASK_WAIT_NONE;
+  task->deadline = -1;
+  pal_list_add_tail(&task->node, &exec->ready);
+  exec->ntasks++;
+}
+
+void
+pal_task_wait_fd(struct pal_task *task,
+                 int fd,
+                 short events,
+                 pal_timeout_t timeout)
+{
+  struct epoll_event ev = {.events = EPOLLONESHOT, .data.ptr = task};
+  int ret;
+
+  if (events & POLLIN) {
+    ev.events |= EPOLLIN;
+  }
+  if (events & POLLOUT) {
+    ev.events |= EPOLLOUT;
+  }
+
+  /* Re-arm an existing registration when awaiting the same fd again, which
+   * is the common case for a task looping on one socket */
+  if (task->fd != fd) {
+    task_unregister_fd(task);
+    ret = epoll_ctl(task->exec->epfd, EPOLL_CTL_ADD, fd, &ev);
+    if (ret < 0 && errno == EEXIST) {
+      ret = epoll_ctl(task->exec->epfd, EPOLL_CTL_MOD, fd, &ev);
+    }
+  } else {
+    ret = epoll_ctl(task->exec->epfd, EPOLL_CTL_MOD, fd, &ev);
+    if (ret < 0 && errno == ENOENT) {
+      ret = epoll_ctl(task->exec->epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+  }
+
+  task->revents = 0;
+  if (ret < 0) {
+    /* Resume straight away and let the task see the failure */
+    task->fd = -1;
+    task->wait = TASK_WAIT_NONE;
+    task->result = -1;
+    pal_list_add_tail(&task->node, &task->exec->ready);
+    return;
+  }
+
+  task->fd = fd;
+  task->wait = TASK_WAIT_FD;
+  task_set_deadline(task, timeout);
+}
+
+void
+pal_task_sleep(struct pal_task *task, pal_timeout_t duration)
+{
+  if (duration.ns <= 0) {
+    task->result = 1;
+    pal_list_add_tail(&task->node, &task->exec->ready);
+    return;
+  }
+  task->wait = TASK_WAIT_SLEEP;
+  task_set_deadline(task, duration);
+}
+
+void
+pal_task_sem_init(pal_task_sem_t *sem, unsigned int count)
+{
+  sem->count = count;
+  pal_list_init(&sem->waiters);
+}
+
+bool
+pal_task_sem_take(struct pal_task *task,
+                  pal_task_sem_t *sem,
+                  pal_timeout_t timeout)
+{
+  if (sem->count > 0) {
+    sem->count--;
+    task->result = 1;
+    return true;
+  } else if (pal_timeout_is_nowait(timeout)) {
+    task->result = 0;
+    return true;
+  }
+
+  task->wait = TASK_WAIT_SEM;
+  pal_list_add_tail(&task->node, &sem->waiters);
+  task_set_deadline(task, timeout);
+  return false;
+}
+
+void
+pal_task_sem_give(pal_task_sem_t *sem)
+{
+  if (pal_list_empty(&sem->waiters)) {
+    sem->count++;
+  } else {
+    /* Hand the count straight to the longest waiter */
+    task_wake(pal_list_first_entry(&sem->waiters, struct pal_task, node), 1);
+  }
+}
+
+static void
+executor_run_ready(pal_executor_t *exec)
+{
+  struct pal_list_head batch;
+
+  /* Tasks made ready while this batch runs wait for the next pass */
+  pal_list_init(&batch);
+  pal_list_splice_init(&exec->ready, &batch);
+  PAL_TRACE_BEGIN("executor.run");
+
+  while (!pal_list_empty(&batch)) {
+    struct pal_task *task =
+        pal_list_first_entry(&batch, struct pal_task, node);
+    pal_list_del_init(&task->node);
+
+    switch (task->fn(task)) {
+    case PAL_TASK_DONE:
+      task_unregister_fd(task);
+      exec->ntasks--;
+      break;
+    case PAL_TASK_READY:
+      pal_list_add_tail(&task->node, &exec->ready);
+      break;
+    default:
+      break; /* the await already parked it */
+    }
+  }
+  PAL_TRACE_END("executor.run");
+}
+
+static void
+executor_expire_timers(pal_executor_t *exec, int64_t now)
+{
+  struct pal_rb_node *first;
+
+  while ((first = pal_rb_first_cached(&exec->timers))) {
+    struct pal_task *task = pal_rb_entry(first, struct pal_task, timer);
+    if (task->deadline > now) {
+      break;
+    }
+    if (task->wait == TASK_WAIT_FD) {
+      /* Disarm so a late event cannot resume the task a second time */
+      task_unregister_fd(task);
+    }
+    task_wake(task, task->wait == TASK_WAIT_SLEEP ? 1 : 0);
+  }
+}
+
+size_t
+pal_executor_run_once(pal_executor_t *exec, pal_timeout_t timeout)
+{
+  struct epoll_event events[TASK_EVENTS_MAX];
+  int n, ms;
+
+  executor_run_ready(exec);
+
+  if (exec->ntasks == 0) {
+    return 0;
+  } else if (!pal_list_empty(&exec->ready)) {
+    timeout = PAL_NO_WAIT;
+  } else if (pal_rb_first_cached(&exec->timers)) {
+    struct pal_task *first = pal_rb_entry(
+        pal_rb_first_cached(&exec->timers), struct pal_task, timer);
+    int64_t until = first->deadline - pal_uptime_ns();
+    if (until < 0) {
+      until = 0;
+    }
+    if (pal_timeout_is_forever(timeout) || until < timeout.ns) {
+      timeout = PAL_NSEC(until);
+    }
+  }
+
+  ms = pal_timeout_to_ms(timeout);
+  PAL_TRACE_BEGIN("executor.wait");
+  n = epoll_wait(exec->epfd, events, TASK_EVENTS_MAX, ms);
+  PAL_TRACE_END("executor.wait");
+  PAL_TRACE_COUNTER("executor.events", n);
+  for (int i = 0; i < n; i++) {
+    struct pal_task *task = events[i].data.ptr;
+    if (task->wait != TASK_WAIT_FD) {
+      continue;
+    }
+    task->revents = events[i].events;
+    task_wake(task, events[i].events & EPOLLERR ? -1 : 1);
+  }
+
+  executor_expire_timers(exec, pal_uptime_ns());
+  return exec->ntasks;
+}
+
+void
+pal_executor_run(pal_executor_t *exec)
+{
+  while (exec->ntasks > 0) {
+    pal_executor_run_once(exec, PAL_FOREVER);
+  }
+}
@@ -2,6 +2,8 @@
 #include <unistd.h>
 
 #include <qwiet/platform/linux/timer.h>
+#include <qwiet/platform/posix/metrics.h>
+#include <qwiet/platform/posix/trace.h>
 
 void
 pal_timer_init(pal_timer_t *timer)
@@ -54,9 +56,30 @@ pal_timer_read(pal_timer_t *timer)
 {
   uint64_t expirations;
   ssize_t ret = read(timer->fd, &expirations, sizeof(expirations));
-  return ret == sizeof(expirations) ? expirations : 0;
+  if (ret != sizeof(expirations)) {
+    return 0;
+  }
+  /* More than one means the reader missed periods */
+  PAL_TRACE_COUNTER("timer.expirations", expirations);
+  return expirations;
 }
 
+#ifdef CONFIG_PAL_METRICS
+/* Absolute time of the next expiry, or -1 if the timer is not armed */
+static int64_t
+timer_next_expiry(pal_timer_t *timer)
+{
+  struct itimerspec its;
+
+  if (timerfd_gettime(timer->fd, &its) ||
+      (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)) {
+    return -1;
+  }
+  return pal_uptime_ns() + (int64_t)its.it_value.tv_sec * 1000000000LL +
+         its.it_value.tv_nsec;
+}
+#endif
+
 bool
 pal_timer_is_ready(pal_timer_t *timer)
 {
@@ -70,7 +93,19 @@ pal_timer_wait_ready(pal_timer_t *timer, pal_timeout_t timeout)
 {
   struct pollfd pfd = {.fd = timer->fd, .events = POLLIN};
   int ms = pal_timeout_to_ms(timeout);
+#ifdef CONFIG_PAL_METRICS
+  int64_t due = timer_next_expiry(timer);
+#endif
+  PAL_TRACE_BEGIN("timer.wait");
   int ret = poll(&pfd, 1, ms);
+  PAL_TRACE_END("timer.wait");
+#ifdef CONFIG_PAL_METRICS
+  /* Already expired on entry (due in the future) is not a late wakeup */
+  int64_t now = pal_uptime_ns();
+  if (ret > 0 && due >= 0 && now >= due) {
+    pal_metrics_record(PAL_METRIC_TIMER_LATENESS, (uint64_t)(now - due));
+  }
+#endif
   return ret > 0 && (pfd.revents & POLLIN) ? 1 : ret < 0 ? -1 : ret;
 }
 
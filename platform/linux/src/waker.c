@@ -0,0 +1,60 @@
+#include <unistd.h>
+
+#include <qwiet/platform/linux/event.h>
+#include <qwiet/platform/linux/waker.h>
+
+void
+pal_waker_init(pal_waker_t *waker)
+{
+  waker->fd = pal_event_fd_counter();
+  atomic_init(&waker->pending, 0);
+}
+
+void
+pal_waker_wake(pal_waker_t *waker)
+{
+  uint32_t prev =
+      atomic_fetch_add_explicit(&waker->pending, 1, memory_order_acq_rel);
+
+  /* Only the idle -> pending transition needs to signal the fd */
+  if (prev == 0) {
+    int ret = pal_event_write(waker->fd, 1);
+    pal_assert(ret == 0, "failed to signal waker fd %d", waker->fd);
+  }
+}
+
+uint32_t
+pal_waker_drain(pal_waker_t *waker)
+{
+  uint64_t val;
+
+  /*
+   * Clear the fd before taking the count. A wake landing between the two
+   * steps sees pending != 0 and skips the write, but its count is still
+   * collected by the exchange below. The reverse order could clear a signal
+   * whose count we never saw.
+   */
+  (void)pal_event_read(waker->fd, &val);
+  return atomic_exchange_explicit(&waker->pending, 0, memory_order_acq_rel);
+}
+
+int
+pal_waker_fd(pal_waker_t *waker)
+{
+  return waker->fd;
+}
+
+int
+pal_waker_wait(pal_waker_t *waker, pal_timeout_t timeout)
+{
+  struct pollfd pfd = {.fd = waker->fd, .events = POLLIN};
+  int ms = pal_timeout_to_ms(timeout);
+  int ret = poll(&pfd, 1, ms);
+  return ret > 0 && (pfd.revents & POLLIN) ? 1 : ret < 0 ? -1 : ret;
+}
+
+void
+pal_waker_cleanup(pal_waker_t *waker)
+{
+  close(waker->fd);
+}
@@ -0,0 +1,412 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <qwiet/platform/posix/journal.h>
+
+#define JOURNAL_MAGIC 0x314c4e524a575100ULL /* "\0QWJRNL1" */
+#define JOURNAL_VERSION 1
+
+/* Records start past the file header, which keeps its own cache line */
+#define JOURNAL_HEADER 64
+
+struct journal_header {
+  uint64_t magic;
+  uint16_t version;
+  uint32_t epoch; /* bumped by every open */
+};
+
+static uint32_t __journal_crc_table[256];
+static pthread_once_t __journal_crc_once = PTHREAD_ONCE_INIT;
+
+/* CRC-32C (Castagnoli), reflected */
+static void
+journal_crc_init(void)
+{
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) {
+      c = c & 1 ? (c >> 1) ^ 0x82f63b78u : c >> 1;
+    }
+    __journal_crc_table[i] = c;
+  }
+}
+
+static uint32_t
+journal_crc(uint32_t crc, const void *data, size_t len)
+{
+  const uint8_t *p = data;
+
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc = __journal_crc_table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static uint32_t
+journal_record_crc(const struct pal_journal_record *rec)
+{
+  const uint8_t *hdr = (const uint8_t *)rec + sizeof(rec->crc);
+  uint32_t crc = journal_crc(0, hdr, sizeof(*rec) - sizeof(rec->crc));
+  return journal_crc(crc, rec + 1, rec->len);
+}
+
+static inline size_t
+journal_size(size_t len)
+{
+  return (sizeof(struct pal_journal_record) + len + 7) & ~(size_t)7;
+}
+
+/* Serial number order, so the epoch may wrap */
+static inline bool
+journal_epoch_before(uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b) < 0;
+}
+
+/* Copy @len bytes to file offset @off's place in the ring */
+static void
+journal_ring_put(pal_journal_t *journal,
+                 size_t off,
+                 const void *data,
+                 size_t len)
+{
+  size_t pos = off % journal->ring_size;
+  size_t first = journal->ring_size - pos < len ? journal->ring_size - pos
+                                                : len;
+
+  memcpy(journal->ring + pos, data, first);
+  memcpy(journal->ring, (const uint8_t *)data + first, len - first);
+}
+
+/* Write the ring's bytes for file offsets [@start, @end) to the file */
+static int
+journal_ring_write(pal_journal_t *journal, size_t start, size_t end)
+{
+  while (start < end) {
+    size_t pos = start % journal->ring_size;
+    size_t len = journal->ring_size - pos < end - start
+                     ? journal->ring_size - pos
+                     : end - start;
+    ssize_t n = pwrite(journal->fd, journal->ring + pos, len, start);
+
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      errno = n ? errno : EIO;
+      return -1;
+    }
+    start += (size_t)n;
+  }
+  return 0;
+}
+
+/*
+ * Find the end of the valid records. Past a crash the mapping may hold a
+ * torn record, or whole records from before an earlier recovery that the
+ * records since have only partly overwritten; the first is caught by the
+ * checksum, the second by its older epoch or out of order sequence.
+ */
+static void
+journal_recover(pal_journal_t *journal, uint32_t last_epoch)
+{
+  size_t off = JOURNAL_HEADER;
+  uint32_t epoch = 0;
+  uint32_t seq = 0;
+
+  while (off + sizeof(struct pal_journal_record) <= journal->capacity) {
+    const struct pal_journal_record *rec =
+        (const struct pal_journal_record *)(journal->map + off);
+
+    if (rec->type == 0 || rec->seq != seq ||
+        (seq && journal_epoch_before(rec->epoch, epoch)) ||
+        journal_epoch_before(last_epoch, rec->epoch) ||
+        rec->len > journal->capacity - off - sizeof(*rec) ||
+        journal_record_crc(rec) != rec->crc) {
+      break;
+    }
+    epoch = rec->epoch;
+    seq++;
+    off += journal_size(rec->len);
+  }
+  journal->head = journal->published = journal->synced = off;
+  journal->seq = journal->recovered = seq;
+}
+
+static void *
+journal_flusher(void *arg)
+{
+  pal_journal_t *journal = arg;
+
+  while (!__atomic_load_n(&journal->stop, __ATOMIC_ACQUIRE)) {
+    pal_sem_wait(&journal->kick, journal->interval);
+    pal_journal_sync(journal);
+  }
+  return NULL;
+}
+
+/**
+ * pal_journal_open - open or create a journal and recover its records
+ * @journal: journal to initialize
+ * @path:    file, created if missing
+ * @cfg:     size, commit period and buffer, NULL for
+ *           PAL_JOURNAL_CONFIG_DEFAULT
+ *
+ * A file larger than the configured capacity keeps its size. Returns 0, or
+ * -1 with errno set if the file cannot be opened, sized or mapped, or is
+ * not a journal (EINVAL), in which case it is left as it was.
+ */
+int
+pal_journal_open(pal_journal_t *journal,
+                 const char *path,
+                 const pal_journal_config_t *cfg)
+{
+  pal_journal_config_t c = cfg ? *cfg : PAL_JOURNAL_CONFIG_DEFAULT;
+  struct journal_header hdr = {0};
+  struct stat st;
+  int err;
+
+  pthread_once(&__journal_crc_once, journal_crc_init);
+  memset(journal, 0, sizeof(*journal));
+  journal->interval = c.interval;
+  journal->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (journal->fd < 0) {
+    return -1;
+  }
+
+  /* Vet what is there before touching it: a file that is not a journal
+   * keeps its size and contents. A zero header is a new journal, or one
+   * whose creation did not get as far as writing it. */
+  if (fstat(journal->fd, &st) ||
+      pread(journal->fd, &hdr, sizeof(hdr), 0) < 0) {
+    goto err_close;
+  }
+  if ((hdr.magic != 0 && hdr.magic != JOURNAL_MAGIC) ||
+      (hdr.magic == JOURNAL_MAGIC && hdr.version != JOURNAL_VERSION)) {
+    errno = EINVAL;
+    goto err_close;
+  }
+
+  journal->capacity = st.st_size;
+  if (journal->capacity < c.capacity) {
+    journal->capacity = c.capacity;
+  }
+  if (journal->capacity <
+      JOURNAL_HEADER + sizeof(struct pal_journal_record)) {
+    errno = EINVAL;
+    goto err_close;
+  }
+  if ((size_t)st.st_size < journal->capacity) {
+    /* Sparse: blocks are only allocated as records reach them */
+    if (ftruncate(journal->fd, journal->capacity) || fsync(journal->fd)) {
+      goto err_close;
+    }
+  }
+
+  /* Touched now so that appends never fault */
+  journal->ring_size = c.buffer ? c.buffer : PAL_JOURNAL_BUFFER;
+  if (journal->ring_size > journal->capacity) {
+    journal->ring_size = journal->capacity;
+  }
+  journal->ring = pal_malloc(journal->ring_size);
+  if (!journal->ring) {
+    errno = ENOMEM;
+    goto err_close;
+  }
+  memset(journal->ring, 0, journal->ring_size);
+
+  /* Records are only ever written through the fd, by whoever syncs */
+  journal->map =
+      mmap(NULL, journal->capacity, PROT_READ, MAP_SHARED, journal->fd, 0);
+  if (journal->map == MAP_FAILED) {
+    goto err_free;
+  }
+  if (hdr.magic != JOURNAL_MAGIC) {
+    hdr.magic = JOURNAL_MAGIC;
+    hdr.version = JOURNAL_VERSION;
+    hdr.epoch = 0;
+  }
+
+  journal_recover(journal, hdr.epoch);
+  journal->epoch = ++hdr.epoch;
+  if (pwrite(journal->fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+      fdatasync(journal->fd)) {
+    goto err_unmap;
+  }
+
+  pthread_mutex_init(&journal->sync_lock, NULL);
+  pal_sem_init(&journal->kick, 0);
+  if (!pal_timeout_is_forever(journal->interval) &&
+      (err = pthread_create(
+           &journal->flusher, NULL, journal_flusher, journal))) {
+    pal_sem_destroy(&journal->kick);
+    pthread_mutex_destroy(&journal->sync_lock);
+    errno = err;
+    goto err_unmap;
+  }
+  return 0;
+
+err_unmap:
+  err = errno;
+  munmap((void *)journal->map, journal->capacity);
+  errno = err;
+err_free:
+  err = errno;
+  pal_free(journal->ring);
+  errno = err;
+err_close:
+  err = errno;
+  close(journal->fd);
+  errno = err;
+  return -1;
+}
+
+/**
+ * pal_journal_append - add a record
+ * @journal: journal, appended to by one thread only
+ * @type:    nonzero, see enum pal_journal_type
+ * @data:    payload
+ * @len:     payload bytes
+ *
+ * Only copies into the journal's buffer; the record is durable once the
+ * next sync completes. Returns 0, or -1 with errno ENOSPC when the journal
+ * is full, EAGAIN when the records not yet synced fill the buffer (the
+ * flusher is kicked; try again once it has caught up), or EINVAL for a bad
+ * type or a record larger than the buffer.
+ */
+int
+pal_journal_append(pal_journal_t *journal,
+                   uint16_t type,
+                   const void *data,
+                   size_t len)
+{
+  static const uint8_t pad[8];
+  struct pal_journal_record rec;
+  size_t size = journal_size(len);
+  size_t synced;
+  uint32_t crc;
+
+  if (type == 0 || len > UINT32_MAX || size > journal->ring_size) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (size > journal->capacity - journal->head) {
+    errno = ENOSPC;
+    return -1;
+  }
+  synced = __atomic_load_n(&journal->synced, __ATOMIC_ACQUIRE);
+  if (journal->head + size - synced > journal->ring_size) {
+    pal_sem_post(&journal->kick);
+    errno = EAGAIN;
+    return -1;
+  }
+
+  rec = (struct pal_journal_record){.len = (uint32_t)len,
+                                    .seq = journal->seq++,
+                                    .epoch = journal->epoch,
+                                    .type = type};
+  crc = journal_crc(0,
+                    (const uint8_t *)&rec + sizeof(rec.crc),
+                    sizeof(rec) - sizeof(rec.crc));
+  rec.crc = journal_crc(crc, data, len);
+  journal_ring_put(journal, journal->head, &rec, sizeof(rec));
+  journal_ring_put(journal, journal->head + sizeof(rec), data, len);
+  journal_ring_put(journal,
+                   journal->head + sizeof(rec) + len,
+                   pad,
+                   size - sizeof(rec) - len);
+
+  journal->head += size;
+  __atomic_store_n(&journal->published, journal->head, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/**
+ * pal_journal_sync - write every record appended so far to disk
+ * @journal: journal
+ *
+ * Blocks for the write-back; the flusher thread calls it every interval.
+ * Returns 0, or -1 if the write or fdatasync() fails, in which case the
+ * records stay pending for the next call.
+ */
+int
+pal_journal_sync(pal_journal_t *journal)
+{
+  size_t end;
+  int ret = 0;
+
+  pthread_mutex_lock(&journal->sync_lock);
+  end = __atomic_load_n(&journal->published, __ATOMIC_ACQUIRE);
+  if (end > journal->synced) {
+    if (journal_ring_write(journal, journal->synced, end) ||
+        fdatasync(journal->fd)) {
+      ret = -1;
+    } else {
+      __atomic_store_n(&journal->synced, end, __ATOMIC_RELEASE);
+    }
+  }
+  pthread_mutex_unlock(&journal->sync_lock);
+  return ret;
+}
+
+/* Have the flusher sync now rather than at the end of its interval */
+void
+pal_journal_flush(pal_journal_t *journal)
+{
+  pal_sem_post(&journal->kick);
+}
+
+/**
+ * pal_journal_replay - visit the records in order
+ * @journal: journal
+ * @visit:   called per record with its payload
+ * @ctx:     passed to @visit
+ *
+ * Call from the appending thread, e.g. after pal_journal_open() to rebuild
+ * the page. Records appended since the last sync are synced first, since
+ * they are read back from the file; if that fails the replay stops short
+ * of them. Returns the number of records visited.
+ */
+size_t
+pal_journal_replay(pal_journal_t *journal,
+                   pal_journal_visit_fn visit,
+                   void *ctx)
+{
+  size_t off = JOURNAL_HEADER, n = 0;
+  size_t end;
+
+  pal_journal_sync(journal);
+  end = pal_journal_synced(journal);
+  while (off < end) {
+    const struct pal_journal_record *rec =
+        (const struct pal_journal_record *)(journal->map + off);
+
+    n++;
+    if (visit(ctx, rec, rec + 1)) {
+      break;
+    }
+    off += journal_size(rec->len);
+  }
+  return n;
+}
+
+/* Stop the flusher, sync what is left and unmap */
+void
+pal_journal_close(pal_journal_t *journal)
+{
+  if (!pal_timeout_is_forever(journal->interval)) {
+    __atomic_store_n(&journal->stop, true, __ATOMIC_RELEASE);
+    pal_sem_post(&journal->kick);
+    pthread_join(journal->flusher, NULL);
+  }
+  pal_journal_sync(journal);
+  pal_sem_destroy(&journal->kick);
+  pthread_mutex_destroy(&journal->sync_lock);
+  munmap((void *)journal->map, journal->capacity);
+  pal_free(journal->ring);
+  close(journal->fd);
+}
@@ -0,0 +1,316 @@
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <time.h>
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/posix/malloc_stats.h>
+
+#define ATOMIC_ADD(p, v) __atomic_add_fetch(p, v, __ATOMIC_RELAXED)
+#define ATOMIC_LOAD(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+
+static struct {
+  pthread_once_t once;
+  struct pal_malloc_site *sites;
+  size_t nsites;
+  uint64_t allocs; /* frees are only counted per site */
+  int64_t live;
+  int64_t peak;
+  int64_t start;         /* second of the first allocation */
+  int64_t window;        /* second being counted */
+  uint64_t window_start; /* allocs when it began */
+  uint64_t seconds[PAL_MALLOC_RATE_BUCKETS];
+#if CONFIG_PAL_MALLOC_STATS_SIGNAL > 0
+  sem_t dump;
+#endif
+} stats = {.once = PTHREAD_ONCE_INIT};
+
+/* Coarse clock: a vDSO read of the last tick, cheap enough for every call */
+static inline int64_t
+stats_second(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return ts.tv_sec;
+}
+
+static inline void
+stats_peak(int64_t *peak, int64_t live)
+{
+  int64_t old = ATOMIC_LOAD(peak);
+
+  while (live > old && !__atomic_compare_exchange_n(peak,
+                                                    &old,
+                                                    live,
+                                                    true,
+                                                    __ATOMIC_RELAXED,
+                                                    __ATOMIC_RELAXED)) {
+  }
+}
+
+static inline int
+rate_bucket(uint64_t n)
+{
+  int bucket = n ? 64 - __builtin_clzll(n) : 0;
+
+  return bucket < PAL_MALLOC_RATE_BUCKETS ? bucket
+                                          : PAL_MALLOC_RATE_BUCKETS - 1;
+}
+
+/* Close the second being counted once the clock moves past it */
+static void
+rate_tick(uint64_t allocs)
+{
+  int64_t now = stats_second();
+  int64_t window = ATOMIC_LOAD(&stats.window);
+
+  if (now != window && __atomic_compare_exchange_n(&stats.window,
+                                                   &window,
+                                                   now,
+                                                   false,
+                                                   __ATOMIC_RELAXED,
+                                                   __ATOMIC_RELAXED)) {
+    uint64_t n = allocs - __atomic_exchange_n(
+                              &stats.window_start, allocs, __ATOMIC_RELAXED);
+    ATOMIC_ADD(&stats.seconds[rate_bucket(n)], 1);
+    if (now - window > 1) {
+      ATOMIC_ADD(&stats.seconds[0], now - window - 1); /* idle seconds */
+    }
+  }
+}
+
+static void
+stats_exit(void)
+{
+  pal_malloc_stats_print(stderr);
+}
+
+#if CONFIG_PAL_MALLOC_STATS_SIGNAL > 0
+static void
+stats_signal(int sig)
+{
+  (void)sig;
+  sem_post(&stats.dump); /* async-signal-safe; the dumper thread prints */
+}
+
+static void *
+stats_dumper(void *arg)
+{
+  (void)arg;
+  for (;;) {
+    while (sem_wait(&stats.dump) && errno == EINTR) {
+    }
+    pal_malloc_stats_print(stderr);
+  }
+  return NULL;
+}
+
+static void
+stats_install_signal(void)
+{
+  struct sigaction sa = {.sa_handler = stats_signal, .sa_flags = SA_RESTART};
+  struct sigaction old;
+  pthread_attr_t attr;
+  pthread_t thread;
+  sigset_t all, prev;
+
+  /* Leave the signal alone if the application already handles it */
+  if (sigaction(CONFIG_PAL_MALLOC_STATS_SIGNAL, NULL, &old) ||
+      old.sa_handler != SIG_DFL) {
+    return;
+  }
+  sem_init(&stats.dump, 0, 0);
+
+  /* The dumper must not be the thread the signal is delivered to */
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &prev);
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  if (pthread_create(&thread, &attr, stats_dumper, NULL) == 0) {
+    sigemptyset(&sa.sa_mask);
+    sigaction(CONFIG_PAL_MALLOC_STATS_SIGNAL, &sa, NULL);
+  }
+  pthread_attr_destroy(&attr);
+  pthread_sigmask(SIG_SETMASK, &prev, NULL);
+}
+#endif
+
+static void
+stats_init(void)
+{
+  stats.start = stats.window = stats_second();
+  atexit(stats_exit);
+#if CONFIG_PAL_MALLOC_STATS_SIGNAL > 0
+  stats_install_signal();
+#endif
+}
+
+static void
+site_register(struct pal_malloc_site *site)
+{
+  if (__atomic_exchange_n(&site->registered, 1, __ATOMIC_ACQ_REL)) {
+    return;
+  }
+  site->next = __atomic_load_n(&stats.sites, __ATOMIC_ACQUIRE);
+  while (!__atomic_compare_exchange_n(&stats.sites,
+                                      &site->next,
+                                      site,
+                                      true,
+                                      __ATOMIC_RELEASE,
+                                      __ATOMIC_ACQUIRE)) {
+  }
+  ATOMIC_ADD(&stats.nsites, 1);
+}
+
+/**
+ * pal_malloc_stats_record - account a new block and return its user pointer
+ * @site: call site the block was allocated from
+ * @raw:  block of sizeof(struct pal_malloc_hdr) + @size bytes, or NULL
+ * @size: bytes requested by the caller
+ */
+void *
+pal_malloc_stats_record(struct pal_malloc_site *site, void *raw, size_t size)
+{
+  struct pal_malloc_hdr *hdr = raw;
+
+  if (!hdr) {
+    return NULL;
+  }
+  pthread_once(&stats.once, stats_init);
+  if (!__atomic_load_n(&site->registered, __ATOMIC_ACQUIRE)) {
+    site_register(site);
+  }
+
+  hdr->site = site;
+  hdr->size = size;
+
+  ATOMIC_ADD(&site->allocs, 1);
+  ATOMIC_ADD(&site->bytes, size);
+  stats_peak(&site->peak, ATOMIC_ADD(&site->live, (int64_t)size));
+  stats_peak(&stats.peak, ATOMIC_ADD(&stats.live, (int64_t)size));
+  rate_tick(ATOMIC_ADD(&stats.allocs, 1));
+
+  return hdr + 1;
+}
+
+/**
+ * pal_malloc_stats_forget - account a block being freed
+ * @ptr: user pointer from pal_malloc(), or NULL
+ *
+ * Returns the raw block to hand to the underlying free.
+ */
+void *
+pal_malloc_stats_forget(void *ptr)
+{
+  struct pal_malloc_hdr *hdr;
+
+  if (!ptr) {
+    return NULL;
+  }
+  hdr = (struct pal_malloc_hdr *)ptr - 1;
+
+  ATOMIC_ADD(&hdr->site->frees, 1);
+  ATOMIC_ADD(&hdr->site->live, -(int64_t)hdr->size);
+  ATOMIC_ADD(&stats.live, -(int64_t)hdr->size);
+
+  return hdr;
+}
+
+void
+pal_malloc_stats(struct pal_malloc_stats *out)
+{
+  memset(out, 0, sizeof(*out));
+  out->sites = ATOMIC_LOAD(&stats.nsites);
+  out->allocs = ATOMIC_LOAD(&stats.allocs);
+  out->live = ATOMIC_LOAD(&stats.live);
+  out->peak = ATOMIC_LOAD(&stats.peak);
+  for (int i = 0; i < PAL_MALLOC_RATE_BUCKETS; i++) {
+    out->seconds[i] = ATOMIC_LOAD(&stats.seconds[i]);
+  }
+  for (struct pal_malloc_site *site =
+           __atomic_load_n(&stats.sites, __ATOMIC_ACQUIRE);
+       site;
+       site = site->next) {
+    out->frees += ATOMIC_LOAD(&site->frees);
+  }
+}
+
+static int
+site_cmp(const void *a, const void *b)
+{
+  uint64_t x = ATOMIC_LOAD(&(*(struct pal_malloc_site *const *)a)->allocs);
+  uint64_t y = ATOMIC_LOAD(&(*(struct pal_malloc_site *const *)b)->allocs);
+
+  return (x < y) - (x > y); /* busiest first */
+}
+
+void
+pal_malloc_stats_print(FILE *out)
+{
+  struct pal_malloc_stats s;
+  struct pal_malloc_site **sites;
+  size_t n = 0;
+  int64_t elapsed;
+
+  pal_malloc_stats(&s);
+  elapsed = s.allocs ? stats_second() - stats.start + 1 : 1;
+
+  flockfile(out);
+  fprintf(out,
+          "pal_malloc: %llu allocs, %llu frees, %lld B live, %lld B peak, "
+          "%.0f allocs/s over %llds\n",
+          (unsigned long long)s.allocs,
+          (unsigned long long)s.frees,
+          (long long)s.live,
+          (long long)s.peak,
+          (double)s.allocs / (double)elapsed,
+          (long long)elapsed);
+
+  /* The registry only grows at its head, so a snapshot of it is stable.
+   * libc directly: this file may not route through itself. */
+  sites = malloc(s.sites * sizeof(*sites));
+  for (struct pal_malloc_site *site =
+           __atomic_load_n(&stats.sites, __ATOMIC_ACQUIRE);
+       site && sites && n < s.sites;
+       site = site->next) {
+    sites[n++] = site;
+  }
+  qsort(sites, n, sizeof(*sites), site_cmp);
+
+  fprintf(out,
+          "  %12s %12s %14s %12s %12s  site\n",
+          "allocs",
+          "frees",
+          "bytes",
+          "live",
+          "peak");
+  for (size_t i = 0; i < n; i++) {
+    fprintf(out,
+            "  %12llu %12llu %14llu %12lld %12lld  %s:%d (%s)\n",
+            (unsigned long long)ATOMIC_LOAD(&sites[i]->allocs),
+            (unsigned long long)ATOMIC_LOAD(&sites[i]->frees),
+            (unsigned long long)ATOMIC_LOAD(&sites[i]->bytes),
+            (long long)ATOMIC_LOAD(&sites[i]->live),
+            (long long)ATOMIC_LOAD(&sites[i]->peak),
+            sites[i]->file,
+            sites[i]->line,
+            sites[i]->func);
+  }
+  free(sites);
+
+  fprintf(out,
+          "  seconds by allocation rate (current: %llu so far):\n",
+          (unsigned long long)(s.allocs - ATOMIC_LOAD(&stats.window_start)));
+  for (int i = 0; i < PAL_MALLOC_RATE_BUCKETS; i++) {
+    if (s.seconds[i]) {
+      fprintf(out,
+              "    %10llu - %10llu /s: %llu\n",
+              i ? 1ULL << (i - 1) : 0ULL,
+              i ? (1ULL << i) - 1 : 0ULL,
+              (unsigned long long)s.seconds[i]);
+    }
+  }
+  funlockfile(out);
+}
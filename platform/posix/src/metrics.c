@@ -0,0 +1,173 @@
+#include <errno.h>
+#include <pthread.h>
+
+#include <qwiet/platform/common/list.h>
+#include <qwiet/platform/posix/metrics.h>
+
+static const char *const metric_names[PAL_METRIC_COUNT] = {
+    [PAL_METRIC_SEM_WAIT] = "sem.wait",
+    [PAL_METRIC_TIMER_LATENESS] = "timer.lateness",
+    [PAL_METRIC_NET_SEND] = "net.send",
+    [PAL_METRIC_NET_RECV] = "net.recv",
+};
+
+struct metrics_set {
+  struct pal_list_head node;
+  pal_histogram_t hist[PAL_METRIC_COUNT];
+};
+
+static struct {
+  pthread_once_t once;
+  pthread_mutex_t lock;
+  pthread_key_t key;
+  struct pal_list_head live; /* sets of running threads */
+  struct metrics_set retired; /* merged sets of exited threads */
+} metrics = {.once = PTHREAD_ONCE_INIT, .lock = PTHREAD_MUTEX_INITIALIZER};
+
+static _Thread_local struct metrics_set *thread_set;
+
+static void
+metrics_thread_exit(void *arg)
+{
+  struct metrics_set *set = arg;
+
+  pthread_mutex_lock(&metrics.lock);
+  pal_list_del(&set->node);
+  for (int m = 0; m < PAL_METRIC_COUNT; m++) {
+    pal_histogram_merge(&metrics.retired.hist[m], &set->hist[m]);
+  }
+  pthread_mutex_unlock(&metrics.lock);
+  free(set);
+  thread_set = NULL;
+}
+
+static void
+metrics_init(void)
+{
+  pthread_key_create(&metrics.key, metrics_thread_exit);
+  pal_list_init(&metrics.live);
+  for (int m = 0; m < PAL_METRIC_COUNT; m++) {
+    pal_histogram_reset(&metrics.retired.hist[m]);
+  }
+}
+
+static struct metrics_set *
+metrics_attach(void)
+{
+  /* libc directly, so the allocation statistics do not count metrics */
+  struct metrics_set *set = malloc(sizeof(*set));
+
+  if (!set) {
+    return NULL;
+  }
+  for (int m = 0; m < PAL_METRIC_COUNT; m++) {
+    pal_histogram_reset(&set->hist[m]);
+  }
+  pthread_once(&metrics.once, metrics_init);
+  pthread_setspecific(metrics.key, set);
+  pthread_mutex_lock(&metrics.lock);
+  pal_list_add_tail(&set->node, &metrics.live);
+  pthread_mutex_unlock(&metrics.lock);
+  return thread_set = set;
+}
+
+/* Leaves errno alone: callers record around syscalls and check it after */
+void
+pal_metrics_record(enum pal_metric metric, uint64_t ns)
+{
+  struct metrics_set *set = thread_set;
+  int saved_errno = errno;
+
+  if (set || (set = metrics_attach())) {
+    pal_histogram_record(&set->hist[metric], ns);
+  }
+  errno = saved_errno;
+}
+
+/* Record the time since @start, a pal_uptime_ns() reading */
+void
+pal_metrics_record_since(enum pal_metric metric, int64_t start)
+{
+  int saved_errno = errno;
+  int64_t now = pal_uptime_ns();
+
+  errno = saved_errno;
+  pal_metrics_record(metric, (uint64_t)(now - start));
+}
+
+/**
+ * pal_metrics_snapshot - merge every thread's histogram of @metric
+ * @metric: metric to read
+ * @out:    receives the merged histogram
+ */
+void
+pal_metrics_snapshot(enum pal_metric metric, pal_histogram_t *out)
+{
+  struct metrics_set *set;
+
+  pthread_once(&metrics.once, metrics_init);
+  pal_histogram_reset(out);
+  pthread_mutex_lock(&metrics.lock);
+  pal_histogram_merge(out, &metrics.retired.hist[metric]);
+  pal_list_for_each_entry(set, &metrics.live, node)
+  {
+    pal_histogram_merge(out, &set->hist[metric]);
+  }
+  pthread_mutex_unlock(&metrics.lock);
+}
+
+/**
+ * pal_metrics_reset - start every metric over
+ *
+ * Values recorded concurrently by other threads may survive the reset.
+ */
+void
+pal_metrics_reset(void)
+{
+  struct metrics_set *set;
+
+  pthread_once(&metrics.once, metrics_init);
+  pthread_mutex_lock(&metrics.lock);
+  pal_list_for_each_entry(set, &metrics.live, node)
+  {
+    for (int m = 0; m < PAL_METRIC_COUNT; m++) {
+      pal_histogram_reset(&set->hist[m]);
+    }
+  }
+  for (int m = 0; m < PAL_METRIC_COUNT; m++) {
+    pal_histogram_reset(&metrics.retired.hist[m]);
+  }
+  pthread_mutex_unlock(&metrics.lock);
+}
+
+void
+pal_metrics_print(FILE *out)
+{
+  /* Too large for some thread stacks */
+  static pal_histogram_t h;
+  static pthread_mutex_t print_lock = PTHREAD_MUTEX_INITIALIZER;
+
+  pthread_mutex_lock(&print_lock);
+  fprintf(out,
+          "%-16s %10s %10s %10s %10s %10s %10s\n",
+          "metric (us)",
+          "count",
+          "p50",
+          "p90",
+          "p99",
+          "p99.9",
+          "max");
+  for (int m = 0; m < PAL_METRIC_COUNT; m++) {
+    pal_metrics_snapshot(m, &h);
+    fprintf(out,
+            "%-16s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+            metric_names[m],
+            (unsigned long long)pal_histogram_count(&h),
+            pal_histogram_percentile(&h, 50.0) / 1e3,
+            pal_histogram_percentile(&h, 90.0) / 1e3,
+            pal_histogram_percentile(&h, 99.0) / 1e3,
+            pal_histogram_percentile(&h, 99.9) / 1e3,
+            (h.count ? h.max : 0) / 1e3);
+  }
+  pthread_mutex_unlock(&print_lock);
+}
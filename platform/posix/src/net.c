@@ -2,7 +2,9 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <qwiet/platform/posix/metrics.h>
 #include <qwiet/platform/posix/net.h>
+#include <qwiet/platform/posix/trace.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -32,7 +34,10 @@ int
 pal_net_socket_poll(struct pollfd *fds, int nfds, pal_timeout_t timeout)
 {
   int ms = pal_timeout_to_ms(timeout);
-  return poll(fds, nfds, ms);
+  PAL_TRACE_BEGIN("net.poll");
+  int ret = poll(fds, nfds, ms);
+  PAL_TRACE_END("net.poll");
+  return ret;
 }
 
 int
@@ -72,13 +77,23 @@ pal_net_socket_set_nonblocking(int sock, bool non_blocking)
 int
 pal_net_send(int sock, const void *buf, uint16_t len, int flags)
 {
-  return (int)send(sock, buf, len, flags);
+  PAL_METRIC_BEGIN(start);
+  PAL_TRACE_BEGIN("net.send");
+  int ret = (int)send(sock, buf, len, flags);
+  PAL_TRACE_END("net.send");
+  PAL_METRIC_END(PAL_METRIC_NET_SEND, start);
+  return ret;
 }
 
 int
 pal_net_recv(int sock, uint8_t *buf, uint16_t len, int flags)
 {
-  return (int)recv(sock, buf, len, flags);
+  PAL_METRIC_BEGIN(start);
+  PAL_TRACE_BEGIN("net.recv");
+  int ret = (int)recv(sock, buf, len, flags);
+  PAL_TRACE_END("net.recv");
+  PAL_METRIC_END(PAL_METRIC_NET_RECV, start);
+  return ret;
 }
 
 int
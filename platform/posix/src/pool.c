@@ -0,0 +1,418 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <qwiet/platform/posix/pool.h>
+
+/* Per-worker deque capacity; overflow spills into the injection queue */
+#define POOL_DEQUE_SIZE 1024
+
+/*
+ * Chase-Lev work-stealing deque with the C11 orderings from Le, Pop, Cohen
+ * and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory
+ * Models" (PPoPP 2013). Fixed capacity: push fails instead of growing.
+ */
+struct pool_deque {
+  _Atomic int64_t top;
+  _Atomic int64_t bottom;
+  struct pal_pool_job *_Atomic buf[POOL_DEQUE_SIZE];
+};
+
+struct pal_pool_worker {
+  pal_pool_t *pool;
+  pthread_t thread;
+  unsigned int rng;
+  struct pool_deque deque;
+};
+
+static _Thread_local struct pal_pool_worker *current_worker;
+
+static bool
+deque_push(struct pool_deque *d, struct pal_pool_job *job)
+{
+  int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+  int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+  if (b - t >= POOL_DEQUE_SIZE) {
+    return false;
+  }
+  atomic_store_explicit(
+      &d->buf[b & (POOL_DEQUE_SIZE - 1)], job, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+  return true;
+}
+
+static struct pal_pool_job *
+deque_pop(struct pool_deque *d)
+{
+  struct pal_pool_job *job = NULL;
+  int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+  int64_t t;
+
+  atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+  if (t <= b) {
+    job = atomic_load_explicit(&d->buf[b & (POOL_DEQUE_SIZE - 1)],
+                               memory_order_relaxed);
+    if (t == b) {
+      /* Last item: race any thief for it */
+      if (!atomic_compare_exchange_strong_explicit(&d->top,
+                                                   &t,
+                                                   t + 1,
+                                                   memory_order_seq_cst,
+                                                   memory_order_relaxed)) {
+        job = NULL;
+      }
+      atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+  } else {
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+  }
+  return job;
+}
+
+static struct pal_pool_job *
+deque_steal(struct pool_deque *d)
+{
+  int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+  if (t < b) {
+    struct pal_pool_job *job = atomic_load_explicit(
+        &d->buf[t & (POOL_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (atomic_compare_exchange_strong_explicit(&d->top,
+                                                &t,
+                                                t + 1,
+                                                memory_order_seq_cst,
+                                                memory_order_relaxed)) {
+      return job;
+    }
+  }
+  return NULL; /* empty, or lost the race */
+}
+
+static struct pal_pool_job *
+inject_pop(pal_pool_t *pool)
+{
+  struct pal_pool_job *job = NULL;
+
+  pthread_mutex_lock(&pool->inject_lock);
+  if (!pal_list_empty(&pool->inject)) {
+    job = pal_list_first_entry(&pool->inject, struct pal_pool_job, node);
+    pal_list_del_init(&job->node);
+  }
+  pthread_mutex_unlock(&pool->inject_lock);
+  return job;
+}
+
+/*
+ * Find a runnable job: own deque first, then the injection queue, then steal
+ * from the other workers starting at a random victim. @self may be NULL for
+ * threads outside the pool that help while waiting.
+ */
+static struct pal_pool_job *
+pool_find_job(pal_pool_t *pool, struct pal_pool_worker *self)
+{
+  struct pal_pool_job *job;
+  int start;
+
+  if (self && (job = deque_pop(&self->deque))) {
+    return job;
+  }
+  if ((job = inject_pop(pool))) {
+    return job;
+  }
+
+  start = self ? (int)(rand_r(&self->rng) % (unsigned)pool->nworkers) : 0;
+  for (int i = 0; i < pool->nworkers; i++) {
+    struct pal_pool_worker *victim =
+        &pool->workers[(start + i) % pool->nworkers];
+    if (victim != self && (job = deque_steal(&victim->deque))) {
+      return job;
+    }
+  }
+  return NULL;
+}
+
+static void
+pool_complete(pal_pool_t *pool, struct pal_pool_job *job)
+{
+  bool was_empty;
+
+  pthread_mutex_lock(&pool->done_lock);
+  was_empty = pal_list_empty(&pool->done);
+  pal_list_add_tail(&job->node, &pool->done);
+  pthread_mutex_unlock(&pool->done_lock);
+
+  /* One byte per empty -> non-empty transition keeps the pipe shallow */
+  if (was_empty) {
+    char c = 0;
+    ssize_t ret = write(pool->notify[1], &c, 1);
+    pal_assert(ret == 1 || errno == EAGAIN, "pool notify write failed");
+  }
+}
+
+static void
+pool_run(pal_pool_t *pool, struct pal_pool_job *job)
+{
+  /* done() may release the job, so sample it before running work() */
+  bool notify = job->done != NULL;
+
+  job->work(job);
+  if (notify) {
+    pool_complete(pool, job);
+  }
+}
+
+static void
+pool_wake(pal_pool_t *pool)
+{
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&pool->sleepers, memory_order_seq_cst) > 0) {
+    pal_sem_post(&pool->idle);
+  }
+}
+
+static void *
+pool_worker_main(void *arg)
+{
+  struct pal_pool_worker *self = arg;
+  pal_pool_t *pool = self->pool;
+  struct pal_pool_job *job;
+
+  current_worker = self;
+  for (;;) {
+    if ((job = pool_find_job(pool, self))) {
+      pool_run(pool, job);
+      continue;
+    }
+
+    /* Announce that we are going idle, then look once more before parking
+     * so a submit racing with us either sees a sleeper or we see its job */
+    atomic_fetch_add_explicit(&pool->sleepers, 1, memory_order_seq_cst);
+    if ((job = pool_find_job(pool, self))) {
+      atomic_fetch_sub_explicit(&pool->sleepers, 1, memory_order_seq_cst);
+      pool_run(pool, job);
+      continue;
+    }
+    if (atomic_load_explicit(&pool->stop, memory_order_acquire)) {
+      atomic_fetch_sub_explicit(&pool->sleepers, 1, memory_order_seq_cst);
+      break;
+    }
+    pal_sem_wait(&pool->idle, PAL_FOREVER);
+    atomic_fetch_sub_explicit(&pool->sleepers, 1, memory_order_seq_cst);
+  }
+  current_worker = NULL;
+  return NULL;
+}
+
+void
+pal_pool_init(pal_pool_t *pool, int nworkers)
+{
+  int ret;
+
+  if (nworkers <= 0) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    nworkers = n > 0 ? (int)n : 1;
+  }
+
+  pool->nworkers = nworkers;
+  pool->workers = pal_malloc(sizeof(struct pal_pool_worker) * nworkers);
+  pal_assert(pool->workers, "failed to allocate %d pool workers", nworkers);
+
+  pthread_mutex_init(&pool->inject_lock, NULL);
+  pal_list_init(&pool->inject);
+  pal_sem_init(&pool->idle, 0);
+  atomic_init(&pool->sleepers, 0);
+  atomic_init(&pool->stop, false);
+
+  pthread_mutex_init(&pool->done_lock, NULL);
+  pal_list_init(&pool->done);
+  ret = pipe(pool->notify);
+  pal_assert(ret == 0, "failed to create pool notify pipe");
+  for (int i = 0; i < 2; i++) {
+    int flags = fcntl(pool->notify[i], F_GETFL, 0);
+    ret = fcntl(pool->notify[i], F_SETFL, flags | O_NONBLOCK);
+    pal_assert(ret == 0, "fcntl F_SETFL failed on pool notify pipe");
+  }
+
+  for (int i = 0; i < nworkers; i++) {
+    struct pal_pool_worker *w = &pool->workers[i];
+    w->pool = pool;
+    w->rng = (unsigned int)i * 2654435761u + 1;
+    atomic_init(&w->deque.top, 0);
+    atomic_init(&w->deque.bottom, 0);
+  }
+  for (int i = 0; i < nworkers; i++) {
+    struct pal_pool_worker *w = &pool->workers[i];
+    ret = pthread_create(&w->thread, NULL, pool_worker_main, w);
+    pal_assert(ret == 0, "failed to start pool worker %d", i);
+  }
+}
+
+void
+pal_pool_submit(pal_pool_t *pool, struct pal_pool_job *job)
+{
+  struct pal_pool_worker *self = current_worker;
+
+  if (!(self && self->pool == pool && deque_push(&self->deque, job))) {
+    pthread_mutex_lock(&pool->inject_lock);
+    pal_list_add_tail(&job->node, &pool->inject);
+    pthread_mutex_unlock(&pool->inject_lock);
+  }
+  pool_wake(pool);
+}
+
+int
+pal_pool_fd(pal_pool_t *pool)
+{
+  return pool->notify[0];
+}
+
+int
+pal_pool_dispatch(pal_pool_t *pool)
+{
+  struct pal_list_head ready, *pos, *n;
+  char buf[64];
+  int count = 0;
+
+  /* Drain the pipe before taking the list, mirroring pal_waker_drain() */
+  while (read(pool->notify[0], buf, sizeof(buf)) > 0)
+    ;
+
+  pal_list_init(&ready);
+  pthread_mutex_lock(&pool->done_lock);
+  pal_list_splice_init(&pool->done, &ready);
+  pthread_mutex_unlock(&pool->done_lock);
+
+  pal_list_for_each_safe(pos, n, &ready)
+  {
+    struct pal_pool_job *job = pal_list_entry(pos, struct pal_pool_job, node);
+    pal_list_del_init(&job->node);
+    job->done(job);
+    count++;
+  }
+  return count;
+}
+
+struct pool_pfor {
+  _Atomic size_t next;
+  size_t end;
+  size_t grain;
+  void (*fn)(void *arg, size_t begin, size_t end);
+  void *arg;
+  _Atomic int active;
+};
+
+struct pool_pfor_job {
+  struct pal_pool_job job;
+  struct pool_pfor *pfor;
+};
+
+static void
+pfor_claim_all(struct pool_pfor *pfor)
+{
+  size_t begin;
+
+  while ((begin = atomic_fetch_add_explicit(
+              &pfor->next, pfor->grain, memory_order_relaxed)) < pfor->end) {
+    size_t end = pfor->end - begin > pfor->grain ? begin + pfor->grain
+                                                 : pfor->end;
+    pfor->fn(pfor->arg, begin, end);
+  }
+}
+
+static void
+pfor_work(struct pal_pool_job *job)
+{
+  struct pool_pfor_job *helper =
+      PAL_CONTAINER_OF(job, struct pool_pfor_job, job);
+  struct pool_pfor *pfor = helper->pfor;
+
+  pfor_claim_all(pfor);
+  atomic_fetch_sub_explicit(&pfor->active, 1, memory_order_release);
+}
+
+void
+pal_pool_parallel_for(pal_pool_t *pool,
+                      size_t begin,
+                      size_t end,
+                      size_t grain,
+                      void (*fn)(void *arg, size_t begin, size_t end),
+                      void *arg)
+{
+  struct pool_pfor pfor;
+  struct pool_pfor_job *helpers;
+  size_t chunks;
+  int nhelpers;
+
+  if (begin >= end) {
+    return;
+  }
+  if (grain == 0) {
+    grain = 1;
+  }
+
+  chunks = (end - begin + grain - 1) / grain;
+  nhelpers = chunks - 1 < (size_t)pool->nworkers ? (int)(chunks - 1)
+                                                 : pool->nworkers;
+  if (nhelpers == 0) {
+    fn(arg, begin, end);
+    return;
+  }
+
+  atomic_init(&pfor.next, begin);
+  pfor.end = end;
+  pfor.grain = grain;
+  pfor.fn = fn;
+  pfor.arg = arg;
+  atomic_init(&pfor.active, nhelpers);
+
+  helpers = pal_malloc(sizeof(*helpers) * nhelpers);
+  pal_assert(helpers, "failed to allocate parallel_for helpers");
+  for (int i = 0; i < nhelpers; i++) {
+    pal_pool_job_init(&helpers[i].job, pfor_work, NULL);
+    helpers[i].pfor = &pfor;
+    pal_pool_submit(pool, &helpers[i].job);
+  }
+
+  /* The caller works too, then helps drain the pool until every helper it
+   * queued has run; parking instead could deadlock when called from a
+   * worker while the remaining helpers sit in this worker's own deque */
+  pfor_claim_all(&pfor);
+  while (atomic_load_explicit(&pfor.active, memory_order_acquire) > 0) {
+    struct pal_pool_worker *self =
+        current_worker && current_worker->pool == pool ? current_worker : NULL;
+    struct pal_pool_job *job = pool_find_job(pool, self);
+    if (job) {
+      pool_run(pool, job);
+    } else {
+      sched_yield();
+    }
+  }
+  pal_free(helpers);
+}
+
+void
+pal_pool_cleanup(pal_pool_t *pool)
+{
+  /* Workers drain any queued jobs before they observe stop */
+  atomic_store_explicit(&pool->stop, true, memory_order_release);
+  for (int i = 0; i < pool->nworkers; i++) {
+    pal_sem_post(&pool->idle);
+  }
+  for (int i = 0; i < pool->nworkers; i++) {
+    pthread_join(pool->workers[i].thread, NULL);
+  }
+
+  close(pool->notify[0]);
+  close(pool->notify[1]);
+  pthread_mutex_destroy(&pool->done_lock);
+  pal_sem_destroy(&pool->idle);
+  pthread_mutex_destroy(&pool->inject_lock);
+  pal_free(pool->workers);
+}
@@ -1,5 +1,7 @@
 #include <errno.h>
+#include <qwiet/platform/posix/metrics.h>
 #include <qwiet/platform/posix/sem.h>
+#include <qwiet/platform/posix/trace.h>
 
 void
 pal_sem_init(pal_sem_t *sem, unsigned int value)
@@ -21,11 +23,20 @@ pal_sem_wait(pal_sem_t *sem, pal_timeout_t timeout)
   if (pal_timeout_is_nowait(timeout)) {
     return sem_trywait(&sem->sem) == 0 ? 1 : errno == EAGAIN ? 0 : -1;
   } else if (pal_timeout_is_forever(timeout)) {
-    return sem_wait(&sem->sem) == 0 ? 1 : -1;
+    PAL_METRIC_BEGIN(start);
+    PAL_TRACE_BEGIN("sem.wait");
+    int ret = sem_wait(&sem->sem);
+    PAL_TRACE_END("sem.wait");
+    PAL_METRIC_END(PAL_METRIC_SEM_WAIT, start);
+    return ret == 0 ? 1 : -1;
   } else {
     struct timespec abs;
     pal_timeout_to_abs_timespec(timeout, &abs);
+    PAL_METRIC_BEGIN(start);
+    PAL_TRACE_BEGIN("sem.wait");
     int ret = sem_timedwait(&sem->sem, &abs);
+    PAL_TRACE_END("sem.wait");
+    PAL_METRIC_END(PAL_METRIC_SEM_WAIT, start);
     return ret == 0 ? 1 : errno == ETIMEDOUT ? 0 : -1;
   }
 }
@@ -35,4 +46,5 @@ pal_sem_post(pal_sem_t *sem)
 {
   int ret = sem_post(&sem->sem);
   pal_assert(ret == 0, "sem_post failed");
+  PAL_TRACE_INSTANT("sem.post");
 }
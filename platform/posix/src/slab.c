@@ -0,0 +1,391 @@
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/list.h>
+#include <qwiet/platform/posix/slab.h>
+
+#define SLAB_SIZE (64 * 1024)
+#define SLAB_HEADER 64 /* objects start on their own cache line */
+#define SLAB_GRANULE 16
+
+/* Objects moved between a thread cache and the slabs in one locked batch */
+#define SLAB_CACHE_DEPTH 32
+#define SLAB_CACHE_BATCH (SLAB_CACHE_DEPTH / 2)
+
+static const uint16_t slab_class_size[PAL_POOL_CLASSES] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
+
+/* Free objects are threaded through their first word */
+struct slab_free {
+  struct slab_free *next;
+};
+
+struct slab {
+  struct pal_list_head node; /* class partial list, or the arena free list */
+  struct slab_free *free;
+  uint16_t fresh; /* objects past this index were never handed out */
+  uint16_t inuse;
+  uint16_t capacity;
+  uint8_t cls;
+};
+
+_Static_assert(sizeof(struct slab) <= SLAB_HEADER, "slab header too large");
+
+struct slab_class {
+  pthread_mutex_t lock;
+  struct pal_list_head partial; /* slabs with at least one free object */
+  struct slab *spare;           /* one empty slab kept against thrashing */
+  size_t slabs;
+  size_t inuse;
+};
+
+struct slab_cache {
+  unsigned int count;
+  void *objs[SLAB_CACHE_DEPTH];
+};
+
+static struct {
+  pthread_once_t once;
+  pthread_mutex_t lock;
+  char *base;
+  char *end;
+  char *brk;                 /* next slab never handed out */
+  struct pal_list_head free; /* empty slabs, memory released */
+  size_t nfree;
+  uint8_t class_of[PAL_POOL_MAX_SIZE / SLAB_GRANULE + 1];
+  struct slab_class classes[PAL_POOL_CLASSES];
+#ifdef CONFIG_PAL_POSIX_SLAB_TLS_CACHE
+  pthread_key_t cache_key;
+#endif
+} arena = {.once = PTHREAD_ONCE_INIT, .lock = PTHREAD_MUTEX_INITIALIZER};
+
+#ifdef CONFIG_PAL_POSIX_SLAB_TLS_CACHE
+static _Thread_local struct slab_cache thread_cache[PAL_POOL_CLASSES];
+static _Thread_local bool thread_cache_registered;
+
+static void
+slab_cache_flush(void *arg);
+#endif
+
+static void
+slab_init(void)
+{
+  size_t reserve = (size_t)CONFIG_PAL_POSIX_SLAB_ARENA_MB << 20;
+  char *map;
+  int cls = 0;
+
+  for (size_t g = 0; g <= PAL_POOL_MAX_SIZE / SLAB_GRANULE; g++) {
+    while (slab_class_size[cls] < g * SLAB_GRANULE) {
+      cls++;
+    }
+    arena.class_of[g] = cls;
+  }
+  for (int i = 0; i < PAL_POOL_CLASSES; i++) {
+    pthread_mutex_init(&arena.classes[i].lock, NULL);
+    pal_list_init(&arena.classes[i].partial);
+  }
+  pal_list_init(&arena.free);
+
+#ifdef CONFIG_PAL_POSIX_SLAB_TLS_CACHE
+  pthread_key_create(&arena.cache_key, slab_cache_flush);
+#endif
+
+  /* Reserve one extra slab so the range can be aligned to SLAB_SIZE. Pages
+   * are only backed once touched. */
+  map = mmap(NULL,
+             reserve + SLAB_SIZE,
+             PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+             -1,
+             0);
+  if (map == MAP_FAILED) {
+    return; /* every request falls back to malloc() */
+  }
+  arena.base = (char *)(((uintptr_t)map + SLAB_SIZE - 1) & ~(SLAB_SIZE - 1));
+  arena.end = arena.base + reserve;
+  arena.brk = arena.base;
+}
+
+static inline bool
+slab_owns(const void *ptr)
+{
+  return (const char *)ptr >= arena.base && (const char *)ptr < arena.end;
+}
+
+static inline struct slab *
+slab_of(const void *ptr)
+{
+  return (struct slab *)((uintptr_t)ptr & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+static struct slab *
+arena_take_slab(void)
+{
+  struct slab *slab = NULL;
+
+  pthread_mutex_lock(&arena.lock);
+  if (!pal_list_empty(&arena.free)) {
+    slab = pal_list_first_entry(&arena.free, struct slab, node);
+    pal_list_del(&slab->node);
+    arena.nfree--;
+  } else if (arena.brk < arena.end) {
+    slab = (struct slab *)arena.brk;
+    arena.brk += SLAB_SIZE;
+  }
+  pthread_mutex_unlock(&arena.lock);
+  return slab;
+}
+
+static void
+arena_give_slab(struct slab *slab)
+{
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+  /* Keep the header page, which holds the free list link */
+  madvise((char *)slab + page, SLAB_SIZE - page, MADV_DONTNEED);
+
+  pthread_mutex_lock(&arena.lock);
+  pal_list_add(&slab->node, &arena.free);
+  arena.nfree++;
+  pthread_mutex_unlock(&arena.lock);
+}
+
+/* Called with the class lock held */
+static void *
+class_alloc(struct slab_class *c, int cls)
+{
+  struct slab *slab;
+  void *obj;
+
+  if (!pal_list_empty(&c->partial)) {
+    slab = pal_list_first_entry(&c->partial, struct slab, node);
+  } else {
+    if (c->spare) {
+      slab = c->spare;
+      c->spare = NULL;
+    } else {
+      if (!(slab = arena_take_slab())) {
+        return NULL;
+      }
+      slab->free = NULL;
+      slab->fresh = 0;
+      slab->inuse = 0;
+      slab->capacity = (SLAB_SIZE - SLAB_HEADER) / slab_class_size[cls];
+      slab->cls = cls;
+      c->slabs++;
+    }
+    pal_list_add(&slab->node, &c->partial);
+  }
+
+  if (slab->free) {
+    obj = slab->free;
+    slab->free = slab->free->next;
+  } else {
+    obj = (char *)slab + SLAB_HEADER + slab->fresh++ * slab_class_size[cls];
+  }
+
+  if (++slab->inuse == slab->capacity) {
+    pal_list_del_init(&slab->node);
+  }
+  c->inuse++;
+  return obj;
+}
+
+/* Called with the class lock held */
+static void
+class_free(struct slab_class *c, void *obj)
+{
+  struct slab *slab = slab_of(obj);
+  struct slab_free *f = obj;
+
+  f->next = slab->free;
+  slab->free = f;
+  c->inuse--;
+
+  if (slab->inuse-- == slab->capacity) {
+    pal_list_add(&slab->node, &c->partial); /* was full */
+  }
+  if (slab->inuse == 0) {
+    pal_list_del(&slab->node);
+    if (!c->spare) {
+      c->spare = slab;
+    } else {
+      c->slabs--;
+      arena_give_slab(slab);
+    }
+  }
+}
+
+#ifdef CONFIG_PAL_POSIX_SLAB_TLS_CACHE
+/* Thread exit: return every cached object to its slab */
+static void
+slab_cache_flush(void *arg)
+{
+  struct slab_cache *caches = arg;
+
+  for (int cls = 0; cls < PAL_POOL_CLASSES; cls++) {
+    struct slab_class *c = &arena.classes[cls];
+    pthread_mutex_lock(&c->lock);
+    while (caches[cls].count) {
+      class_free(c, caches[cls].objs[--caches[cls].count]);
+    }
+    pthread_mutex_unlock(&c->lock);
+  }
+}
+
+static inline struct slab_cache *
+cache_get(int cls)
+{
+  /* Register for the flush at thread exit on first use */
+  if (!thread_cache_registered) {
+    pthread_setspecific(arena.cache_key, thread_cache);
+    thread_cache_registered = true;
+  }
+  return &thread_cache[cls];
+}
+
+static void *
+cache_alloc(int cls)
+{
+  struct slab_cache *cache = cache_get(cls);
+  struct slab_class *c = &arena.classes[cls];
+
+  if (cache->count) {
+    return cache->objs[--cache->count];
+  }
+
+  pthread_mutex_lock(&c->lock);
+  while (cache->count < SLAB_CACHE_BATCH) {
+    void *obj = class_alloc(c, cls);
+    if (!obj) {
+      break;
+    }
+    cache->objs[cache->count++] = obj;
+  }
+  pthread_mutex_unlock(&c->lock);
+
+  return cache->count ? cache->objs[--cache->count] : NULL;
+}
+
+static void
+cache_free(int cls, void *obj)
+{
+  struct slab_cache *cache = cache_get(cls);
+  struct slab_class *c = &arena.classes[cls];
+
+  if (cache->count == SLAB_CACHE_DEPTH) {
+    pthread_mutex_lock(&c->lock);
+    while (cache->count > SLAB_CACHE_DEPTH - SLAB_CACHE_BATCH) {
+      class_free(c, cache->objs[--cache->count]);
+    }
+    pthread_mutex_unlock(&c->lock);
+  }
+  cache->objs[cache->count++] = obj;
+}
+#endif
+
+void *
+pal_pool_alloc(size_t size)
+{
+  int cls;
+  void *obj;
+
+  /* libc directly: this file may not route through itself */
+  if (size > PAL_POOL_MAX_SIZE) {
+    return malloc(size);
+  }
+
+  pthread_once(&arena.once, slab_init);
+  cls = arena.class_of[(size + SLAB_GRANULE - 1) / SLAB_GRANULE];
+
+#ifdef CONFIG_PAL_POSIX_SLAB_TLS_CACHE
+  obj = cache_alloc(cls);
+#else
+  pthread_mutex_lock(&arena.classes[cls].lock);
+  obj = class_alloc(&arena.classes[cls], cls);
+  pthread_mutex_unlock(&arena.classes[cls].lock);
+#endif
+
+  return obj ? obj : malloc(size);
+}
+
+void
+pal_pool_free(void *ptr)
+{
+  int cls;
+
+  if (!slab_owns(ptr)) {
+    free(ptr); /* large, arena exhausted, or NULL */
+    return;
+  }
+
+  cls = slab_of(ptr)->cls;
+#ifdef CONFIG_PAL_POSIX_SLAB_TLS_CACHE
+  cache_free(cls, ptr);
+#else
+  pthread_mutex_lock(&arena.classes[cls].lock);
+  class_free(&arena.classes[cls], ptr);
+  pthread_mutex_unlock(&arena.classes[cls].lock);
+#endif
+}
+
+void
+pal_pool_stats(struct pal_pool_stats *stats)
+{
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+  pthread_once(&arena.once, slab_init);
+  memset(stats, 0, sizeof(*stats));
+  stats->reserved = arena.end - arena.base;
+
+  for (int cls = 0; cls < PAL_POOL_CLASSES; cls++) {
+    struct slab_class *c = &arena.classes[cls];
+    struct pal_pool_class_stats *s = &stats->classes[cls];
+
+    pthread_mutex_lock(&c->lock);
+    s->size = slab_class_size[cls];
+    s->slabs = c->slabs;
+    s->capacity = c->slabs * ((SLAB_SIZE - SLAB_HEADER) / s->size);
+    s->inuse = c->inuse;
+    pthread_mutex_unlock(&c->lock);
+
+    stats->committed += s->slabs * SLAB_SIZE;
+    stats->used += s->inuse * s->size;
+  }
+
+  pthread_mutex_lock(&arena.lock);
+  stats->free_slabs = arena.nfree;
+  stats->committed += arena.nfree * page;
+  pthread_mutex_unlock(&arena.lock);
+}
+
+void
+pal_pool_stats_print(FILE *out)
+{
+  struct pal_pool_stats stats;
+
+  pal_pool_stats(&stats);
+  fprintf(out,
+          "slab: %zu KiB committed, %zu KiB used (%.1f%% fragmented), "
+          "%zu free slabs, %zu MiB reserved\n",
+          stats.committed >> 10,
+          stats.used >> 10,
+          stats.committed
+              ? 100.0 * (1.0 - (double)stats.used / (double)stats.committed)
+              : 0.0,
+          stats.free_slabs,
+          stats.reserved >> 20);
+  for (int cls = 0; cls < PAL_POOL_CLASSES; cls++) {
+    struct pal_pool_class_stats *s = &stats.classes[cls];
+    if (s->slabs) {
+      fprintf(out,
+              "  %5zu B: %4zu slabs %8zu / %8zu objects\n",
+              s->size,
+              s->slabs,
+              s->inuse,
+              s->capacity);
+    }
+  }
+}
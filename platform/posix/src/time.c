@@ -66,3 +66,11 @@ pal_sleep(pal_timeout_t duration)
       ;
   }
 }
+
+int64_t
+pal_uptime_ns(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
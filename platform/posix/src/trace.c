@@ -0,0 +1,291 @@
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <qwiet/platform/posix/time.h>
+#include <qwiet/platform/posix/trace.h>
+
+_Static_assert((CONFIG_PAL_TRACE_RING_RECORDS &
+                (CONFIG_PAL_TRACE_RING_RECORDS - 1)) == 0,
+               "trace ring size must be a power of two");
+
+#define TRACE_FLUSH_MS 50
+
+bool pal_trace_enabled;
+_Thread_local struct pal_trace_ring *pal_trace_ring;
+
+static struct {
+  pthread_once_t once;
+  pthread_mutex_t lock; /* rings list and the output file */
+  pthread_key_t key;
+  struct pal_list_head rings;
+  FILE *out;
+  bool first;  /* no event written yet, so no separator */
+  bool stop;   /* tells the flusher to exit */
+  pthread_t flusher;
+  int pid;
+  int next_tid; /* trace ids are handed out in order of first use */
+  /* Cycle counter to trace time: two reference points, refreshed on
+   * every drain so the ratio improves as the session goes on */
+  uint64_t ticks0;
+  int64_t ns0;
+  double ns_per_tick;
+} trace = {.once = PTHREAD_ONCE_INIT, .lock = PTHREAD_MUTEX_INITIALIZER};
+
+static void
+trace_thread_exit(void *arg)
+{
+  struct pal_trace_ring *ring = arg;
+
+  /* The flusher frees it once drained */
+  __atomic_store_n(&ring->orphaned, true, __ATOMIC_RELEASE);
+}
+
+static void
+trace_init(void)
+{
+  pthread_key_create(&trace.key, trace_thread_exit);
+  pal_list_init(&trace.rings);
+  trace.pid = getpid();
+}
+
+struct pal_trace_ring *
+pal_trace_ring_attach(void)
+{
+  struct pal_trace_ring *ring;
+  int saved_errno = errno; /* callers trace around syscalls */
+
+  /* libc directly: the ring outlives the thread and is freed by the
+   * flusher, and allocation statistics should not count tracing */
+  ring = calloc(1,
+                sizeof(*ring) + CONFIG_PAL_TRACE_RING_RECORDS *
+                                    sizeof(struct pal_trace_record));
+  if (!ring) {
+    errno = saved_errno;
+    return NULL;
+  }
+
+  pthread_once(&trace.once, trace_init);
+  pthread_setspecific(trace.key, ring);
+  pthread_mutex_lock(&trace.lock);
+  ring->tid = ++trace.next_tid;
+  pal_list_add_tail(&ring->node, &trace.rings);
+  pthread_mutex_unlock(&trace.lock);
+
+  pal_trace_ring = ring;
+  errno = saved_errno;
+  return ring;
+}
+
+/**
+ * pal_trace_thread_name - name the calling thread in the trace
+ * @name: name, truncated to 15 characters
+ */
+void
+pal_trace_thread_name(const char *name)
+{
+  struct pal_trace_ring *ring = pal_trace_ring;
+
+  if (ring || (ring = pal_trace_ring_attach())) {
+    pthread_mutex_lock(&trace.lock);
+    snprintf(ring->thread_name, sizeof(ring->thread_name), "%s", name);
+    pthread_mutex_unlock(&trace.lock);
+  }
+}
+
+static void
+trace_calibrate(void)
+{
+  uint64_t ticks = pal_trace_ticks();
+  int64_t ns = pal_uptime_ns();
+
+  if (ticks > trace.ticks0 && ns > trace.ns0) {
+    trace.ns_per_tick =
+        (double)(ns - trace.ns0) / (double)(ticks - trace.ticks0);
+  }
+}
+
+static inline double
+trace_us(uint64_t ticks)
+{
+  return ((double)trace.ns0 +
+          (double)(int64_t)(ticks - trace.ticks0) * trace.ns_per_tick) /
+         1000.0;
+}
+
+/* Called with the lock held */
+static void
+trace_write(const struct pal_trace_ring *ring,
+            const struct pal_trace_record *rec)
+{
+  static const char phase[] = {
+      [PAL_TRACE_TYPE_BEGIN] = 'B',
+      [PAL_TRACE_TYPE_END] = 'E',
+      [PAL_TRACE_TYPE_INSTANT] = 'i',
+      [PAL_TRACE_TYPE_COUNTER] = 'C',
+  };
+
+  fprintf(trace.out,
+          "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+          "\"pid\":%d,\"tid\":%d",
+          trace.first ? "" : ",",
+          rec->name,
+          phase[rec->type],
+          trace_us(rec->ticks),
+          trace.pid,
+          ring->tid);
+  if (rec->type == PAL_TRACE_TYPE_COUNTER) {
+    fprintf(trace.out, ",\"args\":{\"value\":%lld}", (long long)rec->value);
+  } else if (rec->type == PAL_TRACE_TYPE_INSTANT) {
+    fputs(",\"s\":\"t\"", trace.out);
+  }
+  fputc('}', trace.out);
+  trace.first = false;
+}
+
+/* Called with the lock held */
+static void
+trace_write_thread_name(const struct pal_trace_ring *ring)
+{
+  if (ring->thread_name[0]) {
+    fprintf(trace.out,
+            "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+            "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            trace.first ? "" : ",",
+            trace.pid,
+            ring->tid,
+            ring->thread_name);
+    trace.first = false;
+  }
+}
+
+/* Called with the lock held */
+static void
+trace_drain(void)
+{
+  struct pal_trace_ring *ring, *tmp;
+
+  trace_calibrate();
+  pal_list_for_each_entry_safe(ring, tmp, &trace.rings, node)
+  {
+    bool orphaned = __atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE);
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->tail;
+    uint32_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+
+    for (; tail != head; tail++) {
+      trace_write(
+          ring, &ring->records[tail & (CONFIG_PAL_TRACE_RING_RECORDS - 1)]);
+    }
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+    if (dropped) {
+      struct pal_trace_record rec = {.ticks = pal_trace_ticks(),
+                                     .name = "trace.dropped",
+                                     .value = dropped,
+                                     .type = PAL_TRACE_TYPE_COUNTER};
+      trace_write(ring, &rec);
+    }
+    if (orphaned) {
+      trace_write_thread_name(ring);
+      pal_list_del(&ring->node);
+      free(ring);
+    }
+  }
+}
+
+static void *
+trace_flusher(void *arg)
+{
+  struct timespec period = {.tv_nsec = TRACE_FLUSH_MS * 1000000L};
+
+  (void)arg;
+  pthread_mutex_lock(&trace.lock);
+  while (!trace.stop) {
+    trace_drain();
+    pthread_mutex_unlock(&trace.lock);
+    nanosleep(&period, NULL);
+    pthread_mutex_lock(&trace.lock);
+  }
+  pthread_mutex_unlock(&trace.lock);
+  return NULL;
+}
+
+/**
+ * pal_trace_start - begin a session writing Chrome trace JSON to @path
+ * @path: output file, truncated
+ *
+ * Returns 0, or -1 if the file cannot be created or a session is running.
+ */
+int
+pal_trace_start(const char *path)
+{
+  struct pal_trace_ring *ring, *tmp;
+  FILE *out;
+
+  pthread_once(&trace.once, trace_init);
+  if (__atomic_load_n(&pal_trace_enabled, __ATOMIC_RELAXED) ||
+      !(out = fopen(path, "w"))) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&trace.lock);
+  /* Discard what was left since the last session */
+  pal_list_for_each_entry_safe(ring, tmp, &trace.rings, node)
+  {
+    if (__atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE)) {
+      pal_list_del(&ring->node);
+      free(ring);
+      continue;
+    }
+    ring->tail = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+  }
+  trace.out = out;
+  trace.first = true;
+  trace.stop = false;
+  trace.ticks0 = pal_trace_ticks();
+  trace.ns0 = pal_uptime_ns();
+  trace.ns_per_tick = 1.0;
+  fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+  pthread_mutex_unlock(&trace.lock);
+
+  if (pthread_create(&trace.flusher, NULL, trace_flusher, NULL)) {
+    fclose(out);
+    trace.out = NULL;
+    return -1;
+  }
+  __atomic_store_n(&pal_trace_enabled, true, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/**
+ * pal_trace_stop - end the session and complete the trace file
+ *
+ * Records made by other threads while this runs may be cut off.
+ */
+void
+pal_trace_stop(void)
+{
+  struct pal_trace_ring *ring;
+
+  if (!__atomic_exchange_n(&pal_trace_enabled, false, __ATOMIC_ACQ_REL)) {
+    return;
+  }
+
+  pthread_mutex_lock(&trace.lock);
+  trace.stop = true;
+  pthread_mutex_unlock(&trace.lock);
+  pthread_join(trace.flusher, NULL);
+
+  pthread_mutex_lock(&trace.lock);
+  trace_drain();
+  pal_list_for_each_entry(ring, &trace.rings, node)
+  {
+    trace_write_thread_name(ring);
+  }
+  fputs("\n]}\n", trace.out);
+  fclose(trace.out);
+  trace.out = NULL;
+  pthread_mutex_unlock(&trace.lock);
+}
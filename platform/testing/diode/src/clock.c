@@ -0,0 +1,329 @@
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "unity.h"
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/common/list.h>
+#include <qwiet/platform/testing/diode/clock.h>
+
+#ifdef CONFIG_PAL_POSIX_SEM
+#include <qwiet/platform/posix/sem.h>
+#endif
+
+#ifdef CONFIG_PAL_LINUX_TIMER
+#include <qwiet/platform/linux/timer.h>
+#endif
+
+/* A timer created in virtual mode, keyed by its (eventfd) descriptor */
+struct diode_timer {
+  struct pal_list_head node;
+  int fd;
+  int64_t due; /* virtual time of the next expiry, -1 when disarmed */
+  int64_t period;
+};
+
+static struct {
+  pthread_mutex_t lock;
+  bool enabled;
+  int64_t now;
+  struct pal_list_head timers;
+} __clock = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static inline bool
+clock_enabled(void)
+{
+  return __atomic_load_n(&__clock.enabled, __ATOMIC_ACQUIRE);
+}
+
+/* Called with the lock held */
+static void
+clock_advance(int64_t ns)
+{
+  struct diode_timer *t;
+
+  __clock.now += ns;
+  pal_list_for_each_entry(t, &__clock.timers, node)
+  {
+    uint64_t n = 1;
+    if (t->due < 0 || t->due > __clock.now) {
+      continue;
+    }
+    if (t->period) {
+      n += (__clock.now - t->due) / t->period;
+      t->due += (int64_t)n * t->period;
+    } else {
+      t->due = -1;
+    }
+    eventfd_write(t->fd, n);
+  }
+}
+
+void
+diode_clock_init(void)
+{
+  pthread_mutex_lock(&__clock.lock);
+  pal_list_init(&__clock.timers);
+  __clock.now = 0;
+  __atomic_store_n(&__clock.enabled, true, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&__clock.lock);
+}
+
+void
+diode_clock_cleanup(void)
+{
+  struct diode_timer *t, *n;
+
+  pthread_mutex_lock(&__clock.lock);
+  if (__clock.enabled) {
+    /* Timers the test did not clean up */
+    pal_list_for_each_entry_safe(t, n, &__clock.timers, node)
+    {
+      pal_list_del(&t->node);
+      pal_free(t);
+    }
+  }
+  __atomic_store_n(&__clock.enabled, false, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&__clock.lock);
+}
+
+void
+diode_clock_advance(pal_timeout_t duration)
+{
+  TEST_ASSERT_TRUE_MESSAGE(clock_enabled(), "virtual clock not initialized");
+  TEST_ASSERT_TRUE_MESSAGE(duration.ns >= 0, "cannot advance by forever");
+  pthread_mutex_lock(&__clock.lock);
+  clock_advance(duration.ns);
+  pthread_mutex_unlock(&__clock.lock);
+}
+
+/**
+ * diode_clock_next_expiry - virtual time of the earliest armed timer
+ *
+ * Returns -1 when no virtual timer is armed. For simulations that decide how
+ * far a blocked call may skip ahead.
+ */
+int64_t
+diode_clock_next_expiry(void)
+{
+  struct diode_timer *t;
+  int64_t next = -1;
+
+  if (!clock_enabled()) {
+    return -1;
+  }
+  pthread_mutex_lock(&__clock.lock);
+  pal_list_for_each_entry(t, &__clock.timers, node)
+  {
+    if (t->due >= 0 && (next < 0 || t->due < next)) {
+      next = t->due;
+    }
+  }
+  pthread_mutex_unlock(&__clock.lock);
+  return next;
+}
+
+int64_t
+__real_pal_uptime_ns(void);
+
+int64_t
+__wrap_pal_uptime_ns(void)
+{
+  int64_t now;
+
+  if (!clock_enabled()) {
+    return __real_pal_uptime_ns();
+  }
+  pthread_mutex_lock(&__clock.lock);
+  now = __clock.now;
+  pthread_mutex_unlock(&__clock.lock);
+  return now;
+}
+
+void
+__real_pal_sleep(pal_timeout_t duration);
+
+void
+__wrap_pal_sleep(pal_timeout_t duration)
+{
+  if (!clock_enabled()) {
+    __real_pal_sleep(duration);
+    return;
+  }
+  TEST_ASSERT_FALSE_MESSAGE(pal_timeout_is_forever(duration),
+                            "pal_sleep(PAL_FOREVER) in virtual time");
+  if (duration.ns > 0) {
+    diode_clock_advance(duration);
+  }
+}
+
+#ifdef CONFIG_PAL_POSIX_SEM
+int
+__real_pal_sem_wait(pal_sem_t *sem, pal_timeout_t timeout);
+
+int
+__wrap_pal_sem_wait(pal_sem_t *sem, pal_timeout_t timeout)
+{
+  int ret;
+
+  /* Waiting forever needs a post, not time: leave that to the semaphore */
+  if (!clock_enabled() || pal_timeout_is_forever(timeout) ||
+      pal_timeout_is_nowait(timeout)) {
+    return __real_pal_sem_wait(sem, timeout);
+  }
+  if ((ret = __real_pal_sem_wait(sem, PAL_NO_WAIT))) {
+    return ret;
+  }
+  diode_clock_advance(timeout);
+  return __real_pal_sem_wait(sem, PAL_NO_WAIT);
+}
+#endif
+
+#ifdef CONFIG_PAL_LINUX_TIMER
+void
+__real_pal_timer_init(pal_timer_t *timer);
+
+void
+__real_pal_timer_start_oneshot(pal_timer_t *timer, pal_timeout_t duration);
+
+void
+__real_pal_timer_start_periodic(pal_timer_t *timer,
+                                pal_timeout_t delay,
+                                pal_timeout_t period);
+
+void
+__real_pal_timer_stop(pal_timer_t *timer);
+
+int
+__real_pal_timer_wait_ready(pal_timer_t *timer, pal_timeout_t timeout);
+
+void
+__real_pal_timer_cleanup(pal_timer_t *timer);
+
+/* Called with the lock held */
+static struct diode_timer *
+clock_timer_find(pal_timer_t *timer)
+{
+  struct diode_timer *t;
+
+  if (!clock_enabled()) {
+    return NULL;
+  }
+  pal_list_for_each_entry(t, &__clock.timers, node)
+  {
+    if (t->fd == timer->fd) {
+      return t;
+    }
+  }
+  return NULL;
+}
+
+/* Re-arming discards pending expiries, as timerfd_settime() does */
+static bool
+clock_timer_arm(pal_timer_t *timer, int64_t delay, int64_t period)
+{
+  struct diode_timer *t;
+  eventfd_t discard;
+
+  pthread_mutex_lock(&__clock.lock);
+  if ((t = clock_timer_find(timer))) {
+    eventfd_read(t->fd, &discard);
+    t->due = delay > 0 ? __clock.now + delay : -1;
+    t->period = period > 0 ? period : 0;
+  }
+  pthread_mutex_unlock(&__clock.lock);
+  return t != NULL;
+}
+
+void
+__wrap_pal_timer_init(pal_timer_t *timer)
+{
+  struct diode_timer *t;
+
+  if (!clock_enabled()) {
+    __real_pal_timer_init(timer);
+    return;
+  }
+  timer->fd = eventfd(0, EFD_NONBLOCK);
+  TEST_ASSERT_TRUE_MESSAGE(timer->fd >= 0, "eventfd failed");
+  t = pal_malloc(sizeof(*t));
+  TEST_ASSERT_NOT_NULL(t);
+  t->fd = timer->fd;
+  t->due = -1;
+  t->period = 0;
+  pthread_mutex_lock(&__clock.lock);
+  pal_list_add_tail(&t->node, &__clock.timers);
+  pthread_mutex_unlock(&__clock.lock);
+}
+
+void
+__wrap_pal_timer_start_oneshot(pal_timer_t *timer, pal_timeout_t duration)
+{
+  if (!clock_timer_arm(timer, duration.ns, 0)) {
+    __real_pal_timer_start_oneshot(timer, duration);
+  }
+}
+
+void
+__wrap_pal_timer_start_periodic(pal_timer_t *timer,
+                                pal_timeout_t delay,
+                                pal_timeout_t period)
+{
+  if (!clock_timer_arm(timer, delay.ns, period.ns)) {
+    __real_pal_timer_start_periodic(timer, delay, period);
+  }
+}
+
+void
+__wrap_pal_timer_stop(pal_timer_t *timer)
+{
+  if (!clock_timer_arm(timer, 0, 0)) {
+    __real_pal_timer_stop(timer);
+  }
+}
+
+int
+__wrap_pal_timer_wait_ready(pal_timer_t *timer, pal_timeout_t timeout)
+{
+  struct diode_timer *t;
+  int64_t skip;
+  int ret;
+
+  pthread_mutex_lock(&__clock.lock);
+  if (!(t = clock_timer_find(timer))) {
+    pthread_mutex_unlock(&__clock.lock);
+    return __real_pal_timer_wait_ready(timer, timeout);
+  }
+  if (pal_timer_is_ready(timer)) {
+    ret = 1;
+    skip = 0;
+  } else if (t->due >= 0 && (pal_timeout_is_forever(timeout) ||
+                             t->due - __clock.now <= timeout.ns)) {
+    ret = 1;
+    skip = t->due - __clock.now;
+  } else if (pal_timeout_is_forever(timeout)) {
+    pthread_mutex_unlock(&__clock.lock);
+    TEST_FAIL_MESSAGE("waiting forever on a disarmed timer");
+    return -1;
+  } else {
+    ret = 0;
+    skip = timeout.ns;
+  }
+  clock_advance(skip);
+  pthread_mutex_unlock(&__clock.lock);
+  return ret;
+}
+
+void
+__wrap_pal_timer_cleanup(pal_timer_t *timer)
+{
+  struct diode_timer *t;
+
+  pthread_mutex_lock(&__clock.lock);
+  if ((t = clock_timer_find(timer))) {
+    pal_list_del(&t->node);
+    pal_free(t);
+  }
+  pthread_mutex_unlock(&__clock.lock);
+  __real_pal_timer_cleanup(timer);
+}
+#endif
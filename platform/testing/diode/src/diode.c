@@ -1,5 +1,11 @@
 #include "unity_mock_net.h"
+#include <qwiet/platform/testing/diode/clock.h>
 #include <qwiet/platform/testing/diode/net_poll.h>
+#include <qwiet/platform/testing/diode/net_sim.h>
+
+#ifdef CONFIG_PAL_LINUX_DRAWMODE
+#include <qwiet/platform/testing/diode/display/drawmode.h>
+#endif
 
 #ifdef CONFIG_PAL_LINUX_EVDEV
 #include "unity_mock_libevdev.h"
@@ -11,6 +17,9 @@ diode_init(void)
 {
   unity_mock_net_Init();
   diode_poll_init();
+#ifdef CONFIG_PAL_LINUX_DRAWMODE
+  diode_drawmode_init();
+#endif
 #ifdef CONFIG_PAL_LINUX_EVDEV
   unity_mock_libevdev_Init();
   diode_evdev_init();
@@ -20,8 +29,13 @@ diode_init(void)
 void
 diode_destroy(void)
 {
+  diode_clock_cleanup();
+  diode_netsim_cleanup();
   diode_poll_cleanup();
   unity_mock_net_Destroy();
+#ifdef CONFIG_PAL_LINUX_DRAWMODE
+  diode_drawmode_cleanup();
+#endif
 #ifdef CONFIG_PAL_LINUX_EVDEV
   diode_evdev_cleanup();
   unity_mock_libevdev_Destroy();
@@ -33,6 +47,9 @@ diode_verify(void)
 {
   unity_mock_net_Verify();
   diode_poll_verify();
+#ifdef CONFIG_PAL_LINUX_DRAWMODE
+  diode_drawmode_verify();
+#endif
 #ifdef CONFIG_PAL_LINUX_EVDEV
   unity_mock_libevdev_Verify();
   diode_evdev_verify();
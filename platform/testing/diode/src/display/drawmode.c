@@ -0,0 +1,57 @@
+#include "unity.h"
+#include <qwiet/platform/testing/diode/display/drawmode.h>
+#include <qwiet/platform/testing/diode/queue.h>
+
+_Static_assert(offsetof(struct drawmode_expectation, node) == 0,
+               "queue links through the first member");
+
+static struct diode_queue __queue;
+
+int
+diode_drawmode_set(void *ctx, enum pal_drawmode mode)
+{
+  struct drawmode_expectation *expect = diode_queue_peek(&__queue);
+  int ret;
+
+  (void)ctx;
+  TEST_ASSERT_NOT_NULL_MESSAGE(expect, "unexpected display mode switch");
+  TEST_ASSERT_EQUAL_INT(expect->mode, mode);
+  if (expect->ns >= 0) {
+    TEST_ASSERT_EQUAL_INT64(expect->ns, pal_uptime_ns());
+  }
+  ret = expect->ret;
+  diode_queue_pop(&__queue, expect);
+  return ret;
+}
+
+void
+diode_drawmode_init(void)
+{
+  diode_queue_init(&__queue, sizeof(struct drawmode_expectation));
+}
+
+void
+diode_drawmode_cleanup(void)
+{
+  diode_queue_cleanup(&__queue);
+}
+
+void
+diode_drawmode_verify(void)
+{
+  TEST_ASSERT_TRUE_MESSAGE(diode_queue_empty(&__queue),
+                           "display mode switched fewer times than expected");
+}
+
+struct drawmode_expectation *
+diode_drawmode_create_expectation(enum pal_drawmode mode,
+                                  pal_timeout_t at,
+                                  int ret)
+{
+  struct drawmode_expectation *e =
+      diode_queue_push(&__queue, sizeof(struct drawmode_expectation));
+  e->mode = mode;
+  e->ns = pal_timeout_is_forever(at) ? -1 : at.ns;
+  e->ret = ret;
+  return e;
+}
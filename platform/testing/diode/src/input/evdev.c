@@ -1,8 +1,22 @@
 #include "unity.h"
 #include "unity_mock_libevdev.h"
 #include <qwiet/platform/testing/diode/input/evdev.h>
+#include <qwiet/platform/testing/diode/private.h>
+#include <qwiet/platform/testing/diode/queue.h>
 
-static struct pal_list_head __list;
+_Static_assert(offsetof(struct evdev_expectation, node) == 0,
+               "queue links through the first member");
+
+static struct diode_queue __queue;
+
+static void
+__release(struct evdev_expectation *expect)
+{
+  if (expect->replay) {
+    diode_evdev_replay_close(expect->replay);
+  }
+  diode_queue_pop(&__queue, expect);
+}
 
 static int
 __verify_next_event(struct libevdev *dev,
@@ -10,66 +24,69 @@ __verify_next_event(struct libevdev *dev,
                     struct input_event *ev,
                     int ncalls)
 {
-  struct pal_list_head *node = NULL;
-  struct evdev_expectation *expect = NULL;
+  struct evdev_expectation *expect = diode_queue_peek(&__queue);
 
   (void)dev;
   (void)flags;
   (void)ncalls;
 
-  node = __list.next;
-  TEST_ASSERT_NOT_NULL_MESSAGE(node,
+  /* A replay stays at the head of the queue until its last event is read */
+  if (expect && expect->replay) {
+    struct evdev_replay *replay = expect->replay;
+    TEST_ASSERT_TRUE(diode_evdev_replay_next(replay, ev));
+    if (++replay->replayed == replay->events) {
+      __release(expect);
+    }
+    return LIBEVDEV_READ_STATUS_SUCCESS;
+  }
+
+  TEST_ASSERT_NOT_NULL_MESSAGE(expect,
                                "libevdev_next_event called but no "
                                "expectations queued");
 
-  expect = pal_list_entry(node, struct evdev_expectation, node);
-
   /* Only populate ev if returning an event (not -EAGAIN or error) */
   if (expect->ret >= 0) {
+    ev->time = expect->ev.time;
     ev->type = expect->ev.type;
     ev->code = expect->ev.code;
     ev->value = expect->ev.value;
   }
 
   int ret = expect->ret;
-  pal_list_del(&expect->node);
-  pal_free(expect);
+  __release(expect);
   return ret;
 }
 
 void
 diode_evdev_init(void)
 {
-  pal_list_init(&__list);
+  diode_queue_init(&__queue, sizeof(struct evdev_expectation));
   __wrap_libevdev_next_event_Stub(__verify_next_event);
 }
 
 void
 diode_evdev_cleanup(void)
 {
-  struct pal_list_head *pos, *n;
   struct evdev_expectation *expect;
 
-  pal_list_for_each_safe(pos, n, &__list)
-  {
-    pal_list_del(pos);
-    expect = pal_list_entry(pos, struct evdev_expectation, node);
-    pal_free(expect);
+  while ((expect = diode_queue_peek(&__queue))) {
+    __release(expect);
   }
+  diode_queue_cleanup(&__queue);
 }
 
 void
 diode_evdev_verify(void)
 {
   TEST_ASSERT_TRUE_MESSAGE(
-      pal_list_empty(&__list),
+      diode_queue_empty(&__queue),
       "libevdev_next_event called fewer times than expected");
 }
 
 struct evdev_expectation *
 diode_evdev_create_expectation(int ret, int type, int code, int value)
 {
-  struct evdev_expectation *e = pal_malloc(sizeof(*e));
+  struct evdev_expectation *e = diode_queue_push(&__queue, sizeof(*e));
 
   e->ret = ret;
   e->ev.type = type;
@@ -77,9 +94,20 @@ diode_evdev_create_expectation(int ret, int type, int code, int value)
   e->ev.value = value;
   e->ev.time.tv_sec = 0;
   e->ev.time.tv_usec = 0;
+  e->replay = NULL;
+
+  return e;
+}
+
+struct evdev_expectation *
+diode_evdev_create_replay(const char *path)
+{
+  struct evdev_expectation *e = diode_queue_push(&__queue, sizeof(*e));
 
-  pal_list_init(&e->node);
-  pal_list_add_tail(&e->node, &__list);
+  e->ret = LIBEVDEV_READ_STATUS_SUCCESS;
+  memset(&e->ev, 0, sizeof(e->ev));
+  e->replay = NULL; /* until the capture is open */
+  e->replay = diode_evdev_replay_open(path);
 
   return e;
 }
@@ -0,0 +1,283 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include <qwiet/platform/testing/diode/input/evdev.h>
+#include <qwiet/platform/testing/diode/private.h>
+
+/*
+ * Line parsers. The mapping is not NUL terminated, so every scan is bounded
+ * by the end of the line.
+ */
+
+static const char *
+skip_space(const char *p, const char *end)
+{
+  while (p < end && (*p == ' ' || *p == '\t')) {
+    p++;
+  }
+  return p;
+}
+
+static bool
+match(const char **p, const char *end, const char *s)
+{
+  size_t n = strlen(s);
+
+  if ((size_t)(end - *p) < n || memcmp(*p, s, n)) {
+    return false;
+  }
+  *p += n;
+  return true;
+}
+
+static bool
+parse_int(const char **p, const char *end, int base, long long *out)
+{
+  const char *s = skip_space(*p, end);
+  bool neg = false;
+  long long v = 0;
+  int digits = 0;
+
+  if (s < end && (*s == '-' || *s == '+')) {
+    neg = *s++ == '-';
+  }
+  for (; s < end; s++, digits++) {
+    int d;
+    if (*s >= '0' && *s <= '9') {
+      d = *s - '0';
+    } else if (base == 16 && (*s | 0x20) >= 'a' && (*s | 0x20) <= 'f') {
+      d = (*s | 0x20) - 'a' + 10;
+    } else {
+      break;
+    }
+    v = v * base + d;
+  }
+  if (!digits) {
+    return false;
+  }
+  *p = s;
+  *out = neg ? -v : v;
+  return true;
+}
+
+/* "12.000345": seconds and a decimal fraction of any precision */
+static bool
+parse_time(const char **p, const char *end, struct timeval *tv)
+{
+  long long sec, usec = 0;
+  int digits = 0;
+
+  if (!parse_int(p, end, 10, &sec) || !match(p, end, ".")) {
+    return false;
+  }
+  for (; *p < end && **p >= '0' && **p <= '9'; (*p)++, digits++) {
+    if (digits < 6) {
+      usec = usec * 10 + (**p - '0');
+    }
+  }
+  for (; digits < 6; digits++) {
+    usec *= 10;
+  }
+  tv->tv_sec = sec;
+  tv->tv_usec = usec;
+  return true;
+}
+
+/* Separator between fields: optional spaces and one @c */
+static bool
+expect_char(const char **p, const char *end, char c)
+{
+  *p = skip_space(*p, end);
+  if (*p < end && **p == c) {
+    (*p)++;
+    return true;
+  }
+  return false;
+}
+
+/* ", code 0": skip the rest of the previous field, then "@name N" */
+static bool
+parse_field(const char **p, const char *end, const char *name, long long *v)
+{
+  while (*p < end && **p != ',') {
+    (*p)++;
+  }
+  if (!expect_char(p, end, ',')) {
+    return false;
+  }
+  *p = skip_space(*p, end);
+  return match(p, end, name) && parse_int(p, end, 10, v);
+}
+
+/* evemu-record: "E: 0.012000 0003 0000 512" */
+static bool
+parse_evemu(const char *p, const char *end, struct input_event *ev)
+{
+  long long type, code, value;
+
+  if (!match(&p, end, "E:")) {
+    return false;
+  }
+  p = skip_space(p, end);
+  if (!parse_time(&p, end, &ev->time) || !parse_int(&p, end, 16, &type) ||
+      !parse_int(&p, end, 16, &code) || !parse_int(&p, end, 10, &value)) {
+    return false;
+  }
+  ev->type = type;
+  ev->code = code;
+  ev->value = value;
+  return true;
+}
+
+/* libevdev-record: "- [ 0, 12000, 3, 0, 512] # EV_ABS / ABS_X 512" */
+static bool
+parse_record(const char *p, const char *end, struct input_event *ev)
+{
+  long long sec, usec, type, code, value;
+
+  if (!match(&p, end, "-") || !expect_char(&p, end, '[')) {
+    return false;
+  }
+  if (!parse_int(&p, end, 10, &sec) || !expect_char(&p, end, ',') ||
+      !parse_int(&p, end, 10, &usec) || !expect_char(&p, end, ',') ||
+      !parse_int(&p, end, 10, &type) || !expect_char(&p, end, ',') ||
+      !parse_int(&p, end, 10, &code) || !expect_char(&p, end, ',') ||
+      !parse_int(&p, end, 10, &value) || !expect_char(&p, end, ']')) {
+    return false;
+  }
+  ev->time.tv_sec = sec;
+  ev->time.tv_usec = usec;
+  ev->type = type;
+  ev->code = code;
+  ev->value = value;
+  return true;
+}
+
+/*
+ * evtest:
+ *   "Event: time 0.012000, type 3 (EV_ABS), code 0 (ABS_X), value 512"
+ *   "Event: time 0.012000, -------------- SYN_REPORT ------------"
+ *   "Event: time 0.012000, ++++++++++++++ SYN_MT_REPORT ++++++++++++"
+ *   ">>>>>>>>>>>>>> SYN_DROPPED <<<<<<<<<<<<" (no timestamp)
+ */
+static bool
+parse_evtest(const char *p,
+             const char *end,
+             struct input_event *ev,
+             const struct timeval *last)
+{
+  long long type, code, value;
+
+  if (match(&p, end, ">>>")) {
+    ev->time = *last;
+    ev->type = EV_SYN;
+    ev->code = SYN_DROPPED;
+    ev->value = 0;
+    return true;
+  }
+  if (!match(&p, end, "Event: time") || !parse_time(&p, end, &ev->time) ||
+      !expect_char(&p, end, ',')) {
+    return false;
+  }
+  p = skip_space(p, end);
+  if (match(&p, end, "---") || match(&p, end, "+++")) {
+    while (p < end && (*p == '-' || *p == '+' || *p == ' ')) {
+      p++;
+    }
+    ev->type = EV_SYN;
+    ev->value = 0;
+    if (match(&p, end, "SYN_REPORT")) {
+      ev->code = SYN_REPORT;
+    } else if (match(&p, end, "SYN_CONFIG")) {
+      ev->code = SYN_CONFIG;
+    } else if (match(&p, end, "SYN_MT_REPORT")) {
+      ev->code = SYN_MT_REPORT;
+    } else {
+      return false;
+    }
+    return true;
+  }
+  if (!match(&p, end, "type") || !parse_int(&p, end, 10, &type) ||
+      !parse_field(&p, end, "code", &code) ||
+      !parse_field(&p, end, "value", &value)) {
+    return false;
+  }
+  ev->type = type;
+  ev->code = code;
+  ev->value = value;
+  return true;
+}
+
+static bool
+parse_line(const char *p,
+           const char *end,
+           struct input_event *ev,
+           const struct timeval *last)
+{
+  p = skip_space(p, end);
+  return parse_evemu(p, end, ev) || parse_record(p, end, ev) ||
+         parse_evtest(p, end, ev, last);
+}
+
+bool
+diode_evdev_replay_next(struct evdev_replay *replay, struct input_event *ev)
+{
+  while (replay->cur < replay->end) {
+    const char *line = replay->cur;
+    const char *eol = memchr(line, '\n', replay->end - line);
+    if (!eol) {
+      eol = replay->end;
+    }
+    replay->cur = eol < replay->end ? eol + 1 : eol;
+    if (parse_line(line, eol, ev, &replay->time)) {
+      replay->time = ev->time;
+      return true;
+    }
+  }
+  return false;
+}
+
+struct evdev_replay *
+diode_evdev_replay_open(const char *path)
+{
+  struct evdev_replay *replay = pal_malloc(sizeof(*replay));
+  struct input_event ev;
+  struct stat st;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+  TEST_ASSERT_NOT_NULL(replay);
+  TEST_ASSERT_TRUE_MESSAGE(fd >= 0, path);
+  TEST_ASSERT_TRUE_MESSAGE(fstat(fd, &st) == 0, path);
+
+  memset(replay, 0, sizeof(*replay));
+  replay->size = (size_t)st.st_size;
+  if (replay->size) {
+    replay->map = mmap(NULL, replay->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    TEST_ASSERT_TRUE_MESSAGE(replay->map != MAP_FAILED, path);
+    madvise(replay->map, replay->size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  /* One pass to count, so a test can tell how many reads to expect */
+  replay->cur = replay->map;
+  replay->end = replay->cur + replay->size;
+  while (diode_evdev_replay_next(replay, &ev)) {
+    replay->events++;
+  }
+  TEST_ASSERT_TRUE_MESSAGE(replay->events, "no events in capture");
+  replay->cur = replay->map;
+  memset(&replay->time, 0, sizeof(replay->time));
+  return replay;
+}
+
+void
+diode_evdev_replay_close(struct evdev_replay *replay)
+{
+  if (replay->map) {
+    munmap(replay->map, replay->size);
+  }
+  pal_free(replay);
+}
@@ -3,54 +3,50 @@
 #include <qwiet/platform/common.h>
 #include <qwiet/platform/common/list.h>
 #include <qwiet/platform/testing/diode/net_poll.h>
+#include <qwiet/platform/testing/diode/queue.h>
 
-static struct pal_list_head __list;
+/* Polls over up to this many descriptors fit a recycled queue slot */
+#define POLL_SLOT_FDS 4
+
+_Static_assert(offsetof(struct poll_expectation, node) == 0,
+               "queue links through the first member");
+
+static struct diode_queue __queue;
 
 static int
 __verify_poll(struct pollfd *fds, int nfds, pal_timeout_t timeout, int ncalls)
 {
   int ret, sz = sizeof(struct pollfd) * nfds;
-  struct pal_list_head *node = NULL;
-  struct poll_expectation *expect = NULL;
-  // NOTE we must wait for sem before reading list
-  // k_sem_take(&poll_ready, K_FOREVER);
-  node = __list.next;
-  TEST_ASSERT_NOT_NULL(node);
-  expect = pal_list_entry(node, struct poll_expectation, node);
+  struct poll_expectation *expect = diode_queue_peek(&__queue);
+  TEST_ASSERT_NOT_NULL(expect);
   TEST_ASSERT_EQUAL_INT(expect->nfds, nfds);
   TEST_ASSERT_EQUAL_INT(expect->ns, timeout.ns);
   TEST_ASSERT_EQUAL_MEMORY(fds, expect->fds, sz);
   memcpy(fds, &expect->fds[nfds], sz);
   ret = expect->ret;
-  pal_list_del(&expect->node);
-  pal_free(expect);
+  diode_queue_pop(&__queue, expect);
   return ret;
 }
 
 void
 diode_poll_init(void)
 {
-  pal_list_init(&__list);
+  diode_queue_init(&__queue,
+                   sizeof(struct poll_expectation) +
+                       sizeof(struct pollfd) * 2 * POLL_SLOT_FDS);
   __wrap_pal_net_socket_poll_Stub(__verify_poll);
 }
 
 void
 diode_poll_cleanup(void)
 {
-  struct pal_list_head *pos, *n;
-  struct poll_expectation *expectation;
-  pal_list_for_each_safe(pos, n, &__list)
-  {
-    pal_list_del(pos); // unlink from list (not really deleting anything)
-    expectation = pal_list_entry(pos, struct poll_expectation, node);
-    pal_free(expectation);
-  }
+  diode_queue_cleanup(&__queue);
 }
 
 void
 diode_poll_verify()
 {
-  TEST_ASSERT_TRUE_MESSAGE(pal_list_empty(&__list),
+  TEST_ASSERT_TRUE_MESSAGE(diode_queue_empty(&__queue),
                            "poll called fewer times than expected");
 }
 
@@ -65,7 +61,7 @@ diode_poll_create_expectation( //
 {
   va_list ap;
   int sz = sizeof(struct poll_expectation) + sizeof(struct pollfd) * (n << 1);
-  struct poll_expectation *r = pal_malloc(sz);
+  struct poll_expectation *r = diode_queue_push(&__queue, sz);
   struct pollfd *ptr;
   r->nfds = n;
   r->ns = timeout.ns;
@@ -111,9 +107,5 @@ diode_poll_create_expectation( //
     }
   }
   va_end(ap);
-
-  // Add this to our list to be free'd later when tests are complete
-  pal_list_init(&r->node);
-  pal_list_add(&r->node, &__list);
   return r;
 }
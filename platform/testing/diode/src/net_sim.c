@@ -0,0 +1,382 @@
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "unity_mock_net.h"
+#include <qwiet/platform/testing/diode/clock.h>
+#include <qwiet/platform/testing/diode/net_sim.h>
+
+/* Sends up to this size fit a recycled queue slot */
+#define NETSIM_SLOT_BYTES 2048
+
+/* Bytes sent in one call, delivered together */
+struct netsim_segment {
+  struct pal_list_head node;
+  int64_t arrival;
+  uint16_t len;
+  uint16_t off; /* already received */
+  uint8_t data[];
+};
+
+/* One direction of a pair */
+struct netsim_link {
+  struct diode_netsim_link cfg;
+  struct diode_queue segments; /* oldest first */
+  size_t queued;               /* bytes sent and not yet received */
+  int64_t wire_free;           /* when the link finishes serializing */
+};
+
+struct netsim_endpoint {
+  int fd; /* an eventfd, so the number is not reused while open */
+  bool closed;
+  unsigned int sends;
+  unsigned int recvs;
+  struct netsim_link *tx;
+  struct netsim_link *rx;
+  struct netsim_endpoint *peer;
+};
+
+struct netsim_pair {
+  struct pal_list_head node;
+  struct netsim_endpoint ends[2];
+  struct netsim_link links[2];
+};
+
+static struct pal_list_head __pairs;
+
+int
+__real_pal_net_send(int sock, const void *buf, uint16_t len, int flags);
+
+int
+__real_pal_net_recv(int sock, uint8_t *buf, uint16_t len, int flags);
+
+int
+__real_pal_net_socket_poll(struct pollfd *fds,
+                           int nfds,
+                           pal_timeout_t timeout);
+
+int
+__real_pal_net_socket_ready(int sock);
+
+int
+__real_pal_net_close(int sock);
+
+static struct netsim_endpoint *
+netsim_find(int fd)
+{
+  struct netsim_pair *pair;
+
+  pal_list_for_each_entry(pair, &__pairs, node)
+  {
+    for (int i = 0; i < 2; i++) {
+      if (!pair->ends[i].closed && pair->ends[i].fd == fd) {
+        return &pair->ends[i];
+      }
+    }
+  }
+  return NULL;
+}
+
+static bool
+netsim_inject_eagain(struct netsim_link *link, unsigned int *calls)
+{
+  unsigned int every = link->cfg.eagain_every;
+
+  if (every && ++*calls % every == 0) {
+    errno = EAGAIN;
+    return true;
+  }
+  return false;
+}
+
+static int
+netsim_send(int sock, const void *buf, uint16_t len, int flags, int ncalls)
+{
+  struct netsim_endpoint *ep = netsim_find(sock);
+  struct netsim_link *link;
+  struct netsim_segment *seg;
+  size_t space;
+  int64_t now;
+
+  (void)ncalls;
+  if (!ep) {
+    return __real_pal_net_send(sock, buf, len, flags);
+  }
+  link = ep->tx;
+  if (netsim_inject_eagain(link, &ep->sends)) {
+    return -1;
+  }
+  if (ep->peer->closed) {
+    errno = EPIPE;
+    return -1;
+  }
+  space = link->cfg.buffer - link->queued;
+  if (link->cfg.max_send && space > link->cfg.max_send) {
+    space = link->cfg.max_send;
+  }
+  if (!space) {
+    errno = EAGAIN;
+    return -1;
+  }
+  if (len > space) {
+    len = space;
+  }
+
+  seg = diode_queue_push(&link->segments, sizeof(*seg) + len);
+  memcpy(seg->data, buf, len);
+  seg->len = len;
+  seg->off = 0;
+
+  /* Serialized after whatever is still on the wire, then propagated */
+  now = pal_uptime_ns();
+  if (link->wire_free < now) {
+    link->wire_free = now;
+  }
+  if (link->cfg.bandwidth) {
+    link->wire_free += (int64_t)((len * 1000000000ULL + link->cfg.bandwidth -
+                                  1) /
+                                 link->cfg.bandwidth);
+  }
+  seg->arrival = link->wire_free + link->cfg.latency.ns;
+  link->queued += len;
+  return len;
+}
+
+static int
+netsim_recv(int sock, uint8_t *buf, uint16_t len, int flags, int ncalls)
+{
+  struct netsim_endpoint *ep = netsim_find(sock);
+  struct netsim_link *link;
+  struct netsim_segment *seg;
+  int64_t now = pal_uptime_ns();
+  uint16_t got = 0;
+
+  (void)ncalls;
+  if (!ep) {
+    return __real_pal_net_recv(sock, buf, len, flags);
+  }
+  link = ep->rx;
+  if (netsim_inject_eagain(link, &ep->recvs)) {
+    return -1;
+  }
+  if (link->cfg.max_recv && len > link->cfg.max_recv) {
+    len = link->cfg.max_recv;
+  }
+  while (got < len && (seg = diode_queue_peek(&link->segments)) &&
+         seg->arrival <= now) {
+    uint16_t n = seg->len - seg->off;
+    if (n > len - got) {
+      n = len - got;
+    }
+    memcpy(buf + got, seg->data + seg->off, n);
+    seg->off += n;
+    got += n;
+    link->queued -= n;
+    if (seg->off == seg->len) {
+      diode_queue_pop(&link->segments, seg);
+    }
+  }
+  if (got) {
+    return got;
+  }
+  if (ep->peer->closed && diode_queue_empty(&link->segments)) {
+    return 0; /* orderly shutdown */
+  }
+  errno = EAGAIN;
+  return -1;
+}
+
+static short
+netsim_revents(struct netsim_endpoint *ep, short events)
+{
+  struct netsim_segment *seg = diode_queue_peek(&ep->rx->segments);
+  short revents = 0;
+
+  if (ep->peer->closed && !seg) {
+    revents |= POLLHUP | (events & POLLIN);
+  } else if (seg && seg->arrival <= pal_uptime_ns()) {
+    revents |= events & POLLIN;
+  }
+  if (ep->peer->closed) {
+    revents |= events & POLLOUT ? POLLERR : 0;
+  } else if (ep->tx->queued < ep->tx->cfg.buffer) {
+    revents |= events & POLLOUT;
+  }
+  return revents;
+}
+
+/* Earliest arrival a poll over @fds could be waiting for, or -1 */
+static int64_t
+netsim_next_arrival(struct pollfd *fds, int nfds)
+{
+  int64_t next = -1;
+
+  for (int i = 0; i < nfds; i++) {
+    struct netsim_endpoint *ep = netsim_find(fds[i].fd);
+    struct netsim_segment *seg;
+    if (ep && (fds[i].events & POLLIN) &&
+        (seg = diode_queue_peek(&ep->rx->segments)) &&
+        (next < 0 || seg->arrival < next)) {
+      next = seg->arrival;
+    }
+  }
+  return next;
+}
+
+static int
+netsim_poll(struct pollfd *fds, int nfds, pal_timeout_t timeout, int ncalls)
+{
+  int64_t deadline;
+  int simulated = 0;
+
+  (void)ncalls;
+  for (int i = 0; i < nfds; i++) {
+    simulated += netsim_find(fds[i].fd) != NULL;
+  }
+  if (!simulated) {
+    return __real_pal_net_socket_poll(fds, nfds, timeout);
+  }
+  /* Real descriptors are only looked at; waiting is in virtual time */
+  if (simulated < nfds && !pal_timeout_is_nowait(timeout)) {
+    TEST_FAIL_MESSAGE("netsim poll cannot wait on simulated and real "
+                      "descriptors together");
+    return -1;
+  }
+
+  deadline = pal_uptime_ns() + timeout.ns;
+  for (;;) {
+    int64_t now = pal_uptime_ns(), next, timer;
+    int ready = 0;
+
+    for (int i = 0; i < nfds; i++) {
+      struct netsim_endpoint *ep = netsim_find(fds[i].fd);
+      if (ep) {
+        fds[i].revents = netsim_revents(ep, fds[i].events);
+      } else if (__real_pal_net_socket_poll(&fds[i], 1, PAL_NO_WAIT) < 0) {
+        return -1;
+      }
+      ready += fds[i].revents != 0;
+    }
+    if (ready || pal_timeout_is_nowait(timeout)) {
+      return ready;
+    }
+
+    next = netsim_next_arrival(fds, nfds);
+    timer = diode_clock_next_expiry();
+    if (timer >= 0 && (next < 0 || timer < next)) {
+      next = timer;
+    }
+    if (!pal_timeout_is_forever(timeout) && (next < 0 || deadline < next)) {
+      next = deadline;
+    }
+    if (next < 0) {
+      TEST_FAIL_MESSAGE("netsim poll would block forever");
+      return -1;
+    }
+    if (next <= now) {
+      return 0; /* only the deadline can be due already */
+    }
+    diode_clock_advance(PAL_NSEC(next - now));
+  }
+}
+
+static int
+netsim_ready(int sock, int ncalls)
+{
+  (void)ncalls;
+  return netsim_find(sock) ? 1 : __real_pal_net_socket_ready(sock);
+}
+
+static int
+netsim_close(int sock, int ncalls)
+{
+  struct netsim_endpoint *ep = netsim_find(sock);
+
+  (void)ncalls;
+  if (!ep) {
+    return __real_pal_net_close(sock);
+  }
+  ep->closed = true;
+  close(ep->fd);
+  return 0;
+}
+
+static void
+netsim_link_init(struct netsim_link *link, const struct diode_netsim_link *cfg)
+{
+  memset(link, 0, sizeof(*link));
+  if (cfg) {
+    link->cfg = *cfg;
+  }
+  if (!link->cfg.buffer) {
+    link->cfg.buffer = DIODE_NETSIM_BUFFER;
+  }
+  diode_queue_init(&link->segments,
+                   sizeof(struct netsim_segment) + NETSIM_SLOT_BYTES);
+}
+
+void
+diode_netsim_init(void)
+{
+  pal_list_init(&__pairs);
+  __wrap_pal_net_send_Stub(netsim_send);
+  __wrap_pal_net_recv_Stub(netsim_recv);
+  __wrap_pal_net_socket_poll_Stub(netsim_poll);
+  __wrap_pal_net_socket_ready_Stub(netsim_ready);
+  __wrap_pal_net_close_Stub(netsim_close);
+}
+
+void
+diode_netsim_cleanup(void)
+{
+  struct netsim_pair *pair, *n;
+
+  if (!__pairs.next) {
+    return; /* never initialized */
+  }
+  pal_list_for_each_entry_safe(pair, n, &__pairs, node)
+  {
+    for (int i = 0; i < 2; i++) {
+      if (!pair->ends[i].closed) {
+        close(pair->ends[i].fd);
+      }
+      diode_queue_cleanup(&pair->links[i].segments);
+    }
+    pal_list_del(&pair->node);
+    pal_free(pair);
+  }
+  memset(&__pairs, 0, sizeof(__pairs));
+}
+
+/**
+ * diode_netsim_pair - create two connected, simulated sockets
+ * @sv:     receives the descriptors
+ * @a_to_b: shaping of what sv[0] sends, NULL for an ideal link
+ * @b_to_a: shaping of what sv[1] sends, NULL for an ideal link
+ */
+void
+diode_netsim_pair(int sv[2],
+                  const struct diode_netsim_link *a_to_b,
+                  const struct diode_netsim_link *b_to_a)
+{
+  struct netsim_pair *pair = pal_malloc(sizeof(*pair));
+
+  TEST_ASSERT_NOT_NULL_MESSAGE(__pairs.next, "netsim not initialized");
+  TEST_ASSERT_NOT_NULL(pair);
+  netsim_link_init(&pair->links[0], a_to_b);
+  netsim_link_init(&pair->links[1], b_to_a);
+  for (int i = 0; i < 2; i++) {
+    struct netsim_endpoint *ep = &pair->ends[i];
+    ep->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    TEST_ASSERT_TRUE_MESSAGE(ep->fd >= 0, "eventfd failed");
+    ep->closed = false;
+    ep->sends = 0;
+    ep->recvs = 0;
+    ep->tx = &pair->links[i];
+    ep->rx = &pair->links[!i];
+    ep->peer = &pair->ends[!i];
+    sv[i] = ep->fd;
+  }
+  pal_list_add_tail(&pair->node, &__pairs);
+}
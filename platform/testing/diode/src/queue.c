@@ -0,0 +1,116 @@
+#include "unity.h"
+#include <qwiet/platform/testing/diode/queue.h>
+
+/* Precedes every slot; the expectation follows, suitably aligned */
+struct diode_slot {
+  _Alignas(max_align_t) bool heap; /* allocated alone, not from a chunk */
+};
+
+struct diode_chunk {
+  struct pal_list_head node;
+  _Alignas(max_align_t) unsigned char data[];
+};
+
+static inline size_t
+queue_stride(struct diode_queue *q)
+{
+  size_t align = _Alignof(max_align_t);
+  return sizeof(struct diode_slot) + ((q->size + align - 1) & ~(align - 1));
+}
+
+static inline struct diode_slot *
+queue_slot(void *expectation)
+{
+  return (struct diode_slot *)expectation - 1;
+}
+
+static void
+queue_grow(struct diode_queue *q)
+{
+  size_t stride = queue_stride(q);
+  struct diode_chunk *chunk;
+
+  chunk = pal_malloc(sizeof(*chunk) + stride * DIODE_QUEUE_CHUNK);
+  TEST_ASSERT_NOT_NULL_MESSAGE(chunk, "out of memory for expectations");
+  pal_list_add(&chunk->node, &q->chunks);
+  for (size_t i = 0; i < DIODE_QUEUE_CHUNK; i++) {
+    struct diode_slot *slot = (struct diode_slot *)&chunk->data[i * stride];
+    slot->heap = false;
+    pal_list_add_tail((struct pal_list_head *)(slot + 1), &q->free);
+  }
+}
+
+void
+diode_queue_init(struct diode_queue *q, size_t size)
+{
+  pal_list_init(&q->pending);
+  pal_list_init(&q->free);
+  pal_list_init(&q->chunks);
+  q->size = size;
+}
+
+void
+diode_queue_cleanup(struct diode_queue *q)
+{
+  struct pal_list_head *node, *n;
+
+  while (!diode_queue_empty(q)) {
+    diode_queue_pop(q, diode_queue_peek(q));
+  }
+  /* By node: the queue may be embedded where a chunk could not be, so
+   * never form a chunk pointer from the list head */
+  pal_list_for_each_safe(node, n, &q->chunks)
+  {
+    pal_list_del(node);
+    pal_free(pal_list_entry(node, struct diode_chunk, node));
+  }
+  pal_list_init(&q->free);
+}
+
+/**
+ * diode_queue_push - declare an expectation
+ * @q:    queue
+ * @size: size of the expectation, may exceed the queue's slot size
+ *
+ * Returns uninitialized storage, already at the back of the queue.
+ */
+void *
+diode_queue_push(struct diode_queue *q, size_t size)
+{
+  struct pal_list_head *node;
+  struct diode_slot *slot;
+
+  if (size > q->size) {
+    slot = pal_malloc(sizeof(*slot) + size);
+    TEST_ASSERT_NOT_NULL_MESSAGE(slot, "out of memory for expectations");
+    slot->heap = true;
+    node = (struct pal_list_head *)(slot + 1);
+  } else {
+    if (pal_list_empty(&q->free)) {
+      queue_grow(q);
+    }
+    node = q->free.next;
+    pal_list_del(node);
+  }
+  pal_list_add_tail(node, &q->pending);
+  return node;
+}
+
+/**
+ * diode_queue_pop - release a consumed expectation
+ * @q:           queue
+ * @expectation: pending expectation, normally diode_queue_peek()
+ */
+void
+diode_queue_pop(struct diode_queue *q, void *expectation)
+{
+  struct pal_list_head *node = expectation;
+  struct diode_slot *slot = queue_slot(expectation);
+
+  pal_list_del(node);
+  if (slot->heap) {
+    pal_free(slot);
+  } else {
+    pal_list_add(node, &q->free); /* reused first while still cached */
+  }
+}
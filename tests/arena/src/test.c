@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include <unity.h>
+
+#include <qwiet/platform/common/arena.h>
+
+#define CHUNK 4096
+
+static pal_arena_t arena;
+
+void
+setUp(void)
+{
+  pal_arena_init(&arena, CHUNK);
+}
+
+void
+tearDown(void)
+{
+  pal_arena_cleanup(&arena);
+}
+
+void
+test_arena_alloc_aligned(void)
+{
+  char *a = pal_arena_alloc(&arena, 1);
+  char *b = pal_arena_alloc_aligned(&arena, 3, 1);
+  char *c = pal_arena_alloc_aligned(&arena, 8, 64);
+
+  TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)a % PAL_ARENA_ALIGN);
+  TEST_ASSERT_EQUAL_PTR(a + 1, b);
+  TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)c % 64);
+  TEST_ASSERT_TRUE(c >= b + 3);
+
+  /* Oversized requests get their own chunk and keep the alignment */
+  char *big = pal_arena_alloc_aligned(&arena, CHUNK * 3, 256);
+  TEST_ASSERT_NOT_NULL(big);
+  TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)big % 256);
+  memset(big, 0xa5, CHUNK * 3);
+}
+
+void
+test_arena_alloc_oversize(void)
+{
+  char *a = pal_arena_alloc(&arena, 16);
+  size_t footprint = pal_arena_footprint(&arena);
+
+  /* Sizes whose chunk would wrap fail and leave the arena as it was */
+  TEST_ASSERT_NULL(pal_arena_alloc_aligned(&arena, SIZE_MAX - 4, 16));
+  TEST_ASSERT_NULL(pal_arena_alloc_aligned(&arena, SIZE_MAX, 1));
+  TEST_ASSERT_EQUAL_size_t(footprint, pal_arena_footprint(&arena));
+  TEST_ASSERT_EQUAL_PTR(a + 16, pal_arena_alloc(&arena, 16));
+}
+
+void
+test_arena_mark_rewind_reset(void)
+{
+  pal_arena_mark_t mark;
+  void *first, *again;
+  size_t footprint;
+
+  first = pal_arena_alloc(&arena, 100);
+  mark = pal_arena_mark(&arena);
+  again = pal_arena_alloc(&arena, 100);
+
+  /* Spill into further chunks past the mark */
+  for (int i = 0; i < 10; i++) {
+    TEST_ASSERT_NOT_NULL(pal_arena_alloc(&arena, CHUNK / 2));
+  }
+  footprint = pal_arena_footprint(&arena);
+  TEST_ASSERT_TRUE(footprint >= 5 * CHUNK);
+
+  pal_arena_rewind(&arena, mark);
+  TEST_ASSERT_EQUAL_PTR(again, pal_arena_alloc(&arena, 100));
+
+  pal_arena_reset(&arena);
+  TEST_ASSERT_EQUAL_PTR(first, pal_arena_alloc(&arena, 100));
+
+  /* A repeat of the same round reuses the chunks instead of growing */
+  for (int i = 0; i < 11; i++) {
+    TEST_ASSERT_NOT_NULL(pal_arena_alloc(&arena, CHUNK / 2));
+  }
+  TEST_ASSERT_EQUAL_size_t(footprint, pal_arena_footprint(&arena));
+
+  pal_arena_reset(&arena);
+  pal_arena_trim(&arena);
+  TEST_ASSERT_EQUAL_size_t(CHUNK, pal_arena_footprint(&arena));
+}
+
+void
+test_arena_static_buffer(void)
+{
+  static _Alignas(16) unsigned char buf[1024];
+  pal_arena_t fixed;
+  int n = 0;
+
+  pal_arena_init_static(&fixed, buf, sizeof(buf), 0);
+  while (pal_arena_alloc(&fixed, 64)) {
+    n++;
+  }
+  TEST_ASSERT_TRUE(n > 10 && n < 16);
+  TEST_ASSERT_EQUAL_size_t(0, pal_arena_footprint(&fixed) % 16);
+
+  /* Reset makes the whole buffer available again, with nothing to free */
+  pal_arena_reset(&fixed);
+  TEST_ASSERT_NOT_NULL(pal_arena_alloc(&fixed, 64));
+  pal_arena_cleanup(&fixed);
+
+  /* Allowed to grow, it spills into allocated chunks past the buffer */
+  pal_arena_init_static(&fixed, buf, sizeof(buf), CHUNK);
+  for (int i = 0; i < 100; i++) {
+    TEST_ASSERT_NOT_NULL(pal_arena_alloc(&fixed, 64));
+  }
+  TEST_ASSERT_TRUE(pal_arena_footprint(&fixed) > sizeof(buf));
+  pal_arena_cleanup(&fixed);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,182 @@
+#include <unity.h>
+
+#include <qwiet/platform/common/canvas.h>
+
+#define WIDTH 300 /* the last column of tiles is partly off the canvas */
+#define HEIGHT 200
+#define PITCH (WIDTH / 2)
+
+static pal_canvas_t canvas;
+static uint8_t ref_buf[PITCH * HEIGHT], buf[PITCH * HEIGHT];
+static pal_raster_fb_t ref = {ref_buf, WIDTH, HEIGHT, PITCH};
+static pal_raster_fb_t fb = {buf, WIDTH, HEIGHT, PITCH};
+static const pal_raster_pen_t pen = {.min_width = 2, .max_width = 8, .ink = 0};
+
+void
+setUp(void)
+{
+  pal_canvas_init(&canvas, WIDTH, HEIGHT, 15);
+  pal_raster_fill(&ref, 15);
+}
+
+void
+tearDown(void)
+{
+  pal_canvas_cleanup(&canvas);
+  TEST_ASSERT_EQUAL_size_t(0, canvas.ntiles);
+}
+
+static pal_raster_point_t
+pt(float x, float y)
+{
+  return (pal_raster_point_t){.x = x, .y = y, .pressure = 0.5f};
+}
+
+/* Draw on the canvas and on the flat reference alike */
+static void
+draw(pal_raster_point_t a, pal_raster_point_t b)
+{
+  pal_canvas_segment(&canvas, &pen, a, b);
+  pal_raster_segment(&ref, &pen, a, b);
+}
+
+static void
+assert_matches(const uint8_t *expect)
+{
+  pal_canvas_blit(&canvas, &fb, PAL_RECT(0, 0, WIDTH, HEIGHT));
+  TEST_ASSERT_EQUAL_MEMORY(expect, buf, sizeof(buf));
+}
+
+void
+test_canvas_blank(void)
+{
+  TEST_ASSERT_EQUAL_UINT32(5, canvas.cols);
+  TEST_ASSERT_EQUAL_UINT32(4, canvas.rows);
+  TEST_ASSERT_EQUAL_UINT8(15, pal_canvas_get(&canvas, 299, 199));
+  TEST_ASSERT_EQUAL_size_t(0, canvas.ntiles);
+  assert_matches(ref_buf);
+}
+
+void
+test_canvas_segment(void)
+{
+  /* Across the seams of four tiles, and off the right edge */
+  draw(pt(50, 50), pt(80, 70));
+  draw(pt(80, 70), pt(310, 70));
+  assert_matches(ref_buf);
+  TEST_ASSERT_EQUAL_UINT8(0, pal_canvas_get(&canvas, 64, 59));
+  TEST_ASSERT_EQUAL_size_t(7, canvas.ntiles);
+  TEST_ASSERT_NULL(pal_canvas_tile(&canvas, 0, 3));
+
+  /* Entirely off the canvas */
+  draw(pt(-50, -50), pt(-20, -20));
+  TEST_ASSERT_EQUAL_size_t(7, canvas.ntiles);
+}
+
+void
+test_canvas_damage(void)
+{
+  pal_rect_t hints[PAL_DAMAGE_HINTS];
+  pal_damage_t damage;
+  size_t n;
+
+  pal_damage_init(&damage, WIDTH, HEIGHT);
+  draw(pt(10, 10), pt(20, 20));
+  draw(pt(200, 150), pt(201, 150));
+  pal_canvas_damage(&canvas, &damage);
+  n = pal_damage_take(&damage, hints, PAL_DAMAGE_HINTS);
+  TEST_ASSERT_EQUAL_size_t(2, n);
+  TEST_ASSERT_TRUE(hints[0].x1 % 64 == 0 && hints[0].x2 - hints[0].x1 == 64);
+  TEST_ASSERT_TRUE(hints[1].x1 % 64 == 0 && hints[1].x2 - hints[1].x1 == 64);
+
+  /* Reported once */
+  pal_canvas_damage(&canvas, &damage);
+  TEST_ASSERT_TRUE(pal_damage_empty(&damage));
+}
+
+void
+test_canvas_undo_redo(void)
+{
+  static uint8_t first[sizeof(buf)], second[sizeof(buf)];
+  pal_canvas_history_t history;
+
+  pal_canvas_history_init(&history, &canvas, 8);
+  TEST_ASSERT_EQUAL_INT(-1, pal_canvas_undo(&history));
+
+  draw(pt(10, 10), pt(100, 100));
+  pal_canvas_commit(&history);
+  memcpy(first, ref_buf, sizeof(first));
+  draw(pt(100, 10), pt(10, 100));
+  pal_canvas_commit(&history);
+  memcpy(second, ref_buf, sizeof(second));
+
+  /* Uncommitted drawing is dropped by undo */
+  pal_canvas_segment(&canvas, &pen, pt(250, 150), pt(280, 190));
+  TEST_ASSERT_EQUAL_INT(0, pal_canvas_undo(&history));
+  assert_matches(first);
+  TEST_ASSERT_EQUAL_INT(0, pal_canvas_undo(&history));
+  pal_raster_fill(&ref, 15);
+  assert_matches(ref_buf);
+  TEST_ASSERT_EQUAL_INT(-1, pal_canvas_undo(&history));
+
+  TEST_ASSERT_EQUAL_INT(0, pal_canvas_redo(&history));
+  TEST_ASSERT_EQUAL_INT(0, pal_canvas_redo(&history));
+  assert_matches(second);
+  TEST_ASSERT_EQUAL_INT(-1, pal_canvas_redo(&history));
+
+  /* A new commit after an undo forgets the redo */
+  TEST_ASSERT_EQUAL_INT(0, pal_canvas_undo(&history));
+  pal_canvas_clear(&canvas);
+  pal_canvas_commit(&history);
+  TEST_ASSERT_EQUAL_INT(-1, pal_canvas_redo(&history));
+  TEST_ASSERT_EQUAL_INT(0, pal_canvas_undo(&history));
+  assert_matches(first);
+
+  pal_canvas_history_cleanup(&history);
+}
+
+void
+test_canvas_history_depth(void)
+{
+  pal_canvas_history_t history;
+  int undone = 0;
+
+  pal_canvas_history_init(&history, &canvas, 3);
+  for (int i = 0; i < 5; i++) {
+    draw(pt(10 + 40 * i, 10), pt(10 + 40 * i, 30));
+    pal_canvas_commit(&history);
+  }
+  while (pal_canvas_undo(&history) == 0) {
+    undone++;
+  }
+  TEST_ASSERT_EQUAL_INT(3, undone);
+  TEST_ASSERT_EQUAL_UINT8(0, pal_canvas_get(&canvas, 50, 20));
+  TEST_ASSERT_EQUAL_UINT8(15, pal_canvas_get(&canvas, 90, 20));
+  pal_canvas_history_cleanup(&history);
+}
+
+void
+test_canvas_history_memory(void)
+{
+  pal_canvas_history_t history;
+
+  /* 100 short strokes in one tile: each step keeps one tile, not a frame */
+  pal_canvas_history_init(&history, &canvas, 100);
+  for (int i = 0; i < 100; i++) {
+    draw(pt(80 + i % 20, 80 + i / 20 * 5), pt(81 + i % 20, 80 + i / 20 * 5));
+    pal_canvas_commit(&history);
+  }
+  TEST_ASSERT_EQUAL_size_t(100, canvas.ntiles);
+  assert_matches(ref_buf);
+  pal_canvas_history_cleanup(&history);
+  TEST_ASSERT_EQUAL_size_t(1, canvas.ntiles);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
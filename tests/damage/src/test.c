@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <unity.h>
+
+#include <qwiet/platform/common/damage.h>
+
+#define WIDTH 1872
+#define HEIGHT 1404
+
+static pal_damage_t damage;
+static pal_rect_t hints[PAL_DAMAGE_RECTS];
+
+void
+setUp(void)
+{
+  pal_damage_init(&damage, WIDTH, HEIGHT);
+}
+
+void
+tearDown(void)
+{
+}
+
+static bool
+covered(const pal_rect_t *rects, size_t n, int32_t x, int32_t y)
+{
+  for (size_t i = 0; i < n; i++) {
+    if (x >= rects[i].x1 && x < rects[i].x2 && y >= rects[i].y1 &&
+        y < rects[i].y2) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+test_damage_clip_and_empty(void)
+{
+  pal_damage_add(&damage, PAL_RECT(10, 10, 10, 20));
+  pal_damage_add(&damage, PAL_RECT(WIDTH, 0, WIDTH + 5, 5));
+  TEST_ASSERT_TRUE(pal_damage_empty(&damage));
+
+  pal_damage_add(&damage, PAL_RECT(-5, -5, 5, 5));
+  TEST_ASSERT_EQUAL(1, pal_damage_take(&damage, hints, PAL_DAMAGE_HINTS));
+  TEST_ASSERT_EQUAL_INT32(0, hints[0].x1);
+  TEST_ASSERT_EQUAL_INT32(0, hints[0].y1);
+  TEST_ASSERT_EQUAL_INT32(5, hints[0].x2);
+  TEST_ASSERT_EQUAL_INT32(5, hints[0].y2);
+  TEST_ASSERT_TRUE(pal_damage_empty(&damage));
+}
+
+void
+test_damage_merge_adjacent(void)
+{
+  /* A horizontal stroke: touching boxes fold into one */
+  for (int32_t x = 100; x < 1000; x += 10) {
+    pal_damage_add(&damage, PAL_RECT(x, 200, x + 10, 216));
+  }
+  TEST_ASSERT_EQUAL(1, pal_damage_take(&damage, hints, PAL_DAMAGE_HINTS));
+  TEST_ASSERT_EQUAL_INT32(100, hints[0].x1);
+  TEST_ASSERT_EQUAL_INT32(1000, hints[0].x2);
+  TEST_ASSERT_EQUAL_INT32(200, hints[0].y1);
+  TEST_ASSERT_EQUAL_INT32(216, hints[0].y2);
+}
+
+void
+test_damage_keep_distant(void)
+{
+  /* Merging opposite corners would refresh the whole panel */
+  pal_damage_add(&damage, PAL_RECT(0, 0, 32, 32));
+  pal_damage_add(&damage, PAL_RECT(WIDTH - 32, HEIGHT - 32, WIDTH, HEIGHT));
+  pal_damage_add(&damage, PAL_RECT(4, 4, 8, 8)); /* already covered */
+  TEST_ASSERT_EQUAL(2, pal_damage_take(&damage, hints, PAL_DAMAGE_HINTS));
+}
+
+void
+test_damage_bounded_hints(void)
+{
+  size_t n;
+
+  srand(7);
+  for (int i = 0; i < 500; i++) {
+    int32_t x = rand() % WIDTH, y = rand() % HEIGHT;
+    pal_damage_add(&damage, PAL_RECT(x, y, x + 1 + rand() % 20, y + 3));
+    TEST_ASSERT_TRUE(damage.count <= PAL_DAMAGE_RECTS);
+  }
+  n = pal_damage_take(&damage, hints, 4);
+  TEST_ASSERT_TRUE(n >= 1 && n <= 4);
+
+  /* Whatever was added is still covered */
+  srand(7);
+  for (int i = 0; i < 500; i++) {
+    int32_t x = rand() % WIDTH, y = rand() % HEIGHT;
+    int32_t x2 = x + 1 + rand() % 20, y2 = y + 3;
+    TEST_ASSERT_TRUE(covered(hints, n, x, y));
+    TEST_ASSERT_TRUE(covered(hints,
+                             n,
+                             (x2 < WIDTH ? x2 : WIDTH) - 1,
+                             (y2 < HEIGHT ? y2 : HEIGHT) - 1));
+  }
+}
+
+void
+test_damage_add_all(void)
+{
+  pal_damage_add(&damage, PAL_RECT(1, 1, 2, 2));
+  pal_damage_add_all(&damage);
+  pal_damage_add(&damage, PAL_RECT(5, 5, 6, 6));
+  TEST_ASSERT_EQUAL(1, pal_damage_take(&damage, hints, PAL_DAMAGE_HINTS));
+  TEST_ASSERT_EQUAL(WIDTH, hints[0].x2);
+  TEST_ASSERT_EQUAL(HEIGHT, hints[0].y2);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
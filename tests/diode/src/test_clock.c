@@ -0,0 +1,45 @@
+#include <stdbool.h>
+#include <unity.h>
+
+#include <qwiet/platform/posix/time.h>
+#include <qwiet/platform/testing/diode.h>
+
+void
+setUp(void)
+{
+  diode_init();
+  diode_clock_init();
+}
+
+void
+tearDown(void)
+{
+  diode_verify();
+  diode_destroy();
+}
+
+void
+test_diode_clock_advance(void)
+{
+  TEST_ASSERT_EQUAL_INT64(0, pal_uptime_ns());
+  diode_clock_advance(PAL_MSEC(5));
+  TEST_ASSERT_EQUAL_INT64(5000000, pal_uptime_ns());
+  diode_clock_advance(PAL_NO_WAIT);
+  TEST_ASSERT_EQUAL_INT64(5000000, pal_uptime_ns());
+}
+
+void
+test_diode_clock_sleep(void)
+{
+  pal_sleep(PAL_SEC(3600));
+  TEST_ASSERT_EQUAL_INT64(3600000000000LL, pal_uptime_ns());
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,132 @@
+#include <stdbool.h>
+#include <unity.h>
+
+#include <qwiet/platform/linux/drawmode.h>
+#include <qwiet/platform/testing/diode.h>
+#include <qwiet/platform/testing/diode/display/drawmode.h>
+
+static pal_drawmode_t dm;
+
+void
+setUp(void)
+{
+  diode_init();
+  diode_clock_init();
+  pal_drawmode_init(&dm, NULL, diode_drawmode_set, NULL);
+}
+
+void
+tearDown(void)
+{
+  pal_drawmode_cleanup(&dm);
+  diode_verify();
+  diode_destroy();
+}
+
+/* One stylus report every 5 ms for @ms */
+static void
+pen(bool touching, bool in_range, int ms)
+{
+  pal_stylus_sample_t s = {.touching = touching, .in_range = in_range};
+
+  for (int t = 0; t < ms; t += 5) {
+    pal_drawmode_feed(&dm, &s);
+    diode_clock_advance(PAL_MSEC(5));
+    if (pal_timer_is_ready(&dm.timer)) {
+      pal_drawmode_dispatch(&dm);
+    }
+  }
+}
+
+/* Let the idle timer run for @ms with no reports */
+static void
+idle(int ms)
+{
+  int64_t end = pal_uptime_ns() + PAL_MSEC(ms).ns;
+
+  while (pal_uptime_ns() < end &&
+         pal_timer_wait_ready(&dm.timer, PAL_NSEC(end - pal_uptime_ns())) ==
+             1) {
+    pal_drawmode_dispatch(&dm);
+  }
+}
+
+void
+test_drawmode_stroke(void)
+{
+  /* FAST on the second touching report, at 5 ms */
+  EXPECT_DRAWMODE_SET(PAL_DRAWMODE_FAST, PAL_MSEC(5));
+  pen(true, true, 500);
+  TEST_ASSERT_EQUAL_INT(PAL_DRAWMODE_FAST, pal_drawmode_get(&dm));
+
+  /* Last report at 495 ms, NORMAL 800 ms later */
+  EXPECT_DRAWMODE_SET(PAL_DRAWMODE_NORMAL, PAL_MSEC(1295));
+  pen(false, false, 5);
+  idle(2000);
+  TEST_ASSERT_EQUAL_INT(PAL_DRAWMODE_NORMAL, pal_drawmode_get(&dm));
+}
+
+void
+test_drawmode_hover_and_tap(void)
+{
+  /* Hovering and a one-report brush of the tip never go FAST */
+  pen(false, true, 200);
+  pen(true, true, 5);
+  pen(false, true, 200);
+  TEST_ASSERT_EQUAL_INT(PAL_DRAWMODE_NORMAL, pal_drawmode_get(&dm));
+}
+
+void
+test_drawmode_hysteresis(void)
+{
+  EXPECT_DRAWMODE_SET(PAL_DRAWMODE_FAST, DIODE_DRAWMODE_ANYTIME);
+  pen(true, true, 100);
+
+  /* Pauses between letters, pen lifted out of range: no flapping */
+  for (int i = 0; i < 5; i++) {
+    pen(false, false, 600);
+    pen(true, true, 100);
+  }
+  TEST_ASSERT_EQUAL_INT(PAL_DRAWMODE_FAST, pal_drawmode_get(&dm));
+
+  EXPECT_DRAWMODE_SET(PAL_DRAWMODE_NORMAL, DIODE_DRAWMODE_ANYTIME);
+  idle(1000);
+}
+
+void
+test_drawmode_hold(void)
+{
+  pal_drawmode_config_t cfg = {
+      .enter_samples = 1, .idle = PAL_MSEC(100), .hold = PAL_MSEC(500)};
+
+  pal_drawmode_cleanup(&dm);
+  pal_drawmode_init(&dm, &cfg, diode_drawmode_set, NULL);
+
+  /* A short stroke still stays FAST for hold */
+  EXPECT_DRAWMODE_SET(PAL_DRAWMODE_FAST, PAL_NO_WAIT);
+  EXPECT_DRAWMODE_SET(PAL_DRAWMODE_NORMAL, PAL_MSEC(500));
+  pen(true, true, 20);
+  idle(1000);
+}
+
+void
+test_drawmode_set_fails(void)
+{
+  /* A refused switch is retried on the next report */
+  EXPECT_DRAWMODE_SET_ERR(PAL_DRAWMODE_FAST, PAL_MSEC(5));
+  EXPECT_DRAWMODE_SET(PAL_DRAWMODE_FAST, PAL_MSEC(10));
+  pen(true, true, 15);
+  TEST_ASSERT_EQUAL_INT(PAL_DRAWMODE_FAST, pal_drawmode_get(&dm));
+
+  /* Cleanup returns the display to NORMAL */
+  EXPECT_DRAWMODE_SET(PAL_DRAWMODE_NORMAL, DIODE_DRAWMODE_ANYTIME);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
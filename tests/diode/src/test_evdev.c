@@ -1,4 +1,6 @@
 #include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
 #include <unity.h>
 
 #include <qwiet/platform/testing/diode.h>
@@ -112,6 +114,159 @@ test_diode_evdev_stylus_stroke(void)
   }
 }
 
+void
+test_diode_evdev_long_script(void)
+{
+  struct input_event ev;
+  const int strokes = 25000; /* 100k events */
+
+  for (int i = 0; i < strokes; i++) {
+    EXPECT_STYLUS_MOVE(i, i + 1, i + 2);
+  }
+  for (int i = 0; i < strokes; i++) {
+    libevdev_next_event(NULL, LIBEVDEV_READ_FLAG_NORMAL, &ev);
+    TEST_ASSERT_EQUAL_INT(i, ev.value);
+    libevdev_next_event(NULL, LIBEVDEV_READ_FLAG_NORMAL, &ev);
+    TEST_ASSERT_EQUAL_INT(i + 1, ev.value);
+    libevdev_next_event(NULL, LIBEVDEV_READ_FLAG_NORMAL, &ev);
+    TEST_ASSERT_EQUAL_INT(i + 2, ev.value);
+    libevdev_next_event(NULL, LIBEVDEV_READ_FLAG_NORMAL, &ev);
+    TEST_ASSERT_EQUAL_INT(SYN_REPORT, ev.code);
+  }
+}
+
+static char capture_path[32];
+
+/* Write @text to a temporary capture file */
+static const char *
+capture(const char *text)
+{
+  FILE *f;
+
+  strcpy(capture_path, "/tmp/diode-capture-XXXXXX");
+  close(mkstemp(capture_path));
+  f = fopen(capture_path, "w");
+  fputs(text, f);
+  fclose(f);
+  return capture_path;
+}
+
+static void
+expect_replayed(int type, int code, int value, long sec, long usec)
+{
+  struct input_event ev;
+  int ret = libevdev_next_event(NULL, LIBEVDEV_READ_FLAG_NORMAL, &ev);
+
+  TEST_ASSERT_EQUAL_INT(LIBEVDEV_READ_STATUS_SUCCESS, ret);
+  TEST_ASSERT_EQUAL_INT(type, ev.type);
+  TEST_ASSERT_EQUAL_INT(code, ev.code);
+  TEST_ASSERT_EQUAL_INT(value, ev.value);
+  TEST_ASSERT_EQUAL_INT(sec, ev.time.tv_sec);
+  TEST_ASSERT_EQUAL_INT(usec, ev.time.tv_usec);
+}
+
+void
+test_diode_evdev_replay_evemu(void)
+{
+  struct evdev_expectation *e;
+
+  e = EXPECT_EVDEV_REPLAY(capture("# EVEMU 1.3\n"
+                                  "N: Wacom Pen\n"
+                                  "E: 1.005000 0003 0000 -512\n"
+                                  "E: 1.005000 0000 0000 0\n"));
+  unlink(capture_path);
+  TEST_ASSERT_EQUAL_INT(2, e->replay->events);
+  expect_replayed(EV_ABS, ABS_X, -512, 1, 5000);
+  expect_replayed(EV_SYN, SYN_REPORT, 0, 1, 5000);
+}
+
+void
+test_diode_evdev_replay_record(void)
+{
+  EXPECT_EVDEV_REPLAY(capture("events:\n"
+                              "- evdev:\n"
+                              "    - [  0,   5000,   3,  24,   1200] # "
+                              "EV_ABS / ABS_PRESSURE 1200\n"
+                              "    - [  0,   5000,   0,   0,      0] # "
+                              "------------ SYN_REPORT (0) ----------"));
+  unlink(capture_path);
+  expect_replayed(EV_ABS, ABS_PRESSURE, 1200, 0, 5000);
+  expect_replayed(EV_SYN, SYN_REPORT, 0, 0, 5000);
+}
+
+void
+test_diode_evdev_replay_evtest(void)
+{
+  EXPECT_EVDEV_REPLAY(capture(
+      "Testing ... (interrupt to exit)\n"
+      "Event: time 1700000000.250000, type 1 (EV_KEY), code 330 (BTN_TOUCH), "
+      "value 1\n"
+      "Event: time 1700000000.250000, -------------- SYN_REPORT ------------\n"
+      ">>>>>>>>>>>>>> SYN_DROPPED <<<<<<<<<<<<\n"));
+  unlink(capture_path);
+  expect_replayed(EV_KEY, BTN_TOUCH, 1, 1700000000, 250000);
+  expect_replayed(EV_SYN, SYN_REPORT, 0, 1700000000, 250000);
+  expect_replayed(EV_SYN, SYN_DROPPED, 0, 1700000000, 250000);
+}
+
+void
+test_diode_evdev_replay_in_order(void)
+{
+  EXPECT_TOUCH_UP();
+  EXPECT_EVDEV_REPLAY(capture("E: 0.000000 0003 0001 7\n"));
+  unlink(capture_path);
+  EXPECT_EVDEV_EAGAIN();
+
+  expect_replayed(EV_KEY, BTN_TOUCH, 0, 0, 0);
+  expect_replayed(EV_SYN, SYN_REPORT, 0, 0, 0);
+  expect_replayed(EV_ABS, ABS_Y, 7, 0, 0);
+  TEST_ASSERT_EQUAL_INT(-1, libevdev_next_event(NULL, 0, NULL));
+}
+
+void
+test_diode_evdev_replay_throughput(void)
+{
+  struct input_event ev;
+  struct evdev_expectation *e;
+  const int reports = 200 * 60; /* a minute of pen at 200 Hz */
+  FILE *f;
+
+  strcpy(capture_path, "/tmp/diode-capture-XXXXXX");
+  close(mkstemp(capture_path));
+  f = fopen(capture_path, "w");
+  for (int i = 0; i < reports; i++) {
+    const int report[4][3] = {
+        {EV_ABS, ABS_X, i},
+        {EV_ABS, ABS_Y, i / 2},
+        {EV_ABS, ABS_PRESSURE, i % 4096},
+        {EV_SYN, SYN_REPORT, 0},
+    };
+    long us = i * 5000L;
+    for (int n = 0; n < 4; n++) {
+      fprintf(f,
+              "E: %ld.%06ld %04x %04x %d\n",
+              us / 1000000,
+              us % 1000000,
+              report[n][0],
+              report[n][1],
+              report[n][2]);
+    }
+  }
+  fclose(f);
+
+  e = EXPECT_EVDEV_REPLAY(capture_path);
+  unlink(capture_path);
+  TEST_ASSERT_EQUAL_INT(reports * 4, e->replay->events);
+  for (int i = 0; i < reports * 4; i++) {
+    libevdev_next_event(NULL, LIBEVDEV_READ_FLAG_NORMAL, &ev);
+    if (i % 4 == 0) {
+      TEST_ASSERT_EQUAL_INT(i / 4, ev.value);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(59, ev.time.tv_sec);
+  TEST_ASSERT_EQUAL_INT(995000, ev.time.tv_usec);
+}
+
 extern int
 unity_main(void);
 
@@ -0,0 +1,175 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include <qwiet/platform/posix/net.h>
+#include <qwiet/platform/posix/time.h>
+#include <qwiet/platform/testing/diode.h>
+
+void
+setUp(void)
+{
+  diode_init();
+  diode_clock_init();
+  diode_netsim_init();
+}
+
+void
+tearDown(void)
+{
+  diode_verify();
+  diode_destroy();
+}
+
+void
+test_diode_netsim_latency(void)
+{
+  struct diode_netsim_link link = {.latency = PAL_MSEC(10)};
+  struct pollfd pfd;
+  uint8_t buf[8];
+  int sv[2];
+
+  diode_netsim_pair(sv, &link, NULL);
+  TEST_ASSERT_EQUAL_INT(5, pal_net_send(sv[0], "hello", 5, 0));
+  TEST_ASSERT_EQUAL_INT(-1, pal_net_recv(sv[1], buf, sizeof(buf), 0));
+  TEST_ASSERT_EQUAL_INT(EAGAIN, errno);
+
+  pfd = (struct pollfd){.fd = sv[1], .events = POLLIN};
+  TEST_ASSERT_EQUAL_INT(1, pal_net_socket_poll(&pfd, 1, PAL_FOREVER));
+  TEST_ASSERT_EQUAL_INT64(10000000, pal_uptime_ns());
+  TEST_ASSERT_EQUAL_INT(5, pal_net_recv(sv[1], buf, sizeof(buf), 0));
+  TEST_ASSERT_EQUAL_MEMORY("hello", buf, 5);
+}
+
+void
+test_diode_netsim_poll_timeout(void)
+{
+  struct diode_netsim_link link = {.latency = PAL_SEC(1)};
+  struct pollfd pfd;
+  int sv[2];
+
+  diode_netsim_pair(sv, &link, NULL);
+  TEST_ASSERT_EQUAL_INT(1, pal_net_send(sv[0], "x", 1, 0));
+  pfd = (struct pollfd){.fd = sv[1], .events = POLLIN};
+  TEST_ASSERT_EQUAL_INT(0, pal_net_socket_poll(&pfd, 1, PAL_MSEC(250)));
+  TEST_ASSERT_EQUAL_INT64(250000000, pal_uptime_ns());
+}
+
+void
+test_diode_netsim_bandwidth(void)
+{
+  struct diode_netsim_link link = {.bandwidth = 1000000};
+  struct pollfd pfd;
+  uint8_t buf[1024] = {0};
+  size_t sent = 0, received = 0;
+  int sv[2], ret;
+
+  diode_netsim_pair(sv, &link, NULL);
+  while (sent < 64 * 1024) {
+    ret = pal_net_send(sv[0], buf, sizeof(buf), 0);
+    TEST_ASSERT_EQUAL_INT(sizeof(buf), ret);
+    sent += ret;
+  }
+  TEST_ASSERT_EQUAL_INT(-1, pal_net_send(sv[0], buf, sizeof(buf), 0));
+  TEST_ASSERT_EQUAL_INT(EAGAIN, errno);
+
+  pfd = (struct pollfd){.fd = sv[1], .events = POLLIN};
+  while (received < sent) {
+    TEST_ASSERT_EQUAL_INT(1, pal_net_socket_poll(&pfd, 1, PAL_FOREVER));
+    while ((ret = pal_net_recv(sv[1], buf, sizeof(buf), 0)) > 0) {
+      received += ret;
+    }
+  }
+  /* 65536 bytes at 1 MB/s */
+  TEST_ASSERT_EQUAL_INT64(65536000, pal_uptime_ns());
+}
+
+void
+test_diode_netsim_short_io(void)
+{
+  struct diode_netsim_link link = {.max_send = 3, .max_recv = 2};
+  uint8_t buf[8];
+  int sv[2];
+
+  diode_netsim_pair(sv, &link, NULL);
+  TEST_ASSERT_EQUAL_INT(3, pal_net_send(sv[0], "hello", 5, 0));
+  TEST_ASSERT_EQUAL_INT(2, pal_net_send(sv[0], "lo", 2, 0));
+  TEST_ASSERT_EQUAL_INT(2, pal_net_recv(sv[1], buf, sizeof(buf), 0));
+  TEST_ASSERT_EQUAL_INT(2, pal_net_recv(sv[1], buf + 2, sizeof(buf), 0));
+  TEST_ASSERT_EQUAL_INT(1, pal_net_recv(sv[1], buf + 4, sizeof(buf), 0));
+  TEST_ASSERT_EQUAL_MEMORY("hello", buf, 5);
+}
+
+void
+test_diode_netsim_eagain(void)
+{
+  struct diode_netsim_link link = {.eagain_every = 2};
+  int sv[2];
+
+  diode_netsim_pair(sv, &link, NULL);
+  TEST_ASSERT_EQUAL_INT(1, pal_net_send(sv[0], "a", 1, 0));
+  TEST_ASSERT_EQUAL_INT(-1, pal_net_send(sv[0], "b", 1, 0));
+  TEST_ASSERT_EQUAL_INT(EAGAIN, errno);
+  TEST_ASSERT_EQUAL_INT(1, pal_net_send(sv[0], "b", 1, 0));
+}
+
+void
+test_diode_netsim_close(void)
+{
+  struct pollfd pfd;
+  uint8_t buf[8];
+  int sv[2];
+
+  diode_netsim_pair(sv, NULL, NULL);
+  TEST_ASSERT_EQUAL_INT(2, pal_net_send(sv[0], "hi", 2, 0));
+  TEST_ASSERT_EQUAL_INT(0, pal_net_close(sv[0]));
+
+  /* Data sent before the close is still delivered, then end of stream */
+  pfd = (struct pollfd){.fd = sv[1], .events = POLLIN};
+  TEST_ASSERT_EQUAL_INT(1, pal_net_socket_poll(&pfd, 1, PAL_NO_WAIT));
+  TEST_ASSERT_EQUAL_INT(2, pal_net_recv(sv[1], buf, sizeof(buf), 0));
+  TEST_ASSERT_EQUAL_INT(0, pal_net_recv(sv[1], buf, sizeof(buf), 0));
+  TEST_ASSERT_EQUAL_INT(1, pal_net_socket_poll(&pfd, 1, PAL_NO_WAIT));
+  TEST_ASSERT_TRUE(pfd.revents & POLLHUP);
+
+  TEST_ASSERT_EQUAL_INT(-1, pal_net_send(sv[1], "x", 1, 0));
+  TEST_ASSERT_EQUAL_INT(EPIPE, errno);
+}
+
+void
+test_diode_netsim_real_poll(void)
+{
+  struct pollfd pfd;
+  struct timespec t0, t1;
+  int sv[2];
+
+  /* Descriptors the simulator does not own wait in wall time, not on the
+   * virtual clock */
+  TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+  pfd = (struct pollfd){.fd = sv[1], .events = POLLIN};
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  TEST_ASSERT_EQUAL_INT(0, pal_net_socket_poll(&pfd, 1, PAL_MSEC(50)));
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  TEST_ASSERT_TRUE((t1.tv_sec - t0.tv_sec) * 1000000000LL +
+                       (t1.tv_nsec - t0.tv_nsec) >=
+                   45000000LL);
+  TEST_ASSERT_EQUAL_INT64(0, pal_uptime_ns());
+
+  TEST_ASSERT_EQUAL_INT(1, write(sv[0], "x", 1));
+  TEST_ASSERT_EQUAL_INT(1, pal_net_socket_poll(&pfd, 1, PAL_FOREVER));
+  TEST_ASSERT_TRUE(pfd.revents & POLLIN);
+  close(sv[0]);
+  close(sv[1]);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -69,6 +69,35 @@ test_diode_poll_expect_ok(void)
   TEST_ASSERT_EQUAL_INT(POLLOUT, pfds[3].revents);
 }
 
+void
+test_diode_poll_expect_fifo(void)
+{
+  struct pollfd pfd = {.fd = 3, .events = POLLIN, .revents = 0};
+  struct pollfd many[8];
+
+  // Expectations are consumed in the order they were declared
+  EXPECT_NET_POLL_OK(PAL_MSEC(1), "i", "i", 3);
+  EXPECT_NET_POLL_OK(PAL_MSEC(2), "i", "x", 3);
+  EXPECT_NET_POLL_ERR(PAL_MSEC(3), "i", -1, 3);
+
+  // Larger than a queue slot, allocated on its own
+  EXPECT_NET_POLL_OK(
+      PAL_MSEC(4), "iiiiiiii", "iiiiiiii", 1, 2, 3, 4, 5, 6, 7, 8);
+
+  TEST_ASSERT_EQUAL_INT(1, pal_net_socket_poll(&pfd, 1, PAL_MSEC(1)));
+  TEST_ASSERT_EQUAL_INT(POLLIN, pfd.revents);
+  pfd.revents = 0;
+  TEST_ASSERT_EQUAL_INT(0, pal_net_socket_poll(&pfd, 1, PAL_MSEC(2)));
+  TEST_ASSERT_EQUAL_INT(0, pfd.revents);
+  TEST_ASSERT_EQUAL_INT(-1, pal_net_socket_poll(&pfd, 1, PAL_MSEC(3)));
+
+  for (int i = 0; i < 8; i++) {
+    many[i] = (struct pollfd){.fd = i + 1, .events = POLLIN, .revents = 0};
+  }
+  TEST_ASSERT_EQUAL_INT(8, pal_net_socket_poll(many, 8, PAL_MSEC(4)));
+  TEST_ASSERT_EQUAL_INT(POLLIN, many[7].revents);
+}
+
 extern int
 unity_main(void);
 
@@ -0,0 +1,234 @@
+#include <stdlib.h>
+#include <unity.h>
+
+#include <qwiet/platform/common/dither.h>
+
+#define WIDTH 301 /* not a multiple of 8, so rows end in a partial byte */
+#define HEIGHT 150
+#define PITCH 304
+
+static const enum pal_dither_method methods[] = {
+    PAL_DITHER_FLOYD, PAL_DITHER_BAYER, PAL_DITHER_BLUE_NOISE};
+static const enum pal_dither_depth depths[] = {
+    PAL_DITHER_Y1, PAL_DITHER_Y2, PAL_DITHER_Y4};
+
+static uint8_t in[PITCH * HEIGHT], ref_buf[PITCH * HEIGHT], buf[PITCH * HEIGHT];
+static const pal_dither_src_t src = {in, WIDTH, HEIGHT, PITCH};
+
+void
+setUp(void)
+{
+  memset(ref_buf, 0xa5, sizeof(ref_buf));
+  memset(buf, 0xa5, sizeof(buf));
+}
+
+void
+tearDown(void)
+{
+  pal_dither_select(PAL_DITHER_SCALAR);
+}
+
+static uint8_t
+level(const uint8_t *row, uint32_t x, enum pal_dither_depth depth)
+{
+  uint32_t bit = x * depth;
+  return (row[bit / 8] >> (bit % 8)) & ((1 << depth) - 1);
+}
+
+static void
+fill(uint8_t v)
+{
+  memset(in, v, sizeof(in));
+}
+
+void
+test_dither_flat(void)
+{
+  for (size_t m = 0; m < 3; m++) {
+    for (size_t d = 0; d < 3; d++) {
+      pal_dither_dst_t dst = {buf, PITCH, depths[d]};
+      uint8_t max = (1 << depths[d]) - 1;
+
+      memset(buf, 0xa5, sizeof(buf));
+      fill(0);
+      pal_dither(&src, &dst, methods[m]);
+      for (uint32_t y = 0; y < HEIGHT; y++) {
+        for (uint32_t x = 0; x < WIDTH; x++) {
+          TEST_ASSERT_EQUAL_UINT8(0, level(&buf[y * PITCH], x, depths[d]));
+        }
+      }
+      fill(255);
+      pal_dither(&src, &dst, methods[m]);
+      for (uint32_t y = 0; y < HEIGHT; y++) {
+        for (uint32_t x = 0; x < WIDTH; x++) {
+          TEST_ASSERT_EQUAL_UINT8(max, level(&buf[y * PITCH], x, depths[d]));
+        }
+        /* Nothing written past the row */
+        TEST_ASSERT_EQUAL_UINT8(0xa5,
+                                buf[y * PITCH + (WIDTH * depths[d] + 7) / 8]);
+      }
+    }
+  }
+}
+
+void
+test_dither_packing(void)
+{
+  pal_dither_dst_t dst = {buf, PITCH, PAL_DITHER_Y4};
+
+  /* Multiples of 17 are exact Y4 levels, so diffusion leaves them alone */
+  for (uint32_t y = 0; y < HEIGHT; y++) {
+    for (uint32_t x = 0; x < WIDTH; x++) {
+      in[y * PITCH + x] = (uint8_t)((x + y) % 16 * 17);
+    }
+  }
+  pal_dither(&src, &dst, PAL_DITHER_FLOYD);
+  TEST_ASSERT_EQUAL_HEX8(0x10, buf[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x32, buf[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x21, buf[PITCH]);
+  for (uint32_t y = 0; y < HEIGHT; y++) {
+    for (uint32_t x = 0; x < WIDTH; x++) {
+      TEST_ASSERT_EQUAL_UINT8((x + y) % 16, level(&buf[y * PITCH], x, 4));
+    }
+  }
+}
+
+/* Textbook serpentine Floyd-Steinberg over one band, in sixteenths */
+static void
+floyd_reference(uint8_t *out, uint32_t y0, uint32_t y1, int max)
+{
+  static int32_t err[HEIGHT][WIDTH + 2];
+
+  memset(err, 0, sizeof(err));
+  for (uint32_t y = y0; y < y1; y++) {
+    int dir = y & 1 ? -1 : 1;
+    for (int i = 0; i < WIDTH; i++) {
+      int x = dir > 0 ? i : WIDTH - 1 - i;
+      int v = in[y * PITCH + x] + ((err[y][x + 1] + 8) >> 4);
+      int q, e;
+
+      v = v < 0 ? 0 : v > 255 ? 255 : v;
+      q = (v * max + 127) / 255;
+      e = v - q * 255 / max;
+      out[y * WIDTH + x] = (uint8_t)q;
+      err[y][x + 1 + dir] += e * 7;
+      if (y + 1 < y1) {
+        err[y + 1][x + 1 - dir] += e * 3;
+        err[y + 1][x + 1] += e * 5;
+        err[y + 1][x + 1 + dir] += e;
+      }
+    }
+  }
+}
+
+void
+test_dither_floyd(void)
+{
+  static uint8_t expect[HEIGHT * WIDTH];
+  pal_dither_dst_t dst = {buf, PITCH, PAL_DITHER_Y2};
+
+  srand(3);
+  for (size_t i = 0; i < sizeof(in); i++) {
+    in[i] = (uint8_t)(i % PITCH * 255 / WIDTH + rand() % 32);
+  }
+  pal_dither(&src, &dst, PAL_DITHER_FLOYD);
+  for (uint32_t y = 0; y < HEIGHT; y += PAL_DITHER_BAND) {
+    uint32_t y1 = y + PAL_DITHER_BAND < HEIGHT ? y + PAL_DITHER_BAND : HEIGHT;
+    floyd_reference(expect, y, y1, 3);
+  }
+  for (uint32_t y = 0; y < HEIGHT; y++) {
+    for (uint32_t x = 0; x < WIDTH; x++) {
+      TEST_ASSERT_EQUAL_UINT8(expect[y * WIDTH + x],
+                              level(&buf[y * PITCH], x, PAL_DITHER_Y2));
+    }
+  }
+}
+
+void
+test_dither_mean(void)
+{
+  /* Each method keeps the average gray of a flat field */
+  for (size_t m = 0; m < 3; m++) {
+    for (uint32_t v = 32; v < 255; v += 48) {
+      pal_dither_dst_t dst = {buf, PITCH, PAL_DITHER_Y1};
+      uint32_t ones = 0;
+
+      fill(v);
+      pal_dither(&src, &dst, methods[m]);
+      for (uint32_t y = 0; y < 128; y++) {
+        for (uint32_t x = 0; x < 256; x++) {
+          ones += level(&buf[y * PITCH], x, PAL_DITHER_Y1);
+        }
+      }
+      TEST_ASSERT_UINT32_WITHIN(128 * 256 / 64, v * 128 * 256 / 255, ones);
+    }
+  }
+}
+
+void
+test_dither_kernels_match(void)
+{
+  srand(7);
+  for (size_t i = 0; i < sizeof(in); i++) {
+    in[i] = (uint8_t)rand();
+  }
+  for (int impl = PAL_DITHER_SSE2; impl <= PAL_DITHER_NEON; impl++) {
+    if (pal_dither_select(impl)) {
+      continue;
+    }
+    for (size_t m = 1; m < 3; m++) {
+      for (size_t d = 0; d < 3; d++) {
+        pal_dither_dst_t ref = {ref_buf, PITCH, depths[d]};
+        pal_dither_dst_t dst = {buf, PITCH, depths[d]};
+
+        pal_dither_select(PAL_DITHER_SCALAR);
+        pal_dither(&src, &ref, methods[m]);
+        pal_dither_select(impl);
+        pal_dither(&src, &dst, methods[m]);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(ref_buf,
+                                         buf,
+                                         sizeof(buf),
+                                         pal_dither_impl_name(impl));
+      }
+    }
+  }
+}
+
+void
+test_dither_bands(void)
+{
+  srand(11);
+  for (size_t i = 0; i < sizeof(in); i++) {
+    in[i] = (uint8_t)rand();
+  }
+
+  /* Bands out of order give the same frame */
+  for (size_t m = 0; m < 3; m++) {
+    pal_dither_dst_t ref = {ref_buf, PITCH, PAL_DITHER_Y2};
+    pal_dither_dst_t dst = {buf, PITCH, PAL_DITHER_Y2};
+    size_t n = pal_dither_nbands(&src);
+
+    pal_dither(&src, &ref, methods[m]);
+    pal_dither_bands(&src, &dst, methods[m], 1, n);
+    pal_dither_bands(&src, &dst, methods[m], 0, 1);
+    TEST_ASSERT_EQUAL_MEMORY(ref_buf, buf, sizeof(buf));
+
+#ifdef CONFIG_PAL_POSIX_POOL
+    pal_pool_t pool;
+    memset(buf, 0xa5, sizeof(buf));
+    pal_pool_init(&pool, 3);
+    pal_dither_parallel(&pool, &src, &dst, methods[m]);
+    pal_pool_cleanup(&pool);
+    TEST_ASSERT_EQUAL_MEMORY(ref_buf, buf, sizeof(buf));
+#endif
+  }
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,96 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <unity.h>
+
+#include <qwiet/platform/linux/drm.h>
+
+pal_drm_t test_drm;
+
+void
+setUp(void)
+{
+  memset(&test_drm, 0, sizeof(test_drm));
+  test_drm.fd = -1;
+}
+
+void
+tearDown(void)
+{
+  pal_drm_cleanup(&test_drm);
+}
+
+void
+test_drm_headless_buffers(void)
+{
+  pal_drm_buffer_t *buf;
+
+  TEST_ASSERT_EQUAL_INT(0, pal_drm_open_headless(&test_drm, 64, 48));
+  buf = pal_drm_back(&test_drm);
+  TEST_ASSERT_NOT_NULL(buf);
+  TEST_ASSERT_EQUAL_UINT32(64 * 4, buf->pitch);
+  TEST_ASSERT_EQUAL(64 * 4 * 48, buf->size);
+  buf->map[buf->size - 1] = 0xff;
+}
+
+void
+test_drm_headless_flip(void)
+{
+  pal_drm_buffer_t *first, *second;
+
+  TEST_ASSERT_EQUAL_INT(0, pal_drm_open_headless(&test_drm, 64, 48));
+  first = pal_drm_back(&test_drm);
+  TEST_ASSERT_EQUAL_INT(0, pal_drm_present(&test_drm));
+
+  /* Both buffers belong to the display until the flip lands */
+  TEST_ASSERT_NULL(pal_drm_back(&test_drm));
+  TEST_ASSERT_EQUAL_INT(-1, pal_drm_present(&test_drm));
+  TEST_ASSERT_EQUAL_INT(EBUSY, errno);
+
+  TEST_ASSERT_EQUAL_INT(1, pal_drm_dispatch(&test_drm));
+  TEST_ASSERT_EQUAL_UINT64(1, test_drm.flips);
+  second = pal_drm_back(&test_drm);
+  TEST_ASSERT_NOT_NULL(second);
+  TEST_ASSERT_TRUE(first != second);
+  TEST_ASSERT_EQUAL_INT(0, pal_drm_dispatch(&test_drm));
+}
+
+void
+test_drm_headless_wait_ready(void)
+{
+  TEST_ASSERT_EQUAL_INT(0, pal_drm_open_headless(&test_drm, 64, 48));
+  TEST_ASSERT_EQUAL_INT(1, pal_drm_wait_ready(&test_drm, PAL_NO_WAIT));
+  for (int i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL_INT(0, pal_drm_present(&test_drm));
+    TEST_ASSERT_EQUAL_INT(1, pal_drm_wait_ready(&test_drm, PAL_MSEC(100)));
+  }
+  TEST_ASSERT_EQUAL_UINT64(10, test_drm.flips);
+}
+
+void
+test_drm_card_flip(void)
+{
+  pal_drm_buffer_t *buf;
+
+  /* Needs a card with a connected output, e.g. `modprobe vkms` */
+  if (pal_drm_open(&test_drm, NULL)) {
+    TEST_IGNORE_MESSAGE("no DRM card available");
+  }
+  TEST_ASSERT_TRUE(test_drm.width > 0 && test_drm.height > 0);
+  for (int i = 0; i < 3; i++) {
+    buf = pal_drm_back(&test_drm);
+    TEST_ASSERT_NOT_NULL(buf);
+    memset(buf->map, 0x40 * i, buf->size);
+    TEST_ASSERT_EQUAL_INT(0, pal_drm_present(&test_drm));
+    TEST_ASSERT_EQUAL_INT(1, pal_drm_wait_ready(&test_drm, PAL_SEC(1)));
+  }
+  TEST_ASSERT_EQUAL_UINT64(3, test_drm.flips);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,137 @@
+#include <stdbool.h>
+#include <unity.h>
+
+#include <qwiet/platform/common/hashtable.h>
+
+#define ITEMS 5000
+
+struct test_item {
+  int key;
+  struct pal_hash_node hnode;
+};
+
+static pal_hashtable_t table;
+static struct test_item items[ITEMS];
+
+static bool
+item_eq(const struct pal_hash_node *node, const void *key)
+{
+  return PAL_CONTAINER_OF(node, struct test_item, hnode)->key ==
+         *(const int *)key;
+}
+
+static struct test_item *
+item_find(int key)
+{
+  struct pal_hash_node *node =
+      pal_hashtable_find(&table, pal_hash_u32(key), item_eq, &key);
+  return node ? PAL_CONTAINER_OF(node, struct test_item, hnode) : NULL;
+}
+
+static size_t
+table_walk_count(void)
+{
+  struct pal_hash_node *pos;
+  size_t bkt, n = 0;
+
+  pal_hashtable_for_each(&table, bkt, pos) { n++; }
+  return n;
+}
+
+void
+setUp(void)
+{
+  pal_hashtable_init(&table, 0);
+  for (int i = 0; i < ITEMS; i++) {
+    items[i].key = i * 7;
+  }
+}
+
+void
+tearDown(void)
+{
+  pal_hashtable_cleanup(&table);
+}
+
+void
+test_hashtable_add_find_del(void)
+{
+  for (int i = 0; i < 4; i++) {
+    pal_hashtable_add(&table, &items[i].hnode, pal_hash_u32(items[i].key));
+  }
+
+  TEST_ASSERT_EQUAL_size_t(4, pal_hashtable_count(&table));
+  TEST_ASSERT_EQUAL_PTR(&items[2], item_find(14));
+  TEST_ASSERT_NULL(item_find(15));
+
+  pal_hashtable_del(&table, &items[2].hnode);
+  TEST_ASSERT_NULL(item_find(14));
+  TEST_ASSERT_EQUAL_PTR(&items[3], item_find(21));
+  TEST_ASSERT_EQUAL_size_t(3, pal_hashtable_count(&table));
+}
+
+/*
+ * Lookups and iteration must see every entry at every point of a resize,
+ * including while entries are split across the old and new bucket arrays.
+ */
+void
+test_hashtable_incremental_rehash(void)
+{
+  bool saw_rehash = false;
+
+  for (int i = 0; i < ITEMS; i++) {
+    pal_hashtable_add(&table, &items[i].hnode, pal_hash_u32(items[i].key));
+    saw_rehash |= table.buckets[1] != NULL;
+
+    /* Spot check old and new entries instead of all, to keep this fast */
+    TEST_ASSERT_EQUAL_PTR(&items[i], item_find(items[i].key));
+    TEST_ASSERT_EQUAL_PTR(&items[i / 2], item_find(items[i / 2].key));
+    TEST_ASSERT_EQUAL_PTR(&items[0], item_find(0));
+    if ((i & 127) == 0) {
+      TEST_ASSERT_EQUAL_size_t(i + 1, table_walk_count());
+    }
+  }
+
+  TEST_ASSERT_TRUE(saw_rehash);
+  TEST_ASSERT_EQUAL_size_t(ITEMS, table_walk_count());
+  for (int i = 0; i < ITEMS; i++) {
+    TEST_ASSERT_EQUAL_PTR(&items[i], item_find(items[i].key));
+  }
+
+  /* Load factor stays at or below 2 even mid-rehash */
+  TEST_ASSERT_TRUE(pal_hashtable_count(&table) <= 2 * (table.mask[0] + 1));
+}
+
+void
+test_hashtable_for_each_safe_del(void)
+{
+  struct pal_hash_node *pos;
+  struct pal_hlist_node *tmp;
+  size_t bkt;
+
+  for (int i = 0; i < 100; i++) {
+    pal_hashtable_add(&table, &items[i].hnode, pal_hash_u32(items[i].key));
+  }
+
+  /* Drop the odd keys while walking */
+  pal_hashtable_for_each_safe(&table, bkt, tmp, pos)
+  {
+    if (PAL_CONTAINER_OF(pos, struct test_item, hnode)->key & 1) {
+      pal_hashtable_del(&table, pos);
+    }
+  }
+
+  TEST_ASSERT_EQUAL_size_t(50, pal_hashtable_count(&table));
+  TEST_ASSERT_EQUAL_size_t(50, table_walk_count());
+  TEST_ASSERT_NULL(item_find(7));
+  TEST_ASSERT_EQUAL_PTR(&items[2], item_find(14));
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
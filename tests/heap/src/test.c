@@ -0,0 +1,108 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unity.h>
+
+#include <qwiet/platform/common/heap.h>
+
+#define ITEMS 1000
+
+struct test_item {
+  int key;
+  struct pal_heap_node node;
+};
+
+static pal_heap_t heap;
+static struct test_item items[ITEMS];
+
+static bool
+item_less(const struct pal_heap_node *a, const struct pal_heap_node *b)
+{
+  return PAL_CONTAINER_OF(a, struct test_item, node)->key <
+         PAL_CONTAINER_OF(b, struct test_item, node)->key;
+}
+
+static int
+pop_key(void)
+{
+  struct pal_heap_node *node = pal_heap_pop(&heap);
+  TEST_ASSERT_NOT_NULL(node);
+  return PAL_CONTAINER_OF(node, struct test_item, node)->key;
+}
+
+void
+setUp(void)
+{
+  pal_heap_init(&heap, item_less, 0);
+  srand(4321);
+  for (int i = 0; i < ITEMS; i++) {
+    items[i].key = rand() % (ITEMS * 4);
+    pal_heap_node_init(&items[i].node);
+  }
+}
+
+void
+tearDown(void)
+{
+  pal_heap_cleanup(&heap);
+}
+
+void
+test_heap_pops_in_order(void)
+{
+  int prev = -1;
+
+  /* Pushes well past the initial capacity to exercise growth */
+  for (int i = 0; i < ITEMS; i++) {
+    pal_heap_push(&heap, &items[i].node);
+    TEST_ASSERT_TRUE(pal_heap_node_queued(&items[i].node));
+  }
+  TEST_ASSERT_EQUAL_size_t(ITEMS, pal_heap_count(&heap));
+
+  for (int i = 0; i < ITEMS; i++) {
+    int key = pop_key();
+    TEST_ASSERT_TRUE(key >= prev);
+    prev = key;
+  }
+  TEST_ASSERT_TRUE(pal_heap_empty(&heap));
+  TEST_ASSERT_NULL(pal_heap_pop(&heap));
+  TEST_ASSERT_FALSE(pal_heap_node_queued(&items[0].node));
+}
+
+void
+test_heap_remove_and_update(void)
+{
+  int prev = -1;
+
+  for (int i = 0; i < ITEMS; i++) {
+    pal_heap_push(&heap, &items[i].node);
+  }
+
+  /* Remove every third entry, reprioritize every fifth */
+  for (int i = 0; i < ITEMS; i += 3) {
+    pal_heap_remove(&heap, &items[i].node);
+    TEST_ASSERT_FALSE(pal_heap_node_queued(&items[i].node));
+  }
+  for (int i = 1; i < ITEMS; i += 5) {
+    if (pal_heap_node_queued(&items[i].node)) {
+      items[i].key = (i & 1) ? -i : items[i].key + ITEMS;
+      pal_heap_update(&heap, &items[i].node);
+    }
+  }
+
+  TEST_ASSERT_EQUAL_size_t(ITEMS - (ITEMS + 2) / 3, pal_heap_count(&heap));
+  prev = INT32_MIN;
+  while (!pal_heap_empty(&heap)) {
+    int key = pop_key();
+    TEST_ASSERT_TRUE(key >= prev);
+    prev = key;
+  }
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
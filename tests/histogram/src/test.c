@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <unity.h>
+
+#include <qwiet/platform/common/histogram.h>
+
+static pal_histogram_t a, b;
+
+void
+setUp(void)
+{
+  pal_histogram_reset(&a);
+  pal_histogram_reset(&b);
+}
+
+void
+tearDown(void)
+{
+}
+
+void
+test_histogram_buckets_cover_range(void)
+{
+  /* Every value lands in the bucket whose bounds contain it, and the
+   * buckets are contiguous */
+  for (size_t i = 1; i < PAL_HISTOGRAM_BUCKETS; i++) {
+    TEST_ASSERT_EQUAL_UINT64(__pal_histogram_upper(i - 1) + 1,
+                             __pal_histogram_lower(i));
+  }
+  for (uint64_t v = 1; v < (1ULL << PAL_HISTOGRAM_MAX_BITS); v = v * 3 + 1) {
+    size_t i = __pal_histogram_index(v);
+    TEST_ASSERT_TRUE(__pal_histogram_lower(i) <= v);
+    TEST_ASSERT_TRUE(__pal_histogram_upper(i) >= v);
+    /* Bucket width bounds the relative error */
+    TEST_ASSERT_TRUE((__pal_histogram_upper(i) - __pal_histogram_lower(i)) *
+                         PAL_HISTOGRAM_HALF <=
+                     v);
+  }
+  TEST_ASSERT_EQUAL_size_t(PAL_HISTOGRAM_BUCKETS - 1,
+                           __pal_histogram_index(UINT64_MAX));
+}
+
+void
+test_histogram_percentiles(void)
+{
+  uint64_t p50, p99;
+
+  /* 1..10000 us in ns */
+  for (uint64_t v = 1; v <= 10000; v++) {
+    pal_histogram_record(&a, v * 1000);
+  }
+  TEST_ASSERT_EQUAL_UINT64(10000, pal_histogram_count(&a));
+  TEST_ASSERT_EQUAL_UINT64(1000, a.min);
+  TEST_ASSERT_EQUAL_UINT64(10000000, a.max);
+
+  p50 = pal_histogram_percentile(&a, 50.0);
+  p99 = pal_histogram_percentile(&a, 99.0);
+  TEST_ASSERT_TRUE(p50 >= 5000000 && p50 <= 5000000 + 5000000 / 32);
+  TEST_ASSERT_TRUE(p99 >= 9900000 && p99 <= 9900000 + 9900000 / 32);
+  TEST_ASSERT_EQUAL_UINT64(10000000, pal_histogram_percentile(&a, 100.0));
+  /* The top of the lowest bucket, within its precision of min */
+  TEST_ASSERT_TRUE(pal_histogram_percentile(&a, 0.0) <= 1000 + 1000 / 32);
+  TEST_ASSERT_EQUAL_UINT64(0, pal_histogram_percentile(&b, 50.0));
+}
+
+void
+test_histogram_merge(void)
+{
+  /* A tail recorded on another instance shows up after the merge */
+  pal_histogram_record_n(&a, 96, 990);
+  pal_histogram_record_n(&b, 1000000, 10);
+  TEST_ASSERT_EQUAL_UINT64(96, pal_histogram_percentile(&a, 99.0));
+
+  pal_histogram_merge(&a, &b);
+  TEST_ASSERT_EQUAL_UINT64(1000, pal_histogram_count(&a));
+  TEST_ASSERT_EQUAL_UINT64(97, pal_histogram_percentile(&a, 50.0));
+  TEST_ASSERT_EQUAL_UINT64(1000000, pal_histogram_percentile(&a, 99.5));
+  TEST_ASSERT_EQUAL_UINT64(96, a.min);
+  TEST_ASSERT_EQUAL_UINT64(1000000, a.max);
+  TEST_ASSERT_TRUE(pal_histogram_mean(&a) > 10000.0);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,316 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include <qwiet/platform/posix/journal.h>
+
+#define CAPACITY (64 * 1024)
+
+static char path[] = "/tmp/qwiet_journal_XXXXXX";
+static const pal_journal_config_t manual = {.capacity = CAPACITY,
+                                            .interval = PAL_FOREVER};
+static pal_journal_t journal;
+
+void
+setUp(void)
+{
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  close(fd);
+}
+
+void
+tearDown(void)
+{
+  unlink(path);
+  strcpy(path, "/tmp/qwiet_journal_XXXXXX");
+}
+
+/* Record i holds i + 1 copies of the byte i */
+static void
+append(int i)
+{
+  uint8_t data[64];
+
+  memset(data, i, (size_t)i + 1);
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_append(&journal, 7, data, i + 1));
+}
+
+struct seen {
+  int count;
+  int stop_at;
+};
+
+static int
+check(void *ctx, const struct pal_journal_record *rec, const void *data)
+{
+  struct seen *seen = ctx;
+  uint8_t expect[64];
+
+  memset(expect, seen->count, sizeof(expect));
+  TEST_ASSERT_EQUAL_INT(7, rec->type);
+  TEST_ASSERT_EQUAL_UINT32(seen->count, rec->seq);
+  TEST_ASSERT_EQUAL_UINT32(seen->count + 1, rec->len);
+  TEST_ASSERT_EQUAL_MEMORY(expect, data, rec->len);
+  return ++seen->count == seen->stop_at;
+}
+
+static int
+replay(void)
+{
+  struct seen seen = {0, -1};
+  pal_journal_replay(&journal, check, &seen);
+  return seen.count;
+}
+
+/* Flip a byte of the file, as a torn write would leave it */
+static void
+corrupt(off_t off)
+{
+  int fd = open(path, O_RDWR);
+  uint8_t b;
+
+  TEST_ASSERT_EQUAL_INT(1, pread(fd, &b, 1, off));
+  b ^= 0x5a;
+  TEST_ASSERT_EQUAL_INT(1, pwrite(fd, &b, 1, off));
+  close(fd);
+}
+
+void
+test_journal_reopen(void)
+{
+  struct seen seen = {0, 3};
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_size_t(0, journal.recovered);
+  for (int i = 0; i < 10; i++) {
+    append(i);
+  }
+  TEST_ASSERT_EQUAL_INT(10, replay());
+  pal_journal_close(&journal);
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_size_t(10, journal.recovered);
+  append(10);
+  TEST_ASSERT_EQUAL_INT(11, replay());
+  TEST_ASSERT_EQUAL_size_t(3, pal_journal_replay(&journal, check, &seen));
+  pal_journal_close(&journal);
+}
+
+void
+test_journal_torn_record(void)
+{
+  size_t third = 0;
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  for (int i = 0; i < 5; i++) {
+    if (i == 2) {
+      third = journal.head;
+    }
+    append(i);
+  }
+  pal_journal_close(&journal);
+
+  /* The third record's payload is damaged: the two before it survive */
+  corrupt(third + sizeof(struct pal_journal_record));
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_size_t(2, journal.recovered);
+  TEST_ASSERT_EQUAL_size_t(third, journal.head);
+
+  /*
+   * A new third record of the same size lands exactly where the old one
+   * was; the old fourth and fifth still follow it, intact and numbered as
+   * the next ones, but from an older epoch, so they stay dead
+   */
+  append(2);
+  pal_journal_close(&journal);
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_size_t(3, journal.recovered);
+  TEST_ASSERT_EQUAL_INT(3, replay());
+  pal_journal_close(&journal);
+}
+
+void
+test_journal_epoch_wraps(void)
+{
+  uint32_t epoch = UINT32_MAX - 1;
+  int fd;
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  pal_journal_close(&journal);
+
+  /* The header's open count sits after the magic and version */
+  fd = open(path, O_RDWR);
+  TEST_ASSERT_EQUAL_INT(4, pwrite(fd, &epoch, 4, 12));
+  close(fd);
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, journal.epoch);
+  append(0);
+  append(1);
+  pal_journal_close(&journal);
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_UINT32(0, journal.epoch);
+  TEST_ASSERT_EQUAL_size_t(2, journal.recovered);
+  append(2);
+  pal_journal_close(&journal);
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_size_t(3, journal.recovered);
+  TEST_ASSERT_EQUAL_INT(3, replay());
+  pal_journal_close(&journal);
+}
+
+void
+test_journal_full(void)
+{
+  static uint8_t big[CAPACITY / 4];
+  int n = 0;
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  while (pal_journal_append(&journal, 1, big, sizeof(big)) == 0) {
+    n++;
+  }
+  TEST_ASSERT_EQUAL_INT(3, n);
+  TEST_ASSERT_EQUAL_INT(ENOSPC, errno);
+  TEST_ASSERT_EQUAL_INT(-1, pal_journal_append(&journal, 0, big, 1));
+  TEST_ASSERT_EQUAL_INT(EINVAL, errno);
+  pal_journal_close(&journal);
+
+  /* Not a journal */
+  corrupt(0);
+  TEST_ASSERT_EQUAL_INT(-1, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_INT(EINVAL, errno);
+}
+
+void
+test_journal_foreign_file(void)
+{
+  char buf[16] = {0};
+  struct stat st;
+  int fd = open(path, O_RDWR);
+
+  TEST_ASSERT_EQUAL_INT(12, write(fd, "not a journ", 12));
+  close(fd);
+
+  /* Refused without being resized or rewritten */
+  TEST_ASSERT_EQUAL_INT(-1, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_INT(EINVAL, errno);
+  TEST_ASSERT_EQUAL_INT(0, stat(path, &st));
+  TEST_ASSERT_EQUAL_INT64(12, st.st_size);
+  fd = open(path, O_RDONLY);
+  TEST_ASSERT_EQUAL_INT(12, read(fd, buf, sizeof(buf)));
+  close(fd);
+  TEST_ASSERT_EQUAL_STRING("not a journ", buf);
+}
+
+void
+test_journal_buffer(void)
+{
+  pal_journal_config_t cfg = manual;
+  uint8_t data[64];
+  uint32_t len = 0;
+  int fd, n = 0;
+
+  cfg.buffer = 256;
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &cfg));
+
+  /* Appends fill the buffer and stop short of records not yet synced */
+  for (;; n++) {
+    memset(data, n, (size_t)n + 1);
+    if (pal_journal_append(&journal, 7, data, n + 1)) {
+      break;
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(EAGAIN, errno);
+  TEST_ASSERT_TRUE(n > 4);
+
+  /* The file only sees them once synced */
+  fd = open(path, O_RDONLY);
+  TEST_ASSERT_EQUAL_INT(4, pread(fd, &len, 4, 68));
+  TEST_ASSERT_EQUAL_UINT32(0, len);
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_sync(&journal));
+  TEST_ASSERT_EQUAL_INT(4, pread(fd, &len, 4, 68));
+  TEST_ASSERT_EQUAL_UINT32(1, len);
+  close(fd);
+
+  /* Later records wrap around the buffer, some across its end */
+  for (int i = n; i < 48; i++) {
+    append(i);
+    TEST_ASSERT_EQUAL_INT(0, pal_journal_sync(&journal));
+  }
+  TEST_ASSERT_EQUAL_INT(48, replay());
+  pal_journal_close(&journal);
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &cfg));
+  TEST_ASSERT_EQUAL_size_t(48, journal.recovered);
+  TEST_ASSERT_EQUAL_INT(48, replay());
+  TEST_ASSERT_EQUAL_INT(-1, pal_journal_append(&journal, 7, data, 300));
+  TEST_ASSERT_EQUAL_INT(EINVAL, errno);
+  pal_journal_close(&journal);
+}
+
+void
+test_journal_group_commit(void)
+{
+  pal_journal_config_t cfg = {.capacity = CAPACITY,
+                              .interval = PAL_MSEC(5)};
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &cfg));
+  for (int i = 0; i < 20; i++) {
+    append(i);
+  }
+
+  /* The flusher picks up the whole batch */
+  for (int i = 0; i < 200 && pal_journal_synced(&journal) < journal.head;
+       i++) {
+    pal_sleep(PAL_MSEC(5));
+  }
+  TEST_ASSERT_EQUAL_size_t(journal.head, pal_journal_synced(&journal));
+
+  append(20);
+  pal_journal_flush(&journal);
+  for (int i = 0; i < 200 && pal_journal_synced(&journal) < journal.head;
+       i++) {
+    pal_sleep(PAL_MSEC(1));
+  }
+  TEST_ASSERT_EQUAL_size_t(journal.head, pal_journal_synced(&journal));
+  pal_journal_close(&journal);
+}
+
+#ifdef CONFIG_PAL_LINUX_STYLUS
+void
+test_journal_stroke(void)
+{
+  pal_stylus_sample_t samples[32];
+  const struct pal_journal_record *rec;
+
+  for (int i = 0; i < 32; i++) {
+    samples[i] = (pal_stylus_sample_t){.x = i, .y = 2 * i, .touching = 1};
+  }
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_append_stroke(&journal, samples, 32));
+  pal_journal_close(&journal);
+
+  TEST_ASSERT_EQUAL_INT(0, pal_journal_open(&journal, path, &manual));
+  TEST_ASSERT_EQUAL_size_t(1, journal.recovered);
+  rec = (const struct pal_journal_record *)(journal.map + 64);
+  TEST_ASSERT_EQUAL_INT(PAL_JOURNAL_STROKE, rec->type);
+  TEST_ASSERT_EQUAL_MEMORY(samples, rec + 1, sizeof(samples));
+  pal_journal_close(&journal);
+}
+#endif
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
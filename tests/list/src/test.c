@@ -57,6 +57,50 @@ test_list_sanity_check(void)
   TEST_ASSERT_TRUE(pal_list_empty(&test_list));
 }
 
+/*
+ * Sanity check for the single-pointer-head hlist.
+ */
+void
+test_hlist_sanity_check(void)
+{
+  struct test_hitem {
+    int value;
+    struct pal_hlist_node node;
+  } items[3];
+  struct test_hitem *pos;
+  struct pal_hlist_node *n;
+  PAL_HLIST_HEAD(head);
+  int order[3], i = 0;
+
+  for (int k = 0; k < 3; k++) {
+    items[k].value = k + 1;
+    pal_hlist_node_init(&items[k].node);
+    TEST_ASSERT_TRUE(pal_hlist_unhashed(&items[k].node));
+  }
+
+  /* add_head pushes to the front; add_behind inserts after a node */
+  pal_hlist_add_head(&items[0].node, &head);
+  pal_hlist_add_head(&items[2].node, &head);
+  pal_hlist_add_behind(&items[1].node, &items[2].node);
+  TEST_ASSERT_EQUAL_size_t(3, pal_hlist_count_nodes(&head));
+
+  pal_hlist_for_each_entry(pos, &head, node) { order[i++] = pos->value; }
+  TEST_ASSERT_EQUAL_INT(3, order[0]);
+  TEST_ASSERT_EQUAL_INT(2, order[1]);
+  TEST_ASSERT_EQUAL_INT(1, order[2]);
+
+  /* O(1) delete of the middle node through pprev */
+  pal_hlist_del_init(&items[1].node);
+  TEST_ASSERT_TRUE(pal_hlist_unhashed(&items[1].node));
+  TEST_ASSERT_EQUAL_size_t(2, pal_hlist_count_nodes(&head));
+
+  pal_hlist_for_each_entry_safe(pos, n, &head, node)
+  {
+    pal_hlist_del(&pos->node);
+  }
+  TEST_ASSERT_TRUE(pal_hlist_empty(&head));
+}
+
 extern int
 unity_main(void);
 
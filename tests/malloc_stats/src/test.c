@@ -0,0 +1,80 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/posix/malloc_stats.h>
+
+static struct pal_malloc_stats before;
+
+static void *
+alloc_here(size_t size)
+{
+  return pal_malloc(size);
+}
+
+void
+setUp(void)
+{
+  pal_malloc_stats(&before);
+}
+
+void
+tearDown(void)
+{
+}
+
+void
+test_malloc_stats_counts_site(void)
+{
+  struct pal_malloc_stats after;
+  void *p[4];
+
+  for (int i = 0; i < 4; i++) {
+    p[i] = alloc_here(100);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)p[i] % _Alignof(max_align_t));
+    memset(p[i], 0, 100);
+  }
+  pal_malloc_stats(&after);
+  TEST_ASSERT_EQUAL_UINT64(before.allocs + 4, after.allocs);
+  TEST_ASSERT_EQUAL_INT64(before.live + 400, after.live);
+  TEST_ASSERT_TRUE(after.peak >= after.live);
+
+  for (int i = 0; i < 4; i++) {
+    pal_free(p[i]);
+  }
+  pal_free(NULL);
+  pal_malloc_stats(&after);
+  TEST_ASSERT_EQUAL_UINT64(before.frees + 4, after.frees);
+  TEST_ASSERT_EQUAL_INT64(before.live, after.live);
+  TEST_ASSERT_TRUE(after.peak >= before.live + 400);
+}
+
+void
+test_malloc_stats_report_names_site(void)
+{
+  char buf[4096] = {0};
+  FILE *out = tmpfile();
+  void *leak = alloc_here(32);
+
+  TEST_ASSERT_NOT_NULL(out);
+  pal_malloc_stats_print(out);
+  rewind(out);
+  fread(buf, 1, sizeof(buf) - 1, out);
+  fclose(out);
+
+  /* The site is reported with the bytes it still holds */
+  TEST_ASSERT_NOT_NULL(strstr(buf, "(alloc_here)"));
+  TEST_ASSERT_NOT_NULL(strstr(buf, "allocs/s"));
+  pal_free(leak);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,103 @@
+#include <errno.h>
+#include <pthread.h>
+#include <unity.h>
+
+#include <qwiet/platform/posix/metrics.h>
+#include <qwiet/platform/posix/sem.h>
+
+#define WAITS 100
+
+static pal_sem_t ping, pong;
+
+static void *
+ponger(void *arg)
+{
+  (void)arg;
+  for (int i = 0; i < WAITS; i++) {
+    pal_sem_wait(&ping, PAL_FOREVER);
+    pal_sem_post(&pong);
+  }
+  return NULL; /* its histograms are merged on exit */
+}
+
+void
+setUp(void)
+{
+  pal_metrics_reset();
+  pal_sem_init(&ping, 0);
+  pal_sem_init(&pong, 0);
+}
+
+void
+tearDown(void)
+{
+  pal_sem_destroy(&ping);
+  pal_sem_destroy(&pong);
+}
+
+void
+test_metrics_merge_threads(void)
+{
+  pal_histogram_t h;
+  pthread_t thread;
+
+  pthread_create(&thread, NULL, ponger, NULL);
+  for (int i = 0; i < WAITS; i++) {
+    pal_sem_post(&ping);
+    pal_sem_wait(&pong, PAL_FOREVER);
+  }
+  pthread_join(thread, NULL);
+
+  /* Both sides of the ping-pong, including the exited thread */
+  pal_metrics_snapshot(PAL_METRIC_SEM_WAIT, &h);
+  TEST_ASSERT_EQUAL_UINT64(2 * WAITS, pal_histogram_count(&h));
+  TEST_ASSERT_TRUE(pal_histogram_percentile(&h, 99.0) <= h.max);
+
+  pal_metrics_reset();
+  pal_metrics_snapshot(PAL_METRIC_SEM_WAIT, &h);
+  TEST_ASSERT_EQUAL_UINT64(0, pal_histogram_count(&h));
+}
+
+void
+test_metrics_records_timeouts(void)
+{
+  pal_histogram_t h;
+
+  TEST_ASSERT_EQUAL_INT(0, pal_sem_wait(&ping, PAL_MSEC(5)));
+  pal_metrics_snapshot(PAL_METRIC_SEM_WAIT, &h);
+  TEST_ASSERT_EQUAL_UINT64(1, pal_histogram_count(&h));
+  TEST_ASSERT_TRUE(h.min >= 5000000);
+}
+
+static void *
+recorder(void *arg)
+{
+  int *seen = arg;
+
+  /* The thread's first record also allocates its histograms */
+  PAL_METRIC_BEGIN(start);
+  errno = ETIMEDOUT;
+  PAL_METRIC_END(PAL_METRIC_NET_RECV, start);
+  *seen = errno;
+  return NULL;
+}
+
+void
+test_metrics_keep_errno(void)
+{
+  pthread_t thread;
+  int seen = 0;
+
+  pthread_create(&thread, NULL, recorder, &seen);
+  pthread_join(thread, NULL);
+  TEST_ASSERT_EQUAL_INT(ETIMEDOUT, seen);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,136 @@
+#include <stdbool.h>
+#include <unity.h>
+
+#include <qwiet/platform/posix/pool.h>
+
+#define JOBS 256
+#define CHILDREN 64
+
+struct test_job {
+  struct pal_pool_job job;
+  int input;
+  int output;
+  bool done;
+};
+
+struct test_parent {
+  struct pal_pool_job job;
+  struct pal_pool_job children[CHILDREN];
+};
+
+static pal_pool_t pool;
+static _Atomic int child_runs;
+
+void
+setUp(void)
+{
+  pal_pool_init(&pool, 4);
+  atomic_store(&child_runs, 0);
+}
+
+void
+tearDown(void)
+{
+  pal_pool_cleanup(&pool);
+}
+
+static void
+square_work(struct pal_pool_job *job)
+{
+  struct test_job *t = PAL_CONTAINER_OF(job, struct test_job, job);
+  t->output = t->input * t->input;
+}
+
+static void
+square_done(struct pal_pool_job *job)
+{
+  struct test_job *t = PAL_CONTAINER_OF(job, struct test_job, job);
+  t->done = true;
+}
+
+void
+test_pool_completions_dispatch_on_caller(void)
+{
+  static struct test_job jobs[JOBS];
+  struct pollfd pfd = {.fd = pal_pool_fd(&pool), .events = POLLIN};
+  int completed = 0;
+
+  for (int i = 0; i < JOBS; i++) {
+    jobs[i].input = i;
+    jobs[i].done = false;
+    pal_pool_job_init(&jobs[i].job, square_work, square_done);
+    pal_pool_submit(&pool, &jobs[i].job);
+  }
+
+  while (completed < JOBS) {
+    TEST_ASSERT_EQUAL_INT(1, poll(&pfd, 1, 5000));
+    completed += pal_pool_dispatch(&pool);
+  }
+
+  for (int i = 0; i < JOBS; i++) {
+    TEST_ASSERT_TRUE(jobs[i].done);
+    TEST_ASSERT_EQUAL_INT(i * i, jobs[i].output);
+  }
+}
+
+static void
+child_work(struct pal_pool_job *job)
+{
+  (void)job;
+  atomic_fetch_add(&child_runs, 1);
+}
+
+static void
+parent_work(struct pal_pool_job *job)
+{
+  struct test_parent *p = PAL_CONTAINER_OF(job, struct test_parent, job);
+
+  /* Submitted from a worker: lands on its deque, idle workers steal */
+  for (int i = 0; i < CHILDREN; i++) {
+    pal_pool_job_init(&p->children[i], child_work, NULL);
+    pal_pool_submit(&pool, &p->children[i]);
+  }
+}
+
+void
+test_pool_nested_submit(void)
+{
+  static struct test_parent parent;
+
+  pal_pool_job_init(&parent.job, parent_work, NULL);
+  pal_pool_submit(&pool, &parent.job);
+
+  for (int i = 0; i < 500 && atomic_load(&child_runs) < CHILDREN; i++) {
+    pal_sleep(PAL_MSEC(10));
+  }
+  TEST_ASSERT_EQUAL_INT(CHILDREN, atomic_load(&child_runs));
+}
+
+static void
+sum_range(void *arg, size_t begin, size_t end)
+{
+  _Atomic uint64_t *sum = arg;
+  uint64_t local = 0;
+  for (size_t i = begin; i < end; i++) {
+    local += i;
+  }
+  atomic_fetch_add(sum, local);
+}
+
+void
+test_pool_parallel_for(void)
+{
+  _Atomic uint64_t sum = 0;
+
+  pal_pool_parallel_for(&pool, 0, 100000, 1000, sum_range, &sum);
+  TEST_ASSERT_EQUAL_UINT64(100000ULL * 99999ULL / 2, atomic_load(&sum));
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <unity.h>
+
+#include <qwiet/platform/common/raster.h>
+
+#define WIDTH 301 /* odd, so the last byte of a row is half used */
+#define HEIGHT 200
+#define PITCH 152
+
+static uint8_t ref_buf[PITCH * HEIGHT], buf[PITCH * HEIGHT];
+static pal_raster_fb_t ref = {ref_buf, WIDTH, HEIGHT, PITCH};
+static pal_raster_fb_t fb = {buf, WIDTH, HEIGHT, PITCH};
+static const pal_raster_pen_t pen = {.min_width = 1, .max_width = 9, .ink = 0};
+
+void
+setUp(void)
+{
+  pal_raster_fill(&ref, 15);
+  pal_raster_fill(&fb, 15);
+}
+
+void
+tearDown(void)
+{
+  pal_raster_select(PAL_RASTER_SCALAR);
+}
+
+static pal_raster_point_t
+pt(float x, float y, float pressure)
+{
+  return (pal_raster_point_t){.x = x, .y = y, .pressure = pressure};
+}
+
+void
+test_raster_dot(void)
+{
+  pal_raster_segment(&fb, &pen, pt(50, 50, 1), pt(50, 50, 1));
+  TEST_ASSERT_EQUAL_UINT8(0, pal_raster_get(&fb, 49, 49));
+  TEST_ASSERT_EQUAL_UINT8(0, pal_raster_get(&fb, 50, 50));
+  TEST_ASSERT_EQUAL_UINT8(15, pal_raster_get(&fb, 50, 56));
+  TEST_ASSERT_EQUAL_UINT8(15, pal_raster_get(&fb, 44, 50));
+
+  /* The edge is partly covered */
+  TEST_ASSERT_TRUE(pal_raster_get(&fb, 54, 49) > 0);
+  TEST_ASSERT_TRUE(pal_raster_get(&fb, 54, 49) < 15);
+}
+
+void
+test_raster_pressure_width(void)
+{
+  int thin = 0, thick = 0;
+
+  pal_raster_segment(&fb, &pen, pt(10, 100, 0), pt(290, 100, 1));
+  for (uint32_t y = 0; y < HEIGHT; y++) {
+    thin += pal_raster_get(&fb, 20, y) < 8;
+    thick += pal_raster_get(&fb, 280, y) < 8;
+  }
+  TEST_ASSERT_TRUE(thin >= 1 && thin <= 2);
+  TEST_ASSERT_TRUE(thick >= 8 && thick <= 10);
+}
+
+void
+test_raster_clip(void)
+{
+  /* Wild coordinates touch nothing outside the buffer */
+  pal_raster_segment(&fb, &pen, pt(-1e9f, -1e9f, 1), pt(1e9f, 1e9f, 1));
+  pal_raster_segment(&fb, &pen, pt(WIDTH - 1, 0, 1), pt(WIDTH + 50, -9, 1));
+  TEST_ASSERT_EQUAL_UINT8(0, pal_raster_get(&fb, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(0, pal_raster_get(&fb, WIDTH - 1, 0));
+
+  /* The spare nibble of an odd width row is never written */
+  for (uint32_t y = 0; y < HEIGHT; y++) {
+    TEST_ASSERT_EQUAL_UINT8(0xf, buf[y * PITCH + WIDTH / 2] >> 4);
+  }
+}
+
+void
+test_raster_kernels_match_reference(void)
+{
+  for (int impl = PAL_RASTER_SSE2; impl <= PAL_RASTER_NEON; impl++) {
+    if (!pal_raster_supported(impl)) {
+      continue;
+    }
+    setUp();
+    srand(42);
+    for (int i = 0; i < 2000; i++) {
+      pal_raster_point_t a = pt(rand() % (WIDTH * 4) / 4.0f - 10,
+                                rand() % (HEIGHT * 4) / 4.0f - 10,
+                                rand() % 101 / 100.0f);
+      pal_raster_point_t b = pt(a.x + rand() % 81 - 40,
+                                a.y + rand() % 81 - 40,
+                                rand() % 101 / 100.0f);
+      uint8_t ink = rand() % 16;
+      pal_raster_pen_t p = {.min_width = 0.5f, .max_width = 12, .ink = ink};
+      pal_raster_select(PAL_RASTER_SCALAR);
+      pal_raster_segment(&ref, &p, a, b);
+      pal_raster_select(impl);
+      pal_raster_segment(&fb, &p, a, b);
+    }
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(
+        ref_buf, buf, sizeof(buf), pal_raster_impl_name(impl));
+  }
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,181 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unity.h>
+
+#include <qwiet/platform/common/rbtree.h>
+
+#define ITEMS 1000
+
+struct test_item {
+  int key;
+  struct pal_rb_node node;
+};
+
+static struct pal_rb_root_cached tree;
+static struct test_item items[ITEMS];
+
+static bool
+item_less(struct pal_rb_node *a, const struct pal_rb_node *b)
+{
+  return pal_rb_entry(a, struct test_item, node)->key <
+         pal_rb_entry(b, struct test_item, node)->key;
+}
+
+static int
+item_cmp(const void *key, const struct pal_rb_node *node)
+{
+  int k = *(const int *)key;
+  int n = pal_rb_entry(node, struct test_item, node)->key;
+  return (k > n) - (k < n);
+}
+
+/*
+ * Walk the tree checking parent links, no red node with a red child, and
+ * equal black height on every path. Returns the black height.
+ */
+static int
+check_subtree(const struct pal_rb_node *node, const struct pal_rb_node *parent)
+{
+  int left, right;
+  bool black;
+
+  if (!node) {
+    return 1;
+  }
+  black = node->__rb_parent_color & 1;
+  TEST_ASSERT_EQUAL_PTR(parent, pal_rb_parent(node));
+  if (!black) {
+    TEST_ASSERT_TRUE(!node->rb_left || (node->rb_left->__rb_parent_color & 1));
+    TEST_ASSERT_TRUE(!node->rb_right ||
+                     (node->rb_right->__rb_parent_color & 1));
+  }
+  left = check_subtree(node->rb_left, node);
+  right = check_subtree(node->rb_right, node);
+  TEST_ASSERT_EQUAL_INT(left, right);
+  return left + black;
+}
+
+static size_t
+check_tree(void)
+{
+  struct pal_rb_node *pos, *prev = NULL;
+  size_t n = 0;
+
+  check_subtree(tree.rb_root.rb_node, NULL);
+  TEST_ASSERT_EQUAL_PTR(pal_rb_first(&tree.rb_root),
+                        pal_rb_first_cached(&tree));
+  for (pos = pal_rb_first(&tree.rb_root); pos;
+       prev = pos, pos = pal_rb_next(pos)) {
+    if (prev) {
+      TEST_ASSERT_FALSE(item_less(pos, prev));
+      TEST_ASSERT_EQUAL_PTR(prev, pal_rb_prev(pos));
+    }
+    n++;
+  }
+  return n;
+}
+
+void
+setUp(void)
+{
+  tree = PAL_RB_ROOT_CACHED;
+  srand(1234);
+  for (int i = 0; i < ITEMS; i++) {
+    items[i].key = rand() % (ITEMS * 4);
+    PAL_RB_CLEAR_NODE(&items[i].node);
+  }
+}
+
+void
+tearDown(void)
+{
+}
+
+void
+test_rbtree_insert_erase_keeps_invariants(void)
+{
+  for (int i = 0; i < ITEMS; i++) {
+    pal_rb_add_cached(&items[i].node, &tree, item_less);
+  }
+  TEST_ASSERT_EQUAL_size_t(ITEMS, check_tree());
+
+  /* Erasing the leftmost and arbitrary nodes keeps the cache right */
+  for (int i = 0; i < ITEMS; i += 2) {
+    pal_rb_erase_cached(&items[i].node, &tree);
+  }
+  pal_rb_erase_cached(pal_rb_first_cached(&tree), &tree);
+  TEST_ASSERT_EQUAL_size_t(ITEMS / 2 - 1, check_tree());
+}
+
+void
+test_rbtree_equal_keys_keep_insertion_order(void)
+{
+  struct pal_rb_node *pos;
+  int i = 0;
+
+  for (int k = 0; k < 8; k++) {
+    items[k].key = 42;
+    pal_rb_add_cached(&items[k].node, &tree, item_less);
+  }
+
+  for (pos = pal_rb_first_cached(&tree); pos; pos = pal_rb_next(pos)) {
+    TEST_ASSERT_EQUAL_PTR(&items[i++].node, pos);
+  }
+  TEST_ASSERT_EQUAL_INT(8, i);
+}
+
+void
+test_rbtree_find_and_lower_bound(void)
+{
+  struct pal_rb_node *pos;
+  int key;
+
+  for (int i = 0; i < 100; i++) {
+    items[i].key = i * 10;
+    pal_rb_add_cached(&items[i].node, &tree, item_less);
+  }
+
+  key = 420;
+  TEST_ASSERT_EQUAL_PTR(&items[42].node,
+                        pal_rb_find(&key, &tree.rb_root, item_cmp));
+  key = 421;
+  TEST_ASSERT_NULL(pal_rb_find(&key, &tree.rb_root, item_cmp));
+
+  /* Range [421, 450]: 430, 440, 450 */
+  pos = pal_rb_lower_bound(&key, &tree.rb_root, item_cmp);
+  for (int expect = 430; expect <= 450; expect += 10) {
+    TEST_ASSERT_NOT_NULL(pos);
+    TEST_ASSERT_EQUAL_INT(expect,
+                          pal_rb_entry(pos, struct test_item, node)->key);
+    pos = pal_rb_next(pos);
+  }
+
+  key = 991;
+  TEST_ASSERT_NULL(pal_rb_lower_bound(&key, &tree.rb_root, item_cmp));
+}
+
+void
+test_rbtree_postorder_visits_all(void)
+{
+  struct test_item *pos, *n;
+  size_t count = 0;
+
+  for (int i = 0; i < ITEMS; i++) {
+    pal_rb_add_cached(&items[i].node, &tree, item_less);
+  }
+  pal_rbtree_postorder_for_each_entry_safe(pos, n, &tree.rb_root, node)
+  {
+    PAL_RB_CLEAR_NODE(&pos->node);
+    count++;
+  }
+  TEST_ASSERT_EQUAL_size_t(ITEMS, count);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -1,15 +1,18 @@
 #include "unity.h"
 #include <qwiet/platform/posix/sem.h>
 #include <qwiet/platform/posix/time.h>
+#include <qwiet/platform/testing/diode/clock.h>
 
 void
 setUp(void)
 {
+  diode_clock_init();
 }
 
 void
 tearDown(void)
 {
+  diode_clock_cleanup();
 }
 
 void
@@ -22,14 +25,22 @@ test_sem_ok(void)
   ret = pal_sem_wait(&sem, PAL_NO_WAIT);
   TEST_ASSERT_EQUAL_INT(0, ret);
 
+  /* Times out after exactly the timeout, in virtual time */
   ret = pal_sem_wait(&sem, PAL_MSEC(10));
   TEST_ASSERT_EQUAL_INT(0, ret);
+  TEST_ASSERT_EQUAL_INT64(10000000, pal_uptime_ns());
 
   pal_sem_post(&sem);
 
   ret = pal_sem_wait(&sem, PAL_FOREVER);
   TEST_ASSERT_EQUAL_INT(1, ret);
 
+  /* Available: no time passes */
+  pal_sem_post(&sem);
+  ret = pal_sem_wait(&sem, PAL_MSEC(10));
+  TEST_ASSERT_EQUAL_INT(1, ret);
+  TEST_ASSERT_EQUAL_INT64(10000000, pal_uptime_ns());
+
   pal_sem_destroy(&sem);
 }
 
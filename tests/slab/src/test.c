@@ -0,0 +1,140 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <unity.h>
+
+#include <qwiet/platform/common.h>
+#include <qwiet/platform/posix/slab.h>
+
+#define OBJS 5000
+#define THREADS 4
+
+static void *objs[OBJS];
+
+static size_t
+class_inuse(size_t size)
+{
+  struct pal_pool_stats stats;
+
+  pal_pool_stats(&stats);
+  for (int i = 0; i < PAL_POOL_CLASSES; i++) {
+    if (stats.classes[i].size == size) {
+      return stats.classes[i].inuse;
+    }
+  }
+  return 0;
+}
+
+static void *
+churn_thread(void *arg)
+{
+  uint8_t id = (uint8_t)(uintptr_t)arg;
+  void **mine = pal_malloc(sizeof(void *) * OBJS);
+
+  for (int round = 0; round < 4; round++) {
+    for (int i = 0; i < OBJS; i++) {
+      size_t size = 16 + (i * 37) % 700;
+      mine[i] = pal_pool_alloc(size);
+      memset(mine[i], id, size);
+    }
+    for (int i = 0; i < OBJS; i++) {
+      size_t size = 16 + (i * 37) % 700;
+      /* Another thread scribbling here would mean a double hand-out */
+      if (((uint8_t *)mine[i])[size - 1] != id) {
+        pal_free(mine);
+        return (void *)1;
+      }
+      pal_pool_free(mine[i]);
+    }
+  }
+  pal_free(mine);
+  return NULL;
+}
+
+void
+setUp(void)
+{
+}
+
+void
+tearDown(void)
+{
+}
+
+void
+test_slab_sizes_are_aligned_and_distinct(void)
+{
+  for (int i = 0; i < OBJS; i++) {
+    size_t size = 1 + (i * 13) % PAL_POOL_MAX_SIZE;
+    objs[i] = pal_pool_alloc(size);
+    TEST_ASSERT_NOT_NULL(objs[i]);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)objs[i] % 16);
+    memset(objs[i], i & 0xff, size);
+  }
+  for (int i = 0; i < OBJS; i++) {
+    size_t size = 1 + (i * 13) % PAL_POOL_MAX_SIZE;
+    TEST_ASSERT_EQUAL_UINT8(i & 0xff, ((uint8_t *)objs[i])[size - 1]);
+    pal_pool_free(objs[i]);
+  }
+}
+
+void
+test_slab_large_and_null_fall_back_to_libc(void)
+{
+  void *big = pal_pool_alloc(PAL_POOL_MAX_SIZE + 1);
+
+  TEST_ASSERT_NOT_NULL(big);
+  memset(big, 0, PAL_POOL_MAX_SIZE + 1);
+  pal_pool_free(big);
+  pal_pool_free(NULL);
+
+  /* Plain malloc() memory is accepted too */
+  pal_pool_free(malloc(32));
+}
+
+void
+test_slab_stats_track_usage_and_release(void)
+{
+  struct pal_pool_stats stats;
+
+  for (int i = 0; i < OBJS; i++) {
+    objs[i] = pal_pool_alloc(64);
+  }
+  pal_pool_stats(&stats);
+  TEST_ASSERT_TRUE(class_inuse(64) >= OBJS);
+  TEST_ASSERT_TRUE(stats.used <= stats.committed);
+  TEST_ASSERT_TRUE(stats.committed <= stats.reserved);
+
+  for (int i = 0; i < OBJS; i++) {
+    pal_pool_free(objs[i]);
+  }
+
+  /* Only this thread's cache may still hold objects; empty slabs beyond
+   * the spare went back to the arena */
+  pal_pool_stats(&stats);
+  TEST_ASSERT_TRUE(class_inuse(64) <= 32);
+  TEST_ASSERT_TRUE(stats.free_slabs >= 2);
+}
+
+void
+test_slab_threads_churn(void)
+{
+  pthread_t threads[THREADS];
+  void *ret;
+
+  for (uintptr_t i = 0; i < THREADS; i++) {
+    pthread_create(&threads[i], NULL, churn_thread, (void *)(i + 1));
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], &ret);
+    TEST_ASSERT_NULL(ret);
+  }
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,270 @@
+#include <math.h>
+#include <stdlib.h>
+#include <unity.h>
+
+#include <qwiet/platform/common/spatial.h>
+
+#define WIDTH 1404
+#define HEIGHT 1872
+
+static const pal_raster_pen_t pen = {.min_width = 2, .max_width = 6};
+static pal_spatial_t spatial;
+
+struct found {
+  size_t count;
+  uint32_t ids[400];
+};
+
+static int
+collect(void *ctx, uint32_t id)
+{
+  struct found *found = ctx;
+
+  TEST_ASSERT_TRUE(found->count < 400);
+  found->ids[found->count++] = id;
+  return 0;
+}
+
+static int
+has(const struct found *found, uint32_t id)
+{
+  int n = 0;
+  for (size_t i = 0; i < found->count; i++) {
+    n += found->ids[i] == id;
+  }
+  return n;
+}
+
+static pal_raster_point_t
+pt(float x, float y)
+{
+  return (pal_raster_point_t){.x = x, .y = y, .pressure = 0.5f};
+}
+
+/* A horizontal line from (x0, y) to (x1, y) in steps of 10 pixels */
+static void
+line(uint32_t id, float x0, float x1, float y)
+{
+  for (float x = x0; x < x1; x += 10) {
+    pal_spatial_add(&spatial, id, &pen, pt(x, y), pt(fminf(x + 10, x1), y));
+  }
+}
+
+void
+setUp(void)
+{
+  pal_spatial_init(&spatial, WIDTH, HEIGHT, PAL_SPATIAL_CELL_SHIFT);
+}
+
+void
+tearDown(void)
+{
+  pal_spatial_cleanup(&spatial);
+}
+
+void
+test_spatial_circle(void)
+{
+  struct found found = {0};
+
+  /* Radius 2 at half pressure */
+  line(1, 100, 500, 100);
+  line(2, 100, 500, 120);
+  TEST_ASSERT_EQUAL_size_t(2, pal_spatial_count(&spatial));
+  TEST_ASSERT_EQUAL_size_t(80, spatial.segments);
+
+  /* A long stroke crossing many cells is reported once */
+  TEST_ASSERT_EQUAL_size_t(
+      1, pal_spatial_query_circle(&spatial, 300, 105, 3, collect, &found));
+  TEST_ASSERT_EQUAL_INT(1, has(&found, 1));
+
+  /* Just out of reach of both, then touching both */
+  found.count = 0;
+  TEST_ASSERT_EQUAL_size_t(
+      0, pal_spatial_query_circle(&spatial, 300, 110, 7.9f, collect, &found));
+  TEST_ASSERT_EQUAL_size_t(
+      2, pal_spatial_query_circle(&spatial, 300, 110, 8.1f, collect, &found));
+  TEST_ASSERT_EQUAL_INT(1, has(&found, 1));
+  TEST_ASSERT_EQUAL_INT(1, has(&found, 2));
+
+  /* Past the round end cap, the box overlaps but the capsule does not */
+  found.count = 0;
+  TEST_ASSERT_EQUAL_size_t(
+      0, pal_spatial_query_circle(&spatial, 504, 104, 3, collect, &found));
+  TEST_ASSERT_EQUAL_size_t(
+      1, pal_spatial_query_circle(&spatial, 504, 100, 3, collect, &found));
+}
+
+void
+test_spatial_rect(void)
+{
+  pal_rect_t bounds;
+  struct found found = {0};
+
+  line(1, 10, 200, 10);
+  line(2, 300, 600, 700);
+  pal_spatial_add(&spatial, 3, &pen, pt(50, 50), pt(1000, 1500));
+
+  /* The diagonal's one segment is listed all along its box */
+  TEST_ASSERT_EQUAL_size_t(2,
+                           pal_spatial_query_rect(&spatial,
+                                                  PAL_RECT(0, 0, 128, 128),
+                                                  collect,
+                                                  &found));
+  TEST_ASSERT_EQUAL_INT(1, has(&found, 1));
+  TEST_ASSERT_EQUAL_INT(1, has(&found, 3));
+
+  found.count = 0;
+  TEST_ASSERT_EQUAL_size_t(
+      0,
+      pal_spatial_query_rect(
+          &spatial, PAL_RECT(1100, 0, 1404, 600), collect, &found));
+  TEST_ASSERT_EQUAL_size_t(
+      3,
+      pal_spatial_query_rect(
+          &spatial, PAL_RECT(-100, -100, 5000, 5000), collect, &found));
+
+  TEST_ASSERT_TRUE(pal_spatial_bounds(&spatial, 2, &bounds));
+  TEST_ASSERT_EQUAL_INT32(298, bounds.x1);
+  TEST_ASSERT_EQUAL_INT32(698, bounds.y1);
+  TEST_ASSERT_EQUAL_INT32(603, bounds.x2);
+  TEST_ASSERT_EQUAL_INT32(703, bounds.y2);
+  TEST_ASSERT_FALSE(pal_spatial_bounds(&spatial, 4, &bounds));
+}
+
+void
+test_spatial_remove(void)
+{
+  struct found found = {0};
+
+  line(1, 0, 1404, 900);
+  line(2, 0, 1404, 910);
+  line(3, 0, 1404, 2000); /* off the page, never found */
+  TEST_ASSERT_TRUE(pal_spatial_remove(&spatial, 1));
+  TEST_ASSERT_FALSE(pal_spatial_remove(&spatial, 1));
+  TEST_ASSERT_EQUAL_size_t(2, pal_spatial_count(&spatial));
+  TEST_ASSERT_EQUAL_size_t(
+      1,
+      pal_spatial_query_rect(
+          &spatial, PAL_RECT(0, 0, WIDTH, 2100), collect, &found));
+  TEST_ASSERT_EQUAL_INT(1, has(&found, 2));
+
+  /* Ids are reusable */
+  line(1, 0, 100, 905);
+  found.count = 0;
+  TEST_ASSERT_EQUAL_size_t(
+      2, pal_spatial_query_circle(&spatial, 50, 905, 4, collect, &found));
+  TEST_ASSERT_TRUE(pal_spatial_remove(&spatial, 3));
+  TEST_ASSERT_EQUAL_size_t(10 + 141, spatial.segments);
+}
+
+static int
+first(void *ctx, uint32_t id)
+{
+  *(uint32_t *)ctx = id;
+  return 1;
+}
+
+void
+test_spatial_stop(void)
+{
+  uint32_t id = 0;
+
+  for (uint32_t i = 1; i <= 10; i++) {
+    line(i, 100, 200, 100 + (float)i);
+  }
+  TEST_ASSERT_EQUAL_size_t(
+      1, pal_spatial_query_circle(&spatial, 150, 105, 20, first, &id));
+  TEST_ASSERT_TRUE(id >= 1 && id <= 10);
+}
+
+void
+test_spatial_taper(void)
+{
+  struct found found = {0};
+  pal_raster_point_t a = {.x = 100, .y = 100, .pressure = 0};
+  pal_raster_point_t b = {.x = 300, .y = 100, .pressure = 1};
+
+  /* Half width 1 at a, 3 at b */
+  pal_spatial_add(&spatial, 1, &pen, a, b);
+  TEST_ASSERT_EQUAL_size_t(
+      0, pal_spatial_query_circle(&spatial, 110, 103, 1, collect, &found));
+  TEST_ASSERT_EQUAL_size_t(
+      1, pal_spatial_query_circle(&spatial, 290, 103, 1, collect, &found));
+  TEST_ASSERT_EQUAL_size_t(
+      1, pal_spatial_query_circle(&spatial, 97, 100, 2, collect, &found));
+  TEST_ASSERT_EQUAL_size_t(
+      0, pal_spatial_query_circle(&spatial, 96, 100, 2, collect, &found));
+}
+
+/* Against a scan of every segment, on random scribbles */
+void
+test_spatial_matches_scan(void)
+{
+  static float seg[400][8][4];
+  struct found found;
+
+  srand(7);
+  for (uint32_t s = 0; s < 400; s++) {
+    float x = (float)(rand() % WIDTH), y = (float)(rand() % HEIGHT);
+    for (int k = 0; k < 8; k++) {
+      float nx = x + (float)(rand() % 61 - 30);
+      float ny = y + (float)(rand() % 61 - 30);
+      pal_spatial_add(&spatial, s, &pen, pt(x, y), pt(nx, ny));
+      seg[s][k][0] = x;
+      seg[s][k][1] = y;
+      seg[s][k][2] = x = nx;
+      seg[s][k][3] = y = ny;
+    }
+  }
+
+  for (int q = 0; q < 500; q++) {
+    float qx = (float)(rand() % WIDTH), qy = (float)(rand() % HEIGHT);
+    float r = 4 + (float)(rand() % 20);
+
+    found.count = 0;
+    pal_spatial_query_circle(&spatial, qx, qy, r, collect, &found);
+    for (uint32_t s = 0; s < 400; s++) {
+      int hit = 0;
+      for (int k = 0; k < 8 && !hit; k++) {
+        float dx = seg[s][k][2] - seg[s][k][0];
+        float dy = seg[s][k][3] - seg[s][k][1];
+        float px = qx - seg[s][k][0], py = qy - seg[s][k][1];
+        float len2 = dx * dx + dy * dy;
+        float t = len2 > 0 ? (px * dx + py * dy) / len2 : 0;
+        t = t < 0 ? 0 : t > 1 ? 1 : t;
+        hit = hypotf(px - t * dx, py - t * dy) <= r + 2;
+      }
+      TEST_ASSERT_EQUAL_INT(hit, has(&found, s));
+    }
+  }
+
+  for (int q = 0; q < 200; q++) {
+    int32_t x = rand() % WIDTH, y = rand() % HEIGHT, size = rand() % 300;
+    pal_rect_t rect = PAL_RECT(x - size / 2, y, x + size, y + size / 3);
+
+    found.count = 0;
+    pal_spatial_query_rect(&spatial, rect, collect, &found);
+    for (uint32_t s = 0; s < 400; s++) {
+      int hit = 0;
+      for (int k = 0; k < 8 && !hit; k++) {
+        pal_rect_t box =
+            PAL_RECT((int32_t)floorf(fminf(seg[s][k][0], seg[s][k][2]) - 2),
+                     (int32_t)floorf(fminf(seg[s][k][1], seg[s][k][3]) - 2),
+                     (int32_t)ceilf(fmaxf(seg[s][k][0], seg[s][k][2]) + 2) + 1,
+                     (int32_t)ceilf(fmaxf(seg[s][k][1], seg[s][k][3]) + 2) + 1);
+        hit = !pal_rect_empty(pal_rect_intersect(box, rect));
+      }
+      TEST_ASSERT_EQUAL_INT(hit, has(&found, s));
+    }
+  }
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
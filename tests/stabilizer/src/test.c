@@ -0,0 +1,320 @@
+#include <math.h>
+#include <unity.h>
+
+#include <qwiet/platform/linux/input/stabilizer.h>
+
+/*
+ * Traces are synthetic samples shaped like pal_stylus_feed()'s output: a
+ * report every 5 ms, give or take 0.5 ms, stamped to the microsecond as
+ * evdev is, each position off the pen's true path by digitizer noise of
+ * about 10 units. The path is cursive loops at handwriting speed, roughly
+ * 60 to 200 mm/s at 100 units per millimetre. test_stabilizer_evdev()
+ * sends the same trace through pal_stylus_feed() as the tablet's events.
+ */
+
+#define TRACE_SAMPLES 400
+#define TRACE_PERIOD_NS 5000000LL
+#define TRACE_LOOPS_HZ 3.0
+#define TRACE_PI 3.14159265358979323846
+
+struct trace {
+  pal_stylus_sample_t raw[TRACE_SAMPLES];
+  double truth[TRACE_SAMPLES][2];
+};
+
+static struct trace trace;
+static pal_stabilizer_t st;
+static uint32_t seed;
+
+static double
+noise(void)
+{
+  double sum = 0;
+
+  /* Sum of uniforms, about normal with a standard deviation of 1 */
+  for (int i = 0; i < 12; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    sum += (double)(seed >> 8) / (1 << 24);
+  }
+  return sum - 6.0;
+}
+
+static void
+path(double t, double *x, double *y)
+{
+  *x = 20000.0 + 6000.0 * t + 800.0 * sin(2 * TRACE_PI * TRACE_LOOPS_HZ * t);
+  *y = 50000.0 + 1200.0 * cos(2 * TRACE_PI * TRACE_LOOPS_HZ * t);
+}
+
+static void
+record(double jitter)
+{
+  seed = 42;
+  for (int i = 0; i < TRACE_SAMPLES; i++) {
+    int64_t ns = 1000000000LL + i * TRACE_PERIOD_NS +
+                 (int64_t)(noise() * 250.0) * 1000;
+    double *truth = trace.truth[i];
+
+    path((double)(ns - 1000000000LL) / 1e9, &truth[0], &truth[1]);
+    trace.raw[i] = (pal_stylus_sample_t){
+        .time_ns = ns,
+        .x = (int32_t)lround(truth[0] + noise() * jitter),
+        .y = (int32_t)lround(truth[1] + noise() * jitter),
+        .pressure = 1000,
+        .touching = 1,
+        .in_range = 1};
+  }
+}
+
+static void
+start(enum pal_stabilizer_method method)
+{
+  pal_stabilizer_config_t cfg = PAL_STABILIZER_CONFIG_DEFAULT;
+
+  cfg.method = method;
+  pal_stabilizer_init(&st, &cfg);
+}
+
+/* Root mean square distance from the true path, past the first samples */
+static double
+error(const pal_stylus_sample_t *out)
+{
+  double sum = 0;
+
+  for (int i = 20; i < TRACE_SAMPLES; i++) {
+    double dx = out[i].x - trace.truth[i][0];
+    double dy = out[i].y - trace.truth[i][1];
+    sum += dx * dx + dy * dy;
+  }
+  return sqrt(sum / (TRACE_SAMPLES - 20));
+}
+
+/* Root mean square of the second difference of the error, which is high
+ * for noise and low for a smooth offset such as lag */
+static double
+roughness(const pal_stylus_sample_t *out)
+{
+  double sum = 0;
+
+  for (int i = 20; i < TRACE_SAMPLES; i++) {
+    double e[3][2];
+    for (int k = 0; k < 3; k++) {
+      e[k][0] = out[i - k].x - trace.truth[i - k][0];
+      e[k][1] = out[i - k].y - trace.truth[i - k][1];
+    }
+    for (int k = 0; k < 2; k++) {
+      double a = e[0][k] - 2.0 * e[1][k] + e[2][k];
+      sum += a * a;
+    }
+  }
+  return sqrt(sum / (TRACE_SAMPLES - 20));
+}
+
+static void
+replay(pal_stylus_sample_t *out)
+{
+  for (int i = 0; i < TRACE_SAMPLES; i++) {
+    pal_stabilizer_feed(&st, &trace.raw[i], &out[i]);
+  }
+}
+
+void
+setUp(void)
+{
+  record(10.0);
+}
+
+void
+tearDown(void)
+{}
+
+void
+test_stabilizer_none(void)
+{
+  static pal_stylus_sample_t out[TRACE_SAMPLES];
+  pal_stylus_sample_t ahead;
+
+  start(PAL_STABILIZER_NONE);
+  TEST_ASSERT_FALSE(pal_stabilizer_predict(&st, PAL_MSEC(5), &ahead));
+  replay(out);
+  TEST_ASSERT_EQUAL_MEMORY(trace.raw, out, sizeof(out));
+  TEST_ASSERT_TRUE(pal_stabilizer_predict(&st, PAL_MSEC(5), &ahead));
+}
+
+void
+test_stabilizer_smooths(void)
+{
+  static pal_stylus_sample_t out[TRACE_SAMPLES];
+  const enum pal_stabilizer_method methods[] = {
+      PAL_STABILIZER_AVERAGE, PAL_STABILIZER_EURO, PAL_STABILIZER_KALMAN};
+  /* The average lags the fast loops by half its window */
+  const double bound[] = {200.0, 60.0, error(trace.raw)};
+  double raw = roughness(trace.raw);
+
+  for (int m = 0; m < 3; m++) {
+    start(methods[m]);
+    replay(out);
+    TEST_ASSERT_TRUE(roughness(out) < raw * 2 / 3);
+    TEST_ASSERT_TRUE(error(out) < bound[m]);
+    TEST_ASSERT_EQUAL_INT32(trace.raw[9].pressure, out[9].pressure);
+    TEST_ASSERT_EQUAL_INT64(trace.raw[9].time_ns, out[9].time_ns);
+  }
+}
+
+void
+test_stabilizer_resting(void)
+{
+  pal_stylus_sample_t in = {.x = 5000, .y = 5000, .touching = 1}, out;
+  int32_t lo = INT32_MAX, hi = INT32_MIN;
+
+  start(PAL_STABILIZER_EURO);
+  for (int i = 0; i < 400; i++) {
+    in.time_ns = i * TRACE_PERIOD_NS;
+    in.x = 5000 + (int32_t)lround(noise() * 10.0);
+    pal_stabilizer_feed(&st, &in, &out);
+    if (i >= 100) {
+      lo = out.x < lo ? out.x : lo;
+      hi = out.x > hi ? out.x : hi;
+    }
+  }
+  /* Raw spread is about 60 */
+  TEST_ASSERT_TRUE(hi - lo < 20);
+}
+
+void
+test_stabilizer_strokes(void)
+{
+  pal_stylus_sample_t out, up = trace.raw[99], ahead;
+
+  start(PAL_STABILIZER_KALMAN);
+  for (int i = 0; i < 99; i++) {
+    pal_stabilizer_feed(&st, &trace.raw[i], &out);
+  }
+
+  /* Lifting the pen passes through and forgets the stroke */
+  up.touching = 0;
+  pal_stabilizer_feed(&st, &up, &out);
+  TEST_ASSERT_EQUAL_MEMORY(&up, &out, sizeof(out));
+  TEST_ASSERT_FALSE(pal_stabilizer_predict(&st, PAL_MSEC(5), &ahead));
+
+  /* The next stroke starts where the pen lands */
+  pal_stabilizer_feed(&st, &trace.raw[200], &out);
+  TEST_ASSERT_EQUAL_INT32(trace.raw[200].x, out.x);
+  TEST_ASSERT_EQUAL_INT32(trace.raw[200].y, out.y);
+}
+
+void
+test_stabilizer_predict(void)
+{
+  const enum pal_stabilizer_method methods[] = {PAL_STABILIZER_EURO,
+                                                PAL_STABILIZER_KALMAN};
+  /* The 1-euro filter's lag is part of what prediction must make up */
+  const double gain[] = {2.0, 3.0};
+  const int64_t ahead_ns = 8000000;
+  pal_stylus_sample_t ahead;
+
+  for (int m = 0; m < 2; m++) {
+    double held = 0, predicted = 0;
+    pal_stylus_sample_t out;
+
+    start(methods[m]);
+    for (int i = 0; i < TRACE_SAMPLES; i++) {
+      double tx, ty;
+
+      pal_stabilizer_feed(&st, &trace.raw[i], &out);
+      if (i < 20) {
+        continue;
+      }
+      TEST_ASSERT_TRUE(
+          pal_stabilizer_predict(&st, PAL_NSEC(ahead_ns), &ahead));
+      TEST_ASSERT_EQUAL_INT64(out.time_ns + ahead_ns, ahead.time_ns);
+      path((double)(ahead.time_ns - 1000000000LL) / 1e9, &tx, &ty);
+      held += hypot(out.x - tx, out.y - ty);
+      predicted += hypot(ahead.x - tx, ahead.y - ty);
+    }
+    /* Ink drawn ahead lands far nearer the pen than ink that waits */
+    TEST_ASSERT_TRUE(predicted < held / gain[m]);
+  }
+
+  /* Capped at max_ahead */
+  TEST_ASSERT_TRUE(pal_stabilizer_predict(&st, PAL_SEC(1), &ahead));
+  TEST_ASSERT_EQUAL_INT64(trace.raw[TRACE_SAMPLES - 1].time_ns +
+                              PAL_STABILIZER_CONFIG_DEFAULT.max_ahead.ns,
+                          ahead.time_ns);
+}
+
+/* Tablet events for one report, only the axes that changed since prev */
+static size_t
+encode(const pal_stylus_sample_t *prev,
+       const pal_stylus_sample_t *s,
+       struct input_event *ev)
+{
+  size_t n = 0;
+
+  if (!prev) {
+    ev[n++] = (struct input_event){.type = EV_KEY, .code = BTN_TOOL_PEN};
+    ev[n++] = (struct input_event){.type = EV_KEY, .code = BTN_TOUCH};
+    ev[n++] = (struct input_event){.type = EV_ABS, .code = ABS_PRESSURE};
+    ev[0].value = s->in_range;
+    ev[1].value = s->touching;
+    ev[2].value = s->pressure;
+  }
+  if (!prev || prev->x != s->x) {
+    ev[n++] = (struct input_event){
+        .type = EV_ABS, .code = ABS_X, .value = s->x};
+  }
+  if (!prev || prev->y != s->y) {
+    ev[n++] = (struct input_event){
+        .type = EV_ABS, .code = ABS_Y, .value = s->y};
+  }
+  ev[n++] = (struct input_event){.type = EV_SYN, .code = SYN_REPORT};
+  for (size_t k = 0; k < n; k++) {
+    ev[k].time.tv_sec = s->time_ns / 1000000000LL;
+    ev[k].time.tv_usec = s->time_ns % 1000000000LL / 1000;
+  }
+  return n;
+}
+
+void
+test_stabilizer_evdev(void)
+{
+  static pal_stylus_sample_t out[TRACE_SAMPLES], direct[TRACE_SAMPLES];
+  pal_stylus_sample_t sample = {0};
+  pal_stylus_t pen;
+  int reports = 0;
+
+  start(PAL_STABILIZER_EURO);
+  replay(direct);
+
+  pal_stylus_init(&pen);
+  start(PAL_STABILIZER_EURO);
+  for (int i = 0; i < TRACE_SAMPLES; i++) {
+    struct input_event ev[6];
+    size_t n = encode(i ? &trace.raw[i - 1] : NULL, &trace.raw[i], ev);
+
+    for (size_t k = 0; k < n; k++) {
+      if (!pal_stylus_feed(&pen, &ev[k], &sample)) {
+        continue;
+      }
+      TEST_ASSERT_EQUAL_INT(i, reports);
+      pal_stabilizer_feed(&st, &sample, &out[reports++]);
+    }
+  }
+
+  /* Timestamps come from the events, and the filter sees what the tablet
+   * sent whether it arrives as samples or as events */
+  TEST_ASSERT_EQUAL_INT(TRACE_SAMPLES, reports);
+  TEST_ASSERT_EQUAL_INT64(trace.raw[9].time_ns, out[9].time_ns);
+  TEST_ASSERT_EQUAL_MEMORY(direct, out, sizeof(out));
+  TEST_ASSERT_TRUE(roughness(out) < roughness(trace.raw) * 2 / 3);
+  TEST_ASSERT_TRUE(error(out) < 60.0);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
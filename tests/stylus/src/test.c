@@ -0,0 +1,93 @@
+#include <stdbool.h>
+#include <unity.h>
+
+#include <qwiet/platform/linux/input/stylus.h>
+
+pal_stylus_t test_pen;
+pal_stylus_sample_t test_sample;
+
+void
+setUp(void)
+{
+  pal_stylus_init(&test_pen);
+  memset(&test_sample, 0, sizeof(test_sample));
+}
+
+void
+tearDown(void)
+{}
+
+static bool
+feed(uint16_t type, uint16_t code, int32_t value)
+{
+  struct input_event ev = {.type = type, .code = code, .value = value};
+  ev.time.tv_sec = 2;
+  ev.time.tv_usec = 500;
+  return pal_stylus_feed(&test_pen, &ev, &test_sample);
+}
+
+void
+test_stylus_report(void)
+{
+  TEST_ASSERT_FALSE(feed(EV_KEY, BTN_TOOL_PEN, 1));
+  TEST_ASSERT_FALSE(feed(EV_KEY, BTN_TOUCH, 1));
+  TEST_ASSERT_FALSE(feed(EV_ABS, ABS_X, 100));
+  TEST_ASSERT_FALSE(feed(EV_ABS, ABS_Y, 200));
+  TEST_ASSERT_FALSE(feed(EV_ABS, ABS_PRESSURE, 300));
+  TEST_ASSERT_TRUE(feed(EV_SYN, SYN_REPORT, 0));
+  TEST_ASSERT_EQUAL_INT32(100, test_sample.x);
+  TEST_ASSERT_EQUAL_INT32(200, test_sample.y);
+  TEST_ASSERT_EQUAL_INT32(300, test_sample.pressure);
+  TEST_ASSERT_TRUE(test_sample.in_range);
+  TEST_ASSERT_TRUE(test_sample.touching);
+  TEST_ASSERT_FALSE(test_sample.eraser);
+  TEST_ASSERT_EQUAL_INT64(2000500000LL, test_sample.time_ns);
+
+  /* Axes not reported again keep their value */
+  TEST_ASSERT_FALSE(feed(EV_ABS, ABS_X, 110));
+  TEST_ASSERT_FALSE(feed(EV_KEY, BTN_STYLUS, 1));
+  TEST_ASSERT_TRUE(feed(EV_SYN, SYN_REPORT, 0));
+  TEST_ASSERT_EQUAL_INT32(110, test_sample.x);
+  TEST_ASSERT_EQUAL_INT32(200, test_sample.y);
+  TEST_ASSERT_EQUAL(PAL_STYLUS_BUTTON_1, test_sample.buttons);
+}
+
+void
+test_stylus_dropped(void)
+{
+  TEST_ASSERT_FALSE(feed(EV_ABS, ABS_X, 100));
+  TEST_ASSERT_TRUE(feed(EV_SYN, SYN_REPORT, 0));
+
+  /* The partial report after SYN_DROPPED is discarded */
+  TEST_ASSERT_FALSE(feed(EV_SYN, SYN_DROPPED, 0));
+  TEST_ASSERT_FALSE(feed(EV_ABS, ABS_X, 999));
+  TEST_ASSERT_FALSE(feed(EV_SYN, SYN_REPORT, 0));
+
+  TEST_ASSERT_FALSE(feed(EV_ABS, ABS_Y, 50));
+  TEST_ASSERT_TRUE(feed(EV_SYN, SYN_REPORT, 0));
+  TEST_ASSERT_EQUAL_INT32(100, test_sample.x);
+  TEST_ASSERT_EQUAL_INT32(50, test_sample.y);
+}
+
+void
+test_stylus_eraser(void)
+{
+  TEST_ASSERT_FALSE(feed(EV_KEY, BTN_TOOL_RUBBER, 1));
+  TEST_ASSERT_TRUE(feed(EV_SYN, SYN_REPORT, 0));
+  TEST_ASSERT_TRUE(test_sample.eraser);
+  TEST_ASSERT_TRUE(test_sample.in_range);
+
+  TEST_ASSERT_FALSE(feed(EV_KEY, BTN_TOOL_RUBBER, 0));
+  TEST_ASSERT_TRUE(feed(EV_SYN, SYN_REPORT, 0));
+  TEST_ASSERT_FALSE(test_sample.eraser);
+  TEST_ASSERT_FALSE(test_sample.in_range);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
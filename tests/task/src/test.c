@@ -0,0 +1,171 @@
+#include <stdbool.h>
+#include <unity.h>
+
+#include <qwiet/platform/linux/task.h>
+#include <qwiet/platform/posix/net.h>
+
+struct test_sleeper {
+  struct pal_task task;
+  int delay_ms;
+  int result;
+  int *order;
+  int *n;
+};
+
+struct test_pingpong {
+  struct pal_task task;
+  pal_task_sem_t *take, *give;
+  int rounds;
+  int *trace;
+  int *n;
+  int id;
+};
+
+struct test_reader {
+  struct pal_task task;
+  int sock;
+  uint8_t buf[4];
+  int results[2];
+  bool timed_out; /* the first await has finished */
+};
+
+static pal_executor_t exec;
+
+void
+setUp(void)
+{
+  pal_executor_init(&exec);
+}
+
+void
+tearDown(void)
+{
+  pal_executor_cleanup(&exec);
+}
+
+static int
+sleeper_run(struct pal_task *task)
+{
+  struct test_sleeper *s = PAL_CONTAINER_OF(task, struct test_sleeper, task);
+  PAL_TASK_BEGIN(task);
+  PAL_TASK_SLEEP(task, PAL_MSEC(s->delay_ms));
+  s->result = task->result;
+  s->order[(*s->n)++] = s->delay_ms;
+  PAL_TASK_END(task);
+}
+
+void
+test_task_sleep_wakes_in_deadline_order(void)
+{
+  struct test_sleeper sleepers[4];
+  int delays[4] = {30, 10, 0, 20};
+  int order[4], n = 0;
+
+  for (int i = 0; i < 4; i++) {
+    sleepers[i].delay_ms = delays[i];
+    sleepers[i].order = order;
+    sleepers[i].n = &n;
+    pal_task_spawn(&exec, &sleepers[i].task, sleeper_run);
+  }
+  pal_executor_run(&exec);
+
+  TEST_ASSERT_EQUAL_INT(4, n);
+  TEST_ASSERT_EQUAL_INT(0, order[0]);
+  TEST_ASSERT_EQUAL_INT(10, order[1]);
+  TEST_ASSERT_EQUAL_INT(20, order[2]);
+  TEST_ASSERT_EQUAL_INT(30, order[3]);
+
+  /* A sleep of no time counts as slept, like any other */
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_INT(1, sleepers[i].result);
+  }
+}
+
+static int
+pingpong_run(struct pal_task *task)
+{
+  struct test_pingpong *p = PAL_CONTAINER_OF(task, struct test_pingpong, task);
+  PAL_TASK_BEGIN(task);
+  while (p->rounds-- > 0) {
+    PAL_TASK_AWAIT_SEM(task, p->take, PAL_FOREVER);
+    p->trace[(*p->n)++] = p->id;
+    pal_task_sem_give(p->give);
+  }
+  PAL_TASK_END(task);
+}
+
+void
+test_task_sem_ping_pong(void)
+{
+  pal_task_sem_t a, b;
+  struct test_pingpong ping = {.take = &a, .give = &b, .rounds = 3, .id = 1};
+  struct test_pingpong pong = {.take = &b, .give = &a, .rounds = 3, .id = 2};
+  int trace[6], n = 0;
+
+  pal_task_sem_init(&a, 1);
+  pal_task_sem_init(&b, 0);
+  ping.trace = pong.trace = trace;
+  ping.n = pong.n = &n;
+
+  /* Spawn pong first so it parks on the semaphore before ping runs */
+  pal_task_spawn(&exec, &pong.task, pingpong_run);
+  pal_task_spawn(&exec, &ping.task, pingpong_run);
+  pal_executor_run(&exec);
+
+  TEST_ASSERT_EQUAL_INT(6, n);
+  for (int i = 0; i < 6; i++) {
+    TEST_ASSERT_EQUAL_INT(i % 2 ? 2 : 1, trace[i]);
+  }
+}
+
+static int
+reader_run(struct pal_task *task)
+{
+  struct test_reader *r = PAL_CONTAINER_OF(task, struct test_reader, task);
+  PAL_TASK_BEGIN(task);
+
+  /* Nothing written yet: times out */
+  PAL_TASK_AWAIT_FD(task, r->sock, POLLIN, PAL_MSEC(10));
+  r->results[0] = task->result;
+  r->timed_out = true;
+
+  PAL_TASK_AWAIT_FD(task, r->sock, POLLIN, PAL_FOREVER);
+  r->results[1] = task->result;
+  pal_net_recv(r->sock, r->buf, sizeof(r->buf), 0);
+  PAL_TASK_END(task);
+}
+
+void
+test_task_await_fd(void)
+{
+  struct test_reader reader = {.results = {-2, -2}};
+  int sv[2];
+
+  pal_net_socketpair(true, sv);
+  reader.sock = sv[0];
+  pal_task_spawn(&exec, &reader.task, reader_run);
+
+  /* Run until the first await times out and the second is parked */
+  while (!reader.timed_out) {
+    pal_executor_run_once(&exec, PAL_MSEC(50));
+  }
+  TEST_ASSERT_EQUAL_INT(0, reader.results[0]);
+  TEST_ASSERT_EQUAL_INT(-2, reader.results[1]);
+
+  TEST_ASSERT_EQUAL_INT(4, pal_net_send(sv[1], "ping", 4, 0));
+  pal_executor_run(&exec);
+  TEST_ASSERT_EQUAL_INT(1, reader.results[1]);
+  TEST_ASSERT_EQUAL_MEMORY("ping", reader.buf, 4);
+
+  pal_net_close(sv[0]);
+  pal_net_close(sv[1]);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <unity.h>
+
+#include <qwiet/platform/common/tilecache.h>
+
+#define TILE PAL_CANVAS_TILE_BYTES
+
+static pal_tilecache_t cache;
+static uint8_t px[TILE];
+
+void
+setUp(void)
+{
+  pal_tilecache_init(&cache, 2 * TILE);
+}
+
+void
+tearDown(void)
+{
+  pal_tilecache_cleanup(&cache);
+}
+
+/* Mostly white with a scribble and a noisy patch, like a page of notes */
+static void
+scribble(uint8_t *buf, unsigned int seed)
+{
+  memset(buf, 0xff, TILE);
+  srand(seed);
+  for (int row = 0; row < 64; row++) {
+    memset(&buf[row * 32 + (row / 2 + seed) % 29], 0x00, 3);
+  }
+  for (int i = 0; i < 40; i++) {
+    buf[1000 + i] = (uint8_t)rand();
+  }
+}
+
+void
+test_tilecache_roundtrip(void)
+{
+  static uint8_t expect[8][TILE];
+
+  /* More tiles than the budget: the older ones get compressed */
+  for (uint32_t i = 0; i < 8; i++) {
+    scribble(expect[i], i);
+    pal_tilecache_put(&cache, 1, i, expect[i]);
+  }
+  TEST_ASSERT_EQUAL_size_t(8, cache.tiles);
+  TEST_ASSERT_EQUAL_size_t(2, cache.raw);
+  TEST_ASSERT_EQUAL_size_t(6, cache.compressed);
+  TEST_ASSERT_TRUE(pal_tilecache_ratio(&cache) > 3.0);
+
+  for (uint32_t i = 0; i < 8; i++) {
+    TEST_ASSERT_EQUAL_MEMORY(expect[i], pal_tilecache_get(&cache, 1, i), TILE);
+  }
+  TEST_ASSERT_NULL(pal_tilecache_get(&cache, 1, 8));
+  TEST_ASSERT_NULL(pal_tilecache_get(&cache, 2, 0));
+}
+
+void
+test_tilecache_incompressible(void)
+{
+  srand(1);
+  for (size_t i = 0; i < TILE; i++) {
+    px[i] = (uint8_t)rand();
+  }
+  pal_tilecache_put(&cache, 0, 0, px);
+  memset(px + 100, 0xff, 7); /* exactly one short run among literals */
+  pal_tilecache_put(&cache, 0, 1, px);
+  for (uint32_t i = 2; i < 5; i++) {
+    pal_tilecache_put(&cache, 0, i, px);
+  }
+  TEST_ASSERT_EQUAL_MEMORY(px, pal_tilecache_get(&cache, 0, 1), TILE);
+  TEST_ASSERT_NOT_NULL(pal_tilecache_get(&cache, 0, 0));
+  TEST_ASSERT_TRUE(cache.compressed_size <=
+                   cache.compressed * (TILE + TILE / 128));
+}
+
+void
+test_tilecache_lru(void)
+{
+  memset(px, 0xff, TILE);
+  pal_tilecache_put(&cache, 0, 0, px);
+  pal_tilecache_put(&cache, 0, 1, px);
+
+  /* Touching 0 makes 1 the one to go */
+  pal_tilecache_get(&cache, 0, 0);
+  pal_tilecache_put(&cache, 0, 2, px);
+  TEST_ASSERT_EQUAL_UINT64(1, cache.hits);
+  pal_tilecache_get(&cache, 0, 0);
+  TEST_ASSERT_EQUAL_UINT64(2, cache.hits);
+  pal_tilecache_get(&cache, 0, 1);
+  TEST_ASSERT_EQUAL_UINT64(1, cache.misses);
+  TEST_ASSERT_TRUE(pal_tilecache_hit_rate(&cache) > 0.6);
+
+  /* Read back without a rewrite, the compressed copy is kept */
+  TEST_ASSERT_EQUAL_size_t(2, cache.compressed);
+  px[0] = 0;
+  pal_tilecache_put(&cache, 0, 1, px);
+  TEST_ASSERT_EQUAL_size_t(1, cache.compressed);
+}
+
+void
+test_tilecache_drop(void)
+{
+  memset(px, 0x11, TILE);
+  for (uint32_t page = 0; page < 3; page++) {
+    for (uint32_t i = 0; i < 4; i++) {
+      pal_tilecache_put(&cache, page, i, px);
+    }
+  }
+  pal_tilecache_drop(&cache, 0, 3);
+  TEST_ASSERT_NULL(pal_tilecache_get(&cache, 0, 3));
+  pal_tilecache_drop_page(&cache, 1);
+  TEST_ASSERT_EQUAL_size_t(7, cache.tiles);
+  for (uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_NULL(pal_tilecache_get(&cache, 1, i));
+    TEST_ASSERT_NOT_NULL(pal_tilecache_get(&cache, 2, i));
+  }
+}
+
+void
+test_tilecache_pages(void)
+{
+  const pal_raster_pen_t pen = {.min_width = 2, .max_width = 6, .ink = 0};
+  pal_canvas_t canvas;
+
+  pal_tilecache_cleanup(&cache);
+  pal_tilecache_init(&cache, PAL_TILECACHE_BUDGET);
+  pal_canvas_init(&canvas, 1872, 1404, 15);
+
+  /* Three pages of one diagonal each */
+  for (uint32_t page = 0; page < 3; page++) {
+    pal_canvas_clear(&canvas);
+    pal_canvas_segment(&canvas,
+                       &pen,
+                       (pal_raster_point_t){100.0f * page, 0, 1},
+                       (pal_raster_point_t){1000 + 100.0f * page, 1000, 1});
+    pal_canvas_save(&canvas, &cache, page);
+  }
+
+  /* Flip back: page 1 had ink where page 0 did not */
+  pal_canvas_load(&canvas, &cache, 1);
+  TEST_ASSERT_EQUAL_UINT8(0, pal_canvas_get(&canvas, 600, 500));
+  TEST_ASSERT_EQUAL_UINT8(15, pal_canvas_get(&canvas, 500, 500));
+  TEST_ASSERT_NULL(pal_canvas_tile(&canvas, 29, 0));
+
+  /* A page never saved is blank */
+  pal_canvas_load(&canvas, &cache, 7);
+  TEST_ASSERT_EQUAL_size_t(0, canvas.ntiles);
+  pal_canvas_cleanup(&canvas);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -1,14 +1,16 @@
 #include <stdbool.h>
 #include <unity.h>
 
-#include <qwiet/platform/posix/time.h>
 #include <qwiet/platform/linux/timer.h>
+#include <qwiet/platform/posix/time.h>
+#include <qwiet/platform/testing/diode/clock.h>
 
 pal_timer_t test_timer;
 
 void
 setUp(void)
 {
+  diode_clock_init();
   pal_timer_init(&test_timer);
 }
 
@@ -16,6 +18,7 @@ void
 tearDown(void)
 {
   pal_timer_cleanup(&test_timer);
+  diode_clock_cleanup();
 }
 
 void
@@ -24,8 +27,10 @@ test_timer_oneshot(void)
   pal_timer_start_oneshot(&test_timer, PAL_MSEC(20));
   TEST_ASSERT_FALSE(pal_timer_is_ready(&test_timer));
 
-  /* Wait for expiration */
-  pal_sleep(PAL_MSEC(30));
+  /* Not a nanosecond early */
+  diode_clock_advance(PAL_NSEC(20000000 - 1));
+  TEST_ASSERT_FALSE(pal_timer_is_ready(&test_timer));
+  diode_clock_advance(PAL_NSEC(1));
   TEST_ASSERT_TRUE(pal_timer_is_ready(&test_timer));
 
   /* Ack the expiration */
@@ -45,19 +50,44 @@ test_timer_periodic(void)
 
   /* Wait for first expiration */
   TEST_ASSERT_EQUAL_INT(1, pal_timer_wait_ready(&test_timer, PAL_MSEC(50)));
+  TEST_ASSERT_EQUAL_INT64(20000000, pal_uptime_ns());
   TEST_ASSERT_TRUE(pal_timer_is_ready(&test_timer));
 
   /* Ack the expiration */
-  TEST_ASSERT_TRUE(pal_timer_read(&test_timer) >= 1);
+  TEST_ASSERT_EQUAL_UINT64(1, pal_timer_read(&test_timer));
   TEST_ASSERT_FALSE(pal_timer_is_ready(&test_timer));
 
   /* Wait for second expiration */
   TEST_ASSERT_EQUAL_INT(1, pal_timer_wait_ready(&test_timer, PAL_MSEC(50)));
-  TEST_ASSERT_TRUE(pal_timer_is_ready(&test_timer));
+  TEST_ASSERT_EQUAL_INT64(40000000, pal_uptime_ns());
 
   /* Ack again */
-  TEST_ASSERT_TRUE(pal_timer_read(&test_timer) >= 1);
+  TEST_ASSERT_EQUAL_UINT64(1, pal_timer_read(&test_timer));
   TEST_ASSERT_FALSE(pal_timer_is_ready(&test_timer));
+
+  /* A slow reader sees the periods it missed */
+  diode_clock_advance(PAL_MSEC(100));
+  TEST_ASSERT_EQUAL_UINT64(5, pal_timer_read(&test_timer));
+}
+
+void
+test_timer_wait_timeout(void)
+{
+  pal_timer_start_oneshot(&test_timer, PAL_MSEC(100));
+  TEST_ASSERT_EQUAL_INT(0, pal_timer_wait_ready(&test_timer, PAL_MSEC(30)));
+  TEST_ASSERT_EQUAL_INT64(30000000, pal_uptime_ns());
+  TEST_ASSERT_EQUAL_INT(0, pal_timer_wait_ready(&test_timer, PAL_NO_WAIT));
+
+  /* Re-arming counts from the current time */
+  pal_timer_start_oneshot(&test_timer, PAL_MSEC(10));
+  TEST_ASSERT_EQUAL_INT(1, pal_timer_wait_ready(&test_timer, PAL_FOREVER));
+  TEST_ASSERT_EQUAL_INT64(40000000, pal_uptime_ns());
+
+  /* Stopped timers never fire */
+  pal_timer_start_oneshot(&test_timer, PAL_MSEC(10));
+  pal_timer_stop(&test_timer);
+  TEST_ASSERT_EQUAL_INT(0, pal_timer_wait_ready(&test_timer, PAL_MSEC(20)));
+  TEST_ASSERT_EQUAL_UINT64(0, pal_timer_read(&test_timer));
 }
 
 extern int
@@ -0,0 +1,110 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include <qwiet/platform/posix/trace.h>
+
+static char path[] = "/tmp/qwiet_trace_XXXXXX";
+static char json[1 << 16];
+
+static void
+read_trace(void)
+{
+  FILE *f = fopen(path, "r");
+  size_t n;
+
+  TEST_ASSERT_NOT_NULL(f);
+  n = fread(json, 1, sizeof(json) - 1, f);
+  json[n] = '\0';
+  fclose(f);
+}
+
+static void *
+worker(void *arg)
+{
+  (void)arg;
+  pal_trace_thread_name("worker");
+  PAL_TRACE_BEGIN("work");
+  PAL_TRACE_COUNTER("items", 42);
+  PAL_TRACE_END("work");
+  return NULL; /* exits with records still in its ring */
+}
+
+void
+setUp(void)
+{
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  close(fd);
+}
+
+void
+tearDown(void)
+{
+  unlink(path);
+  strcpy(path, "/tmp/qwiet_trace_XXXXXX");
+}
+
+void
+test_trace_records_from_threads(void)
+{
+  pthread_t thread;
+  const char *begin, *end;
+
+  /* Outside a session nothing is recorded */
+  PAL_TRACE_INSTANT("before");
+
+  TEST_ASSERT_EQUAL_INT(0, pal_trace_start(path));
+  TEST_ASSERT_EQUAL_INT(-1, pal_trace_start(path));
+  PAL_TRACE_BEGIN("main");
+  pthread_create(&thread, NULL, worker, NULL);
+  pthread_join(thread, NULL);
+  PAL_TRACE_INSTANT("joined");
+  PAL_TRACE_END("main");
+  pal_trace_stop();
+  PAL_TRACE_INSTANT("after");
+
+  read_trace();
+  TEST_ASSERT_EQUAL_STRING_LEN("{\"displayTimeUnit\"", json, 18);
+  TEST_ASSERT_NOT_NULL(strstr(json, "\n]}\n"));
+  TEST_ASSERT_NULL(strstr(json, "\"before\""));
+  TEST_ASSERT_NULL(strstr(json, "\"after\""));
+  TEST_ASSERT_NOT_NULL(strstr(json, "\"name\":\"work\",\"ph\":\"B\""));
+  TEST_ASSERT_NOT_NULL(strstr(json, "\"args\":{\"value\":42}"));
+  TEST_ASSERT_NOT_NULL(strstr(json, "\"args\":{\"name\":\"worker\"}"));
+
+  /* Timestamps are monotonic within a thread */
+  begin = strstr(json, "\"name\":\"main\",\"ph\":\"B\"");
+  end = strstr(json, "\"name\":\"main\",\"ph\":\"E\"");
+  TEST_ASSERT_NOT_NULL(begin);
+  TEST_ASSERT_NOT_NULL(end);
+  TEST_ASSERT_TRUE(strtod(strstr(begin, "\"ts\":") + 5, NULL) <=
+                   strtod(strstr(end, "\"ts\":") + 5, NULL));
+}
+
+void
+test_trace_sessions_restart(void)
+{
+  TEST_ASSERT_EQUAL_INT(0, pal_trace_start(path));
+  PAL_TRACE_INSTANT("first");
+  pal_trace_stop();
+
+  TEST_ASSERT_EQUAL_INT(0, pal_trace_start(path));
+  PAL_TRACE_INSTANT("second");
+  pal_trace_stop();
+
+  read_trace();
+  TEST_ASSERT_NULL(strstr(json, "\"first\""));
+  TEST_ASSERT_NOT_NULL(strstr(json, "\"second\""));
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
@@ -0,0 +1,108 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <unity.h>
+
+#include <qwiet/platform/linux/channel.h>
+#include <qwiet/platform/linux/waker.h>
+
+#define PRODUCERS 4
+#define MESSAGES 10000
+
+struct test_msg {
+  int producer;
+  int seq;
+  struct pal_mpsc_node node;
+};
+
+struct test_producer {
+  pal_channel_t *chan;
+  int id;
+  struct test_msg msgs[MESSAGES];
+};
+
+void
+setUp(void)
+{
+}
+
+void
+tearDown(void)
+{
+}
+
+void
+test_waker_coalesces_wakes(void)
+{
+  pal_waker_t waker;
+  pal_waker_init(&waker);
+
+  TEST_ASSERT_EQUAL_INT(0, pal_waker_wait(&waker, PAL_NO_WAIT));
+
+  pal_waker_wake(&waker);
+  pal_waker_wake(&waker);
+  pal_waker_wake(&waker);
+  TEST_ASSERT_EQUAL_INT(1, pal_waker_wait(&waker, PAL_NO_WAIT));
+
+  /* All three wakes are collected by a single drain */
+  TEST_ASSERT_EQUAL_UINT32(3, pal_waker_drain(&waker));
+  TEST_ASSERT_EQUAL_INT(0, pal_waker_wait(&waker, PAL_NO_WAIT));
+  TEST_ASSERT_EQUAL_UINT32(0, pal_waker_drain(&waker));
+
+  pal_waker_cleanup(&waker);
+}
+
+static void *
+producer_main(void *arg)
+{
+  struct test_producer *p = arg;
+  for (int i = 0; i < MESSAGES; i++) {
+    p->msgs[i].producer = p->id;
+    p->msgs[i].seq = i;
+    pal_channel_send(p->chan, &p->msgs[i].node);
+  }
+  return NULL;
+}
+
+void
+test_channel_many_producers(void)
+{
+  static struct test_producer producers[PRODUCERS];
+  pthread_t threads[PRODUCERS];
+  int next[PRODUCERS] = {0};
+  int received = 0;
+  pal_channel_t chan;
+
+  pal_channel_init(&chan);
+  for (int i = 0; i < PRODUCERS; i++) {
+    producers[i].chan = &chan;
+    producers[i].id = i;
+    pthread_create(&threads[i], NULL, producer_main, &producers[i]);
+  }
+
+  while (received < PRODUCERS * MESSAGES) {
+    struct pal_mpsc_node *node;
+    TEST_ASSERT_EQUAL_INT(1, pal_waker_wait(&chan.waker, PAL_SEC(5)));
+    while ((node = pal_channel_recv(&chan))) {
+      struct test_msg *msg = pal_mpsc_entry(node, struct test_msg, node);
+      /* Per-producer FIFO order is preserved */
+      TEST_ASSERT_EQUAL_INT(next[msg->producer], msg->seq);
+      next[msg->producer]++;
+      received++;
+    }
+  }
+
+  for (int i = 0; i < PRODUCERS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  TEST_ASSERT_NULL(pal_channel_recv(&chan));
+  pal_channel_cleanup(&chan);
+}
+
+extern int
+unity_main(void);
+
+int
+main(void)
+{
+  return unity_main();
+}
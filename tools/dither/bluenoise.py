@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Generate the blue-noise threshold map used by platform/common/src/dither.c.
+
+Runs Ulichney's void-and-cluster method on a toroidal grid, so the map tiles
+without seams, and writes the ranks scaled to 0..255 as a C table:
+
+    tools/dither/bluenoise.py > platform/common/src/dither_noise.h
+
+The seed is fixed; the output only changes if the parameters do.
+"""
+
+import argparse
+import math
+import random
+import sys
+
+SIGMA = 1.5
+RADIUS = 6  # exp(-36 / 4.5) is below a 16-bit rank
+
+
+def kernel() -> list[tuple[int, int, float]]:
+    return [
+        (dx, dy, math.exp(-(dx * dx + dy * dy) / (2 * SIGMA * SIGMA)))
+        for dy in range(-RADIUS, RADIUS + 1)
+        for dx in range(-RADIUS, RADIUS + 1)
+    ]
+
+
+class Field:
+    """A binary pattern and the gaussian energy each of its ones radiates."""
+
+    def __init__(self, size: int, ones: list[bool]) -> None:
+        self.size = size
+        self.ones = list(ones)
+        self.energy = [0.0] * (size * size)
+        self.kernel = kernel()
+        for i, one in enumerate(self.ones):
+            if one:
+                self.splat(i, 1.0)
+
+    def splat(self, i: int, sign: float) -> None:
+        n = self.size
+        x, y = i % n, i // n
+        for dx, dy, w in self.kernel:
+            self.energy[(y + dy) % n * n + (x + dx) % n] += sign * w
+
+    def flip(self, i: int) -> None:
+        self.ones[i] = not self.ones[i]
+        self.splat(i, 1.0 if self.ones[i] else -1.0)
+
+    def tightest_cluster(self) -> int:
+        return max((e, i) for i, e in enumerate(self.energy) if self.ones[i])[1]
+
+    def largest_void(self) -> int:
+        return min((e, i) for i, e in enumerate(self.energy) if not self.ones[i])[1]
+
+
+def void_and_cluster(size: int, seed: int) -> list[int]:
+    cells = size * size
+    rng = random.Random(seed)
+    initial = [False] * cells
+    for i in rng.sample(range(cells), cells // 10):
+        initial[i] = True
+
+    # Spread the initial pattern until moving its tightest one no longer helps
+    field = Field(size, initial)
+    while True:
+        cluster = field.tightest_cluster()
+        field.flip(cluster)
+        void = field.largest_void()
+        field.flip(void)
+        if void == cluster:
+            break
+    prototype = field.ones
+    count = sum(prototype)
+    rank = [0] * cells
+
+    # Phase 1: rank the prototype's ones, tightest cluster last
+    field = Field(size, prototype)
+    for r in range(count - 1, -1, -1):
+        i = field.tightest_cluster()
+        field.flip(i)
+        rank[i] = r
+
+    # Phase 2: fill the largest voids up to half
+    field = Field(size, prototype)
+    for r in range(count, cells // 2):
+        i = field.largest_void()
+        field.flip(i)
+        rank[i] = r
+
+    # Phase 3: the zeros are now the minority, rank their tightest clusters
+    field = Field(size, [not one for one in field.ones])
+    for r in range(cells // 2, cells):
+        i = field.tightest_cluster()
+        field.flip(i)
+        rank[i] = r
+
+    return rank
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--size", type=int, default=64)
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    size = args.size
+    rank = void_and_cluster(size, args.seed)
+    out = [
+        "/* Auto-generated by bluenoise.py - DO NOT EDIT */",
+        f"#define DITHER_NOISE_SIZE {size}",
+        "",
+        "static const uint8_t __dither_noise[DITHER_NOISE_SIZE * DITHER_NOISE_SIZE] = {",
+    ]
+    for y in range(size):
+        row = rank[y * size : (y + 1) * size]
+        vals = [r * 256 // (size * size) for r in row]
+        for x in range(0, size, 16):
+            out.append("    " + " ".join(f"{v:3d}," for v in vals[x : x + 16]))
+    out.append("};")
+    sys.stdout.write("\n".join(out) + "\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())